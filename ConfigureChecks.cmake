@@ -95,6 +95,9 @@ check_function_exists("getifaddrs"       HAVE_GETIFADDRS)
 check_function_exists("issetugid"        HAVE_ISSETUGID)
 check_function_exists("setresgid"        HAVE_SETRESGID)
 check_function_exists("setresuid"        HAVE_SETRESUID)
+if(NOT WIN32)
+	check_symbol_exists("mmap"           "sys/mman.h" HAVE_MMAP)
+endif()
 if (APPLE)
 	cmake_push_check_state()
 	set(CMAKE_REQUIRED_LIBRARIES ${APPLE_CORE_FOUNDATION_LIBRARY})
@@ -1076,6 +1076,41 @@ calculate_hashes(const char *filename)
     }
 }
 
+/*
+ * Get the next record, either from the packets found by
+ * wtap_scan_index(), with the information we use filled in, or by
+ * reading it from the file.
+ */
+static wtap_rec *
+next_record(wtap *wth, GArray *index, unsigned *index_pos, wtap_rec *index_rec,
+            wtap_batch *batch, int *err, char **err_info, int64_t *data_offset)
+{
+    const wtap_index_entry *entry;
+
+    if (index == NULL) {
+        if (batch == NULL)
+            return NULL;
+        return wtap_batch_read(wth, batch, err, err_info, data_offset);
+    }
+
+    if (*index_pos >= index->len)
+        return NULL;
+    entry = &g_array_index(index, wtap_index_entry, *index_pos);
+    (*index_pos)++;
+
+    index_rec->rec_type = REC_TYPE_PACKET;
+    index_rec->presence_flags = entry->presence_flags;
+    index_rec->section_number = entry->section_number;
+    index_rec->ts = entry->ts;
+    index_rec->tsprec = entry->tsprec;
+    index_rec->rec_header.packet_header.caplen = entry->caplen;
+    index_rec->rec_header.packet_header.len = entry->len;
+    index_rec->rec_header.packet_header.pkt_encap = entry->pkt_encap;
+    index_rec->rec_header.packet_header.interface_id = entry->interface_id;
+    *data_offset = entry->offset;
+    return index_rec;
+}
+
 static int
 process_cap_file(const char *filename, bool need_separator)
 {
@@ -1089,7 +1124,11 @@ process_cap_file(const char *filename, bool need_separator)
     int64_t               bytes  = 0;
     uint32_t              snaplen_min_inferred = 0xffffffff;
     uint32_t              snaplen_max_inferred =          0;
-    wtap_rec              rec;
+    wtap_rec             *rec;
+    wtap_rec              index_rec;
+    wtap_batch           *batch = NULL;
+    GArray               *index = NULL;
+    unsigned              index_pos = 0;
     capture_info          cf_info;
     bool                  have_times = true;
     nstime_t              earliest_packet_time;
@@ -1155,29 +1194,40 @@ process_cap_file(const char *filename, bool need_separator)
     wtap_set_cb_new_ipv6(cf_info.wth, count_ipv6_address);
     wtap_set_cb_new_secrets(cf_info.wth, count_decryption_secret);
 
-    /* Tally up data that we need to parse through the file to find */
-    wtap_rec_init(&rec, 1514);
-    while (wtap_read(cf_info.wth, &rec, &err, &err_info, &data_offset))  {
-        if (rec.presence_flags & WTAP_HAS_TS) {
+    /*
+     * Tally up data that we need to parse through the file to find.
+     * Unless we need the packet comments, which are only in the
+     * packets themselves, find the packets with a parallel scan if
+     * the file allows it.
+     */
+    err = 0;
+    if (!pkt_comments)
+        wtap_scan_index(cf_info.wth, 0, &index, &err, &err_info);
+    if (index == NULL && err == 0)
+        batch = wtap_batch_new(1514);
+    wtap_rec_init(&index_rec, 0);
+    while ((rec = next_record(cf_info.wth, index, &index_pos, &index_rec, batch,
+                              &err, &err_info, &data_offset)) != NULL)  {
+        if (rec->presence_flags & WTAP_HAS_TS) {
             prev_time = cur_time;
-            cur_time = rec.ts;
+            cur_time = rec->ts;
             if (packet == 0) {
-                earliest_packet_time = rec.ts;
-                earliest_packet_time_tsprec = rec.tsprec;
-                latest_packet_time  = rec.ts;
-                latest_packet_time_tsprec = rec.tsprec;
-                prev_time  = rec.ts;
+                earliest_packet_time = rec->ts;
+                earliest_packet_time_tsprec = rec->tsprec;
+                latest_packet_time  = rec->ts;
+                latest_packet_time_tsprec = rec->tsprec;
+                prev_time  = rec->ts;
             }
             if (nstime_cmp(&cur_time, &prev_time) < 0) {
                 order = NOT_IN_ORDER;
             }
             if (nstime_cmp(&cur_time, &earliest_packet_time) < 0) {
                 earliest_packet_time = cur_time;
-                earliest_packet_time_tsprec = rec.tsprec;
+                earliest_packet_time_tsprec = rec->tsprec;
             }
             if (nstime_cmp(&cur_time, &latest_packet_time) > 0) {
                 latest_packet_time = cur_time;
-                latest_packet_time_tsprec = rec.tsprec;
+                latest_packet_time_tsprec = rec->tsprec;
             }
         } else {
             have_times = false; /* at least one packet has no time stamp */
@@ -1185,13 +1235,13 @@ process_cap_file(const char *filename, bool need_separator)
                 order = ORDER_UNKNOWN;
         }
 
-        if (rec.rec_type == REC_TYPE_PACKET) {
-            bytes += rec.rec_header.packet_header.len;
+        if (rec->rec_type == REC_TYPE_PACKET) {
+            bytes += rec->rec_header.packet_header.len;
             packet++;
             /* packet comments */
-            if (pkt_comments && wtap_block_count_option(rec.block, OPT_COMMENT) > 0) {
+            if (pkt_comments && wtap_block_count_option(rec->block, OPT_COMMENT) > 0) {
               char *cmt_buff;
-              for (i = 0; wtap_block_get_nth_string_option_value(rec.block, OPT_COMMENT, i, &cmt_buff) == WTAP_OPTTYPE_SUCCESS; i++) {
+              for (i = 0; wtap_block_get_nth_string_option_value(rec->block, OPT_COMMENT, i, &cmt_buff) == WTAP_OPTTYPE_SUCCESS; i++) {
                 pc = g_new0(pkt_cmt, 1);
 
                 pc->recno = packet;
@@ -1211,25 +1261,25 @@ process_cap_file(const char *filename, bool need_separator)
             /* 'Limit packet capture length' was done for this rcd. */
             /* Keep track as to the min/max actual snapshot lengths */
             /*  seen for this file.                                 */
-            if (rec.rec_header.packet_header.caplen < rec.rec_header.packet_header.len) {
-                if (rec.rec_header.packet_header.caplen < snaplen_min_inferred)
-                    snaplen_min_inferred = rec.rec_header.packet_header.caplen;
-                if (rec.rec_header.packet_header.caplen > snaplen_max_inferred)
-                    snaplen_max_inferred = rec.rec_header.packet_header.caplen;
+            if (rec->rec_header.packet_header.caplen < rec->rec_header.packet_header.len) {
+                if (rec->rec_header.packet_header.caplen < snaplen_min_inferred)
+                    snaplen_min_inferred = rec->rec_header.packet_header.caplen;
+                if (rec->rec_header.packet_header.caplen > snaplen_max_inferred)
+                    snaplen_max_inferred = rec->rec_header.packet_header.caplen;
             }
 
-            if ((rec.rec_header.packet_header.pkt_encap > 0) &&
-                    (rec.rec_header.packet_header.pkt_encap < WTAP_NUM_ENCAP_TYPES)) {
-                cf_info.encap_counts[rec.rec_header.packet_header.pkt_encap] += 1;
+            if ((rec->rec_header.packet_header.pkt_encap > 0) &&
+                    (rec->rec_header.packet_header.pkt_encap < WTAP_NUM_ENCAP_TYPES)) {
+                cf_info.encap_counts[rec->rec_header.packet_header.pkt_encap] += 1;
             } else {
                 fprintf(stderr, "capinfos: Unknown packet encapsulation %d in frame %u of file \"%s\"\n",
-                        rec.rec_header.packet_header.pkt_encap, packet, filename);
+                        rec->rec_header.packet_header.pkt_encap, packet, filename);
             }
 
             /* Packet interface_id info */
-            if (rec.presence_flags & WTAP_HAS_INTERFACE_ID) {
+            if (rec->presence_flags & WTAP_HAS_INTERFACE_ID) {
                 /* cf_info.num_interfaces is size, not index, so it's one more than max index */
-                if (rec.rec_header.packet_header.interface_id >= cf_info.num_interfaces) {
+                if (rec->rec_header.packet_header.interface_id >= cf_info.num_interfaces) {
                     /*
                      * OK, re-fetch the number of interfaces, as there might have
                      * been an interface that was in the middle of packets, and
@@ -1244,9 +1294,9 @@ process_cap_file(const char *filename, bool need_separator)
                     g_free(idb_info);
                     idb_info = NULL;
                 }
-                if (rec.rec_header.packet_header.interface_id < cf_info.num_interfaces) {
+                if (rec->rec_header.packet_header.interface_id < cf_info.num_interfaces) {
                     g_array_index(cf_info.interface_packet_counts, uint32_t,
-                            rec.rec_header.packet_header.interface_id) += 1;
+                            rec->rec_header.packet_header.interface_id) += 1;
                 }
                 else {
                     cf_info.pkt_interface_id_unknown += 1;
@@ -1263,9 +1313,12 @@ process_cap_file(const char *filename, bool need_separator)
             }
         }
 
-        wtap_rec_reset(&rec);
+        wtap_rec_reset(rec);
     } /* while */
-    wtap_rec_cleanup(&rec);
+    wtap_batch_free(batch);
+    wtap_rec_cleanup(&index_rec);
+    if (index != NULL)
+        g_array_free(index, true);
 
     /*
      * Get IDB info strings.
@@ -535,6 +535,8 @@ print_usage(FILE *output)
     fprintf(output, "  --capture-comment <comment>\n");
     fprintf(output, "                           add a capture comment to the output file\n");
     fprintf(output, "                           (only for pcapng)\n");
+    fprintf(output, "  --compress-chunked       with --compress-type, compress in independent chunks\n");
+    fprintf(output, "                           that can be decompressed in parallel\n");
     fprintf(output, "  --temp-dir <directory>   write temporary files to this directory\n");
     fprintf(output, "                           (default: %s)\n", g_get_tmp_dir());
     fprintf(output, "\n");
@@ -5122,6 +5124,7 @@ gather_dumpcap_runtime_info(feature_list l)
 #ifdef _WIN32
 #define LONGOPT_SIGNAL_PIPE         LONGOPT_BASE_APPLICATION+5
 #endif
+#define LONGOPT_COMPRESS_CHUNKED    LONGOPT_BASE_APPLICATION+6
 
 /* And now our feature presentation... [ fade to music ] */
 int
@@ -5140,6 +5143,7 @@ main(int argc, char *argv[])
 #ifdef _WIN32
         {"signal-pipe", ws_required_argument, NULL, LONGOPT_SIGNAL_PIPE},
 #endif
+        {"compress-chunked", ws_no_argument, NULL, LONGOPT_COMPRESS_CHUNKED},
         {0, 0, 0, 0 }
     };
 
@@ -5537,6 +5541,9 @@ main(int argc, char *argv[])
             }
             g_ptr_array_add(capture_comments, g_strdup(ws_optarg));
             break;
+        case LONGOPT_COMPRESS_CHUNKED:
+            wtap_set_compression_chunk_size(WTAP_COMPRESSION_CHUNK_SIZE);
+            break;
         case 'Z':
             capture_child = true;
             /*
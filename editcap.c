@@ -1019,6 +1019,8 @@ print_usage(FILE *output)
     fprintf(output, "                         when writing the output file.  Does not discard\n");
     fprintf(output, "                         comments added by \"-a\" in the same command line.\n");
     fprintf(output, "  --compress <type>      Compress the output file using the type compression format.\n");
+    fprintf(output, "  --compress-chunked     Compress the output file in independent chunks, so that\n");
+    fprintf(output, "                         it can be decompressed in parallel.\n");
     fprintf(output, "\n");
     fprintf(output, "Miscellaneous:\n");
     fprintf(output, "  -h, --help             display this help and exit.\n");
@@ -1284,21 +1286,22 @@ process_new_idbs(wtap *wth, wtap_dumper *pdh, GArray *idbs_seen,
 static int
 extract_secrets(wtap *wth, char* filename, int *err, char **err_info)
 {
-    wtap_rec                     read_rec;
+    wtap_rec                    *read_rec;
+    wtap_batch                  *batch;
     int64_t       offset;
     char         *fprefix            = NULL;
     char         *fsuffix            = NULL;
 
     /* Read all of the packets in turn */
-    wtap_rec_init(&read_rec, 1514);
-    while (wtap_read(wth, &read_rec, err, err_info, &offset)) {
+    batch = wtap_batch_new(1514);
+    while ((read_rec = wtap_batch_read(wth, batch, err, err_info, &offset)) != NULL) {
         /* Do we want to respect the max packet number on the command line?
          * Probably more confusing than it's worth, because a user might
          * not know if a DSB is at the end of the file.
          */
-        wtap_rec_reset(&read_rec);
+        wtap_rec_reset(read_rec);
     }
-    wtap_rec_cleanup(&read_rec);
+    wtap_batch_free(batch);
 
     wtapng_dsb_mandatory_t *dsb;
     if (strcmp(filename, "-") == 0) {
@@ -1378,6 +1381,7 @@ main(int argc, char *argv[])
 #define LONGOPT_DISCARD_PACKET_COMMENTS LONGOPT_BASE_APPLICATION+9
 #define LONGOPT_EXTRACT_SECRETS         LONGOPT_BASE_APPLICATION+10
 #define LONGOPT_COMPRESS                LONGOPT_BASE_APPLICATION+11
+#define LONGOPT_COMPRESS_CHUNKED        LONGOPT_BASE_APPLICATION+12
 
     static const struct ws_option long_options[] = {
         {"novlan", ws_no_argument, NULL, LONGOPT_NO_VLAN},
@@ -1393,6 +1397,7 @@ main(int argc, char *argv[])
         {"discard-packet-comments", ws_no_argument, NULL, LONGOPT_DISCARD_PACKET_COMMENTS},
         {"extract-secrets", ws_no_argument, NULL, LONGOPT_EXTRACT_SECRETS},
         {"compress", ws_required_argument, NULL, LONGOPT_COMPRESS},
+        {"compress-chunked", ws_no_argument, NULL, LONGOPT_COMPRESS_CHUNKED},
         {0, 0, 0, 0 }
     };
 
@@ -1420,7 +1425,8 @@ main(int argc, char *argv[])
     uint64_t      max_packet_number  = 0;
     GArray       *dsb_types          = NULL;
     GPtrArray    *dsb_filenames      = NULL;
-    wtap_rec                     read_rec;
+    wtap_rec                    *read_rec;
+    wtap_batch                  *batch = NULL;
     wtap_dump_params             params = WTAP_DUMP_PARAMS_INIT;
     char                        *shb_user_appl;
     int                          ret = EXIT_SUCCESS;
@@ -1433,7 +1439,6 @@ main(int argc, char *argv[])
     g_set_prgname("editcap");
 
     cmdarg_err_init(stderr_cmdarg_err, stderr_cmdarg_err_cont);
-    memset(&read_rec, 0, sizeof read_rec);
 
     /* Initialize log handler early so we can have proper logging during startup. */
     ws_log_init(vcmdarg_err);
@@ -1604,6 +1609,10 @@ main(int argc, char *argv[])
             break;
         }
 
+        case LONGOPT_COMPRESS_CHUNKED:
+            wtap_set_compression_chunk_size(WTAP_COMPRESSION_CHUNK_SIZE);
+            break;
+
         case 'a':
         {
             uint64_t frame_number;
@@ -2109,8 +2118,8 @@ main(int argc, char *argv[])
     idbs_seen = g_array_new(FALSE, FALSE, sizeof(wtap_block_t));
 
     /* Read all of the packets in turn */
-    wtap_rec_init(&read_rec, 1514);
-    while (wtap_read(wth, &read_rec, &read_err, &read_err_info, &data_offset)) {
+    batch = wtap_batch_new(1514);
+    while ((read_rec = wtap_batch_read(wth, batch, &read_err, &read_err_info, &data_offset)) != NULL) {
         /*
          * XXX - what about non-packet records in the file after this?
          * NRBs, DSBs, and ISBs are now written when wtap_dump_close() calls
@@ -2126,7 +2135,7 @@ main(int argc, char *argv[])
         if (read_count == 1) {
             if (split_packet_count != 0 || !nstime_is_unset(&secs_per_block)) {
                 filename = fileset_get_filename_by_pattern(block_cnt++,
-                                                           (read_rec.presence_flags & WTAP_HAS_TS) ? &read_rec.ts : NULL,
+                                                           (read_rec->presence_flags & WTAP_HAS_TS) ? &read_rec->ts : NULL,
                                                            fprefix, fsuffix);
             } else {
                 filename = g_strdup(argv[ws_optind+1]);
@@ -2169,19 +2178,26 @@ main(int argc, char *argv[])
             goto clean_exit;
         }
 
-        buf = ws_buffer_start_ptr(&read_rec.data);
+        /*
+         * The data might be in a read-only mapping of the file; if
+         * we're going to change it in place, get a copy of our own.
+         */
+        if (chop.len_begin != 0 || chop.len_end != 0 || set_unused ||
+            rem_vlan || err_prob > 0.0)
+            ws_buffer_make_writable(&read_rec->data);
+        buf = ws_buffer_start_ptr(&read_rec->data);
 
         /*
          * Not all packets have time stamps. Only process the time
          * stamp if we have one.
          */
-        if (read_rec.presence_flags & WTAP_HAS_TS) {
+        if (read_rec->presence_flags & WTAP_HAS_TS) {
             if (!nstime_is_unset(&secs_per_block)) {
                 if (nstime_is_unset(&block_next)) {
-                    block_next = read_rec.ts;
+                    block_next = read_rec->ts;
                     nstime_add(&block_next, &secs_per_block);
                 }
-                while (nstime_cmp(&read_rec.ts, &block_next) > 0) { /* time for the next file */
+                while (nstime_cmp(&read_rec->ts, &block_next) > 0) { /* time for the next file */
 
                     /* We presumably want to write the DSBs from files given
                      * on the command line to every file.
@@ -2234,7 +2250,7 @@ main(int argc, char *argv[])
 
                 g_free(filename);
                 filename = fileset_get_filename_by_pattern(block_cnt++,
-                                                           (read_rec.presence_flags & WTAP_HAS_TS) ? &read_rec.ts : NULL,
+                                                           (read_rec->presence_flags & WTAP_HAS_TS) ? &read_rec->ts : NULL,
                                                            fprefix, fsuffix);
                 ws_assert(filename);
 
@@ -2259,14 +2275,14 @@ main(int argc, char *argv[])
              * Is the packet in the selected timeframe?
              * If the packet has no time stamp, the answer is "no".
              */
-            if (read_rec.presence_flags & WTAP_HAS_TS) {
+            if (read_rec->presence_flags & WTAP_HAS_TS) {
                 if (have_starttime && have_stoptime) {
-                    ts_okay = nstime_cmp(&read_rec.ts, &starttime) >= 0 &&
-                              nstime_cmp(&read_rec.ts, &stoptime) < 0;
+                    ts_okay = nstime_cmp(&read_rec->ts, &starttime) >= 0 &&
+                              nstime_cmp(&read_rec->ts, &stoptime) < 0;
                 } else if (have_starttime) {
-                    ts_okay = nstime_cmp(&read_rec.ts, &starttime) >= 0;
+                    ts_okay = nstime_cmp(&read_rec->ts, &starttime) >= 0;
                 } else if (have_stoptime) {
-                    ts_okay = nstime_cmp(&read_rec.ts, &stoptime) < 0;
+                    ts_okay = nstime_cmp(&read_rec->ts, &stoptime) < 0;
                 }
             }
         } else {
@@ -2284,7 +2300,7 @@ main(int argc, char *argv[])
             if (verbose && !dup_detect && !dup_detect_by_time)
                 fprintf(stderr, "Packet: %" PRIu64 "\n", count);
 
-            if (read_rec.presence_flags & WTAP_HAS_TS) {
+            if (read_rec->presence_flags & WTAP_HAS_TS) {
                 /* Do we adjust timestamps to ensure strict chronological
                  * order? */
                 if (do_strict_time_adjustment) {
@@ -2293,7 +2309,7 @@ main(int argc, char *argv[])
                             nstime_t current;
                             nstime_t delta;
 
-                            current = read_rec.ts;
+                            current = read_rec->ts;
 
                             nstime_delta(&delta, &current, &previous_time);
 
@@ -2306,14 +2322,14 @@ main(int argc, char *argv[])
                                  * chronological order (oldest to newest).
                                  */
                                 /* fprintf(stderr, "++out of order, need to adjust this packet!\n"); */
-                                read_rec.ts.secs = previous_time.secs + strict_time_adj.tv.secs;
-                                read_rec.ts.nsecs = previous_time.nsecs;
-                                if (read_rec.ts.nsecs + strict_time_adj.tv.nsecs >= ONE_BILLION) {
+                                read_rec->ts.secs = previous_time.secs + strict_time_adj.tv.secs;
+                                read_rec->ts.nsecs = previous_time.nsecs;
+                                if (read_rec->ts.nsecs + strict_time_adj.tv.nsecs >= ONE_BILLION) {
                                     /* carry */
-                                    read_rec.ts.secs++;
-                                    read_rec.ts.nsecs += strict_time_adj.tv.nsecs - ONE_BILLION;
+                                    read_rec->ts.secs++;
+                                    read_rec->ts.nsecs += strict_time_adj.tv.nsecs - ONE_BILLION;
                                 } else {
-                                    read_rec.ts.nsecs += strict_time_adj.tv.nsecs;
+                                    read_rec->ts.nsecs += strict_time_adj.tv.nsecs;
                                 }
                             }
                         } else {
@@ -2322,55 +2338,55 @@ main(int argc, char *argv[])
                              * Unconditionally set each timestamp to previous
                              * packet's timestamp plus delta.
                              */
-                            read_rec.ts.secs = previous_time.secs + strict_time_adj.tv.secs;
-                            read_rec.ts.nsecs = previous_time.nsecs;
-                            if (read_rec.ts.nsecs + strict_time_adj.tv.nsecs >= ONE_BILLION) {
+                            read_rec->ts.secs = previous_time.secs + strict_time_adj.tv.secs;
+                            read_rec->ts.nsecs = previous_time.nsecs;
+                            if (read_rec->ts.nsecs + strict_time_adj.tv.nsecs >= ONE_BILLION) {
                                 /* carry */
-                                read_rec.ts.secs++;
-                                read_rec.ts.nsecs += strict_time_adj.tv.nsecs - ONE_BILLION;
+                                read_rec->ts.secs++;
+                                read_rec->ts.nsecs += strict_time_adj.tv.nsecs - ONE_BILLION;
                             } else {
-                                read_rec.ts.nsecs += strict_time_adj.tv.nsecs;
+                                read_rec->ts.nsecs += strict_time_adj.tv.nsecs;
                             }
                         }
                     }
-                    previous_time = read_rec.ts;
+                    previous_time = read_rec->ts;
                 }
 
                 if (time_adj.tv.secs != 0) {
                     if (time_adj.is_negative)
-                        read_rec.ts.secs -= time_adj.tv.secs;
+                        read_rec->ts.secs -= time_adj.tv.secs;
                     else
-                        read_rec.ts.secs += time_adj.tv.secs;
+                        read_rec->ts.secs += time_adj.tv.secs;
                 }
 
                 if (time_adj.tv.nsecs != 0) {
                     if (time_adj.is_negative) { /* subtract */
-                        if (read_rec.ts.nsecs < time_adj.tv.nsecs) { /* borrow */
-                            read_rec.ts.secs--;
-                            read_rec.ts.nsecs += ONE_BILLION;
+                        if (read_rec->ts.nsecs < time_adj.tv.nsecs) { /* borrow */
+                            read_rec->ts.secs--;
+                            read_rec->ts.nsecs += ONE_BILLION;
                         }
-                        read_rec.ts.nsecs -= time_adj.tv.nsecs;
+                        read_rec->ts.nsecs -= time_adj.tv.nsecs;
                     } else {                  /* add */
-                        if (read_rec.ts.nsecs + time_adj.tv.nsecs >= ONE_BILLION) {
+                        if (read_rec->ts.nsecs + time_adj.tv.nsecs >= ONE_BILLION) {
                             /* carry */
-                            read_rec.ts.secs++;
-                            read_rec.ts.nsecs += time_adj.tv.nsecs - ONE_BILLION;
+                            read_rec->ts.secs++;
+                            read_rec->ts.nsecs += time_adj.tv.nsecs - ONE_BILLION;
                         } else {
-                            read_rec.ts.nsecs += time_adj.tv.nsecs;
+                            read_rec->ts.nsecs += time_adj.tv.nsecs;
                         }
                     }
                 }
             } /* time stamp adjustment */
 
-            if (read_rec.rec_type == REC_TYPE_PACKET) {
+            if (read_rec->rec_type == REC_TYPE_PACKET) {
                 if (snaplen != 0) {
                     /* Limit capture length to snaplen */
-                    if (read_rec.rec_header.packet_header.caplen > snaplen) {
-                        read_rec.rec_header.packet_header.caplen = snaplen;
+                    if (read_rec->rec_header.packet_header.caplen > snaplen) {
+                        read_rec->rec_header.packet_header.caplen = snaplen;
                     }
                     /* If -L, also set reported length to snaplen */
-                    if (adjlen && read_rec.rec_header.packet_header.len > snaplen) {
-                        read_rec.rec_header.packet_header.len = snaplen;
+                    if (adjlen && read_rec->rec_header.packet_header.len > snaplen) {
+                        read_rec->rec_header.packet_header.len = snaplen;
                     }
                 }
 
@@ -2379,33 +2395,33 @@ main(int argc, char *argv[])
                  * encapsulation type of the packet.
                  */
                 if (out_frame_type != -2) {
-                    read_rec.rec_header.packet_header.pkt_encap = out_frame_type;
+                    read_rec->rec_header.packet_header.pkt_encap = out_frame_type;
                 }
 
                 /*
                  * CHOP
                  */
-                handle_chopping(chop, &read_rec.rec_header.packet_header,
+                handle_chopping(chop, &read_rec->rec_header.packet_header,
                                 &buf, adjlen);
 
                 /* set unused info */
                 if (set_unused) {
                     /* set unused bytes to zero so that duplicates check ignores unused bytes */
-                    set_unused_info(&read_rec.rec_header.packet_header, buf);
+                    set_unused_info(&read_rec->rec_header.packet_header, buf);
                 }
 
                 /* remove vlan info */
                 if (rem_vlan) {
-                    remove_vlan_info(&read_rec.rec_header.packet_header, buf);
+                    remove_vlan_info(&read_rec->rec_header.packet_header, buf);
                 }
 
                 /* suppress duplicates by packet window */
                 if (dup_detect) {
-                    if (is_duplicate(buf, read_rec.rec_header.packet_header.caplen)) {
+                    if (is_duplicate(buf, read_rec->rec_header.packet_header.caplen)) {
                         if (verbose) {
                             fprintf(stderr, "Skipped: %" PRIu64 ", Len: %u, MD5 Hash: ",
                                     count,
-                                    read_rec.rec_header.packet_header.caplen);
+                                    read_rec->rec_header.packet_header.caplen);
                             for (i = 0; i < 16; i++)
                                 fprintf(stderr, "%02x",
                                         (unsigned char)fd_hash[cur_dup_entry].digest[i]);
@@ -2418,7 +2434,7 @@ main(int argc, char *argv[])
                         if (verbose) {
                             fprintf(stderr, "Packet: %" PRIu64 ", Len: %u, MD5 Hash: ",
                                     count,
-                                    read_rec.rec_header.packet_header.caplen);
+                                    read_rec->rec_header.packet_header.caplen);
                             for (i = 0; i < 16; i++)
                                 fprintf(stderr, "%02x",
                                         (unsigned char)fd_hash[cur_dup_entry].digest[i]);
@@ -2427,21 +2443,21 @@ main(int argc, char *argv[])
                     }
                 } /* suppression of duplicates */
 
-                if (read_rec.presence_flags & WTAP_HAS_TS) {
+                if (read_rec->presence_flags & WTAP_HAS_TS) {
                     /* suppress duplicates by time window */
                     if (dup_detect_by_time) {
                         nstime_t current;
 
-                        current.secs  = read_rec.ts.secs;
-                        current.nsecs = read_rec.ts.nsecs;
+                        current.secs  = read_rec->ts.secs;
+                        current.nsecs = read_rec->ts.nsecs;
 
                         if (is_duplicate_rel_time(buf,
-                                                  read_rec.rec_header.packet_header.caplen,
+                                                  read_rec->rec_header.packet_header.caplen,
                                                   &current)) {
                             if (verbose) {
                                 fprintf(stderr, "Skipped: %" PRIu64 ", Len: %u, MD5 Hash: ",
                                         count,
-                                        read_rec.rec_header.packet_header.caplen);
+                                        read_rec->rec_header.packet_header.caplen);
                                 for (i = 0; i < 16; i++)
                                     fprintf(stderr, "%02x",
                                             (unsigned char)fd_hash[cur_dup_entry].digest[i]);
@@ -2454,7 +2470,7 @@ main(int argc, char *argv[])
                             if (verbose) {
                                 fprintf(stderr, "Packet: %" PRIu64 ", Len: %u, MD5 Hash: ",
                                         count,
-                                        read_rec.rec_header.packet_header.caplen);
+                                        read_rec->rec_header.packet_header.caplen);
                                 for (i = 0; i < 16; i++)
                                     fprintf(stderr, "%02x",
                                             (unsigned char)fd_hash[cur_dup_entry].digest[i]);
@@ -2467,13 +2483,13 @@ main(int argc, char *argv[])
 
             /* Random error mutation */
             if (err_prob > 0.0) {
-                mutate_packet_data(&read_rec, buf, change_offset, count);
+                mutate_packet_data(read_rec, buf, change_offset, count);
             } /* random error mutation */
 
             /* Discard all packet comments when writing */
             if (discard_pkt_comments) {
-                while (WTAP_OPTTYPE_SUCCESS == wtap_block_remove_nth_option_instance(read_rec.block, OPT_COMMENT, 0)) {
-                    read_rec.block_was_modified = true;
+                while (WTAP_OPTTYPE_SUCCESS == wtap_block_remove_nth_option_instance(read_rec->block, OPT_COMMENT, 0)) {
+                    read_rec->block_was_modified = true;
                 }
             }
 
@@ -2483,15 +2499,19 @@ main(int argc, char *argv[])
                     (const char*)g_tree_lookup(frames_user_comments, &read_count);
                 if (comment != NULL) {
                     /* Erase any existing comments before adding the new one */
-                    while (WTAP_OPTTYPE_SUCCESS == wtap_block_remove_nth_option_instance(read_rec.block, OPT_COMMENT, 0)) {
-                        read_rec.block_was_modified = true;
+                    while (WTAP_OPTTYPE_SUCCESS == wtap_block_remove_nth_option_instance(read_rec->block, OPT_COMMENT, 0)) {
+                        read_rec->block_was_modified = true;
                     }
 
+                    /* Packets with no options are read without a block. */
+                    if (read_rec->block == NULL)
+                        read_rec->block = wtap_block_create(WTAP_BLOCK_PACKET);
+
                     /* The comment is not modified by dumper, cast away. */
-                    wtap_block_add_string_option(read_rec.block, OPT_COMMENT, (char *)comment, strlen((char *)comment));
-                    read_rec.block_was_modified = true;
+                    wtap_block_add_string_option(read_rec->block, OPT_COMMENT, (char *)comment, strlen((char *)comment));
+                    read_rec->block_was_modified = true;
                 } else {
-                    read_rec.block_was_modified = false;
+                    read_rec->block_was_modified = false;
                 }
             }
 
@@ -2504,7 +2524,7 @@ main(int argc, char *argv[])
             }
 
             /* Attempt to dump out current frame to the output file */
-            if (!wtap_dump(pdh, &read_rec, buf, &write_err, &write_err_info)) {
+            if (!wtap_dump(pdh, read_rec, buf, &write_err, &write_err_info)) {
                 cfile_write_failure_message(argv[ws_optind], filename,
                                             write_err, write_err_info,
                                             read_count,
@@ -2522,9 +2542,10 @@ main(int argc, char *argv[])
             written_count++;
         }
         count++;
-        wtap_rec_reset(&read_rec);
+        wtap_rec_reset(read_rec);
     }
-    wtap_rec_cleanup(&read_rec);
+    wtap_batch_free(batch);
+    batch = NULL;
 
     if (verbose)
         fprintf(stderr, "Total selected: %" PRIu64 "\n", written_count);
@@ -2614,7 +2635,7 @@ clean_exit:
     wtap_dump_params_cleanup(&params);
     if (wth != NULL)
         wtap_close(wth);
-    wtap_rec_reset(&read_rec);
+    wtap_batch_free(batch);
     wtap_cleanup();
     free_progdirs();
     if (capture_comments != NULL) {
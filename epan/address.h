@@ -136,6 +136,7 @@ set_address_tvb(address *addr, int addr_type, int addr_len, tvbuff_t *tvb, int o
         /* Must not be AT_NONE - AT_NONE must have no data */
         ws_assert(addr_type != AT_NONE);
         p = tvb_get_ptr(tvb, offset, addr_len);
+        tvb_set_address_ref(tvb);
     } else
         p = NULL;
     set_address(addr, addr_type, addr_len, p);
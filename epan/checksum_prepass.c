@@ -0,0 +1,319 @@
+/* checksum_prepass.c
+ * Validation of the checksums of batches of records ahead of dissection
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib.h>
+
+#include "checksum_prepass.h"
+#include "prefs.h"
+#include "prefs-int.h"
+#include "etypes.h"
+#include "ipproto.h"
+
+#include <wsutil/crc32.h>
+#include <wsutil/pint.h>
+#include <wsutil/ws_ones_sum.h>
+
+/*
+ * Each thread helping the calling one gets at least this much data, as
+ * waking it up costs about as much as summing a few KiB.  This is sized
+ * to what one batch holds: WTAP_BATCH_SIZE full-size Ethernet frames are
+ * about 96 KiB, and get two helpers; records read from a pipe come one
+ * at a time, and are validated by the calling thread.
+ */
+#define PREPASS_THREAD_MIN_BYTES	(32 * 1024)
+
+typedef struct {
+	const wtap_rec	*recs;
+	uint8_t		*results;
+	unsigned	 count;
+	unsigned	 wanted;
+	int		 next;		/* next record to validate */
+	int		 running;	/* pool threads still working on the batch */
+	GMutex		 lock;
+	GCond		 done;
+} prepass_batch_t;
+
+static unsigned prepass_threads = 1;
+static GThreadPool *prepass_pool;
+
+static bool
+prepass_pref_enabled(const char *module_name, const char *pref_name)
+{
+	module_t *module = prefs_find_module(module_name);
+	pref_t *pref;
+
+	if (module == NULL)
+		return false;
+	pref = prefs_find_preference(module, pref_name);
+	return pref != NULL && prefs_get_bool_value(pref, pref_current);
+}
+
+unsigned
+checksum_prepass_wanted(void)
+{
+	unsigned wanted = 0;
+
+	if (prepass_pref_enabled("ip", "check_checksum"))
+		wanted |= CKSUM_PREPASS_IP;
+	if (prepass_pref_enabled("tcp", "check_checksum"))
+		wanted |= CKSUM_PREPASS_TCP;
+	if (prepass_pref_enabled("udp", "check_checksum"))
+		wanted |= CKSUM_PREPASS_UDP;
+	if (prepass_pref_enabled("eth", "check_fcs"))
+		wanted |= CKSUM_PREPASS_FCS;
+	return wanted;
+}
+
+/*
+ * Returns whether the TCP or UDP checksum of a segment or datagram is
+ * good, computing it as the dissectors do: over a pseudo-header made of
+ * the addresses followed by the protocol and length as two 16-bit words
+ * for IPv4, or as two 32-bit words for IPv6, then the data.
+ */
+static bool
+prepass_l4_good(const uint8_t *addrs, unsigned addr_len, unsigned proto,
+		const uint8_t *data, unsigned len)
+{
+	uint8_t phdr[40];
+	unsigned phdr_len = addr_len * 2;
+	uint32_t sum;
+
+	memcpy(phdr, addrs, phdr_len);
+	if (addr_len == 4) {
+		phton32(phdr + phdr_len, (proto << 16) | len);
+		phdr_len += 4;
+	} else {
+		phton32(phdr + phdr_len, len);
+		phton32(phdr + phdr_len + 4, proto);
+		phdr_len += 8;
+	}
+
+	/* Both parts have an even length, so their sums can just be added. */
+	sum = ws_ones_sum16(phdr, phdr_len) + ws_ones_sum16(data, len);
+	sum = (sum & 0xffff) + (sum >> 16);
+	return sum == 0xffff;
+}
+
+static uint8_t
+prepass_check_ip(const uint8_t *pd, unsigned caplen, unsigned offset, unsigned wanted)
+{
+	const uint8_t *addrs, *l4;
+	unsigned version, hlen, total_len, addr_len, proto, l4_len;
+	uint8_t good = 0;
+
+	if (caplen - offset < 20)
+		return 0;
+	version = pd[offset] >> 4;
+	if (version == 4) {
+		hlen = (pd[offset] & 0x0f) * 4;
+		if (hlen < 20 || caplen - offset < hlen)
+			return 0;
+		/* The sum of a header with a good checksum is -0. */
+		if ((wanted & CKSUM_PREPASS_IP) && ws_ones_sum16(pd + offset, hlen) == 0xffff)
+			good |= CKSUM_PREPASS_IP;
+
+		/*
+		 * With options, the dissectors might use another
+		 * destination address, e.g. from a source route; fragments
+		 * are checksummed once reassembled, if at all.  A total
+		 * length of 0 is taken to be a TSO packet.
+		 */
+		total_len = pntoh16(pd + offset + 2);
+		if (hlen != 20 || total_len <= hlen || caplen - offset < total_len ||
+		    (pntoh16(pd + offset + 6) & 0x3fff) != 0)
+			return good;
+		proto = pd[offset + 9];
+		addrs = pd + offset + 12;
+		addr_len = 4;
+		l4 = pd + offset + hlen;
+		l4_len = total_len - hlen;
+	} else if (version == 6) {
+		/* A payload length of 0 is a jumbogram. */
+		l4_len = pntoh16(pd + offset + 4);
+		if (caplen - offset < 40 || l4_len == 0 || caplen - offset - 40 < l4_len)
+			return 0;
+		proto = pd[offset + 6];
+		addrs = pd + offset + 8;
+		addr_len = 16;
+		l4 = pd + offset + 40;
+	} else {
+		return 0;
+	}
+
+	if (proto == IP_PROTO_TCP && (wanted & CKSUM_PREPASS_TCP) && l4_len >= 20) {
+		/* The TCP dissector has a warning of its own for -0. */
+		if (pntoh16(l4 + 16) != 0xffff && prepass_l4_good(addrs, addr_len, proto, l4, l4_len))
+			good |= CKSUM_PREPASS_TCP;
+	} else if (proto == IP_PROTO_UDP && (wanted & CKSUM_PREPASS_UDP) && l4_len >= 8) {
+		/* A checksum of 0 means there's none. */
+		if (pntoh16(l4 + 4) == l4_len && pntoh16(l4 + 6) != 0 &&
+		    prepass_l4_good(addrs, addr_len, proto, l4, l4_len))
+			good |= CKSUM_PREPASS_UDP;
+	}
+	return good;
+}
+
+static uint8_t
+prepass_check_record(const wtap_rec *rec, unsigned wanted)
+{
+	const uint8_t *pd;
+	unsigned caplen, offset;
+	unsigned etype;
+	uint8_t good = 0;
+
+	if (rec->rec_type != REC_TYPE_PACKET)
+		return 0;
+	pd = ws_buffer_start_ptr(&rec->data);
+	caplen = rec->rec_header.packet_header.caplen;
+
+	switch (rec->rec_header.packet_header.pkt_encap) {
+
+	case WTAP_ENCAP_ETHERNET:
+		if (caplen < 14)
+			return 0;
+		/* Only if we know there's an FCS, and have all of the frame */
+		if ((wanted & CKSUM_PREPASS_FCS) &&
+		    rec->rec_header.packet_header.pseudo_header.eth.fcs_len == 4 &&
+		    caplen == rec->rec_header.packet_header.len && caplen >= 18 &&
+		    crc32_ccitt(pd, caplen - 4) == pletoh32(pd + caplen - 4))
+			good |= CKSUM_PREPASS_FCS;
+		offset = 14;
+		etype = pntoh16(pd + 12);
+		while ((etype == ETHERTYPE_VLAN || etype == ETHERTYPE_IEEE_802_1AD) && caplen - offset >= 4) {
+			etype = pntoh16(pd + offset + 2);
+			offset += 4;
+		}
+		break;
+
+	case WTAP_ENCAP_SLL:
+		if (caplen < 16)
+			return 0;
+		offset = 16;
+		etype = pntoh16(pd + 14);
+		break;
+
+	case WTAP_ENCAP_SLL2:
+		if (caplen < 20)
+			return 0;
+		offset = 20;
+		etype = pntoh16(pd);
+		break;
+
+	case WTAP_ENCAP_RAW_IP:
+	case WTAP_ENCAP_RAW_IP4:
+	case WTAP_ENCAP_RAW_IP6:
+		return prepass_check_ip(pd, caplen, 0, wanted);
+
+	default:
+		return 0;
+	}
+
+	if (etype == ETHERTYPE_IP || etype == ETHERTYPE_IPv6)
+		good |= prepass_check_ip(pd, caplen, offset, wanted);
+	return good;
+}
+
+static void
+prepass_work(prepass_batch_t *batch)
+{
+	unsigned i;
+
+	while ((i = (unsigned)g_atomic_int_add(&batch->next, 1)) < batch->count)
+		batch->results[i] = prepass_check_record(&batch->recs[i], batch->wanted);
+}
+
+static void
+prepass_worker(void *data, void *user_data _U_)
+{
+	prepass_batch_t *batch = (prepass_batch_t *)data;
+
+	prepass_work(batch);
+	g_mutex_lock(&batch->lock);
+	if (--batch->running == 0)
+		g_cond_signal(&batch->done);
+	g_mutex_unlock(&batch->lock);
+}
+
+void
+checksum_prepass_run(const wtap_rec *recs, unsigned count, uint8_t *results)
+{
+	prepass_batch_t batch;
+	size_t bytes = 0;
+	unsigned helpers, i;
+
+	memset(results, 0, count);
+	batch.wanted = checksum_prepass_wanted();
+	if (batch.wanted == 0)
+		return;
+	batch.recs = recs;
+	batch.results = results;
+	batch.count = count;
+	batch.next = 0;
+
+	for (i = 0; i < count; i++) {
+		if (recs[i].rec_type == REC_TYPE_PACKET)
+			bytes += recs[i].rec_header.packet_header.caplen;
+	}
+	helpers = MIN(prepass_threads - 1, (unsigned)(bytes / PREPASS_THREAD_MIN_BYTES));
+	if (helpers == 0) {
+		prepass_work(&batch);
+		return;
+	}
+
+	if (prepass_pool == NULL)
+		prepass_pool = g_thread_pool_new(prepass_worker, NULL, prepass_threads - 1, false, NULL);
+	g_mutex_init(&batch.lock);
+	g_cond_init(&batch.done);
+	batch.running = helpers;
+	for (i = 0; i < helpers; i++)
+		g_thread_pool_push(prepass_pool, &batch, NULL);
+	prepass_work(&batch);
+
+	/* The batch is on our stack, so wait for the helpers to let go of it. */
+	g_mutex_lock(&batch.lock);
+	while (batch.running != 0)
+		g_cond_wait(&batch.done, &batch.lock);
+	g_mutex_unlock(&batch.lock);
+	g_cond_clear(&batch.done);
+	g_mutex_clear(&batch.lock);
+}
+
+void
+checksum_prepass_set_threads(unsigned threads)
+{
+	if (prepass_pool != NULL) {
+		g_thread_pool_free(prepass_pool, false, true);
+		prepass_pool = NULL;
+	}
+	prepass_threads = MAX(threads, 1);
+}
+
+void
+checksum_prepass_cleanup(void)
+{
+	checksum_prepass_set_threads(1);
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
@@ -0,0 +1,84 @@
+/** @file
+ *
+ * Validation of the checksums of batches of records ahead of dissection
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __CHECKSUM_PREPASS_H__
+#define __CHECKSUM_PREPASS_H__
+
+#include <wiretap/wtap.h>
+#include <epan/packet_info.h>
+#include "ws_symbol_export.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+ * When checksum validation is enabled, a program reading a capture file
+ * can validate the checksums of the records it reads ahead of dissecting
+ * them, with several threads, and store the results in the frames'
+ * frame_data.  The dissectors then don't compute the checksums that were
+ * found to be good.  They still compute the ones that weren't, so that
+ * they can report what's wrong exactly as before.
+ *
+ * Only simple cases are handled: the outermost IPv4 header, and the TCP
+ * segment or UDP datagram right after it or right after an IPv6 header
+ * without extension headers, in unfragmented packets on Ethernet (with or
+ * without VLAN tags), Linux cooked or raw IP links, and the FCS of
+ * Ethernet frames that are known to have one.
+ */
+
+/** Flags of frame_data.cksum_good */
+#define CKSUM_PREPASS_IP	0x1	/**< The IPv4 header checksum */
+#define CKSUM_PREPASS_TCP	0x2	/**< The TCP checksum */
+#define CKSUM_PREPASS_UDP	0x4	/**< The UDP checksum */
+#define CKSUM_PREPASS_FCS	0x8	/**< The Ethernet FCS */
+
+/**
+ * Returns the CKSUM_PREPASS_ flags of the checksums that the dissectors
+ * are set to validate, or 0 if they validate none and there's no point in
+ * running checksum_prepass_run().
+ */
+WS_DLL_PUBLIC unsigned
+checksum_prepass_wanted(void);
+
+/**
+ * Validates the checksums of count records, with up to the number of
+ * threads set with checksum_prepass_set_threads() if there's enough data,
+ * and sets results[i] to the CKSUM_PREPASS_ flags of the checksums of
+ * recs[i] that were found to be good.
+ */
+WS_DLL_PUBLIC void
+checksum_prepass_run(const wtap_rec *recs, unsigned count, uint8_t *results);
+
+/** Sets the maximum number of threads used by checksum_prepass_run(). */
+WS_DLL_PUBLIC void
+checksum_prepass_set_threads(unsigned threads);
+
+/**
+ * Returns whether the checksum pre-pass found a checksum of the frame
+ * being dissected to be good.  The flags are about the outermost headers,
+ * so this is false in the other layers of the protocol.
+ */
+static inline bool
+checksum_prepass_good(const packet_info *pinfo, unsigned check)
+{
+	return (pinfo->fd->cksum_good & check) && pinfo->curr_proto_layer_num == 1 &&
+	    !pinfo->flags.in_error_pkt;
+}
+
+/* Called by the epan library when it's cleaned up. */
+void checksum_prepass_cleanup(void);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __CHECKSUM_PREPASS_H__ */
@@ -160,6 +160,24 @@ static wmem_map_t *conversation_hashtable_deinterlacer = NULL;
 
 static uint32_t new_index;
 
+/*
+ * Conversation expiry: the frame number and time stamp at each call to
+ * conversation_expire(), oldest first, so that we can tell which frame
+ * numbers are at least a given time old.
+ */
+typedef struct {
+    uint32_t frame;
+    nstime_t ts;
+} expiry_mark_t;
+
+static GArray *expiry_marks;
+
+/* Protocol ID to conversation_expire_func */
+static GHashTable *expire_routines;
+
+static uint64_t conversations_expired;
+static uint64_t conversation_bytes_reclaimed;
+
 /*
  * Placeholder for address-less conversations.
  */
@@ -701,6 +719,11 @@ conversation_epan_reset(void)
      * Start the conversation indices over at 0.
      */
     new_index = 0;
+
+    conversations_expired = 0;
+    conversation_bytes_reclaimed = 0;
+    if (expiry_marks != NULL)
+        g_array_set_size(expiry_marks, 0);
 }
 
 /*
@@ -792,6 +815,9 @@ conversation_remove_from_hashtable(wmem_map_t *hashtable, conversation_t *conv)
             else
                 chain_head->latest_found = conv->latest_found;
 
+            /* Re-insert under the new head's key, so the map doesn't
+             * keep pointing to ours, which might be freed. */
+            wmem_map_steal(hashtable, conv->key_ptr);
             wmem_map_insert(hashtable, chain_head->key_ptr, chain_head);
         }
     }
@@ -848,7 +874,7 @@ conversation_t *conversation_new_full(const uint32_t setup_frame, conversation_e
 
     conversation_t *conversation = wmem_new0(wmem_file_scope(), conversation_t);
     conversation->conv_index = new_index;
-    conversation->setup_frame = conversation->last_frame = setup_frame;
+    conversation->setup_frame = conversation->last_frame = conversation->last_active = setup_frame;
 
     new_index++;
 
@@ -1040,7 +1066,7 @@ conversation_new(const uint32_t setup_frame, const address *addr1, const address
     conversation = wmem_new0(wmem_file_scope(), conversation_t);
 
     conversation->conv_index = new_index;
-    conversation->setup_frame = conversation->last_frame = setup_frame;
+    conversation->setup_frame = conversation->last_frame = conversation->last_active = setup_frame;
 
     /* set the options and key pointer */
     conversation->options = options;
@@ -1085,7 +1111,7 @@ conversation_new_by_id(const uint32_t setup_frame, const conversation_type ctype
 {
     conversation_t *conversation = wmem_new0(wmem_file_scope(), conversation_t);
     conversation->conv_index = new_index;
-    conversation->setup_frame = conversation->last_frame = setup_frame;
+    conversation->setup_frame = conversation->last_frame = conversation->last_active = setup_frame;
 
     new_index++;
 
@@ -1107,7 +1133,7 @@ conversation_new_deinterlacer(const uint32_t setup_frame, const address *addr1,
 
     conversation_t *conversation = wmem_new0(wmem_file_scope(), conversation_t);
     conversation->conv_index = new_index;
-    conversation->setup_frame = conversation->last_frame = setup_frame;
+    conversation->setup_frame = conversation->last_frame = conversation->last_active = setup_frame;
 
     conversation_element_t *new_key = wmem_alloc(wmem_file_scope(), sizeof(conversation_element_t) * (DEINTR_ENDP_IDX+1));
 
@@ -1155,7 +1181,7 @@ conversation_new_deinterlaced(const uint32_t setup_frame, const address *addr1,
 
     conversation_t *conversation = wmem_new0(wmem_file_scope(), conversation_t);
     conversation->conv_index = new_index;
-    conversation->setup_frame = conversation->last_frame = setup_frame;
+    conversation->setup_frame = conversation->last_frame = conversation->last_active = setup_frame;
 
     if (options & NO_PORTS) {
         conversation_element_t *new_key = wmem_alloc(wmem_file_scope(), sizeof(conversation_element_t) * (DEINTD_ENDP_NO_PORTS_IDX+2));
@@ -1353,6 +1379,8 @@ static conversation_t *conversation_lookup_hashtable(wmem_map_t *conversation_ha
 
     if (match) {
         chain_head->latest_found = match;
+        if (frame_num > match->last_active)
+            match->last_active = frame_num;
     }
 
     return match;
@@ -2470,6 +2498,150 @@ conversation_get_id_from_elements(struct _packet_info *pinfo, conversation_type
     return pinfo->conv_elements[0].uint_val;
 }
 
+void
+conversation_set_closed(conversation_t *conv)
+{
+    conv->closed = true;
+}
+
+void
+conversation_register_expire_routine(const int proto, conversation_expire_func func)
+{
+    if (expire_routines == NULL)
+        expire_routines = g_hash_table_new(g_direct_hash, g_direct_equal);
+    g_hash_table_insert(expire_routines, GINT_TO_POINTER(proto), (void *)func);
+}
+
+/*
+ * Return the newest frame number marked at least timeout seconds before
+ * now, or 0 if there isn't one.
+ */
+static uint32_t
+expiry_cutoff(const nstime_t *now, unsigned timeout)
+{
+    uint32_t frame = 0;
+
+    for (unsigned i = 0; i < expiry_marks->len; i++) {
+        expiry_mark_t *mark = &g_array_index(expiry_marks, expiry_mark_t, i);
+
+        if (now->secs - mark->ts.secs < (time_t)timeout)
+            break;
+        frame = mark->frame;
+    }
+    return frame;
+}
+
+typedef struct {
+    uint32_t idle_cutoff;
+    uint32_t closed_cutoff;
+    wmem_map_t *hashtable;      /* the table being scanned */
+    GPtrArray *expired;         /* pairs of hash table and conversation */
+} expire_scan_t;
+
+static void
+expire_scan_chain(void *key _U_, void *value, void *user_data)
+{
+    expire_scan_t *scan = (expire_scan_t *)user_data;
+
+    for (conversation_t *conv = (conversation_t *)value; conv != NULL; conv = conv->next) {
+        if (conv->last_active < (conv->closed ? scan->closed_cutoff : scan->idle_cutoff)) {
+            g_ptr_array_add(scan->expired, scan->hashtable);
+            g_ptr_array_add(scan->expired, conv);
+        }
+    }
+}
+
+static void
+expire_scan_table(void *key _U_, void *value, void *user_data)
+{
+    expire_scan_t *scan = (expire_scan_t *)user_data;
+
+    scan->hashtable = (wmem_map_t *)value;
+    wmem_map_foreach(scan->hashtable, expire_scan_chain, scan);
+}
+
+static bool
+expire_proto_data(const void *key, void *value, void *user_data)
+{
+    conversation_t *conv = (conversation_t *)user_data;
+    conversation_expire_func func;
+
+    func = (conversation_expire_func)g_hash_table_lookup(expire_routines, key);
+    if (func != NULL && value != NULL)
+        conversation_bytes_reclaimed += func(conv, value);
+    return false;
+}
+
+/*
+ * Free the protocol data of a conversation that's been removed from its
+ * hash table, for the protocols that have an expire routine.
+ *
+ * The conversation itself, and its key, are left allocated until the
+ * file scope is freed.  Dissectors hold on to conversation pointers,
+ * and some use them as keys in tables of their own (e.g., DCE RPC's
+ * bind and call tables); if we freed the conversation, a new one could
+ * be allocated at the same address and pick up the old one's state.
+ */
+static void
+conversation_free_data(conversation_t *conv)
+{
+    if (conv->data_list != NULL) {
+        if (expire_routines != NULL)
+            wmem_tree_foreach(conv->data_list, expire_proto_data, conv);
+        wmem_tree_destroy(conv->data_list, false, false);
+        conv->data_list = NULL;
+    }
+    /* The dissector tree may be shared with conversations created from
+     * a template, so leave it to the file scope. */
+}
+
+unsigned
+conversation_expire(uint32_t frame_num, const nstime_t *now,
+    unsigned idle_timeout, unsigned closed_timeout, uint32_t *frame_cutoff)
+{
+    expire_scan_t scan;
+    expiry_mark_t mark;
+    unsigned count;
+
+    if (expiry_marks == NULL)
+        expiry_marks = g_array_new(false, false, sizeof(expiry_mark_t));
+
+    /* Mark where we are, and forget marks we won't need any more. */
+    mark.frame = frame_num;
+    mark.ts = *now;
+    g_array_append_val(expiry_marks, mark);
+    scan.idle_cutoff = expiry_cutoff(now, MAX(idle_timeout, closed_timeout));
+    scan.closed_cutoff = expiry_cutoff(now, closed_timeout);
+    while (expiry_marks->len > 1 &&
+           g_array_index(expiry_marks, expiry_mark_t, 1).frame <= scan.idle_cutoff)
+        g_array_remove_index(expiry_marks, 0);
+    *frame_cutoff = scan.idle_cutoff;
+    if (scan.closed_cutoff == 0)
+        return 0;
+
+    /* Find the expired conversations, then remove and free them. */
+    scan.expired = g_ptr_array_new();
+    wmem_map_foreach(conversation_hashtable_element_list, expire_scan_table, &scan);
+    for (unsigned i = 0; i < scan.expired->len; i += 2) {
+        conversation_t *conv = (conversation_t *)g_ptr_array_index(scan.expired, i + 1);
+
+        conversation_remove_from_hashtable((wmem_map_t *)g_ptr_array_index(scan.expired, i), conv);
+        conversation_free_data(conv);
+    }
+    count = scan.expired->len / 2;
+    g_ptr_array_free(scan.expired, true);
+    conversations_expired += count;
+    return count;
+}
+
+void
+conversation_get_stats(conversation_stats_t *stats)
+{
+    stats->live = (uint32_t)(new_index - conversations_expired);
+    stats->expired = conversations_expired;
+    stats->reclaimed_bytes = conversation_bytes_reclaimed;
+}
+
 wmem_map_t *
 get_conversation_hashtables(void)
 {
@@ -233,6 +233,8 @@ typedef struct conversation {
     wmem_tree_t *dissector_tree;	/** tree containing protocol dissector client associated with conversation */
     unsigned	options;		/** wildcard flags */
     conversation_element_t *key_ptr;	/** Keys are conversation element arrays terminated with a CE_CONVERSATION_TYPE */
+    uint32_t last_active;		/** highest frame number for which this conversation was looked up */
+    bool	closed;			/** a protocol has seen this conversation end; see conversation_set_closed() */
 } conversation_t;
 
 /*
@@ -559,6 +561,69 @@ WS_DLL_PUBLIC void conversation_set_port2(conversation_t *conv, const uint32_t p
  */
 WS_DLL_PUBLIC void conversation_set_addr2(conversation_t *conv, const address *addr);
 
+/**
+ * Note that a protocol has seen the conversation end, e.g. with a TCP
+ * RST or FINs in both directions, so that conversation_expire() can
+ * expire it after closed_timeout rather than idle_timeout.
+ * @param conv Conversation.
+ */
+WS_DLL_PUBLIC void conversation_set_closed(conversation_t *conv);
+
+/**
+ * Function called for a protocol's data when a conversation is expired.
+ * It should free proto_data and anything only it refers to, and return
+ * the number of bytes freed.
+ */
+typedef size_t (*conversation_expire_func)(conversation_t *conv, void *proto_data);
+
+/**
+ * Register a function to free a protocol's conversation data when a
+ * conversation is expired.  Data of protocols that don't register one
+ * is just dropped along with the conversation; it isn't freed until the
+ * file scope is.
+ * @param proto Protocol ID.
+ * @param func The function.
+ */
+WS_DLL_PUBLIC void conversation_register_expire_routine(const int proto, conversation_expire_func func);
+
+/**
+ * Expire conversations that have been idle for idle_timeout seconds, or,
+ * if they've been closed, for closed_timeout seconds; they're removed from
+ * the conversation tables, so a later packet with the same addresses and
+ * ports gets a new conversation, and the data of protocols that registered
+ * an expire routine (currently TCP and UDP) is freed.  The data of other
+ * protocols, the conversation_t itself and its key stay allocated until
+ * the file scope is freed, so a pointer to a conversation never refers to
+ * a newer one.
+ *
+ * This is only safe when dissecting in a single pass, as frames from
+ * before the expiry won't be dissected again, and should be called between
+ * frames, every few seconds of capture time.  Idle time is measured from
+ * the calls, so conversations are expired up to one call interval late.
+ *
+ * @param frame_num The number of the last frame dissected.
+ * @param now Its time stamp.
+ * @param idle_timeout Idle time in seconds after which to expire a conversation.
+ * @param closed_timeout Idle time in seconds after which to expire a closed conversation.
+ * @param[out] frame_cutoff Set to the number of a frame at least idle_timeout
+ *   seconds old, or 0 if there isn't one yet; anything not referred to since
+ *   before that frame can be expired too.
+ * @return The number of conversations expired.
+ */
+WS_DLL_PUBLIC unsigned conversation_expire(uint32_t frame_num, const nstime_t *now,
+    unsigned idle_timeout, unsigned closed_timeout, uint32_t *frame_cutoff);
+
+/**
+ * Conversation counters, since the last file was opened.
+ */
+typedef struct {
+    uint32_t live;              /**< conversations in the conversation tables */
+    uint64_t expired;           /**< conversations expired */
+    uint64_t reclaimed_bytes;   /**< bytes freed by expiring them */
+} conversation_stats_t;
+
+WS_DLL_PUBLIC void conversation_get_stats(conversation_stats_t *stats);
+
 /**
  * @brief Get a hash table of conversation hash table.
  *
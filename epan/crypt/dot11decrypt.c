@@ -13,10 +13,13 @@
 /* Keep this first after config.h so that WS_LOG_DOMAIN is set correctly. */
 #include "dot11decrypt_debug.h"
 
+#include <errno.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <glib.h>
 
 #include <wsutil/wsgcrypt.h>
+#include <wsutil/file_util.h>
 #include <wsutil/crc32.h>
 #include <wsutil/pint.h>
 
@@ -149,6 +152,23 @@ static int Dot11DecryptRsnaPwd2Psk(
     unsigned char *output)
     ;
 
+/**
+ * Calculates the PSKs of several passphrases, using several threads if
+ * more than one of them isn't in the PSK cache.
+ * @param pwds [IN] the passphrases and SSIDs
+ * @param psks [OUT] the calculated PSKs
+ * @param n [IN] the number of passphrases
+ */
+static void Dot11DecryptRsnaPwd2PskMany(
+    const struct DOT11DECRYPT_KEY_ITEMDATA_PWD **pwds,
+    unsigned char **psks,
+    const unsigned n)
+    ;
+
+static void Dot11DecryptPrederiveWildcardPsks(
+    PDOT11DECRYPT_CONTEXT ctx)
+    ;
+
 static int Dot11DecryptRsnaMng(
     unsigned char *decrypt_data,
     unsigned mac_header_len,
@@ -1058,6 +1078,9 @@ int Dot11DecryptSetKeys(
 {
     int i;
     int success;
+    const struct DOT11DECRYPT_KEY_ITEMDATA_PWD *pwds[DOT11DECRYPT_MAX_KEYS_NR];
+    unsigned char *psks[DOT11DECRYPT_MAX_KEYS_NR];
+    unsigned pwds_nr;
 
     if (ctx==NULL || keys==NULL) {
         ws_warning("NULL context or NULL keys array");
@@ -1075,15 +1098,22 @@ int Dot11DecryptSetKeys(
     /* check and insert keys */
     for (i=0, success=0; i<(int)keys_nr; i++) {
         if (Dot11DecryptValidateKey(keys+i)==true) {
-            if (keys[i].KeyType==DOT11DECRYPT_KEY_TYPE_WPA_PWD) {
-                Dot11DecryptRsnaPwd2Psk(&keys[i].UserPwd, keys[i].KeyData.Wpa.Psk);
-                keys[i].KeyData.Wpa.PskLen = DOT11DECRYPT_WPA_PWD_PSK_LEN;
-            }
             memcpy(&ctx->keys[success], &keys[i], sizeof(keys[i]));
             success++;
         }
     }
 
+    /* derive the PSKs of the passphrases, which can take a while */
+    for (i=0, pwds_nr=0; i<success; i++) {
+        if (ctx->keys[i].KeyType==DOT11DECRYPT_KEY_TYPE_WPA_PWD) {
+            pwds[pwds_nr] = &ctx->keys[i].UserPwd;
+            psks[pwds_nr] = ctx->keys[i].KeyData.Wpa.Psk;
+            ctx->keys[i].KeyData.Wpa.PskLen = DOT11DECRYPT_WPA_PWD_PSK_LEN;
+            pwds_nr++;
+        }
+    }
+    Dot11DecryptRsnaPwd2PskMany(pwds, psks, pwds_nr);
+
     ctx->keys_nr=success;
     return success;
 }
@@ -1668,6 +1698,10 @@ Dot11DecryptRsna4WHandshake(
         uint8_t ptk[DOT11DECRYPT_WPA_PTK_MAX_LEN];
         size_t ptk_len = 0;
 
+        if (!useCache) {
+            Dot11DecryptPrederiveWildcardPsks(ctx);
+        }
+
         /* now you can derive the PTK */
         for (key_index=0; key_index<(int)ctx->keys_nr || useCache; key_index++) {
             /* use the cached one, or try all keys */
@@ -1877,6 +1911,10 @@ Dot11DecryptScanFtAssocForKeys(
     uint8_t ptk[DOT11DECRYPT_WPA_PTK_MAX_LEN];
     size_t ptk_len;
 
+    if (!useCache) {
+        Dot11DecryptPrederiveWildcardPsks(ctx);
+    }
+
     /* now you can derive the PTK */
     for (key_index = 0; key_index < ctx->keys_nr || useCache; key_index++) {
         /* use the cached one, or try all keys */
@@ -2710,14 +2748,242 @@ Dot11DecryptRsnaPwd2PskStep(
     return DOT11DECRYPT_RET_SUCCESS;
 }
 
+/*
+ * Cache of the PSKs derived from passphrases, shared by all the contexts,
+ * so that a passphrase is only derived once for each SSID, rather than
+ * every time the keys are set or a handshake with a wildcard SSID is seen.
+ * The entries are identified by an HMAC of the passphrase and SSID, so that
+ * the cache can be saved without the passphrases.  The HMAC key is random,
+ * and saved with the cache, so that the IDs in one cache can't be checked
+ * against a table of IDs precomputed for likely passphrases.
+ */
+#define DOT11DECRYPT_PSK_CACHE_ID_LEN   32
+#define DOT11DECRYPT_PSK_CACHE_KEY_LEN  32
+
+typedef struct {
+    uint8_t id[DOT11DECRYPT_PSK_CACHE_ID_LEN];
+    uint8_t psk[DOT11DECRYPT_WPA_PWD_PSK_LEN];
+} DOT11DECRYPT_PSK_CACHE_ENTRY;
+
+static GHashTable *psk_cache;
+static GMutex psk_cache_mutex;
+static bool psk_cache_dirty;
+static uint8_t psk_cache_key[DOT11DECRYPT_PSK_CACHE_KEY_LEN];
+static bool psk_cache_have_key;
+
+/* Must be called with psk_cache_mutex held. */
+static void
+Dot11DecryptPskCacheInitKey(void)
+{
+    if (!psk_cache_have_key) {
+        gcry_randomize(psk_cache_key, sizeof(psk_cache_key), GCRY_STRONG_RANDOM);
+        psk_cache_have_key = true;
+    }
+}
+
+static unsigned
+Dot11DecryptPskCacheHash(const void *key)
+{
+    const DOT11DECRYPT_PSK_CACHE_ENTRY *entry = (const DOT11DECRYPT_PSK_CACHE_ENTRY *)key;
+
+    /* The ID is already a hash. */
+    return pntoh32(entry->id);
+}
+
+static gboolean
+Dot11DecryptPskCacheEqual(const void *key1, const void *key2)
+{
+    return memcmp(key1, key2, DOT11DECRYPT_PSK_CACHE_ID_LEN) == 0;
+}
+
+static void
+Dot11DecryptPskCacheId(
+    const struct DOT11DECRYPT_KEY_ITEMDATA_PWD *userPwd,
+    uint8_t *id)
+{
+    uint8_t buf[1 + DOT11DECRYPT_WPA_PASSPHRASE_MAX_LEN + DOT11DECRYPT_WPA_SSID_MAX_LEN];
+    uint8_t key[DOT11DECRYPT_PSK_CACHE_KEY_LEN];
+    size_t len = 0;
+
+    g_mutex_lock(&psk_cache_mutex);
+    Dot11DecryptPskCacheInitKey();
+    memcpy(key, psk_cache_key, sizeof(key));
+    g_mutex_unlock(&psk_cache_mutex);
+
+    buf[len++] = (uint8_t)userPwd->PassphraseLen;
+    memcpy(buf + len, userPwd->Passphrase, userPwd->PassphraseLen);
+    len += userPwd->PassphraseLen;
+    memcpy(buf + len, userPwd->Ssid, userPwd->SsidLen);
+    len += userPwd->SsidLen;
+    ws_hmac_buffer(GCRY_MD_SHA256, id, buf, len, key, sizeof(key));
+}
+
+static bool
+Dot11DecryptPskCacheLookup(const uint8_t *id, unsigned char *psk)
+{
+    DOT11DECRYPT_PSK_CACHE_ENTRY *entry = NULL;
+
+    g_mutex_lock(&psk_cache_mutex);
+    if (psk_cache) {
+        entry = (DOT11DECRYPT_PSK_CACHE_ENTRY *)g_hash_table_lookup(psk_cache, id);
+        if (entry) {
+            memcpy(psk, entry->psk, DOT11DECRYPT_WPA_PWD_PSK_LEN);
+        }
+    }
+    g_mutex_unlock(&psk_cache_mutex);
+    return entry != NULL;
+}
+
+static void
+Dot11DecryptPskCacheInsert(const uint8_t *id, const unsigned char *psk, bool dirty)
+{
+    DOT11DECRYPT_PSK_CACHE_ENTRY *entry = g_new(DOT11DECRYPT_PSK_CACHE_ENTRY, 1);
+
+    memcpy(entry->id, id, DOT11DECRYPT_PSK_CACHE_ID_LEN);
+    memcpy(entry->psk, psk, DOT11DECRYPT_WPA_PWD_PSK_LEN);
+    g_mutex_lock(&psk_cache_mutex);
+    if (!psk_cache) {
+        psk_cache = g_hash_table_new_full(Dot11DecryptPskCacheHash, Dot11DecryptPskCacheEqual,
+                                          g_free, NULL);
+    }
+    g_hash_table_add(psk_cache, entry);
+    psk_cache_dirty |= dirty;
+    g_mutex_unlock(&psk_cache_mutex);
+}
+
+static bool
+Dot11DecryptPskCacheParseHex(const char *hex, uint8_t *bytes, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        int hi = g_ascii_xdigit_value(hex[2 * i]);
+        int lo = hi < 0 ? -1 : g_ascii_xdigit_value(hex[2 * i + 1]);
+
+        if (lo < 0) {
+            return false;
+        }
+        bytes[i] = (uint8_t)(hi << 4 | lo);
+    }
+    return true;
+}
+
+#define DOT11DECRYPT_PSK_CACHE_KEY_PREFIX "key "
+
+void
+Dot11DecryptLoadPskCache(const char *path)
+{
+    char line[2 * DOT11DECRYPT_PSK_CACHE_ID_LEN + 1 + 2 * DOT11DECRYPT_WPA_PWD_PSK_LEN + 3];
+    uint8_t key[DOT11DECRYPT_PSK_CACHE_KEY_LEN];
+    uint8_t id[DOT11DECRYPT_PSK_CACHE_ID_LEN];
+    uint8_t psk[DOT11DECRYPT_WPA_PWD_PSK_LEN];
+    FILE *fp;
+
+    fp = ws_fopen(path, "r");
+    if (!fp) {
+        return;
+    }
+    /* The first line is the HMAC key; a file without one (e.g., from an
+     * older version, with unkeyed IDs) is removed. */
+    if (!fgets(line, sizeof(line), fp) ||
+        strncmp(line, DOT11DECRYPT_PSK_CACHE_KEY_PREFIX, strlen(DOT11DECRYPT_PSK_CACHE_KEY_PREFIX)) != 0 ||
+        strlen(line) < strlen(DOT11DECRYPT_PSK_CACHE_KEY_PREFIX) + 2 * sizeof(key) ||
+        !Dot11DecryptPskCacheParseHex(line + strlen(DOT11DECRYPT_PSK_CACHE_KEY_PREFIX), key, sizeof(key))) {
+        fclose(fp);
+        ws_unlink(path);
+        return;
+    }
+    g_mutex_lock(&psk_cache_mutex);
+    if (psk_cache_have_key && memcmp(key, psk_cache_key, sizeof(key)) != 0 && psk_cache) {
+        /* What we have was derived with another key; derive it again. */
+        g_hash_table_remove_all(psk_cache);
+    }
+    memcpy(psk_cache_key, key, sizeof(key));
+    psk_cache_have_key = true;
+    g_mutex_unlock(&psk_cache_mutex);
+
+    /* Each other line is the hex ID and PSK, separated by a space. */
+    while (fgets(line, sizeof(line), fp)) {
+        if (strlen(line) < sizeof(line) - 3 ||
+            line[2 * DOT11DECRYPT_PSK_CACHE_ID_LEN] != ' ' ||
+            !Dot11DecryptPskCacheParseHex(line, id, sizeof(id)) ||
+            !Dot11DecryptPskCacheParseHex(line + 2 * DOT11DECRYPT_PSK_CACHE_ID_LEN + 1, psk, sizeof(psk))) {
+            continue;
+        }
+        Dot11DecryptPskCacheInsert(id, psk, false);
+    }
+    fclose(fp);
+    ws_debug("Loaded the PSK cache from %s", path);
+}
+
+bool
+Dot11DecryptSavePskCache(const char *path)
+{
+    GHashTableIter iter;
+    void *key;
+    FILE *fp = NULL;
+    int fd;
+    bool ok = true;
+
+    g_mutex_lock(&psk_cache_mutex);
+    if (!psk_cache || !psk_cache_dirty) {
+        g_mutex_unlock(&psk_cache_mutex);
+        return true;
+    }
+    /* The PSKs are as good as the passphrases; only the user may read them. */
+    fd = ws_open(path, O_WRONLY|O_CREAT|O_TRUNC, 0600);
+    if (fd != -1) {
+        fp = ws_fdopen(fd, "w");
+        if (!fp) {
+            ws_close(fd);
+        }
+    }
+    if (!fp) {
+        g_mutex_unlock(&psk_cache_mutex);
+        ws_debug("Can't save the PSK cache to %s: %s", path, g_strerror(errno));
+        return false;
+    }
+    Dot11DecryptPskCacheInitKey();
+    ok = fputs(DOT11DECRYPT_PSK_CACHE_KEY_PREFIX, fp) != EOF;
+    for (unsigned i = 0; ok && i < sizeof(psk_cache_key); i++) {
+        ok = fprintf(fp, "%02x", psk_cache_key[i]) > 0;
+    }
+    ok = ok && fputc('\n', fp) != EOF;
+    g_hash_table_iter_init(&iter, psk_cache);
+    while (ok && g_hash_table_iter_next(&iter, &key, NULL)) {
+        const DOT11DECRYPT_PSK_CACHE_ENTRY *entry = (const DOT11DECRYPT_PSK_CACHE_ENTRY *)key;
+        unsigned i;
+
+        for (i = 0; ok && i < sizeof(entry->id); i++) {
+            ok = fprintf(fp, "%02x", entry->id[i]) > 0;
+        }
+        ok = ok && fputc(' ', fp) != EOF;
+        for (i = 0; ok && i < sizeof(entry->psk); i++) {
+            ok = fprintf(fp, "%02x", entry->psk[i]) > 0;
+        }
+        ok = ok && fputc('\n', fp) != EOF;
+    }
+    ok = (fclose(fp) == 0) && ok;
+    if (ok) {
+        psk_cache_dirty = false;
+    }
+    g_mutex_unlock(&psk_cache_mutex);
+    return ok;
+}
+
 static int
 Dot11DecryptRsnaPwd2Psk(
     const struct DOT11DECRYPT_KEY_ITEMDATA_PWD *userPwd,
     unsigned char *output)
 {
     unsigned char m_output[40] = { 0 };
-    GByteArray *pp_ba = g_byte_array_new();
+    uint8_t id[DOT11DECRYPT_PSK_CACHE_ID_LEN];
+    GByteArray *pp_ba;
 
+    Dot11DecryptPskCacheId(userPwd, id);
+    if (Dot11DecryptPskCacheLookup(id, output)) {
+        return 0;
+    }
+
+    pp_ba = g_byte_array_new();
     g_byte_array_append(pp_ba, userPwd->Passphrase, (unsigned)userPwd->PassphraseLen);
 
     Dot11DecryptRsnaPwd2PskStep(pp_ba->data, pp_ba->len, userPwd->Ssid, userPwd->SsidLen, 4096, 1, m_output);
@@ -2726,9 +2992,101 @@ Dot11DecryptRsnaPwd2Psk(
     memcpy(output, m_output, DOT11DECRYPT_WPA_PWD_PSK_LEN);
     g_byte_array_free(pp_ba, true);
 
+    Dot11DecryptPskCacheInsert(id, output, true);
     return 0;
 }
 
+typedef struct {
+    const struct DOT11DECRYPT_KEY_ITEMDATA_PWD **pwds;
+    unsigned char **psks;
+    unsigned n;
+    int next;
+} DOT11DECRYPT_PWD2PSK_JOB;
+
+static void *
+Dot11DecryptRsnaPwd2PskWorker(void *data)
+{
+    DOT11DECRYPT_PWD2PSK_JOB *job = (DOT11DECRYPT_PWD2PSK_JOB *)data;
+    unsigned i;
+
+    while ((i = (unsigned)g_atomic_int_add(&job->next, 1)) < job->n) {
+        Dot11DecryptRsnaPwd2Psk(job->pwds[i], job->psks[i]);
+    }
+    return NULL;
+}
+
+static void
+Dot11DecryptRsnaPwd2PskMany(
+    const struct DOT11DECRYPT_KEY_ITEMDATA_PWD **pwds,
+    unsigned char **psks,
+    const unsigned n)
+{
+    DOT11DECRYPT_PWD2PSK_JOB job = { pwds, psks, n, 0 };
+    uint8_t id[DOT11DECRYPT_PSK_CACHE_ID_LEN];
+    GThread **workers;
+    unsigned missing = 0, threads, i;
+
+    for (i = 0; i < n; i++) {
+        Dot11DecryptPskCacheId(pwds[i], id);
+        if (!Dot11DecryptPskCacheLookup(id, psks[i])) {
+            missing++;
+        }
+    }
+
+    /* Each derivation is long enough to be worth a thread. */
+    threads = MIN(missing, (unsigned)g_get_num_processors());
+    if (threads <= 1) {
+        Dot11DecryptRsnaPwd2PskWorker(&job);
+        return;
+    }
+    workers = g_new(GThread *, threads - 1);
+    for (i = 0; i < threads - 1; i++) {
+        workers[i] = g_thread_new("dot11decrypt_pwd2psk", Dot11DecryptRsnaPwd2PskWorker, &job);
+    }
+    Dot11DecryptRsnaPwd2PskWorker(&job);
+    for (i = 0; i < threads - 1; i++) {
+        g_thread_join(workers[i]);
+    }
+    g_free(workers);
+}
+
+/*
+ * Derives the PSKs of the passphrases with a wildcard SSID for the SSID
+ * of the packet, in parallel, so that the keys loop finds them in the cache.
+ */
+static void
+Dot11DecryptPrederiveWildcardPsks(
+    PDOT11DECRYPT_CONTEXT ctx)
+{
+    struct DOT11DECRYPT_KEY_ITEMDATA_PWD *pwds;
+    const struct DOT11DECRYPT_KEY_ITEMDATA_PWD **pwd_ptrs;
+    unsigned char *psks;
+    unsigned char **psk_ptrs;
+    unsigned n = 0;
+
+    pwds = g_new(struct DOT11DECRYPT_KEY_ITEMDATA_PWD, ctx->keys_nr);
+    pwd_ptrs = g_new(const struct DOT11DECRYPT_KEY_ITEMDATA_PWD *, ctx->keys_nr);
+    psks = (unsigned char *)g_malloc(ctx->keys_nr * DOT11DECRYPT_WPA_PWD_PSK_LEN);
+    psk_ptrs = g_new(unsigned char *, ctx->keys_nr);
+    for (size_t i = 0; i < ctx->keys_nr; i++) {
+        if (Dot11DecryptIsPwdWildcardSsid(ctx, &ctx->keys[i])) {
+            pwds[n] = ctx->keys[i].UserPwd;
+            memcpy(pwds[n].Ssid, ctx->pkt_ssid, ctx->pkt_ssid_len);
+            pwds[n].SsidLen = ctx->pkt_ssid_len;
+            pwd_ptrs[n] = &pwds[n];
+            psk_ptrs[n] = psks + n * DOT11DECRYPT_WPA_PWD_PSK_LEN;
+            n++;
+        }
+    }
+    if (n > 1) {
+        Dot11DecryptRsnaPwd2PskMany(pwd_ptrs, psk_ptrs, n);
+    }
+    g_free(psk_ptrs);
+    g_free(psks);
+    g_free(pwd_ptrs);
+    g_free(pwds);
+}
+
 /*
  * Returns the decryption_key_t struct given a string describing the key.
  * Returns NULL if the input_string cannot be parsed.
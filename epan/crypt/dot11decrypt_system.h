@@ -404,6 +404,27 @@ extern int Dot11DecryptSetKeys(
 	const size_t keys_nr)
 	;
 
+/**
+ * Loads PSKs derived from passphrases, saved by Dot11DecryptSavePskCache,
+ * into the PSK cache, which is shared by all the contexts.
+ * @param path [IN] the file to load
+ */
+extern void Dot11DecryptLoadPskCache(
+	const char *path)
+	;
+
+/**
+ * Saves the PSK cache, if PSKs were derived since it was loaded or saved.
+ * The file has the PSKs, which are as good as the passphrases for
+ * decrypting traffic, but not the passphrases; it's only readable by the
+ * user.
+ * @param path [IN] the file to write
+ * @return false if the file could not be written.
+ */
+extern bool Dot11DecryptSavePskCache(
+	const char *path)
+	;
+
 /**
  * Sets the "last seen" SSID.  This allows us to pick up previous
  * SSIDs and use them when "wildcard" passphrases are specified
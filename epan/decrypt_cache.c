@@ -0,0 +1,137 @@
+/* decrypt_cache.c
+ * Cache of decrypted data, shared by the dissectors that decrypt
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+#define WS_LOG_DOMAIN LOG_DOMAIN_EPAN
+
+#include <string.h>
+
+#include <glib.h>
+
+#include "decrypt_cache.h"
+#include "lru_cache.h"
+#include "prefs.h"
+
+#include <wsutil/wslog.h>
+
+typedef struct {
+	int		proto;
+	uint32_t	frame_num;
+	unsigned	record;
+} decrypt_cache_key_t;
+
+static lru_cache_t *cache;
+
+static unsigned
+decrypt_cache_key_hash(const void *k)
+{
+	const decrypt_cache_key_t *key = (const decrypt_cache_key_t *)k;
+
+	return (key->frame_num * 31 + key->record) * 31 + (unsigned)key->proto;
+}
+
+static gboolean
+decrypt_cache_key_equal(const void *k1, const void *k2)
+{
+	const decrypt_cache_key_t *key1 = (const decrypt_cache_key_t *)k1;
+	const decrypt_cache_key_t *key2 = (const decrypt_cache_key_t *)k2;
+
+	return key1->frame_num == key2->frame_num &&
+	    key1->record == key2->record &&
+	    key1->proto == key2->proto;
+}
+
+size_t
+decrypt_cache_limit(void)
+{
+	return (size_t)prefs.decrypted_memory_limit * 1024 * 1024;
+}
+
+void
+decrypt_cache_add(const int proto, const uint32_t frame_num, const unsigned record,
+		  const void *data, const unsigned length)
+{
+	size_t limit = decrypt_cache_limit();
+	decrypt_cache_key_t key = { proto, frame_num, record };
+
+	if (cache == NULL || limit == 0)
+		return;
+	lru_cache_add(cache, &key, data, length, limit);
+}
+
+uint8_t *
+decrypt_cache_lookup(wmem_allocator_t *scope, const int proto, const uint32_t frame_num,
+		     const unsigned record, unsigned *length)
+{
+	const uint8_t *data;
+	decrypt_cache_key_t key = { proto, frame_num, record };
+
+	if (cache == NULL || decrypt_cache_limit() == 0)
+		return NULL;
+
+	data = lru_cache_lookup(cache, &key, length);
+	if (data == NULL)
+		return NULL;
+	return (uint8_t *)wmem_memdup(scope, data, *length);
+}
+
+bool
+decrypt_cache_contains(const int proto, const uint32_t frame_num, const unsigned record)
+{
+	decrypt_cache_key_t key = { proto, frame_num, record };
+
+	return cache != NULL && lru_cache_contains(cache, &key);
+}
+
+void
+decrypt_cache_get_stats(decrypt_cache_stats_t *stats)
+{
+	if (cache == NULL) {
+		memset(stats, 0, sizeof(*stats));
+		return;
+	}
+	lru_cache_get_stats(cache, stats);
+}
+
+void
+decrypt_cache_init(void)
+{
+	cache = lru_cache_new(decrypt_cache_key_hash, decrypt_cache_key_equal,
+	    sizeof(decrypt_cache_key_t));
+}
+
+void
+decrypt_cache_cleanup(void)
+{
+	decrypt_cache_stats_t stats;
+
+	decrypt_cache_get_stats(&stats);
+	if (stats.hits || stats.misses) {
+		ws_info("decrypted data cache: %" PRIu64 " hits, %" PRIu64 " misses, "
+		    "%" PRIu64 " additions, %" PRIu64 " evictions",
+		    stats.hits, stats.misses, stats.additions, stats.evictions);
+	}
+
+	lru_cache_free(cache);
+	cache = NULL;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
@@ -0,0 +1,84 @@
+/** @file
+ *
+ * Cache of decrypted data, shared by the dissectors that decrypt
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __DECRYPT_CACHE_H__
+#define __DECRYPT_CACHE_H__
+
+#include <wsutil/wmem/wmem.h>
+#include <epan/lru_cache.h>
+#include "ws_symbol_export.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+ * The decrypted data of records (packets, PDUs, ...) is kept in a cache
+ * whose size is limited by the protocols.decrypted_memory_limit
+ * preference, so that dissecting a packet again doesn't decrypt it again.
+ * Entries are identified by the protocol, the frame number and the index
+ * of the record in the frame, and kept in an lru_cache_t.
+ *
+ * If the preference is 0, the cache is disabled: nothing is added, and
+ * lookups always fail.  Dissectors that have no other way to get the data
+ * then decrypt it again.
+ */
+
+/** Counters of the cache, since the capture file was opened */
+typedef lru_cache_stats_t decrypt_cache_stats_t;
+
+/**
+ * Returns the maximum size of the data in the cache, in bytes, or 0 if the
+ * cache is disabled.
+ */
+WS_DLL_PUBLIC size_t
+decrypt_cache_limit(void);
+
+/**
+ * Adds a copy of the decrypted data of a record to the cache, replacing
+ * what was there for it, and drops the least recently used entries beyond
+ * the limit.  Does nothing if the cache is disabled or if the data is
+ * bigger than the whole cache.
+ */
+WS_DLL_PUBLIC void
+decrypt_cache_add(const int proto, const uint32_t frame_num, const unsigned record,
+		  const void *data, const unsigned length);
+
+/**
+ * Looks up the decrypted data of a record.  On a hit, returns a copy of it
+ * allocated in scope (which can be pinfo->pool, so that the data stays
+ * valid for the dissection even if the entry is dropped) and sets *length.
+ * Returns NULL on a miss.
+ */
+WS_DLL_PUBLIC uint8_t *
+decrypt_cache_lookup(wmem_allocator_t *scope, const int proto, const uint32_t frame_num,
+		     const unsigned record, unsigned *length);
+
+/**
+ * Returns whether the decrypted data of a record is in the cache, without
+ * counting it as a hit or a miss nor making it the most recently used.
+ */
+WS_DLL_PUBLIC bool
+decrypt_cache_contains(const int proto, const uint32_t frame_num, const unsigned record);
+
+/** Gets the counters of the cache. */
+WS_DLL_PUBLIC void
+decrypt_cache_get_stats(decrypt_cache_stats_t *stats);
+
+/* Called by the epan library when dissection is initialized and cleaned up. */
+void decrypt_cache_init(void);
+void decrypt_cache_cleanup(void);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __DECRYPT_CACHE_H__ */
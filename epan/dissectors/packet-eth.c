@@ -38,6 +38,7 @@
 #include "packet-acdr.h"
 #include "packet-mctp.h"
 #include <epan/crc32-tvb.h>
+#include <epan/checksum_prepass.h>
 #include <wiretap/erf_record.h>
 
 void proto_register_eth(void);
@@ -943,7 +944,14 @@ add_ethernet_trailer(packet_info *pinfo, proto_tree *tree, proto_tree *fh_tree,
        * should have set fcs_len to zero in the ethertype_data struct.
        * XXX: Maybe add an expert info saying why we aren't checking the FCS? */
       if (eth_check_fcs && payload_offset == ETH_HEADER_SIZE) {
-        uint32_t fcs = crc32_802_tvb(tvb, tvb_captured_length(tvb) - 4);
+        uint32_t fcs;
+
+        /* The checksum pre-pass checks the FCS of the whole frame. */
+        if (checksum_prepass_good(pinfo, CKSUM_PREPASS_FCS) && tvb_raw_offset(tvb) == 0 &&
+            tvb_captured_length(tvb) == pinfo->fd->cap_len)
+          fcs = sent_fcs;
+        else
+          fcs = crc32_802_tvb(tvb, tvb_captured_length(tvb) - 4);
         proto_tree_add_checksum(fh_tree, trailer_tvb, padding_length+trailer_length, hf_eth_fcs, hf_eth_fcs_status, &ei_eth_fcs_bad, pinfo, fcs, ENC_BIG_ENDIAN, PROTO_CHECKSUM_VERIFY);
 
         if (fcs != sent_fcs) {
@@ -152,8 +152,8 @@ typedef struct {
 
 /* Cached decompressed header data in one packet_info */
 typedef struct {
-    /* list of pointer to wmem_array_t, which is array of
-       http2_header_t */
+    /* list of pointer to http2_header_block_t, one per header block
+       fragment in the packet */
     wmem_list_t *header_list;
     /* This points to the list frame containing current decompressed
        header for dissecting later. */
@@ -179,6 +179,54 @@ typedef struct {
 #ifdef HAVE_NGHTTP2
 typedef uint64_t http2_frame_num_t;
 
+/* HPACK state of one direction of a session, kept to decompress header
+   blocks again when their headers were dropped from the header cache. */
+typedef struct {
+    /* http2_header_block_t pointers, in the order they were decompressed */
+    wmem_array_t *blocks;
+    /* dynamic table size changes applied from SETTINGS (uint32_t), in order */
+    wmem_array_t *table_size_changes;
+    /* http2_hpack_snapshot_t pointers, by increasing block index */
+    wmem_array_t *snapshots;
+    /* last SETTINGS_HEADER_TABLE_SIZE applied */
+    uint32_t settings_table_size;
+    /* true if the inflater is between two header blocks */
+    bool at_block_boundary;
+} http2_hpack_flow_t;
+
+/* Dynamic table of an inflater before decompressing a header block
+   fragment, from which the following ones can be decompressed again. */
+typedef struct {
+    /* index of the header block fragment in http2_hpack_flow_t.blocks */
+    unsigned block_index;
+    /* number of http2_hpack_flow_t.table_size_changes applied */
+    unsigned table_size_changes;
+    uint32_t settings_table_size;
+    /* HPACK representations of a table size update and of the entries,
+       oldest first, which rebuild the dynamic table */
+    uint8_t *table;
+    unsigned table_len;
+} http2_hpack_snapshot_t;
+
+/* A header block fragment (payload of HEADERS, PUSH_PROMISE or
+   CONTINUATION) and its decompressed headers. */
+typedef struct {
+    /* wmem_array_t of http2_header_t, or NULL if dropped from the header
+       cache */
+    wmem_array_t *headers;
+    /* The rest is only used if the headers are in the header cache, i.e. if
+       the header_cache_limit preference was set when decompressing it. */
+    http2_hpack_flow_t *flow;
+    unsigned index;
+    /* number of flow->table_size_changes applied before decompressing it */
+    unsigned table_size_changes;
+    uint8_t *compressed;
+    unsigned compressed_len;
+    bool final;
+    size_t headers_size;
+    GList link;
+} http2_header_block_t;
+
 /* struct for per-stream, per-direction DATA frame reassembly */
 typedef struct {
     http2_frame_num_t data_initiated_in;
@@ -259,6 +307,7 @@ typedef struct {
 #ifdef HAVE_NGHTTP2
     nghttp2_hd_inflater *hd_inflater[2];
     http2_header_repr_info_t header_repr_info[2];
+    http2_hpack_flow_t hpack_flow[2];
     wmem_map_t *per_stream_info;
     bool        fix_dynamic_table[2];
 #endif
@@ -560,6 +609,21 @@ static const fragment_items http2_body_fragment_items = {
 static wmem_map_t *http2_hdrcache_map;
 /* Header name_length + name + value_length + value */
 static char *http2_header_pstr;
+
+/* With sessions that have many streams, the decompressed headers of all the
+   packets take a lot of memory.  If header_cache_limit is set, they're kept
+   in a cache of that many kilobytes instead, and the header blocks whose
+   headers were dropped are decompressed again when needed, from the nearest
+   snapshot of the HPACK dynamic table that precedes them. */
+static unsigned http2_header_cache_limit;   /* in KB, 0 to keep all the headers */
+/* http2_header_block_t whose headers are in the cache, least recently used first */
+static GQueue http2_header_cache = G_QUEUE_INIT;
+static size_t http2_header_cache_size;
+
+/* Snapshot the dynamic table at most every this many header block fragments */
+#define HTTP2_HPACK_SNAPSHOT_INTERVAL   64
+#define HTTP2_HPACK_STATIC_TABLE_LENGTH 61
+#define HTTP2_DEFAULT_HEADER_TABLE_SIZE 4096
 #endif
 
 #ifdef HAVE_NGHTTP2
@@ -1193,6 +1257,9 @@ http2_init_protocol(void)
 static void
 http2_cleanup_protocol(void) {
     g_hash_table_destroy(streamid_hash);
+#ifdef HAVE_NGHTTP2
+    http2_header_cache_clear();
+#endif
 }
 
 static dissector_handle_t http2_handle;
@@ -1450,6 +1517,15 @@ get_http2_session(packet_info *pinfo, conversation_t* conversation)
          * Fragments were missing and that recovery should be attempted. */
         h2session->fix_dynamic_table[0] = true;
         h2session->fix_dynamic_table[1] = true;
+        for (unsigned i = 0; i < 2; i++) {
+            http2_hpack_flow_t *flow = &h2session->hpack_flow[i];
+
+            flow->blocks = wmem_array_new(wmem_file_scope(), sizeof(http2_header_block_t *));
+            flow->table_size_changes = wmem_array_new(wmem_file_scope(), sizeof(uint32_t));
+            flow->snapshots = wmem_array_new(wmem_file_scope(), sizeof(http2_hpack_snapshot_t *));
+            flow->settings_table_size = HTTP2_DEFAULT_HEADER_TABLE_SIZE;
+            flow->at_block_boundary = true;
+        }
 #endif
 
         h2session->fwd_flow = tcpd->fwd;
@@ -1616,12 +1692,23 @@ push_settings(packet_info *pinfo, http2_session_t *h2session,
     wmem_queue_push(queue, settings);
 }
 
+/* Changes the dynamic table size of an inflater, remembering it to
+   decompress header blocks again. */
+static void
+change_hd_inflater_table_size(http2_session_t *h2session, uint32_t flow_index, uint32_t size)
+{
+    http2_hpack_flow_t *flow = &h2session->hpack_flow[flow_index];
+
+    nghttp2_hd_inflate_change_table_size(h2session->hd_inflater[flow_index], size);
+    wmem_array_append_one(flow->table_size_changes, size);
+    flow->settings_table_size = size;
+}
+
 static void
 apply_and_pop_settings(packet_info *pinfo, http2_session_t *h2session)
 {
     wmem_queue_t *queue;
     http2_settings_t *settings;
-    nghttp2_hd_inflater *inflater;
     uint32_t flow_index;
 
     /* When header table size is applied, it affects the inflater of
@@ -1629,8 +1716,6 @@ apply_and_pop_settings(packet_info *pinfo, http2_session_t *h2session)
 
     flow_index = select_http2_flow_index(pinfo, h2session);
 
-    inflater = h2session->hd_inflater[flow_index];
-
     queue = h2session->settings_queue[flow_index ^ 1];
 
     if(wmem_queue_count(queue) == 0) {
@@ -1641,12 +1726,12 @@ apply_and_pop_settings(packet_info *pinfo, http2_session_t *h2session)
 
     if(settings->has_header_table_size) {
         if(settings->min_header_table_size < settings->header_table_size) {
-            nghttp2_hd_inflate_change_table_size
-                (inflater, settings->min_header_table_size);
+            change_hd_inflater_table_size(h2session, flow_index,
+                                          settings->min_header_table_size);
         }
 
-        nghttp2_hd_inflate_change_table_size(inflater,
-                                             settings->header_table_size);
+        change_hd_inflater_table_size(h2session, flow_index,
+                                      settings->header_table_size);
     }
 }
 
@@ -1759,15 +1844,13 @@ process_http2_header_repr_info(wmem_array_t *headers,
 
         if(header_repr_info->complete) {
             if(header_repr_info->type == HTTP2_HD_HEADER_TABLE_SIZE_UPDATE) {
-                http2_header_t *out;
-
-                out = wmem_new(wmem_file_scope(), http2_header_t);
+                http2_header_t out;
 
-                out->type = header_repr_info->type;
-                out->length = i - start;
-                out->table.header_table_size = header_repr_info->integer;
+                out.type = header_repr_info->type;
+                out.length = i - start;
+                out.table.header_table_size = header_repr_info->integer;
 
-                wmem_array_append(headers, out, 1);
+                wmem_array_append(headers, &out, 1);
 
                 reset_http2_header_repr_info(header_repr_info);
                 /* continue to decode header table size update or
@@ -2069,6 +2152,365 @@ fix_partial_header_dissection_support(nghttp2_hd_inflater *hd_inflater, bool *fi
     nghttp2_hd_inflate_end_headers(hd_inflater);
 }
 
+/* Decompresses a header block fragment with hd_inflater into a new array of
+   http2_header_t.  If cached, the array and the header data are allocated
+   with g_malloc, to be freed when dropped from the header cache; otherwise
+   they're file-scoped, and identical header data is shared.  Sets
+   *at_block_boundary if the end of the header block was reached. */
+static wmem_array_t *
+decompress_http2_header_block(nghttp2_hd_inflater *hd_inflater, http2_header_repr_info_t *header_repr_info,
+                              const uint8_t *headbuf, unsigned headlen, int final,
+                              http2_header_data_t *header_data, bool cached, bool *at_block_boundary)
+{
+    wmem_allocator_t *scope = cached ? NULL : wmem_file_scope();
+    wmem_array_t *headers;
+    int decompressed_bytes = 0;
+    int rv;
+
+    *at_block_boundary = false;
+    headers = wmem_array_sized_new(scope, sizeof(http2_header_t), 16);
+
+    for(;;) {
+        nghttp2_nv nv;
+        int inflate_flags = 0;
+
+        if (wmem_array_get_count(headers) >= MAX_HTTP2_HEADER_LINES) {
+            if (header_data) {
+                header_data->header_lines_exceeded = true;
+            }
+            break;
+        }
+
+        rv = (int)nghttp2_hd_inflate_hd2(hd_inflater, &nv,
+                                         &inflate_flags, headbuf, headlen, final);
+
+        if(rv < 0) {
+            break;
+        }
+
+        headbuf += rv;
+        headlen -= rv;
+
+        rv -= process_http2_header_repr_info(headers, header_repr_info, headbuf - rv, rv);
+
+        if(inflate_flags & NGHTTP2_HD_INFLATE_EMIT) {
+            char *cached_pstr;
+            uint32_t len;
+            unsigned datalen = (unsigned)(4 + nv.namelen + 4 + nv.valuelen);
+            http2_header_t out;
+            char *pstr;
+
+            if (decompressed_bytes + datalen >= MAX_HTTP2_HEADER_SIZE) {
+                if (header_data) {
+                    header_data->header_size_reached = decompressed_bytes;
+                    header_data->header_size_attempted = decompressed_bytes + datalen;
+                }
+                break;
+            }
+
+            out.type = header_repr_info->type;
+            out.length = rv;
+            out.table.data.idx = header_repr_info->integer;
+
+            out.table.data.datalen = datalen;
+            decompressed_bytes += datalen;
+
+            /* Prepare buffer... with the following format
+               name length (uint32)
+               name (string)
+               value length (uint32)
+               value (string)
+            */
+            if (cached) {
+                pstr = (char *)g_malloc(datalen);
+            } else {
+                http2_header_pstr = (char *)wmem_realloc(wmem_file_scope(), http2_header_pstr, datalen);
+                pstr = http2_header_pstr;
+            }
+
+            /* nv.namelen and nv.valuelen are of size_t.  In order
+               to get length in 4 bytes, we have to copy it to
+               uint32_t. */
+            len = (uint32_t)nv.namelen;
+            phton32(&pstr[0], len);
+            memcpy(&pstr[4], nv.name, nv.namelen);
+
+            len = (uint32_t)nv.valuelen;
+            phton32(&pstr[4 + nv.namelen], len);
+            memcpy(&pstr[4 + nv.namelen + 4], nv.value, nv.valuelen);
+
+            if (cached) {
+                out.table.data.data = pstr;
+            } else if ((cached_pstr = (char *)wmem_map_lookup(http2_hdrcache_map, pstr)) != NULL) {
+                out.table.data.data = cached_pstr;
+            } else {
+                wmem_map_insert(http2_hdrcache_map, pstr, pstr);
+                out.table.data.data = pstr;
+                http2_header_pstr = NULL;
+            }
+
+            wmem_array_append(headers, &out, 1);
+
+            reset_http2_header_repr_info(header_repr_info);
+        }
+        if(inflate_flags & NGHTTP2_HD_INFLATE_FINAL) {
+            nghttp2_hd_inflate_end_headers(hd_inflater);
+            *at_block_boundary = true;
+            break;
+        }
+        if((inflate_flags & NGHTTP2_HD_INFLATE_EMIT) == 0 &&
+           headlen == 0) {
+            break;
+        }
+    }
+
+    return headers;
+}
+
+static size_t
+http2_headers_size(wmem_array_t *headers)
+{
+    size_t size = sizeof(wmem_array_t) + wmem_array_get_count(headers) * sizeof(http2_header_t);
+
+    for (unsigned i = 0; i < wmem_array_get_count(headers); ++i) {
+        http2_header_t *in = (http2_header_t*)wmem_array_index(headers, i);
+
+        if (in->type != HTTP2_HD_HEADER_TABLE_SIZE_UPDATE) {
+            size += in->table.data.datalen;
+        }
+    }
+    return size;
+}
+
+static void
+http2_headers_free(wmem_array_t *headers)
+{
+    for (unsigned i = 0; i < wmem_array_get_count(headers); ++i) {
+        http2_header_t *in = (http2_header_t*)wmem_array_index(headers, i);
+
+        if (in->type != HTTP2_HD_HEADER_TABLE_SIZE_UPDATE) {
+            g_free(in->table.data.data);
+        }
+    }
+    wmem_destroy_array(headers);
+}
+
+/* Puts the headers of a header block in the header cache, and drops the
+   least recently used ones beyond the limit. */
+static void
+http2_header_cache_keep(http2_header_block_t *block)
+{
+    size_t limit = (size_t)http2_header_cache_limit * 1024;
+
+    block->headers_size = http2_headers_size(block->headers);
+    block->link.data = block;
+    g_queue_push_tail_link(&http2_header_cache, &block->link);
+    http2_header_cache_size += block->headers_size;
+
+    while (http2_header_cache_size > limit && http2_header_cache.length > 1) {
+        http2_header_block_t *old = (http2_header_block_t *)g_queue_pop_head_link(&http2_header_cache)->data;
+
+        http2_header_cache_size -= old->headers_size;
+        http2_headers_free(old->headers);
+        old->headers = NULL;
+    }
+}
+
+static void
+http2_header_cache_clear(void)
+{
+    GList *link;
+
+    while ((link = g_queue_pop_head_link(&http2_header_cache)) != NULL) {
+        http2_header_block_t *block = (http2_header_block_t *)link->data;
+
+        http2_headers_free(block->headers);
+        block->headers = NULL;
+    }
+    http2_header_cache_size = 0;
+}
+
+/* Appends an HPACK integer (RFC 7541, Section 5.1). */
+static void
+hpack_append_integer(GByteArray *buf, uint8_t first, unsigned prefix, size_t value)
+{
+    unsigned k = (1 << prefix) - 1;
+    uint8_t byte;
+
+    if (value < k) {
+        byte = first | (uint8_t)value;
+        g_byte_array_append(buf, &byte, 1);
+        return;
+    }
+    byte = first | (uint8_t)k;
+    g_byte_array_append(buf, &byte, 1);
+    value -= k;
+    while (value >= 128) {
+        byte = (uint8_t)(value & 0x7f) | 0x80;
+        g_byte_array_append(buf, &byte, 1);
+        value >>= 7;
+    }
+    byte = (uint8_t)value;
+    g_byte_array_append(buf, &byte, 1);
+}
+
+static void
+add_http2_hpack_snapshot(http2_hpack_flow_t *flow, nghttp2_hd_inflater *hd_inflater)
+{
+    http2_hpack_snapshot_t *snapshot = wmem_new(wmem_file_scope(), http2_hpack_snapshot_t);
+    GByteArray *table = g_byte_array_new();
+    size_t idx;
+
+    /* A dynamic table size update, then literal header fields with
+       incremental indexing and a new name for the entries, oldest first.
+       Entries are numbered from 1, after those of the static table,
+       newest first. */
+    hpack_append_integer(table, 0x20, 5, nghttp2_hd_inflate_get_max_dynamic_table_size(hd_inflater));
+    for (idx = nghttp2_hd_inflate_get_num_table_entries(hd_inflater); idx > HTTP2_HPACK_STATIC_TABLE_LENGTH; idx--) {
+        const nghttp2_nv *nv = nghttp2_hd_inflate_get_table_entry(hd_inflater, idx);
+
+        if (!nv) {
+            break;
+        }
+        hpack_append_integer(table, 0x40, 6, 0);
+        hpack_append_integer(table, 0, 7, nv->namelen);
+        g_byte_array_append(table, nv->name, (unsigned)nv->namelen);
+        hpack_append_integer(table, 0, 7, nv->valuelen);
+        g_byte_array_append(table, nv->value, (unsigned)nv->valuelen);
+    }
+
+    snapshot->block_index = wmem_array_get_count(flow->blocks);
+    snapshot->table_size_changes = wmem_array_get_count(flow->table_size_changes);
+    snapshot->settings_table_size = flow->settings_table_size;
+    snapshot->table_len = table->len;
+    snapshot->table = (uint8_t *)wmem_memdup(wmem_file_scope(), table->data, table->len);
+    g_byte_array_free(table, true);
+
+    wmem_array_append_one(flow->snapshots, snapshot);
+}
+
+/* Returns a new inflater with the dynamic table of the snapshot, or NULL. */
+static nghttp2_hd_inflater *
+restore_http2_hpack_snapshot(const http2_hpack_snapshot_t *snapshot)
+{
+    nghttp2_hd_inflater *hd_inflater;
+    const uint8_t *p = snapshot->table;
+    size_t len = snapshot->table_len;
+
+    if (nghttp2_hd_inflate_new(&hd_inflater) != 0) {
+        return NULL;
+    }
+    nghttp2_hd_inflate_change_table_size(hd_inflater, snapshot->settings_table_size);
+    for (;;) {
+        nghttp2_nv nv;
+        int inflate_flags = 0;
+        int rv = (int)nghttp2_hd_inflate_hd2(hd_inflater, &nv, &inflate_flags, p, len, 1);
+
+        if (rv < 0) {
+            nghttp2_hd_inflate_del(hd_inflater);
+            return NULL;
+        }
+        p += rv;
+        len -= rv;
+        if (inflate_flags & NGHTTP2_HD_INFLATE_FINAL) {
+            break;
+        }
+        if ((inflate_flags & NGHTTP2_HD_INFLATE_EMIT) == 0 && len == 0) {
+            break;
+        }
+    }
+    nghttp2_hd_inflate_end_headers(hd_inflater);
+    return hd_inflater;
+}
+
+/* Decompresses the headers of a header block again, with those of the blocks
+   between it and the nearest snapshot preceding it, which are put back in
+   the header cache too. */
+static void
+rebuild_http2_header_block(http2_header_block_t *target)
+{
+    http2_hpack_flow_t *flow = target->flow;
+    http2_hpack_snapshot_t *snapshot = NULL;
+    http2_header_repr_info_t header_repr_info;
+    nghttp2_hd_inflater *hd_inflater;
+    unsigned lo = 0, hi = wmem_array_get_count(flow->snapshots);
+    unsigned change;
+
+    /* Find the last snapshot at or before the block. */
+    while (lo < hi) {
+        unsigned mid = lo + (hi - lo) / 2;
+        http2_hpack_snapshot_t *s = *(http2_hpack_snapshot_t **)wmem_array_index(flow->snapshots, mid);
+
+        if (s->block_index <= target->index) {
+            snapshot = s;
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (!snapshot || (hd_inflater = restore_http2_hpack_snapshot(snapshot)) == NULL) {
+        return;
+    }
+
+    reset_http2_header_repr_info(&header_repr_info);
+    change = snapshot->table_size_changes;
+    for (unsigned i = snapshot->block_index; i <= target->index; i++) {
+        http2_header_block_t *block = *(http2_header_block_t **)wmem_array_index(flow->blocks, i);
+        wmem_array_t *headers;
+        bool at_block_boundary;
+
+        for (; change < block->table_size_changes; change++) {
+            nghttp2_hd_inflate_change_table_size(hd_inflater,
+                *(uint32_t *)wmem_array_index(flow->table_size_changes, change));
+        }
+        headers = decompress_http2_header_block(hd_inflater, &header_repr_info,
+                                                block->compressed, block->compressed_len, block->final,
+                                                NULL, true, &at_block_boundary);
+        if (block->headers) {
+            http2_headers_free(headers);
+        } else {
+            block->headers = headers;
+            http2_header_cache_keep(block);
+        }
+    }
+    nghttp2_hd_inflate_del(hd_inflater);
+}
+
+/* Returns the headers of a header block, decompressing them again if they
+   were dropped from the header cache, or NULL if that fails.  The headers
+   of cached blocks can be dropped by the next call. */
+static wmem_array_t *
+get_http2_header_block_headers(http2_header_block_t *block)
+{
+    if (!block->flow) {
+        return block->headers;
+    }
+    if (block->headers) {
+        g_queue_unlink(&http2_header_cache, &block->link);
+        g_queue_push_tail_link(&http2_header_cache, &block->link);
+    } else {
+        rebuild_http2_header_block(block);
+    }
+    return block->headers;
+}
+
+/* Copies headers, with their data, to scope. */
+static wmem_array_t *
+copy_http2_headers(wmem_allocator_t *scope, wmem_array_t *headers)
+{
+    wmem_array_t *copy = wmem_array_sized_new(scope, sizeof(http2_header_t), wmem_array_get_count(headers));
+
+    for (unsigned i = 0; i < wmem_array_get_count(headers); ++i) {
+        http2_header_t out = *(http2_header_t*)wmem_array_index(headers, i);
+
+        if (out.type != HTTP2_HD_HEADER_TABLE_SIZE_UPDATE) {
+            out.table.data.data = (char *)wmem_memdup(scope, out.table.data.data, out.table.data.datalen);
+        }
+        wmem_array_append(copy, &out, 1);
+    }
+    return copy;
+}
+
 static void
 inflate_http2_header_block(tvbuff_t *tvb, packet_info *pinfo, unsigned offset, proto_tree *tree,
                            unsigned headlen, http2_session_t *h2session, uint8_t flags)
@@ -2083,13 +2525,13 @@ inflate_http2_header_block(tvbuff_t *tvb, packet_info *pinfo, unsigned offset, p
     int hoffset = 0;
     nghttp2_hd_inflater *hd_inflater;
     tvbuff_t *header_tvb = NULL;
-    int rv;
     int header_len = 0;
     int final;
     uint32_t flow_index;
     http2_header_data_t *header_data;
     http2_header_repr_info_t *header_repr_info;
     wmem_list_t *header_list;
+    http2_header_block_t *block;
     wmem_array_t *headers;
     unsigned i;
     const char *method_header_value = NULL;
@@ -2111,7 +2553,9 @@ inflate_http2_header_block(tvbuff_t *tvb, packet_info *pinfo, unsigned offset, p
            cache, already processed data will be fed into decompressor
            again and again since dissector will be called randomly.
            This makes context out-of-sync. */
-        int decompressed_bytes = 0;
+        bool cached = http2_header_cache_limit != 0;
+        bool at_block_boundary;
+        http2_hpack_flow_t *flow;
 
         /* Make sure the length isn't too large. */
         tvb_ensure_bytes_exist(tvb, offset, headlen);
@@ -2121,98 +2565,40 @@ inflate_http2_header_block(tvbuff_t *tvb, packet_info *pinfo, unsigned offset, p
         flow_index = select_http2_flow_index(pinfo, h2session);
         hd_inflater = h2session->hd_inflater[flow_index];
         header_repr_info = &h2session->header_repr_info[flow_index];
+        flow = &h2session->hpack_flow[flow_index];
 
         fix_partial_header_dissection_support(hd_inflater, &h2session->fix_dynamic_table[flow_index]);
 
         final = flags & HTTP2_FLAGS_END_HEADERS;
 
-        headers = wmem_array_sized_new(wmem_file_scope(), sizeof(http2_header_t), 16);
-
-        for(;;) {
-            nghttp2_nv nv;
-            int inflate_flags = 0;
+        block = wmem_new0(wmem_file_scope(), http2_header_block_t);
+        if (cached) {
+            unsigned num_snapshots = wmem_array_get_count(flow->snapshots);
 
-            if (wmem_array_get_count(headers) >= MAX_HTTP2_HEADER_LINES) {
-                header_data->header_lines_exceeded = true;
-                break;
-            }
-
-            rv = (int)nghttp2_hd_inflate_hd2(hd_inflater, &nv,
-                                             &inflate_flags, headbuf, headlen, final);
-
-            if(rv < 0) {
-                break;
+            /* The dynamic table can only be restored between header blocks. */
+            if (flow->at_block_boundary &&
+                (num_snapshots == 0 ||
+                 wmem_array_get_count(flow->blocks) - (*(http2_hpack_snapshot_t **)wmem_array_index(flow->snapshots, num_snapshots - 1))->block_index >= HTTP2_HPACK_SNAPSHOT_INTERVAL)) {
+                add_http2_hpack_snapshot(flow, hd_inflater);
             }
+            block->flow = flow;
+            block->index = wmem_array_get_count(flow->blocks);
+            block->table_size_changes = wmem_array_get_count(flow->table_size_changes);
+            block->compressed = (uint8_t *)wmem_memdup(wmem_file_scope(), headbuf, headlen);
+            block->compressed_len = headlen;
+            block->final = final != 0;
+            wmem_array_append_one(flow->blocks, block);
+        }
 
-            headbuf += rv;
-            headlen -= rv;
-
-            rv -= process_http2_header_repr_info(headers, header_repr_info, headbuf - rv, rv);
-
-            if(inflate_flags & NGHTTP2_HD_INFLATE_EMIT) {
-                char *cached_pstr;
-                uint32_t len;
-                unsigned datalen = (unsigned)(4 + nv.namelen + 4 + nv.valuelen);
-                http2_header_t *out;
-
-                if (decompressed_bytes + datalen >= MAX_HTTP2_HEADER_SIZE) {
-                    header_data->header_size_reached = decompressed_bytes;
-                    header_data->header_size_attempted = decompressed_bytes + datalen;
-                    break;
-                }
-
-                out = wmem_new(wmem_file_scope(), http2_header_t);
-
-                out->type = header_repr_info->type;
-                out->length = rv;
-                out->table.data.idx = header_repr_info->integer;
-
-                out->table.data.datalen = datalen;
-                decompressed_bytes += datalen;
-
-                /* Prepare buffer... with the following format
-                   name length (uint32)
-                   name (string)
-                   value length (uint32)
-                   value (string)
-                */
-                http2_header_pstr = (char *)wmem_realloc(wmem_file_scope(), http2_header_pstr, out->table.data.datalen);
-
-                /* nv.namelen and nv.valuelen are of size_t.  In order
-                   to get length in 4 bytes, we have to copy it to
-                   uint32_t. */
-                len = (uint32_t)nv.namelen;
-                phton32(&http2_header_pstr[0], len);
-                memcpy(&http2_header_pstr[4], nv.name, nv.namelen);
-
-                len = (uint32_t)nv.valuelen;
-                phton32(&http2_header_pstr[4 + nv.namelen], len);
-                memcpy(&http2_header_pstr[4 + nv.namelen + 4], nv.value, nv.valuelen);
-
-                cached_pstr = (char *)wmem_map_lookup(http2_hdrcache_map, http2_header_pstr);
-                if (cached_pstr) {
-                    out->table.data.data = cached_pstr;
-                } else {
-                    wmem_map_insert(http2_hdrcache_map, http2_header_pstr, http2_header_pstr);
-                    out->table.data.data = http2_header_pstr;
-                    http2_header_pstr = NULL;
-                }
-
-                wmem_array_append(headers, out, 1);
-
-                reset_http2_header_repr_info(header_repr_info);
-            }
-            if(inflate_flags & NGHTTP2_HD_INFLATE_FINAL) {
-                nghttp2_hd_inflate_end_headers(hd_inflater);
-                break;
-            }
-            if((inflate_flags & NGHTTP2_HD_INFLATE_EMIT) == 0 &&
-               headlen == 0) {
-                break;
-            }
+        headers = decompress_http2_header_block(hd_inflater, header_repr_info, headbuf, headlen, final,
+                                                header_data, cached, &at_block_boundary);
+        flow->at_block_boundary = at_block_boundary;
+        block->headers = headers;
+        if (cached) {
+            http2_header_cache_keep(block);
         }
 
-        wmem_list_append(header_list, headers);
+        wmem_list_append(header_list, block);
 
         if(!header_data->current) {
             header_data->current = wmem_list_head(header_list);
@@ -2229,11 +2615,12 @@ inflate_http2_header_block(tvbuff_t *tvb, packet_info *pinfo, unsigned offset, p
         }
         header_stream_info = get_header_stream_info_for_id(pinfo, h2session, false, header_stream_id);
         if (header_stream_info) {
-            wmem_list_append(header_stream_info->stream_header_list, headers);
+            wmem_list_append(header_stream_info->stream_header_list, block);
         }
 
     } else if (header_data->current) {
-        headers = (wmem_array_t*)wmem_list_frame_data(header_data->current);
+        block = (http2_header_block_t*)wmem_list_frame_data(header_data->current);
+        headers = get_http2_header_block_headers(block);
 
         header_data->current = wmem_list_frame_next(header_data->current);
 
@@ -2244,6 +2631,15 @@ inflate_http2_header_block(tvbuff_t *tvb, packet_info *pinfo, unsigned offset, p
         return;
     }
 
+    if (!headers) {
+        return;
+    }
+    /* The headers of cached blocks can be dropped while dissecting, e.g. when
+       a subdissector looks up the headers of the stream. */
+    if (block->flow) {
+        headers = copy_http2_headers(pinfo->pool, headers);
+    }
+
     if(wmem_array_get_count(headers) == 0) {
         return;
     }
@@ -3328,7 +3724,7 @@ get_real_header_value(packet_info* pinfo, const char* name, bool the_other_direc
         frame;
         frame = wmem_list_frame_next(frame))
     {   /* each frame contains one HEADERS or CONTINUATION frame's headers */
-        headers = (wmem_array_t*)wmem_list_frame_data(frame);
+        headers = get_http2_header_block_headers((http2_header_block_t*)wmem_list_frame_data(frame));
         if (!headers) {
             continue;
         }
@@ -4984,6 +5380,14 @@ proto_register_http2(void)
         "A table to define HTTP2 fake headers for parsing a HTTP2 stream conversation that first HEADERS frame is missing.",
         fake_headers_uat);
 
+    prefs_register_uint_preference(http2_module, "header_cache_limit",
+        "Memory limit for decompressed headers (KB)",
+        "If not 0, the decompressed headers of packets are kept in a cache of at most "
+        "this many kilobytes rather than for as long as the capture file is open. "
+        "Headers dropped from the cache are decompressed again when needed, starting "
+        "from a snapshot of the HPACK dynamic table.",
+        10, &http2_header_cache_limit);
+
     /* Fill hash table with static headers */
     register_static_headers();
 
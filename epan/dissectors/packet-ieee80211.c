@@ -54,6 +54,7 @@
 #include <epan/exceptions.h>
 #include <wsutil/pint.h>
 #include <wsutil/ws_roundup.h>
+#include <wsutil/filesystem.h>
 #include <epan/addr_resolv.h>
 #include <epan/address_types.h>
 #include <epan/strutil.h>
@@ -67,6 +68,7 @@
 #include <epan/crypt/wep-wpadefs.h>
 #include <epan/expert.h>
 #include <epan/conversation_table.h>
+#include <epan/decrypt_cache.h>
 #include <epan/uat.h>
 #include <epan/eapol_keydes_types.h>
 #include <epan/proto_data.h>
@@ -284,6 +286,11 @@ UAT_CSTRING_CB_DEF(uat_wep_key_records, string, uat_wep_key_record_t)
 /* Stuff for the WEP/WPA/WPA2 decoder */
 static bool enable_decryption = true;
 
+/* Keep the PSKs derived from WPA passphrases in the profile */
+#define PSK_CACHE_FILE_NAME "80211_psk_cache"
+static bool save_psk_cache;
+static bool psk_cache_loaded;
+
 static void
 ieee_80211_add_tagged_parameters(tvbuff_t *tvb, int offset, packet_info *pinfo,
                                   proto_tree *tree, int tagged_parameters_len, int ftype,
@@ -42020,6 +42027,41 @@ static void try_scan_tdls_keys(tvbuff_t *tvb, packet_info *pinfo _U_, int offset
   }
 }
 
+/*
+ * The keys used to decrypt frames, each kept once per file, so that the
+ * decrypted data cache only has to hold the ID of the key with each frame.
+ */
+static wmem_map_t *used_key_ids;        /* DOT11DECRYPT_KEY_ITEM -> ID */
+static wmem_map_t *used_keys;           /* ID -> DOT11DECRYPT_KEY_ITEM */
+
+static unsigned
+used_key_hash_fn(const void *k)
+{
+  return wmem_strong_hash((const uint8_t *)k, sizeof(DOT11DECRYPT_KEY_ITEM));
+}
+
+static gboolean
+used_key_equal_fn(const void *v, const void *w)
+{
+  return memcmp(v, w, sizeof(DOT11DECRYPT_KEY_ITEM)) == 0;
+}
+
+/* Returns the ID of a key, starting at 1. */
+static uint32_t
+used_key_get_id(const DOT11DECRYPT_KEY_ITEM *key)
+{
+  void *id = wmem_map_lookup(used_key_ids, key);
+
+  if (id == NULL) {
+    DOT11DECRYPT_KEY_ITEM *copy = (DOT11DECRYPT_KEY_ITEM *)wmem_memdup(wmem_file_scope(), key, sizeof *key);
+
+    id = GUINT_TO_POINTER(wmem_map_size(used_key_ids) + 1);
+    wmem_map_insert(used_key_ids, copy, id);
+    wmem_map_insert(used_keys, id, copy);
+  }
+  return GPOINTER_TO_UINT(id);
+}
+
 /* It returns the algorithm used for decryption and trailer length. */
 static tvbuff_t *
 try_decrypt(tvbuff_t *tvb, packet_info *pinfo, unsigned offset, unsigned len,
@@ -42030,16 +42072,50 @@ try_decrypt(tvbuff_t *tvb, packet_info *pinfo, unsigned offset, unsigned len,
   tvbuff_t          *decr_tvb = NULL;
   uint32_t           dec_caplen;
   unsigned char      dec_data[DOT11DECRYPT_MAX_CAPLEN];
+  /* Frames are identified in the decrypted data cache by their offset. */
+  const unsigned     record = (unsigned)tvb_raw_offset(tvb);
+  uint8_t           *cached;
+  unsigned           cached_len;
+  uint32_t           key_id;
+  const DOT11DECRYPT_KEY_ITEM *key = NULL;
+  int                ret;
 
   if (!enable_decryption)
     return NULL;
 
-  /* get the entire packet                                  */
-  enc_data = tvb_get_ptr(tvb, 0, len+offset);
+  /*
+   * The cache holds the ID of the key used followed by the decrypted
+   * frame. It's only looked up once the frame was decrypted, as
+   * decrypting updates the security associations.
+   */
+  cached = PINFO_FD_VISITED(pinfo) ?
+      decrypt_cache_lookup(pinfo->pool, proto_wlan, pinfo->num, record, &cached_len) : NULL;
+  if (cached && cached_len > sizeof key_id &&
+      cached_len - sizeof key_id <= DOT11DECRYPT_MAX_CAPLEN) {
+    memcpy(&key_id, cached, sizeof key_id);
+    key = (const DOT11DECRYPT_KEY_ITEM *)wmem_map_lookup(used_keys, GUINT_TO_POINTER(key_id));
+  }
+  if (key) {
+    memcpy(used_key, key, sizeof(DOT11DECRYPT_KEY_ITEM));
+    dec_caplen = (uint32_t)(cached_len - sizeof key_id);
+    memcpy(dec_data, cached + sizeof key_id, dec_caplen);
+    ret = DOT11DECRYPT_RET_SUCCESS;
+  } else {
+    /* get the entire packet                                  */
+    enc_data = tvb_get_ptr(tvb, 0, len+offset);
 
-  /* decrypt packet with Dot11Decrypt */
-  int ret = Dot11DecryptDecryptPacket(&dot11decrypt_ctx, enc_data, offset, offset+len,
-                                       dec_data, &dec_caplen, used_key);
+    /* decrypt packet with Dot11Decrypt */
+    ret = Dot11DecryptDecryptPacket(&dot11decrypt_ctx, enc_data, offset, offset+len,
+                                    dec_data, &dec_caplen, used_key);
+    if (ret == DOT11DECRYPT_RET_SUCCESS && decrypt_cache_limit()) {
+      key_id = used_key_get_id(used_key);
+      cached_len = (unsigned)sizeof key_id + dec_caplen;
+      cached = (uint8_t *)wmem_alloc(pinfo->pool, cached_len);
+      memcpy(cached, &key_id, sizeof key_id);
+      memcpy(cached + sizeof key_id, dec_data, dec_caplen);
+      decrypt_cache_add(proto_wlan, pinfo->num, record, cached, cached_len);
+    }
+  }
   if (ret == DOT11DECRYPT_RET_SUCCESS) {
     uint8_t *tmp;
     *algorithm=used_key->KeyType;
@@ -42076,6 +42152,20 @@ try_decrypt(tvbuff_t *tvb, packet_info *pinfo, unsigned offset, unsigned len,
 }
 
 /* Collect our WEP and WPA keys */
+static void
+save_dot11decrypt_psk_cache(void)
+{
+  char *path;
+
+  if (!save_psk_cache)
+    return;
+
+  /* Also keeps the PSKs derived for the SSIDs of wildcard passphrases. */
+  path = get_persconffile_path(PSK_CACHE_FILE_NAME, true);
+  Dot11DecryptSavePskCache(path);
+  g_free(path);
+}
+
 static void
 set_dot11decrypt_keys(void)
 {
@@ -42160,9 +42250,19 @@ set_dot11decrypt_keys(void)
     }
   }
 
+  if (save_psk_cache && !psk_cache_loaded)
+  {
+    char *path = get_persconffile_path(PSK_CACHE_FILE_NAME, true);
+    Dot11DecryptLoadPskCache(path);
+    g_free(path);
+    psk_cache_loaded = true;
+  }
+
   /* Now set the keys */
   Dot11DecryptSetKeys(&dot11decrypt_ctx, keys->Keys, keys->nKeys);
   g_free(keys);
+
+  save_dot11decrypt_psk_cache();
 }
 
 static void
@@ -61193,6 +61293,11 @@ proto_register_ieee80211(void)
   sta_prop_hash = wmem_map_new_autoreset(wmem_epan_scope(), wmem_file_scope(),
                                          sta_prop_hash_fn, sta_prop_equal_fn);
 
+  used_key_ids = wmem_map_new_autoreset(wmem_epan_scope(), wmem_file_scope(),
+                                        used_key_hash_fn, used_key_equal_fn);
+  used_keys = wmem_map_new_autoreset(wmem_epan_scope(), wmem_file_scope(),
+                                     g_direct_hash, g_direct_equal);
+
   ieee80211_handle = register_dissector("wlan", dissect_ieee80211,                    proto_wlan);
   register_dissector("wlan_withfcs",            dissect_ieee80211_withfcs,            proto_wlan);
   wlan_withoutfcs_handle = register_dissector("wlan_withoutfcs", dissect_ieee80211_withoutfcs, proto_wlan);
@@ -61205,6 +61310,7 @@ proto_register_ieee80211(void)
   reassembly_table_register(&wlan_reassembly_table,
                         &addresses_reassembly_table_functions);
   register_init_routine(wlan_retransmit_init);
+  register_cleanup_routine(save_dot11decrypt_psk_cache);
   reassembly_table_register(&gas_reassembly_table,
                         &addresses_reassembly_table_functions);
 
@@ -61283,6 +61389,16 @@ proto_register_ieee80211(void)
     "Enable decryption", "Enable WEP and WPA/WPA2 decryption",
     &enable_decryption);
 
+  prefs_register_bool_preference(wlan_module, "save_psk_cache",
+    "Save the PSKs derived from passphrases",
+    "Save the PSKs derived from WPA passphrases in the profile, so that "
+    "they don't have to be derived again, which is slow with many "
+    "passphrases and SSIDs. The passphrases themselves are not saved, but "
+    "the PSKs decrypt the networks' traffic just as well: the file holds "
+    "credentials equivalent to the network keys, and should be protected "
+    "like them.",
+    &save_psk_cache);
+
   wep_uat = uat_new("WEP and WPA Decryption Keys",
             sizeof(uat_wep_key_record_t), /* record size */
             "80211_keys",                 /* filename */
@@ -32,6 +32,7 @@
 #include <epan/aftypes.h>
 #include <epan/arcnet_pids.h>
 #include <epan/in_cksum.h>
+#include <epan/checksum_prepass.h>
 #include <epan/nlpid.h>
 #include <epan/ax25_pids.h>
 #include <epan/decode_as.h>
@@ -2157,7 +2158,11 @@ dissect_ip_v4(tvbuff_t *tvb, packet_info *pinfo, proto_tree *parent_tree, void*
    * available, check the checksum.
    */
   if (ip_check_checksum && tvb_bytes_exist(tvb, offset, hlen)) {
-    ipsum = ip_checksum_tvb(tvb, offset, hlen);
+    /* The checksum pre-pass may have already found it to be good. */
+    if (checksum_prepass_good(pinfo, CKSUM_PREPASS_IP))
+      ipsum = 0;
+    else
+      ipsum = ip_checksum_tvb(tvb, offset, hlen);
     item = proto_tree_add_checksum(ip_tree, tvb, offset + 10, hf_ip_checksum, hf_ip_checksum_status, &ei_ip_checksum_bad, pinfo, ipsum,
                                 ENC_BIG_ENDIAN, PROTO_CHECKSUM_VERIFY|PROTO_CHECKSUM_IN_CKSUM);
     /*
@@ -59,6 +59,9 @@
 #include "packet-quic.h"
 #include <epan/reassemble.h>
 #include <epan/prefs.h>
+#include <epan/epan.h>
+#include <epan/decrypt_cache.h>
+#include <wiretap/wtap.h>
 #include <wsutil/pint.h>
 
 #include <epan/tap.h>
@@ -320,8 +323,11 @@ static const fragment_items quic_crypto_fragment_items = {
 
 typedef struct quic_decrypt_result {
     const unsigned char   *error;      /**< Error message or NULL for success. */
-    const uint8_t  *data;       /**< Decrypted result on success (file-scoped). */
+    const uint8_t  *data;       /**< Decrypted result on success (file-scoped), or
+                                     NULL if it's in the decrypted data cache. */
     unsigned        data_len;   /**< Size of decrypted data. */
+    struct quic_decrypt_again *again; /**< How to decrypt it again, if it's in the
+                                           decrypted data cache. */
 } quic_decrypt_result_t;
 
 /** QUIC decryption context. */
@@ -330,10 +336,34 @@ typedef struct quic_decrypt_result {
 typedef struct quic_hp_cipher {
     gcry_cipher_hd_t    hp_cipher;  /**< Header protection cipher. */
 } quic_hp_cipher;
+/**
+ * Packet protection key, kept for decrypting packets again when their
+ * decrypted data is dropped from the decrypted data cache.
+ */
+typedef struct quic_pp_key {
+    int                 cipher_algo;
+    int                 cipher_mode;
+    unsigned            key_length;
+    uint8_t             key[256/8];
+    gcry_cipher_hd_t    hd;         /**< Opened when first needed. */
+} quic_pp_key_t;
 typedef struct quic_pp_cipher {
     gcry_cipher_hd_t    pp_cipher;  /**< Packet protection cipher. */
     uint8_t             pp_iv[TLS13_AEAD_NONCE_LENGTH];
+    quic_pp_key_t      *key;        /**< File-scoped copy of the key, or NULL. */
 } quic_pp_cipher;
+
+/** What is needed to decrypt a packet again, in addition to its ciphertext. */
+typedef struct quic_decrypt_again {
+    quic_pp_key_t  *key;
+    uint8_t         nonce[TLS13_AEAD_NONCE_LENGTH];
+    uint8_t        *header;         /**< Associated data. */
+    unsigned        header_length;
+    unsigned        index;          /**< In quic_decrypted, and record index in the cache */
+    uint32_t        frame_num;
+    int64_t         file_off;       /**< Of the frame, for reading it back. */
+    unsigned        frame_offset;   /**< Of the ciphertext in the frame, or UINT_MAX. */
+} quic_decrypt_again_t;
 typedef struct quic_ciphers {
     quic_hp_cipher hp_cipher;
     quic_pp_cipher pp_cipher;
@@ -2882,7 +2912,271 @@ dissect_quic_frame_type(tvbuff_t *tvb, packet_info *pinfo, proto_tree *quic_tree
 static bool
 quic_hp_cipher_init(quic_hp_cipher *hp_cipher, int hash_algo, uint8_t key_length, uint8_t *secret, uint32_t version);
 static bool
-quic_pp_cipher_init(quic_pp_cipher *pp_cipher, int hash_algo, uint8_t key_length, uint8_t *secret, uint32_t version);
+quic_pp_cipher_init(quic_pp_cipher *pp_cipher, int hash_algo, int cipher_algo, int cipher_mode,
+                    uint8_t key_length, uint8_t *secret, uint32_t version);
+
+/*
+ * Decrypted data cache {{{
+ *
+ * With the protocols.decrypted_memory_limit preference, the decrypted data
+ * of packets is kept in the decrypted data cache, of limited size, rather
+ * than for as long as the capture file is open. The packets whose data was
+ * dropped from it are decrypted again when they are dissected again. As the
+ * keys and nonces of packets are known by then, packets whose ciphertext is
+ * in their frame can be read back from the capture file and decrypted ahead,
+ * with several threads, which keeps sequential passes over the packets fast.
+ */
+
+/* Results that can be decrypted again, in frame order */
+static GPtrArray *quic_decrypted;
+/* Keys whose cipher handle was opened */
+static GSList *quic_pp_keys_opened;
+
+/* At most this many packets are decrypted ahead at once. */
+#define QUIC_DECRYPT_AHEAD_MAX  4096
+
+/*
+ * Returns the offset of the data in the frame being dissected, or UINT_MAX
+ * if it's not a part of it (e.g. it was reassembled or decrypted).
+ */
+static unsigned
+quic_frame_offset(packet_info *pinfo, tvbuff_t *tvb, unsigned offset, unsigned length)
+{
+    tvbuff_t *frame_tvb;
+    const uint8_t *frame_start, *data;
+
+    if (pinfo->data_src == NULL) {
+        return UINT_MAX;
+    }
+    frame_tvb = get_data_source_tvb((const struct data_source *)pinfo->data_src->data);
+    frame_start = tvb_get_ptr(frame_tvb, 0, -1);
+    data = tvb_get_ptr(tvb, offset, length);
+    if (frame_start == NULL || data == NULL ||
+        (uintptr_t)data < (uintptr_t)frame_start ||
+        (uintptr_t)data + length > (uintptr_t)frame_start + tvb_captured_length(frame_tvb)) {
+        return UINT_MAX;
+    }
+    return (unsigned)(data - frame_start);
+}
+
+static bool
+quic_pp_key_open(const quic_pp_key_t *key, gcry_cipher_hd_t *hd)
+{
+    if (gcry_cipher_open(hd, key->cipher_algo, key->cipher_mode, 0)) {
+        return false;
+    }
+    if (gcry_cipher_setkey(*hd, key->key, key->key_length)) {
+        gcry_cipher_close(*hd);
+        return false;
+    }
+    return true;
+}
+
+static void
+quic_pp_key_close(void *hd)
+{
+    gcry_cipher_close((gcry_cipher_hd_t)hd);
+}
+
+/* Decrypts the ciphertext in buffer, followed by the 16 bytes tag, in place. */
+static bool
+quic_decrypt_again_buffer(gcry_cipher_hd_t hd, const quic_decrypt_again_t *again, uint8_t *buffer, unsigned length)
+{
+    return gcry_cipher_reset(hd) == 0 &&
+           gcry_cipher_setiv(hd, again->nonce, TLS13_AEAD_NONCE_LENGTH) == 0 &&
+           gcry_cipher_authenticate(hd, again->header, again->header_length) == 0 &&
+           gcry_cipher_decrypt(hd, buffer, length, NULL, 0) == 0 &&
+           gcry_cipher_checktag(hd, buffer + length, 16) == 0;
+}
+
+static void
+quic_decrypted_keep(const quic_decrypt_result_t *result, const uint8_t *data)
+{
+    decrypt_cache_add(proto_quic, result->again->frame_num, result->again->index, data, result->data_len);
+}
+
+typedef struct {
+    quic_decrypt_result_t  *result;
+    uint8_t                *buffer;     /**< The ciphertext and tag, then the plaintext. */
+    bool                    ok;
+} quic_decrypt_ahead_job_t;
+
+typedef struct {
+    quic_decrypt_ahead_job_t   *jobs;
+    unsigned                    num_jobs;
+    int                         next;
+} quic_decrypt_ahead_t;
+
+static void *
+quic_decrypt_ahead_worker(void *data)
+{
+    quic_decrypt_ahead_t *ahead = (quic_decrypt_ahead_t *)data;
+    /* Cipher handles can't be shared between threads. */
+    GHashTable *hds = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, quic_pp_key_close);
+    unsigned i;
+
+    while ((i = (unsigned)g_atomic_int_add(&ahead->next, 1)) < ahead->num_jobs) {
+        quic_decrypt_ahead_job_t *job = &ahead->jobs[i];
+        const quic_decrypt_again_t *again = job->result->again;
+        gcry_cipher_hd_t hd = (gcry_cipher_hd_t)g_hash_table_lookup(hds, again->key);
+
+        if (!hd) {
+            if (!quic_pp_key_open(again->key, &hd)) {
+                continue;
+            }
+            g_hash_table_insert(hds, again->key, hd);
+        }
+        job->ok = quic_decrypt_again_buffer(hd, again, job->buffer, job->result->data_len);
+    }
+    g_hash_table_destroy(hds);
+    return NULL;
+}
+
+/*
+ * Decrypts the packets whose data was dropped, starting with the one at
+ * index start in quic_decrypted, reading their ciphertext from the capture
+ * file. At most half of the cache is filled, so that the data of these
+ * packets doesn't drop each other's.
+ */
+static void
+quic_decrypt_ahead(packet_info *pinfo, unsigned start)
+{
+    quic_decrypt_ahead_t ahead = { NULL, 0, 0 };
+    GArray *jobs = g_array_new(false, false, sizeof(quic_decrypt_ahead_job_t));
+    size_t budget = decrypt_cache_limit() / 2;
+    GThread **workers;
+    unsigned num_threads, i;
+    uint32_t rec_frame_num = 0;
+    bool have_rec = false;
+    wtap_rec rec;
+
+    wtap_rec_init(&rec, 1514);
+    for (i = start; i < quic_decrypted->len && jobs->len < QUIC_DECRYPT_AHEAD_MAX; i++) {
+        quic_decrypt_result_t *result = (quic_decrypt_result_t *)g_ptr_array_index(quic_decrypted, i);
+        const quic_decrypt_again_t *again = result->again;
+        quic_decrypt_ahead_job_t job;
+
+        if (again->frame_offset == UINT_MAX ||
+            decrypt_cache_contains(proto_quic, again->frame_num, again->index)) {
+            continue;
+        }
+        if (result->data_len > budget) {
+            break;
+        }
+        if (!have_rec || rec_frame_num != again->frame_num) {
+            rec_frame_num = again->frame_num;
+            have_rec = epan_get_frame_data(pinfo->epan, again->frame_num, again->file_off, &rec);
+            if (!have_rec) {
+                break;
+            }
+        }
+        if ((uint64_t)again->frame_offset + result->data_len + 16 > ws_buffer_length(&rec.data)) {
+            continue;
+        }
+        job.result = result;
+        job.buffer = (uint8_t *)g_memdup2(ws_buffer_start_ptr(&rec.data) + again->frame_offset,
+                                          result->data_len + 16);
+        job.ok = false;
+        g_array_append_val(jobs, job);
+        budget -= result->data_len;
+    }
+    wtap_rec_cleanup(&rec);
+
+    ahead.jobs = (quic_decrypt_ahead_job_t *)(void *)jobs->data;
+    ahead.num_jobs = jobs->len;
+    /* Starting a thread costs about as much as decrypting a few packets. */
+    num_threads = MIN((unsigned)g_get_num_processors(), (ahead.num_jobs + 15) / 16);
+    if (num_threads > 1) {
+        workers = g_new(GThread *, num_threads - 1);
+        for (i = 0; i < num_threads - 1; i++) {
+            workers[i] = g_thread_new("quic_decrypt_ahead", quic_decrypt_ahead_worker, &ahead);
+        }
+        quic_decrypt_ahead_worker(&ahead);
+        for (i = 0; i < num_threads - 1; i++) {
+            g_thread_join(workers[i]);
+        }
+        g_free(workers);
+    } else {
+        quic_decrypt_ahead_worker(&ahead);
+    }
+
+    for (i = 0; i < ahead.num_jobs; i++) {
+        quic_decrypt_ahead_job_t *job = &ahead.jobs[i];
+
+        if (job->ok) {
+            quic_decrypted_keep(job->result, job->buffer);
+        }
+        g_free(job->buffer);
+    }
+    g_array_free(jobs, true);
+}
+
+/*
+ * Returns the decrypted data of a packet, allocated in pinfo->pool, from the
+ * decrypted data cache or by decrypting it again, with the packets following
+ * it if possible. The ciphertext is at offset header_length of tvb.
+ */
+static const uint8_t *
+quic_decrypted_data(packet_info *pinfo, const quic_decrypt_result_t *result, tvbuff_t *tvb, unsigned header_length)
+{
+    quic_decrypt_again_t *again = result->again;
+    quic_pp_key_t *key = again->key;
+    uint8_t *buffer;
+    unsigned length;
+
+    buffer = decrypt_cache_lookup(pinfo->pool, proto_quic, again->frame_num, again->index, &length);
+    if (buffer) {
+        return buffer;
+    }
+
+    if (again->frame_offset != UINT_MAX && epan_can_get_frame_data(pinfo->epan)) {
+        quic_decrypt_ahead(pinfo, again->index);
+        buffer = decrypt_cache_lookup(pinfo->pool, proto_quic, again->frame_num, again->index, &length);
+        if (buffer) {
+            return buffer;
+        }
+    }
+
+    if (tvb_captured_length_remaining(tvb, header_length) < result->data_len + 16) {
+        return NULL;
+    }
+    if (!key->hd) {
+        if (!quic_pp_key_open(key, &key->hd)) {
+            return NULL;
+        }
+        quic_pp_keys_opened = g_slist_prepend(quic_pp_keys_opened, key);
+    }
+    buffer = (uint8_t *)tvb_memdup(pinfo->pool, tvb, header_length, result->data_len + 16);
+    if (!quic_decrypt_again_buffer(key->hd, again, buffer, result->data_len)) {
+        return NULL;
+    }
+    quic_decrypted_keep(result, buffer);
+    return buffer;
+}
+
+static void
+quic_decrypted_init(void)
+{
+    quic_decrypted = g_ptr_array_new();
+}
+
+static void
+quic_decrypted_cleanup(void)
+{
+    GSList *link;
+
+    for (link = quic_pp_keys_opened; link; link = link->next) {
+        quic_pp_key_t *key = (quic_pp_key_t *)link->data;
+
+        gcry_cipher_close(key->hd);
+        key->hd = NULL;
+    }
+    g_slist_free(quic_pp_keys_opened);
+    quic_pp_keys_opened = NULL;
+    g_ptr_array_free(quic_decrypted, true);
+    quic_decrypted = NULL;
+}
+/* }}} */
 
 /**
  * Given a QUIC message (header + non-empty payload), the actual packet number,
@@ -2970,6 +3264,19 @@ quic_decrypt_message(quic_pp_cipher *pp_cipher, tvbuff_t *head, unsigned header_
     result->error = NULL;
     result->data = buffer;
     result->data_len = buffer_length;
+
+    if (pp_cipher->key && decrypt_cache_limit()) {
+        quic_decrypt_again_t *again = wmem_new(wmem_file_scope(), quic_decrypt_again_t);
+
+        again->key = pp_cipher->key;
+        memcpy(again->nonce, nonce, sizeof(again->nonce));
+        again->header = (uint8_t *)wmem_memdup(wmem_file_scope(), header, header_length);
+        again->header_length = header_length;
+        again->frame_num = pinfo->num;
+        again->file_off = pinfo->fd->file_off;
+        again->frame_offset = quic_frame_offset(pinfo, head, header_length, buffer_length + 16);
+        result->again = again;
+    }
 }
 
 static bool
@@ -3167,7 +3474,7 @@ quic_pp_cipher_prepare(quic_pp_cipher *pp_cipher, int hash_algo, int cipher_algo
 
     if (secret) {
         unsigned cipher_keylen = (uint8_t) gcry_cipher_get_algo_keylen(cipher_algo);
-        if (!quic_pp_cipher_init(pp_cipher, hash_algo, cipher_keylen, secret, version)) {
+        if (!quic_pp_cipher_init(pp_cipher, hash_algo, cipher_algo, cipher_mode, cipher_keylen, secret, version)) {
             quic_pp_cipher_reset(pp_cipher);
             *error = "Failed to derive key material for PP cipher";
             return false;
@@ -3294,7 +3601,8 @@ quic_hp_cipher_init(quic_hp_cipher *hp_cipher, int hash_algo, uint8_t key_length
     return gcry_cipher_setkey(hp_cipher->hp_cipher, hp_key, key_length) == 0;
 }
 static bool
-quic_pp_cipher_init(quic_pp_cipher *pp_cipher, int hash_algo, uint8_t key_length, uint8_t *secret, uint32_t version)
+quic_pp_cipher_init(quic_pp_cipher *pp_cipher, int hash_algo, int cipher_algo, int cipher_mode,
+                    uint8_t key_length, uint8_t *secret, uint32_t version)
 {
     unsigned char      write_key[256/8];   /* Maximum key size is for AES256 cipher. */
     unsigned    hash_len = gcry_md_get_algo_dlen(hash_algo);
@@ -3310,6 +3618,15 @@ quic_pp_cipher_init(quic_pp_cipher *pp_cipher, int hash_algo, uint8_t key_length
         return false;
     }
 
+    if (decrypt_cache_limit()) {
+        /* Packets may have to be decrypted again after this cipher is gone. */
+        pp_cipher->key = wmem_new0(wmem_file_scope(), quic_pp_key_t);
+        pp_cipher->key->cipher_algo = cipher_algo;
+        pp_cipher->key->cipher_mode = cipher_mode;
+        pp_cipher->key->key_length = key_length;
+        memcpy(pp_cipher->key->key, write_key, key_length);
+    }
+
     return gcry_cipher_setkey(pp_cipher->pp_cipher, write_key, key_length) == 0;
 }
 
@@ -3523,6 +3840,7 @@ quic_process_payload(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, proto_
                      quic_pp_cipher *pp_cipher, uint8_t first_byte, unsigned pkn_len)
 {
     quic_decrypt_result_t *decryption = &quic_packet->decryption;
+    const uint8_t *decryption_data = NULL;
 
     /*
      * If no decryption error has occurred yet, try decryption on the first
@@ -3531,14 +3849,27 @@ quic_process_payload(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, proto_
     if (!PINFO_FD_VISITED(pinfo)) {
         if (!quic_packet->decryption.error && quic_is_pp_cipher_initialized(pp_cipher)) {
             quic_decrypt_message(pp_cipher, tvb, offset, first_byte, pkn_len, quic_packet->packet_number, &quic_packet->decryption, pinfo);
+            if (!decryption->error && decryption->again) {
+                /* The data now goes to the decrypted data cache. */
+                decryption->again->index = quic_decrypted->len;
+                g_ptr_array_add(quic_decrypted, decryption);
+                quic_decrypted_keep(decryption, decryption->data);
+                wmem_free(wmem_file_scope(), (void *)decryption->data);
+                decryption->data = NULL;
+            }
         }
     }
 
     if (decryption->error) {
         expert_add_info_format(pinfo, ti, &ei_quic_decryption_failed,
                                "Decryption failed: %s", decryption->error);
+    } else if (decryption->again && decryption->data_len &&
+               !(decryption_data = quic_decrypted_data(pinfo, decryption, tvb, offset))) {
+        expert_add_info_format(pinfo, ti, &ei_quic_decryption_failed,
+                               "Decryption failed: the dropped decrypted data can't be decrypted again");
     } else if (decryption->data_len) {
-        tvbuff_t *decrypted_tvb = tvb_new_child_real_data(tvb, decryption->data,
+        const uint8_t *data = decryption->again ? decryption_data : decryption->data;
+        tvbuff_t *decrypted_tvb = tvb_new_child_real_data(tvb, data,
                 decryption->data_len, decryption->data_len);
         add_new_data_source(pinfo, decrypted_tvb, "Decrypted QUIC");
 
@@ -5744,6 +6075,8 @@ proto_register_quic(void)
 
     register_init_routine(quic_init);
     register_cleanup_routine(quic_cleanup);
+    register_init_routine(quic_decrypted_init);
+    register_cleanup_routine(quic_decrypted_cleanup);
 
     register_follow_stream(proto_quic, "quic_follow", quic_follow_conv_filter, quic_follow_index_filter, udp_follow_address_filter,
                            udp_port_to_display, follow_quic_tap_listener, get_quic_connections_count,
@@ -27,6 +27,7 @@
 #include <epan/decode_as.h>
 #include <epan/exported_pdu.h>
 #include <epan/in_cksum.h>
+#include <epan/checksum_prepass.h>
 #include <epan/proto_data.h>
 #include <epan/tfs.h>
 #include <epan/unit_strings.h>
@@ -8856,11 +8857,15 @@ dissect_tcp(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, void* data _U_)
             expert_add_info(pinfo, tf, &ei_tcp_connection_fin_active);
         } else {
             expert_add_info(pinfo, tf, &ei_tcp_connection_fin_passive);
+            /* Both sides have closed, so the conversation can be
+             * expired soon after it goes quiet. */
+            conversation_set_closed(conv);
         }
     }
     if(tcph->th_flags & TH_RST){
         /* XXX - find a way to know the server port and output only that one */
         expert_add_info(pinfo, tf_rst, &ei_tcp_connection_rst);
+        conversation_set_closed(conv);
 
     }
     if(tcp_analyze_seq
@@ -9009,8 +9014,14 @@ dissect_tcp(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, void* data _U_)
              * checksum offloading in Linux and Windows (and possibly others.)
              */
             uint16_t partial_cksum;
-            SET_CKSUM_VEC_TVB(cksum_vec[3], tvb, offset, reported_len);
-            computed_cksum = in_cksum_ret_partial(cksum_vec, 4, &partial_cksum);
+            if (checksum_prepass_good(pinfo, CKSUM_PREPASS_TCP)) {
+                /* The checksum pre-pass found it to be good, and not 0xFFFF. */
+                computed_cksum = 0;
+                partial_cksum = 0;
+            } else {
+                SET_CKSUM_VEC_TVB(cksum_vec[3], tvb, offset, reported_len);
+                computed_cksum = in_cksum_ret_partial(cksum_vec, 4, &partial_cksum);
+            }
             if (computed_cksum == 0 && th_sum == 0xffff) {
                 item = proto_tree_add_uint_format_value(tcp_tree, hf_tcp_checksum, tvb,
                                                   offset + 16, 2, th_sum,
@@ -9391,6 +9402,73 @@ tcp_init(void)
     mptcp_tokens = wmem_tree_new(wmem_file_scope());
 }
 
+static size_t
+tcp_flow_expire(tcp_flow_t *flow)
+{
+    size_t freed = 0;
+
+    if (flow->tcp_analyze_seq_info) {
+        tcp_unacked_t *ual, *next;
+
+        for (ual = flow->tcp_analyze_seq_info->segments; ual; ual = next) {
+            next = ual->next;
+            wmem_free(wmem_file_scope(), ual);
+            freed += sizeof *ual;
+        }
+        wmem_free(wmem_file_scope(), flow->tcp_analyze_seq_info);
+        freed += sizeof(tcp_analyze_seq_flow_info_t);
+    }
+    if (flow->process_info) {
+        wmem_free(wmem_file_scope(), flow->process_info->username);
+        wmem_free(wmem_file_scope(), flow->process_info->command);
+        wmem_free(wmem_file_scope(), flow->process_info);
+        freed += sizeof(tcp_process_info_t);
+    }
+    if (flow->multisegment_pdus) {
+        freed += wmem_tree_count(flow->multisegment_pdus) * sizeof(struct tcp_multisegment_pdu);
+        wmem_tree_destroy(flow->multisegment_pdus, false, true);
+    }
+    if (flow->ooo_segments) {
+        wmem_list_frame_t *frame;
+
+        for (frame = wmem_list_head(flow->ooo_segments); frame; frame = wmem_list_frame_next(frame)) {
+            ooo_segment_item *item = (ooo_segment_item *)wmem_list_frame_data(frame);
+
+            freed += sizeof *item + item->len;
+            wmem_free(wmem_file_scope(), item->data);
+            wmem_free(wmem_file_scope(), item);
+        }
+        wmem_destroy_list(flow->ooo_segments);
+    }
+    return freed;
+}
+
+/*
+ * Free the TCP conversation data of an expired conversation; see
+ * conversation_expire().
+ */
+static size_t
+tcp_conversation_expire(conversation_t *conv _U_, void *proto_data)
+{
+    struct tcp_analysis *tcpd = (struct tcp_analysis *)proto_data;
+    size_t freed;
+
+    /* MPTCP connections refer to their subflows' data. */
+    if (tcpd->mptcp_analysis)
+        return 0;
+
+    freed = sizeof *tcpd;
+    freed += tcp_flow_expire(&tcpd->flow1);
+    freed += tcp_flow_expire(&tcpd->flow2);
+    if (tcpd->acked_table) {
+        freed += wmem_tree_count(tcpd->acked_table) * sizeof(struct tcp_acked);
+        wmem_tree_destroy(tcpd->acked_table, false, true);
+    }
+    wmem_free(wmem_file_scope(), tcpd->conversation_completeness_str);
+    wmem_free(wmem_file_scope(), tcpd);
+    return freed;
+}
+
 void
 proto_register_tcp(void)
 {
@@ -10486,6 +10564,7 @@ proto_register_tcp(void)
 
     proto_tcp = proto_register_protocol("Transmission Control Protocol", "TCP", "tcp");
     tcp_handle = register_dissector("tcp", dissect_tcp, proto_tcp);
+    conversation_register_expire_routine(proto_tcp, tcp_conversation_expire);
     tcp_cap_handle = register_capture_dissector("tcp", capture_tcp, proto_tcp);
     proto_register_field_array(proto_tcp, hf, array_length(hf));
     proto_register_subtree_array(ett, array_length(ett));
@@ -43,6 +43,7 @@ typedef zng_stream zlib_stream;
 #include <wsutil/filesystem.h>
 #include <wsutil/file_util.h>
 #include <wsutil/str_util.h>
+#include <wsutil/tempfile.h>
 #include <wsutil/report_message.h>
 #include <wsutil/pint.h>
 #include <wsutil/strtoi.h>
@@ -4555,6 +4556,7 @@ ssl_generate_pre_master_secret(SslDecryptSession *ssl_session,
     }
 
     /* check to see if the PMS was provided to us*/
+    tls_keylog_load_client_random(mk_map, &ssl_session->client_random);
     if (ssl_restore_master_key(ssl_session, "Unencrypted pre-master secret", true,
            mk_map->pms, &ssl_session->client_random)) {
         return true;
@@ -6253,6 +6255,443 @@ ssl_get_record_info(tvbuff_t *parent_tvb, int proto, packet_info *pinfo, int rec
 }
 /* Links SSL records with the real packet data. }}} */
 
+/* Key log index. {{{ */
+/*
+ * With the keylog_index preference, the key log isn't loaded at once. The
+ * lines keyed by a Client Random are instead indexed once, sorted by Client
+ * Random, in a temporary file, and the lines of a Client Random are loaded
+ * when its secrets are looked up. The other lines (RSA) are loaded at once,
+ * and so are lines appended to the key log after it was indexed.
+ */
+
+/* Number of index records sorted in memory at a time. */
+#define TLS_KEYLOG_INDEX_RUN_RECS   (1024 * 1024)
+
+typedef struct {
+    uint8_t     crandom[8];     /* The start of the Client Random */
+    uint64_t    offset;         /* of the line in the key log */
+} tls_keylog_index_rec_t;
+
+typedef struct {
+    FILE       *fp;
+    uint64_t    left;           /* records left after rec */
+    tls_keylog_index_rec_t rec;
+} tls_keylog_index_run_t;
+
+static bool tls_keylog_index_enabled;
+
+static struct {
+    char       *keylog_path;
+    ws_statb64  keylog_stat;
+    int64_t     indexed_len;    /* The length of the key log that is indexed */
+    FILE       *keylog_file;    /* For reading the indexed lines */
+    char       *index_path;
+    FILE       *index_file;
+    uint64_t    num_recs;
+    GArray     *other_lines;    /* Offsets of the lines not in the index */
+    GHashTable *fetched;        /* mk_map -> set of Client Random starts loaded */
+} keylog_index;
+
+static void
+tls_keylog_index_free(void)
+{
+    if (keylog_index.index_file) {
+        fclose(keylog_index.index_file);
+    }
+    if (keylog_index.index_path) {
+        ws_unlink(keylog_index.index_path);
+        g_free(keylog_index.index_path);
+    }
+    if (keylog_index.keylog_file) {
+        fclose(keylog_index.keylog_file);
+    }
+    g_free(keylog_index.keylog_path);
+    if (keylog_index.other_lines) {
+        g_array_free(keylog_index.other_lines, true);
+    }
+    if (keylog_index.fetched) {
+        g_hash_table_destroy(keylog_index.fetched);
+    }
+    memset(&keylog_index, 0, sizeof(keylog_index));
+}
+
+static int
+tls_keylog_index_rec_cmp(const void *a, const void *b)
+{
+    const tls_keylog_index_rec_t *rec_a = (const tls_keylog_index_rec_t *)a;
+    const tls_keylog_index_rec_t *rec_b = (const tls_keylog_index_rec_t *)b;
+    int ret = memcmp(rec_a->crandom, rec_b->crandom, sizeof(rec_a->crandom));
+
+    if (ret != 0) {
+        return ret;
+    }
+    /* Keep the lines in file order, later lines override earlier ones. */
+    return rec_a->offset < rec_b->offset ? -1 : rec_a->offset > rec_b->offset;
+}
+
+/* Reads a whole line, however long, including its line end. */
+static bool
+tls_keylog_read_line(FILE *fp, GString *line)
+{
+    char buf[1110];
+
+    g_string_truncate(line, 0);
+    while (fgets(buf, sizeof(buf), fp)) {
+        g_string_append(line, buf);
+        if (line->str[line->len - 1] == '\n') {
+            break;
+        }
+    }
+    return line->len > 0;
+}
+
+/*
+ * Checks, without the regex, whether the line is keyed by a Client Random,
+ * and returns the start of the Client Random if it is.
+ */
+static bool
+tls_keylog_line_crandom(const char *line, size_t len, uint8_t *crandom)
+{
+    static const char *labels[] = {
+        "CLIENT_RANDOM",
+        "PMS_CLIENT_RANDOM",
+        "CLIENT_EARLY_TRAFFIC_SECRET",
+        "CLIENT_HANDSHAKE_TRAFFIC_SECRET",
+        "SERVER_HANDSHAKE_TRAFFIC_SECRET",
+        "CLIENT_TRAFFIC_SECRET_0",
+        "SERVER_TRAFFIC_SECRET_0",
+        "EARLY_EXPORTER_SECRET",
+        "EXPORTER_SECRET",
+        "ECH_SECRET",
+        "ECH_CONFIG",
+    };
+    const char *space, *hex;
+    size_t label_len;
+    unsigned i;
+
+    space = (const char *)memchr(line, ' ', len);
+    if (!space) {
+        return false;
+    }
+    label_len = space - line;
+    for (i = 0; i < G_N_ELEMENTS(labels); i++) {
+        if (strlen(labels[i]) == label_len && memcmp(labels[i], line, label_len) == 0) {
+            break;
+        }
+    }
+    if (i == G_N_ELEMENTS(labels)) {
+        return false;
+    }
+
+    hex = space + 1;
+    if (label_len + 1 + 64 + 1 > len || hex[64] != ' ') {
+        return false;
+    }
+    for (i = 0; i < 64; i++) {
+        if (!g_ascii_isxdigit(hex[i])) {
+            return false;
+        }
+    }
+    for (i = 0; i < 8; i++) {
+        crandom[i] = (g_ascii_xdigit_value(hex[2 * i]) << 4) | g_ascii_xdigit_value(hex[2 * i + 1]);
+    }
+    return true;
+}
+
+static FILE *
+tls_keylog_index_tempfile(char **path)
+{
+    GError *err = NULL;
+    FILE *fp;
+    int fd;
+
+    fd = create_tempfile(NULL, path, "wireshark_tls_keylog", NULL, &err);
+    if (fd == -1) {
+        ssl_debug_printf("%s can't create a temporary file: %s\n", G_STRFUNC, err->message);
+        g_error_free(err);
+        return NULL;
+    }
+    fp = ws_fdopen(fd, "w+b");
+    if (!fp) {
+        ws_close(fd);
+        ws_unlink(*path);
+        g_free(*path);
+        *path = NULL;
+    }
+    return fp;
+}
+
+/* Sorts the records and appends them to the file of sorted runs. */
+static bool
+tls_keylog_index_write_run(FILE **runs_file, char **runs_path,
+                           tls_keylog_index_rec_t *run, unsigned run_len)
+{
+    if (!*runs_file) {
+        *runs_file = tls_keylog_index_tempfile(runs_path);
+        if (!*runs_file) {
+            return false;
+        }
+    }
+    qsort(run, run_len, sizeof(*run), tls_keylog_index_rec_cmp);
+    return fwrite(run, sizeof(*run), run_len, *runs_file) == run_len;
+}
+
+static void
+tls_keylog_index_sift_down(tls_keylog_index_run_t **heap, unsigned n, unsigned i)
+{
+    for (;;) {
+        unsigned min = i, left = 2 * i + 1, right = 2 * i + 2;
+        tls_keylog_index_run_t *tmp;
+
+        if (left < n && tls_keylog_index_rec_cmp(&heap[left]->rec, &heap[min]->rec) < 0) {
+            min = left;
+        }
+        if (right < n && tls_keylog_index_rec_cmp(&heap[right]->rec, &heap[min]->rec) < 0) {
+            min = right;
+        }
+        if (min == i) {
+            return;
+        }
+        tmp = heap[i];
+        heap[i] = heap[min];
+        heap[min] = tmp;
+        i = min;
+    }
+}
+
+/* Merges the sorted runs into the index file. */
+static bool
+tls_keylog_index_merge(const char *runs_path, GArray *run_lens, FILE *out)
+{
+    tls_keylog_index_run_t *runs = g_new0(tls_keylog_index_run_t, run_lens->len);
+    tls_keylog_index_run_t **heap = g_new(tls_keylog_index_run_t *, run_lens->len);
+    uint64_t start = 0;
+    unsigned n = 0;
+    bool ok = true;
+
+    for (unsigned i = 0; ok && i < run_lens->len; i++) {
+        tls_keylog_index_run_t *run = &runs[i];
+
+        run->fp = ws_fopen(runs_path, "rb");
+        ok = run->fp &&
+             ws_fseek64(run->fp, start * sizeof(run->rec), SEEK_SET) == 0 &&
+             fread(&run->rec, sizeof(run->rec), 1, run->fp) == 1;
+        run->left = g_array_index(run_lens, unsigned, i) - 1;
+        start += g_array_index(run_lens, unsigned, i);
+        heap[n++] = run;
+    }
+    for (unsigned i = n / 2; ok && i-- > 0; ) {
+        tls_keylog_index_sift_down(heap, n, i);
+    }
+    while (ok && n > 0) {
+        tls_keylog_index_run_t *run = heap[0];
+
+        ok = fwrite(&run->rec, sizeof(run->rec), 1, out) == 1;
+        if (run->left > 0) {
+            ok = ok && fread(&run->rec, sizeof(run->rec), 1, run->fp) == 1;
+            run->left--;
+        } else {
+            heap[0] = heap[--n];
+        }
+        tls_keylog_index_sift_down(heap, n, 0);
+    }
+
+    for (unsigned i = 0; i < run_lens->len; i++) {
+        if (runs[i].fp) {
+            fclose(runs[i].fp);
+        }
+    }
+    g_free(heap);
+    g_free(runs);
+    return ok;
+}
+
+/*
+ * Indexes the complete lines of the key log. As there can be more records
+ * than should be kept in memory, they are sorted in runs, which are then
+ * merged.
+ */
+static bool
+tls_keylog_index_build(FILE *keylog_file)
+{
+    tls_keylog_index_rec_t *run;
+    unsigned run_len = 0;
+    GArray *run_lens;
+    char *runs_path = NULL;
+    FILE *runs_file = NULL;
+    GString *line;
+    int64_t offset = 0;
+    bool ok = true;
+
+    keylog_index.index_file = tls_keylog_index_tempfile(&keylog_index.index_path);
+    if (!keylog_index.index_file) {
+        return false;
+    }
+
+    run = g_new(tls_keylog_index_rec_t, TLS_KEYLOG_INDEX_RUN_RECS);
+    run_lens = g_array_new(false, false, sizeof(unsigned));
+    line = g_string_new(NULL);
+    rewind(keylog_file);
+    while (ok && tls_keylog_read_line(keylog_file, line)) {
+        if (line->str[line->len - 1] != '\n') {
+            /* It may still be being written, load it later. */
+            break;
+        }
+        if (tls_keylog_line_crandom(line->str, line->len, run[run_len].crandom)) {
+            run[run_len++].offset = offset;
+            keylog_index.num_recs++;
+            if (run_len == TLS_KEYLOG_INDEX_RUN_RECS) {
+                ok = tls_keylog_index_write_run(&runs_file, &runs_path, run, run_len);
+                g_array_append_val(run_lens, run_len);
+                run_len = 0;
+            }
+        } else if (line->str[0] != '#' && !g_ascii_isspace(line->str[0])) {
+            g_array_append_val(keylog_index.other_lines, offset);
+        }
+        offset += line->len;
+    }
+    ok = ok && !ferror(keylog_file);
+
+    if (ok && run_lens->len == 0) {
+        /* A single run, no need to merge it. */
+        qsort(run, run_len, sizeof(*run), tls_keylog_index_rec_cmp);
+        ok = fwrite(run, sizeof(*run), run_len, keylog_index.index_file) == run_len;
+    } else if (ok) {
+        if (run_len > 0) {
+            ok = tls_keylog_index_write_run(&runs_file, &runs_path, run, run_len);
+            g_array_append_val(run_lens, run_len);
+        }
+        ok = ok && fflush(runs_file) == 0 &&
+             tls_keylog_index_merge(runs_path, run_lens, keylog_index.index_file);
+    }
+    ok = ok && fflush(keylog_index.index_file) == 0;
+    keylog_index.indexed_len = offset;
+
+    if (runs_file) {
+        fclose(runs_file);
+        ws_unlink(runs_path);
+        g_free(runs_path);
+    }
+    g_string_free(line, true);
+    g_array_free(run_lens, true);
+    g_free(run);
+    return ok;
+}
+
+static bool
+tls_keylog_index_read(uint64_t i, tls_keylog_index_rec_t *rec)
+{
+    return ws_fseek64(keylog_index.index_file, i * sizeof(*rec), SEEK_SET) == 0 &&
+           fread(rec, sizeof(*rec), 1, keylog_index.index_file) == 1;
+}
+
+/*
+ * Makes sure the index of the key log is up to date, loads the lines that
+ * are not in it, and leaves keylog_file after the indexed part, so that
+ * ssl_load_keyfile loads the lines appended after it as usual.
+ */
+static bool
+tls_keylog_index_attach(const char *keylog_filename, FILE *keylog_file,
+                        const ssl_master_key_map_t *mk_map)
+{
+    ws_statb64 st;
+    GString *line;
+
+    if (ws_fstat64(ws_fileno(keylog_file), &st) != 0) {
+        return false;
+    }
+
+    if (!keylog_index.keylog_path || strcmp(keylog_index.keylog_path, keylog_filename) != 0 ||
+        keylog_index.keylog_stat.st_dev != st.st_dev ||
+        keylog_index.keylog_stat.st_ino != st.st_ino ||
+        st.st_size < keylog_index.indexed_len) {
+        tls_keylog_index_free();
+        ssl_debug_printf("%s indexing %s\n", G_STRFUNC, keylog_filename);
+        keylog_index.keylog_path = g_strdup(keylog_filename);
+        keylog_index.keylog_stat = st;
+        keylog_index.other_lines = g_array_new(false, false, sizeof(int64_t));
+        keylog_index.fetched = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                                     NULL, (GDestroyNotify)g_hash_table_destroy);
+        keylog_index.keylog_file = ws_fopen(keylog_filename, "rb");
+        if (!keylog_index.keylog_file || !tls_keylog_index_build(keylog_file)) {
+            ssl_debug_printf("%s failed to index the key log\n", G_STRFUNC);
+            tls_keylog_index_free();
+            rewind(keylog_file);
+            return false;
+        }
+        ssl_debug_printf("%s indexed %" PRIu64 " lines\n", G_STRFUNC, keylog_index.num_recs);
+    }
+
+    g_hash_table_insert(keylog_index.fetched, (void *)mk_map,
+                        g_hash_table_new_full(g_int64_hash, g_int64_equal, g_free, NULL));
+
+    line = g_string_new(NULL);
+    for (unsigned i = 0; i < keylog_index.other_lines->len; i++) {
+        if (ws_fseek64(keylog_index.keylog_file, g_array_index(keylog_index.other_lines, int64_t, i), SEEK_SET) == 0 &&
+            tls_keylog_read_line(keylog_index.keylog_file, line)) {
+            tls_keylog_process_lines(mk_map, (const uint8_t *)line->str, (unsigned)line->len);
+        }
+    }
+    g_string_free(line, true);
+
+    if (ws_fseek64(keylog_file, keylog_index.indexed_len, SEEK_SET) != 0) {
+        rewind(keylog_file);
+    }
+    return true;
+}
+
+void
+tls_keylog_load_client_random(const ssl_master_key_map_t *mk_map, const StringInfo *client_random)
+{
+    tls_keylog_index_rec_t rec;
+    GHashTable *fetched;
+    uint64_t crandom_start, low, high;
+    GString *line;
+
+    if (!keylog_index.fetched || client_random->data_len != 32) {
+        return;
+    }
+    fetched = (GHashTable *)g_hash_table_lookup(keylog_index.fetched, mk_map);
+    if (!fetched) {
+        return;
+    }
+    memcpy(&crandom_start, client_random->data, sizeof(crandom_start));
+    if (g_hash_table_contains(fetched, &crandom_start)) {
+        return;
+    }
+    g_hash_table_add(fetched, g_memdup2(&crandom_start, sizeof(crandom_start)));
+
+    /* Find the first record of the Client Random. */
+    low = 0;
+    high = keylog_index.num_recs;
+    while (low < high) {
+        uint64_t mid = low + (high - low) / 2;
+
+        if (!tls_keylog_index_read(mid, &rec)) {
+            return;
+        }
+        if (memcmp(rec.crandom, client_random->data, sizeof(rec.crandom)) < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    line = g_string_new(NULL);
+    for (; low < keylog_index.num_recs; low++) {
+        if (!tls_keylog_index_read(low, &rec) ||
+            memcmp(rec.crandom, client_random->data, sizeof(rec.crandom)) != 0) {
+            break;
+        }
+        if (ws_fseek64(keylog_index.keylog_file, rec.offset, SEEK_SET) == 0 &&
+            tls_keylog_read_line(keylog_index.keylog_file, line)) {
+            tls_keylog_process_lines(mk_map, (const uint8_t *)line->str, (unsigned)line->len);
+        }
+    }
+    g_string_free(line, true);
+}
+/* Key log index. }}} */
+
 /* initialize/reset per capture state data (ssl sessions cache). {{{ */
 void
 ssl_common_init(ssl_master_key_map_t *mk_map,
@@ -6302,6 +6741,10 @@ ssl_common_cleanup(ssl_master_key_map_t *mk_map, FILE **ssl_keylog_file,
 
     g_hash_table_destroy(mk_map->used_crandom);
 
+    if (keylog_index.fetched) {
+        g_hash_table_remove(keylog_index.fetched, mk_map);
+    }
+
     g_free(decrypted_data->data);
     g_free(compressed_data->data);
 
@@ -6509,6 +6952,9 @@ ssl_finalize_decryption(SslDecryptSession *ssl, ssl_master_key_map_t *mk_map)
     /* for decryption, there needs to be a master secret (which can be derived
      * from pre-master secret). If missing, try to pick a master key from cache
      * (an earlier packet in the capture or key logfile). */
+    if (!(ssl->state & (SSL_MASTER_SECRET | SSL_PRE_MASTER_SECRET))) {
+        tls_keylog_load_client_random(mk_map, &ssl->client_random);
+    }
     if (!(ssl->state & (SSL_MASTER_SECRET | SSL_PRE_MASTER_SECRET)) &&
         !ssl_restore_master_key(ssl, "Session ID", false,
                                 mk_map->session, &ssl->session_id) &&
@@ -6595,6 +7041,7 @@ tls13_load_secret(SslDecryptSession *ssl, ssl_master_key_map_t *mk_map,
     ssl_debug_printf("%s transitioning to new key, old state 0x%02x\n", G_STRFUNC, ssl->state);
     ssl->state &= ~(SSL_MASTER_SECRET | SSL_PRE_MASTER_SECRET | SSL_HAVE_SESSION_KEY);
 
+    tls_keylog_load_client_random(mk_map, &ssl->client_random);
     StringInfo *secret = (StringInfo *)g_hash_table_lookup(key_map, &ssl->client_random);
     if (!secret) {
         ssl_debug_printf("%s Cannot find %s, decryption impossible\n", G_STRFUNC, label);
@@ -6950,11 +7397,19 @@ ssl_load_keyfile(const char *tls_keylog_filename, FILE **keylog_file,
     }
 
     if (*keylog_file == NULL) {
-        *keylog_file = ws_fopen(tls_keylog_filename, "r");
+        /* The index has byte offsets, which text mode would break. */
+        *keylog_file = ws_fopen(tls_keylog_filename, tls_keylog_index_enabled ? "rb" : "r");
         if (!*keylog_file) {
             ssl_debug_printf("%s failed to open SSL keylog\n", G_STRFUNC);
             return;
         }
+        if (tls_keylog_index_enabled) {
+            if (!tls_keylog_index_attach(tls_keylog_filename, *keylog_file, mk_map)) {
+                ssl_debug_printf("%s loading the whole key log\n", G_STRFUNC);
+            }
+        } else if (keylog_index.keylog_path) {
+            tls_keylog_index_free();
+        }
     }
 
     for (;;) {
@@ -9726,6 +10181,7 @@ ssl_dissect_hnd_hello_ext_ech(ssl_common_dissect_t *hf, tvbuff_t *tvb, packet_in
                 ssl_debug_printf("%s missing Client Random\n", G_STRFUNC);
                 break;
             }
+            tls_keylog_load_client_random(mk_map, &session->client_random);
             StringInfo *ech_secret = (StringInfo *)g_hash_table_lookup(mk_map->ech_secret, &session->client_random);
             StringInfo *ech_config = (StringInfo *)g_hash_table_lookup(mk_map->ech_config, &session->client_random);
             if (!ech_secret || !ech_config) {
@@ -12622,6 +13078,14 @@ ssl_common_register_options(module_t *module, ssl_common_options_t *options, boo
              "\n"
              "(All fields are in hex notation)",
              &(options->keylog_filename), false);
+
+        prefs_register_bool_preference(module, "keylog_index", "Index the (Pre)-Master-Secret log",
+             "Index the (Pre)-Master-Secret log by Client Random in a temporary file "
+             "and only load the secrets of the sessions found in the capture, "
+             "rather than the whole log. This is faster and uses less memory "
+             "with very large logs.",
+             &tls_keylog_index_enabled);
+        register_shutdown_routine(tls_keylog_index_free);
 }
 
 void
@@ -812,6 +812,10 @@ extern void
 ssl_load_keyfile(const char *ssl_keylog_filename, FILE **keylog_file,
                  const ssl_master_key_map_t *mk_map);
 
+/* loads the secrets of the Client Random if the key log is indexed */
+extern void
+tls_keylog_load_client_random(const ssl_master_key_map_t *mk_map, const StringInfo *client_random);
+
 #ifdef HAVE_LIBGNUTLS
 /* parse ssl related preferences (private keys and ports association strings) */
 extern void
@@ -4230,6 +4230,7 @@ tls13_get_quic_secret(packet_info *pinfo, bool is_from_server, int type, unsigne
         ws_assert_not_reached();
     }
 
+    tls_keylog_load_client_random(&ssl_master_key_map, &ssl->client_random);
     StringInfo *secret = (StringInfo *)g_hash_table_lookup(key_map, &ssl->client_random);
     if (!secret || secret->data_len < secret_min_len || secret->data_len > secret_max_len) {
         ssl_debug_printf("%s Cannot find QUIC %s of size %d..%d, found bad size %d!\n",
@@ -4359,6 +4360,7 @@ tls13_exporter(packet_info *pinfo, bool is_early,
     ssl_load_keyfile(ssl_options.keylog_filename, &ssl_keylog_file, &ssl_master_key_map);
     key_map = is_early ? ssl_master_key_map.tls13_early_exporter
                        : ssl_master_key_map.tls13_exporter;
+    tls_keylog_load_client_random(&ssl_master_key_map, &ssl_session->client_random);
     secret = (StringInfo *)g_hash_table_lookup(key_map, &ssl_session->client_random);
     if (!secret) {
         return false;
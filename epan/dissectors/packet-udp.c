@@ -18,6 +18,7 @@
 #include <epan/addr_resolv.h>
 #include <epan/ipproto.h>
 #include <epan/in_cksum.h>
+#include <epan/checksum_prepass.h>
 #include <epan/prefs.h>
 #include <epan/follow.h>
 #include <epan/expert.h>
@@ -1166,8 +1167,14 @@ dissect(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, uint32_t ip_proto)
              * same argument as above.
              */
             uint16_t partial_cksum;
-            SET_CKSUM_VEC_TVB(cksum_vec[3], tvb, offset, udph->uh_sum_cov);
-            computed_cksum = in_cksum_ret_partial(&cksum_vec[0], 4, &partial_cksum);
+            if (ip_proto == IP_PROTO_UDP && checksum_prepass_good(pinfo, CKSUM_PREPASS_UDP)) {
+                /* The checksum pre-pass found it to be good. */
+                computed_cksum = 0;
+                partial_cksum = 0;
+            } else {
+                SET_CKSUM_VEC_TVB(cksum_vec[3], tvb, offset, udph->uh_sum_cov);
+                computed_cksum = in_cksum_ret_partial(&cksum_vec[0], 4, &partial_cksum);
+            }
             uint16_t shouldbe_cksum = in_cksum_shouldbe(udph->uh_sum, computed_cksum);
             if (computed_cksum != 0 && udph->uh_sum == g_htons(partial_cksum)) {
                 /* Don't use PROTO_CHECKSUM_IN_CKSUM because we expect the value
@@ -1310,6 +1317,31 @@ udp_init(void)
     udp_stream_count = 0;
 }
 
+/*
+ * Free the UDP conversation data of an expired conversation; see
+ * conversation_expire().
+ */
+static size_t
+udp_conversation_expire(conversation_t *conv _U_, void *proto_data)
+{
+    struct udp_analysis *udpd = (struct udp_analysis *)proto_data;
+    udp_flow_t *flows[] = { &udpd->flow1, &udpd->flow2 };
+    size_t freed = sizeof *udpd;
+
+    for (unsigned i = 0; i < G_N_ELEMENTS(flows); i++) {
+        if (flows[i]->username) {
+            freed += strlen(flows[i]->username) + 1;
+            wmem_free(wmem_file_scope(), flows[i]->username);
+        }
+        if (flows[i]->command) {
+            freed += strlen(flows[i]->command) + 1;
+            wmem_free(wmem_file_scope(), flows[i]->command);
+        }
+    }
+    wmem_free(wmem_file_scope(), udpd);
+    return freed;
+}
+
 void
 proto_register_udp(void)
 {
@@ -1460,6 +1492,7 @@ proto_register_udp(void)
     proto_udp = proto_register_protocol("User Datagram Protocol", "UDP", "udp");
     proto_register_field_array(proto_udp, hf_udp, array_length(hf_udp));
     udp_handle = register_dissector("udp", dissect_udp, proto_udp);
+    conversation_register_expire_routine(proto_udp, udp_conversation_expire);
     udp_cap_handle = register_capture_dissector("udp", capture_udp, proto_udp);
     expert_udp = expert_register_protocol(proto_udp);
 
@@ -24,6 +24,7 @@
 #include <epan/prefs.h>
 #include <epan/proto_data.h>
 #include <epan/conversation.h>
+#include <epan/decrypt_cache.h>
 #include <epan/uat.h>
 #include <wsutil/file_util.h>
 #include <wsutil/filesystem.h>
@@ -1324,11 +1325,20 @@ wg_dissect_decrypted_packet(tvbuff_t *tvb, packet_info *pinfo, proto_tree *wg_tr
 
     DISSECTOR_ASSERT(plain_length >= 0);
     const int ctext_len = plain_length + AUTH_TAG_LENGTH;
-    const unsigned char *ctext = tvb_get_ptr(tvb, 16, ctext_len);
-    unsigned char *plain = (unsigned char *)wmem_alloc0(pinfo->pool, (unsigned)plain_length);
-    if (!wg_aead_decrypt(cipher, counter, ctext, (unsigned)ctext_len, NULL, 0, plain, (unsigned)plain_length)) {
-        proto_tree_add_expert(wg_tree, pinfo, &ei_wg_decryption_error, tvb, 16, ctext_len);
-        return;
+    /* Packets are identified in the decrypted data cache by their offset in the frame. */
+    const unsigned record = (unsigned)tvb_raw_offset(tvb);
+    unsigned cached_length;
+    unsigned char *plain = decrypt_cache_lookup(pinfo->pool, proto_wg, pinfo->num, record, &cached_length);
+    if (!plain || cached_length != (unsigned)plain_length) {
+        const unsigned char *ctext = tvb_get_ptr(tvb, 16, ctext_len);
+        plain = (unsigned char *)wmem_alloc0(pinfo->pool, (unsigned)plain_length);
+        if (!wg_aead_decrypt(cipher, counter, ctext, (unsigned)ctext_len, NULL, 0, plain, (unsigned)plain_length)) {
+            proto_tree_add_expert(wg_tree, pinfo, &ei_wg_decryption_error, tvb, 16, ctext_len);
+            return;
+        }
+        if (plain_length != 0) {
+            decrypt_cache_add(proto_wg, pinfo->num, record, plain, (unsigned)plain_length);
+        }
     }
     if (plain_length == 0) {
         return;
@@ -56,10 +56,12 @@
 #include "conversation_filter.h"
 #include "conversation_table.h"
 #include "reassemble.h"
+#include "tvbuff-int.h"
 #include "srt_table.h"
 #include "stats_tree.h"
 #include "secrets.h"
 #include "funnel.h"
+#include "checksum_prepass.h"
 #include "wscbor.h"
 #include <dtd.h>
 
@@ -112,6 +114,9 @@ static GSList *epan_plugin_register_all_handoffs;
 
 static wmem_allocator_t *pinfo_pool_cache;
 
+/* Number of epan_dissect_t's between init and cleanup */
+static unsigned live_dissections;
+
 /* Global variables holding the content of the corresponding environment variable
  * to save fetching it repeatedly.
  */
@@ -436,6 +441,7 @@ epan_cleanup(void)
 	cleanup_enabled_and_disabled_lists();
 	stats_tree_cleanup();
 	funnel_cleanup();
+	checksum_prepass_cleanup();
 	dtd_location(NULL);
 #ifdef HAVE_LUA
 	wslua_cleanup();
@@ -527,6 +533,21 @@ epan_get_frame_ts(const epan_t *session, uint32_t frame_num)
 	return abs_ts;
 }
 
+bool
+epan_get_frame_data(const epan_t *session, uint32_t frame_num, int64_t file_off, wtap_rec *rec)
+{
+	if (session && session->funcs.get_frame_data)
+		return session->funcs.get_frame_data(session->prov, frame_num, file_off, rec);
+
+	return false;
+}
+
+bool
+epan_can_get_frame_data(const epan_t *session)
+{
+	return session && session->funcs.get_frame_data != NULL;
+}
+
 void
 epan_free(epan_t *session)
 {
@@ -564,6 +585,7 @@ epan_dissect_init(epan_dissect_t *edt, epan_t *session, const bool create_proto_
 {
 	ws_assert(edt);
 
+	live_dissections++;
 	edt->session = session;
 
 	memset(&edt->pi, 0, sizeof(edt->pi));
@@ -572,8 +594,10 @@ epan_dissect_init(epan_dissect_t *edt, epan_t *session, const bool create_proto_
 		pinfo_pool_cache = NULL;
 	}
 	else {
-		edt->pi.pool = wmem_allocator_new(WMEM_ALLOCATOR_BLOCK_FAST);
+		edt->pi.pool = wmem_allocator_new(WMEM_ALLOCATOR_ARENA);
 	}
+	/* Counting allocated bytes costs a hash table insertion per allocation. */
+	wmem_count_bytes_allocated(edt->pi.pool, dissector_profile_is_enabled());
 
 	if (create_proto_tree) {
 		edt->tree = proto_tree_create_root(&edt->pi);
@@ -612,6 +636,10 @@ epan_dissect_reset(epan_dissect_t *edt)
 	if (edt->tree)
 		proto_tree_reset(edt->tree);
 
+	/* Nothing else can be holding pointers to reassembled frame data. */
+	if (live_dissections <= 1)
+		tvb_frame_ref_unload_all();
+
 	tmp = edt->pi.pool;
 	wmem_free_all(tmp);
 
@@ -704,6 +732,7 @@ epan_dissect_cleanup(epan_dissect_t* edt)
 {
 	ws_assert(edt);
 
+	live_dissections--;
 	g_slist_foreach(epan_plugins, epan_plugin_dissect_cleanup, edt);
 
 	g_slist_free(edt->pi.proto_data);
@@ -720,6 +749,9 @@ epan_dissect_cleanup(epan_dissect_t* edt)
 		proto_tree_free(edt->tree);
 	}
 
+	if (live_dissections == 0)
+		tvb_frame_ref_unload_all();
+
 	if (pinfo_pool_cache == NULL) {
 		wmem_free_all(edt->pi.pool);
 		pinfo_pool_cache = edt->pi.pool;
@@ -736,6 +768,12 @@ epan_dissect_free(epan_dissect_t* edt)
 	g_free(edt);
 }
 
+unsigned
+epan_dissect_count(void)
+{
+	return live_dissections;
+}
+
 void
 epan_dissect_prime_with_dfilter(epan_dissect_t *edt, const dfilter_t* dfcode)
 {
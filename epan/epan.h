@@ -31,6 +31,7 @@ typedef struct epan_dissect epan_dissect_t;
 
 struct epan_dfilter;
 struct epan_column_info;
+struct wtap_rec;
 
 /**
  * Opaque structure provided when an epan_t is created; it contains
@@ -49,6 +50,7 @@ struct packet_provider_funcs {
 	const char *(*get_interface_name)(struct packet_provider_data *prov, uint32_t interface_id, unsigned section_number);
 	const char *(*get_interface_description)(struct packet_provider_data *prov, uint32_t interface_id, unsigned section_number);
 	wtap_block_t (*get_modified_block)(struct packet_provider_data *prov, const frame_data *fd);
+	bool (*get_frame_data)(struct packet_provider_data *prov, uint32_t frame_num, int64_t file_off, struct wtap_rec *rec);
 };
 
 /**
@@ -141,6 +143,26 @@ WS_DLL_PUBLIC const char *epan_get_interface_description(const epan_t *session,
 
 const nstime_t *epan_get_frame_ts(const epan_t *session, uint32_t frame_num);
 
+/**
+ * Read the record of a frame that's already been read, e.g. so that data
+ * that refers to it doesn't have to keep a copy of it.
+ *
+ * @param session the session
+ * @param frame_num the frame number
+ * @param file_off the offset of the frame in the capture file, from
+ * its frame_data; the frame might not have been added to the frame data
+ * sequence yet, if it's still being dissected.
+ * @param rec the record to read into; it must have been initialized
+ * @return true if the record was read, false if it wasn't, or if the user
+ * of libwireshark can't read frames back.
+ */
+bool epan_get_frame_data(const epan_t *session, uint32_t frame_num, int64_t file_off, struct wtap_rec *rec);
+
+/**
+ * @return true if epan_get_frame_data() can read frames back in this session.
+ */
+bool epan_can_get_frame_data(const epan_t *session);
+
 WS_DLL_PUBLIC void epan_free(epan_t *session);
 
 WS_DLL_PUBLIC const char*
@@ -245,6 +267,10 @@ WS_DLL_PUBLIC
 void
 epan_dissect_free(epan_dissect_t* edt);
 
+/** the number of packet dissections initialized and not yet cleaned up */
+unsigned
+epan_dissect_count(void);
+
 /** Sets custom column */
 const char *
 epan_custom_set(epan_dissect_t *edt, GSList *ids, int occurrence, bool display_details,
@@ -234,6 +234,7 @@ frame_data_init(frame_data *fdata, uint32_t num, const wtap_rec *rec,
   fdata->abs_ts = rec->ts;
   fdata->has_modified_block = 0;
   fdata->need_colorize = 0;
+  fdata->cksum_good = 0;
   fdata->color_filter = NULL;
   fdata->shift_offset.secs = 0;
   fdata->shift_offset.nsecs = 0;
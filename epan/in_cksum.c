@@ -18,6 +18,8 @@
 #include <epan/tvbuff.h>
 #include <epan/in_cksum.h>
 
+#include <wsutil/ws_ones_sum.h>
+
 /*
  * Checksum routine for Internet Protocol family headers (Portable Version).
  *
@@ -95,28 +97,22 @@ in_cksum_ret_partial(const vec_t *vec, int veclen, uint16_t *partial)
 			byte_swapped = 1;
 		}
 		/*
-		 * Unroll the loop to make overhead from
-		 * branches &c small.
+		 * Sum the whole words with ws_ones_sum16(), which
+		 * is vectorized where the processor allows it; its
+		 * result is already folded to 16 bits, so it can't
+		 * overflow sum however long the chunk is.
 		 */
-		while ((mlen -= 32) >= 0) {
-			sum += w[0]; sum += w[1]; sum += w[2]; sum += w[3];
-			sum += w[4]; sum += w[5]; sum += w[6]; sum += w[7];
-			sum += w[8]; sum += w[9]; sum += w[10]; sum += w[11];
-			sum += w[12]; sum += w[13]; sum += w[14]; sum += w[15];
-			w += 16;
-		}
-		mlen += 32;
-		while ((mlen -= 8) >= 0) {
-			sum += w[0]; sum += w[1]; sum += w[2]; sum += w[3];
-			w += 4;
+		if (mlen >= 2) {
+			REDUCE;
+			sum += ws_ones_sum16((const uint8_t *)w, mlen & ~1);
+			w += mlen / 2;
+			mlen &= 1;
 		}
-		mlen += 8;
 		if (mlen == 0 && byte_swapped == 0)
 			continue;
 		REDUCE;
-		while ((mlen -= 2) >= 0) {
-			sum += *w++;
-		}
+		/* -1 if there's an odd byte left, -2 otherwise */
+		mlen -= 2;
 		if (byte_swapped) {
 			REDUCE;
 			sum <<= 8;
@@ -0,0 +1,144 @@
+/* lru_cache.c
+ * Cache of byte data of limited size, least recently used first out
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib.h>
+
+#include "lru_cache.h"
+
+typedef struct {
+	void		*key;
+	GList		link;		/* in lru, with data pointing to the entry */
+	unsigned	length;
+	uint8_t		data[];
+} lru_cache_entry_t;
+
+struct lru_cache {
+	size_t		key_size;
+	/* key -> lru_cache_entry_t */
+	GHashTable	*entries;
+	/* The entries, least recently used first */
+	GQueue		lru;
+	lru_cache_stats_t stats;
+};
+
+static void
+lru_cache_remove(lru_cache_t *cache, lru_cache_entry_t *entry)
+{
+	g_queue_unlink(&cache->lru, &entry->link);
+	cache->stats.entries--;
+	cache->stats.bytes -= entry->length;
+	g_hash_table_remove(cache->entries, entry->key);
+	g_free(entry->key);
+	g_free(entry);
+}
+
+lru_cache_t *
+lru_cache_new(GHashFunc key_hash, GEqualFunc key_equal, size_t key_size)
+{
+	lru_cache_t *cache = g_new0(lru_cache_t, 1);
+
+	cache->key_size = key_size;
+	cache->entries = g_hash_table_new(key_hash, key_equal);
+	g_queue_init(&cache->lru);
+	return cache;
+}
+
+void
+lru_cache_free(lru_cache_t *cache)
+{
+	lru_cache_entry_t *entry;
+
+	if (cache == NULL)
+		return;
+
+	while ((entry = (lru_cache_entry_t *)g_queue_peek_head(&cache->lru)) != NULL)
+		lru_cache_remove(cache, entry);
+	g_hash_table_destroy(cache->entries);
+	g_free(cache);
+}
+
+void
+lru_cache_add(lru_cache_t *cache, const void *key, const void *data,
+	      unsigned length, size_t limit)
+{
+	lru_cache_entry_t *entry;
+
+	if (length > limit)
+		return;
+
+	entry = (lru_cache_entry_t *)g_hash_table_lookup(cache->entries, key);
+	if (entry)
+		lru_cache_remove(cache, entry);
+
+	while (cache->stats.bytes + length > limit) {
+		lru_cache_remove(cache, (lru_cache_entry_t *)g_queue_peek_head(&cache->lru));
+		cache->stats.evictions++;
+	}
+
+	entry = (lru_cache_entry_t *)g_malloc(sizeof(lru_cache_entry_t) + length);
+	entry->key = g_memdup2(key, cache->key_size);
+	entry->length = length;
+	memcpy(entry->data, data, length);
+	entry->link.data = entry;
+	entry->link.prev = NULL;
+	entry->link.next = NULL;
+	g_queue_push_tail_link(&cache->lru, &entry->link);
+	g_hash_table_insert(cache->entries, entry->key, entry);
+	cache->stats.entries++;
+	cache->stats.bytes += length;
+	cache->stats.additions++;
+}
+
+const uint8_t *
+lru_cache_lookup(lru_cache_t *cache, const void *key, unsigned *length)
+{
+	lru_cache_entry_t *entry;
+
+	entry = (lru_cache_entry_t *)g_hash_table_lookup(cache->entries, key);
+	if (entry == NULL) {
+		cache->stats.misses++;
+		return NULL;
+	}
+	cache->stats.hits++;
+	g_queue_unlink(&cache->lru, &entry->link);
+	g_queue_push_tail_link(&cache->lru, &entry->link);
+
+	*length = entry->length;
+	return entry->data;
+}
+
+bool
+lru_cache_contains(const lru_cache_t *cache, const void *key)
+{
+	return g_hash_table_contains(cache->entries, key);
+}
+
+void
+lru_cache_get_stats(const lru_cache_t *cache, lru_cache_stats_t *stats)
+{
+	*stats = cache->stats;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
@@ -0,0 +1,84 @@
+/** @file
+ *
+ * Cache of byte data of limited size, least recently used first out
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __LRU_CACHE_H__
+#define __LRU_CACHE_H__
+
+#include <glib.h>
+#include "ws_symbol_export.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+ * Entries hold a copy of their key, of a fixed size, and of their data.
+ * The caller gives the limit on the total size of the data each time it
+ * adds an entry, so that it can come from a preference that changes.
+ */
+
+typedef struct lru_cache lru_cache_t;
+
+/** Counters of a cache, since it was created */
+typedef struct {
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t additions;
+	uint64_t evictions;
+	unsigned entries;	/**< Entries in the cache */
+	size_t   bytes;		/**< Data in the cache */
+} lru_cache_stats_t;
+
+/**
+ * Creates a cache whose keys are key_size bytes long, hashed and compared
+ * with key_hash and key_equal.
+ */
+WS_DLL_PUBLIC lru_cache_t *
+lru_cache_new(GHashFunc key_hash, GEqualFunc key_equal, size_t key_size);
+
+/** Frees a cache and all its entries. */
+WS_DLL_PUBLIC void
+lru_cache_free(lru_cache_t *cache);
+
+/**
+ * Adds a copy of data to the cache under key, replacing what was there
+ * for it, and drops the least recently used entries until the data in the
+ * cache is at most limit bytes.  Does nothing if length is more than limit.
+ */
+WS_DLL_PUBLIC void
+lru_cache_add(lru_cache_t *cache, const void *key, const void *data,
+	      unsigned length, size_t limit);
+
+/**
+ * Looks up the data of key, making it the most recently used.  On a hit,
+ * returns the data, which stays valid until the next call to
+ * lru_cache_add() or lru_cache_free(), and sets *length.  Returns NULL on
+ * a miss.
+ */
+WS_DLL_PUBLIC const uint8_t *
+lru_cache_lookup(lru_cache_t *cache, const void *key, unsigned *length);
+
+/**
+ * Returns whether key is in the cache, without counting it as a hit or a
+ * miss nor making it the most recently used.
+ */
+WS_DLL_PUBLIC bool
+lru_cache_contains(const lru_cache_t *cache, const void *key);
+
+/** Gets the counters of a cache. */
+WS_DLL_PUBLIC void
+lru_cache_get_stats(const lru_cache_t *cache, lru_cache_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __LRU_CACHE_H__ */
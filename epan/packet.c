@@ -28,11 +28,13 @@
 
 #include "addr_resolv.h"
 #include "tvbuff.h"
+#include "tvbuff-int.h"
 #include "epan_dissect.h"
 
 #include <epan/wmem_scopes.h>
 
 #include <epan/column-info.h>
+#include <epan/decrypt_cache.h>
 #include <epan/exceptions.h>
 #include <epan/reassemble.h>
 #include <epan/stream.h>
@@ -41,6 +43,7 @@
 #include <epan/range.h>
 
 #include <wsutil/str_util.h>
+#include <wsutil/time_util.h>
 #include <wsutil/wslog.h>
 #include <wsutil/ws_assert.h>
 
@@ -49,6 +52,8 @@ static dissector_handle_t frame_handle;
 static dissector_handle_t file_handle;
 static dissector_handle_t data_handle;
 
+static void dissector_profile_cleanup(void);
+
 /**
  * A data source.
  * Has a tvbuff and a name.
@@ -280,6 +285,7 @@ call_routine(void *routine, void *dummy _U_)
 void
 packet_cleanup(void)
 {
+	dissector_profile_cleanup();
 	g_slist_free(init_routines);
 	g_slist_free(cleanup_routines);
 	g_slist_free(postseq_cleanup_routines);
@@ -360,6 +366,10 @@ init_dissection(void)
 	/* Initialize the stream-handling tables */
 	stream_init();
 
+	/* Initialize the caches of decrypted and uncompressed data */
+	decrypt_cache_init();
+	tvb_uncompress_cache_init();
+
 	/* Initialize the expert infos */
 	expert_packet_init();
 }
@@ -373,6 +383,10 @@ cleanup_dissection(void)
 	/* Cleanup the stream-handling tables */
 	stream_cleanup();
 
+	/* Cleanup the caches of decrypted and uncompressed data */
+	decrypt_cache_cleanup();
+	tvb_uncompress_cache_cleanup();
+
 	/* Cleanup the expert infos */
 	expert_packet_cleanup();
 
@@ -858,6 +872,140 @@ remove_last_layer(packet_info *pinfo, bool reduce_count)
 }
 
 
+/*
+ * Dissector profiling.
+ *
+ * When enabled, every call through a dissector handle or to a heuristic
+ * dissector is timed, and the bytes it allocates from pinfo->pool are
+ * counted, and the results are accumulated per protocol. "self" figures
+ * exclude the dissectors called from the dissector in question. pinfo->pool
+ * is an arena, which keeps a running total of the bytes it hands out, so
+ * counting them adds no work per allocation. When disabled, the only cost
+ * is a test of dissector_profiling per call.
+ */
+typedef struct {
+	uint64_t start_ns;
+	uint64_t start_bytes;
+	uint64_t child_ns;
+	uint64_t child_bytes;
+} dissector_profile_frame_t;
+
+static bool dissector_profiling;
+static GHashTable *dissector_profile_table;	/* proto id -> dissector_profile_t */
+static GArray *dissector_profile_stack;		/* of dissector_profile_frame_t */
+
+void
+dissector_profile_set_enabled(bool enabled)
+{
+	if (enabled && dissector_profile_table == NULL) {
+		dissector_profile_table = g_hash_table_new_full(g_direct_hash,
+		    g_direct_equal, NULL, g_free);
+		dissector_profile_stack = g_array_new(false, false,
+		    sizeof(dissector_profile_frame_t));
+	}
+	dissector_profiling = enabled;
+}
+
+bool
+dissector_profile_is_enabled(void)
+{
+	return dissector_profiling;
+}
+
+void
+dissector_profile_reset(void)
+{
+	if (dissector_profile_table != NULL)
+		g_hash_table_remove_all(dissector_profile_table);
+}
+
+static int
+dissector_profile_compare(const void *a, const void *b)
+{
+	const dissector_profile_t *pa = (const dissector_profile_t *)a;
+	const dissector_profile_t *pb = (const dissector_profile_t *)b;
+
+	if (pa->self_ns != pb->self_ns)
+		return pa->self_ns < pb->self_ns ? 1 : -1;
+	return pa->proto_id - pb->proto_id;
+}
+
+GArray *
+dissector_profile_get(void)
+{
+	GArray *profile = g_array_new(false, false, sizeof(dissector_profile_t));
+	GHashTableIter iter;
+	void *value;
+
+	if (dissector_profile_table == NULL)
+		return profile;
+
+	g_hash_table_iter_init(&iter, dissector_profile_table);
+	while (g_hash_table_iter_next(&iter, NULL, &value))
+		g_array_append_vals(profile, value, 1);
+	g_array_sort(profile, dissector_profile_compare);
+	return profile;
+}
+
+static void
+dissector_profile_cleanup(void)
+{
+	if (dissector_profile_table != NULL) {
+		g_hash_table_destroy(dissector_profile_table);
+		dissector_profile_table = NULL;
+		g_array_free(dissector_profile_stack, true);
+		dissector_profile_stack = NULL;
+	}
+	dissector_profiling = false;
+}
+
+static void
+dissector_profile_enter(packet_info *pinfo)
+{
+	dissector_profile_frame_t frame;
+
+	/* The pool may predate the enabling of profiling. */
+	wmem_count_bytes_allocated(pinfo->pool, true);
+	frame.start_bytes = wmem_bytes_allocated(pinfo->pool);
+	frame.child_ns = 0;
+	frame.child_bytes = 0;
+	frame.start_ns = ws_monotonic_time_ns();
+	g_array_append_val(dissector_profile_stack, frame);
+}
+
+static void
+dissector_profile_leave(packet_info *pinfo, int proto_id)
+{
+	uint64_t end_ns = ws_monotonic_time_ns();
+	unsigned depth = dissector_profile_stack->len;
+	dissector_profile_frame_t *frame;
+	dissector_profile_t *entry;
+	uint64_t total_ns, total_bytes;
+
+	frame = &g_array_index(dissector_profile_stack, dissector_profile_frame_t, depth - 1);
+	total_ns = end_ns - frame->start_ns;
+	total_bytes = wmem_bytes_allocated(pinfo->pool) - frame->start_bytes;
+
+	entry = (dissector_profile_t *)g_hash_table_lookup(dissector_profile_table,
+	    GINT_TO_POINTER(proto_id));
+	if (entry == NULL) {
+		entry = g_new0(dissector_profile_t, 1);
+		entry->proto_id = proto_id;
+		g_hash_table_insert(dissector_profile_table, GINT_TO_POINTER(proto_id), entry);
+	}
+	entry->calls++;
+	entry->total_ns += total_ns;
+	entry->self_ns += total_ns - frame->child_ns;
+	entry->self_bytes += total_bytes - frame->child_bytes;
+
+	g_array_set_size(dissector_profile_stack, depth - 1);
+	if (depth > 1) {
+		frame = &g_array_index(dissector_profile_stack, dissector_profile_frame_t, depth - 2);
+		frame->child_ns += total_ns;
+		frame->child_bytes += total_bytes;
+	}
+}
+
 /* This function will return
  *   >0  this protocol was successfully dissected and this was this protocol.
  *   0   this packet did not match this protocol.
@@ -867,6 +1015,24 @@ remove_last_layer(packet_info *pinfo, bool reduce_count)
  * from "packet did not match this protocol".  See issues #12366 and
  * #12368.
  */
+static int
+call_dissector_func(dissector_handle_t handle, tvbuff_t *tvb,
+		    packet_info *pinfo, proto_tree *tree, void *data)
+{
+	switch (handle->dissector_type) {
+
+	case DISSECTOR_TYPE_SIMPLE:
+		return (handle->dissector_func.dissector_type_simple)(tvb, pinfo, tree, data);
+
+	case DISSECTOR_TYPE_CALLBACK:
+		return (handle->dissector_func.dissector_type_callback)(tvb, pinfo, tree, data, handle->dissector_data);
+
+	default:
+		ws_assert_not_reached();
+	}
+	return 0;
+}
+
 static int
 call_dissector_through_handle(dissector_handle_t handle, tvbuff_t *tvb,
 			      packet_info *pinfo, proto_tree *tree, void *data)
@@ -881,24 +1047,46 @@ call_dissector_through_handle(dissector_handle_t handle, tvbuff_t *tvb,
 			proto_get_protocol_short_name(handle->protocol);
 	}
 
-	switch (handle->dissector_type) {
-
-	case DISSECTOR_TYPE_SIMPLE:
-		len = (handle->dissector_func.dissector_type_simple)(tvb, pinfo, tree, data);
-		break;
+	if (G_UNLIKELY(dissector_profiling) && handle->protocol != NULL) {
+		volatile int profiled_len = 0;
 
-	case DISSECTOR_TYPE_CALLBACK:
-		len = (handle->dissector_func.dissector_type_callback)(tvb, pinfo, tree, data, handle->dissector_data);
-		break;
-
-	default:
-		ws_assert_not_reached();
+		dissector_profile_enter(pinfo);
+		TRY {
+			profiled_len = call_dissector_func(handle, tvb, pinfo, tree, data);
+		}
+		FINALLY {
+			dissector_profile_leave(pinfo, proto_get_id(handle->protocol));
+		}
+		ENDTRY;
+		len = profiled_len;
+	} else {
+		len = call_dissector_func(handle, tvb, pinfo, tree, data);
 	}
 	pinfo->current_proto = saved_proto;
 
 	return len;
 }
 
+static bool
+call_heuristic_dissector(heur_dtbl_entry_t *hdtbl_entry, tvbuff_t *tvb,
+			 packet_info *pinfo, proto_tree *tree, void *data)
+{
+	if (G_UNLIKELY(dissector_profiling) && hdtbl_entry->protocol != NULL) {
+		volatile bool accepted = false;
+
+		dissector_profile_enter(pinfo);
+		TRY {
+			accepted = (hdtbl_entry->dissector)(tvb, pinfo, tree, data);
+		}
+		FINALLY {
+			dissector_profile_leave(pinfo, proto_get_id(hdtbl_entry->protocol));
+		}
+		ENDTRY;
+		return accepted;
+	}
+	return (hdtbl_entry->dissector)(tvb, pinfo, tree, data);
+}
+
 /*
  * Call a dissector through a handle.
  * If the protocol for that handle isn't enabled, return 0 without
@@ -3122,7 +3310,7 @@ dissector_try_heuristic(heur_dissector_list_t sub_dissectors, tvbuff_t *tvb,
 		pinfo->heur_list_name = hdtbl_entry->list_name;
 
 		saved_desegment_len = pinfo->desegment_len;
-		len = (hdtbl_entry->dissector)(tvb, pinfo, tree, data);
+		len = call_heuristic_dissector(hdtbl_entry, tvb, pinfo, tree, data);
 		consumed_none = len == 0 || (pinfo->desegment_len != saved_desegment_len && pinfo->desegment_offset == 0);
 		if (hdtbl_entry->protocol != NULL &&
 			(consumed_none || (tree && saved_tree_count == tree->tree_data->count))) {
@@ -3768,7 +3956,7 @@ void call_heur_dissector_direct(heur_dtbl_entry_t *heur_dtbl_entry, tvbuff_t *tv
 	pinfo->heur_list_name = heur_dtbl_entry->list_name;
 
 	/* call the dissector, in case of failure call data handle (might happen with exported PDUs) */
-	if (!(*heur_dtbl_entry->dissector)(tvb, pinfo, tree, data)) {
+	if (!call_heuristic_dissector(heur_dtbl_entry, tvb, pinfo, tree, data)) {
 		/*
 		 * We added a protocol layer above. The dissector
 		 * didn't accept the packet or it didn't add any
@@ -972,6 +972,33 @@ WS_DLL_PUBLIC void increment_dissection_depth(packet_info *pinfo);
 
 WS_DLL_PUBLIC void decrement_dissection_depth(packet_info *pinfo);
 
+/** Per-protocol dissector profile counters. */
+typedef struct {
+    int      proto_id;      /**< Protocol ID */
+    uint64_t calls;         /**< Number of calls to the protocol's dissectors */
+    uint64_t total_ns;      /**< Time spent in them, including dissectors they called */
+    uint64_t self_ns;       /**< Time spent in them, excluding dissectors they called */
+    uint64_t self_bytes;    /**< Bytes they allocated from pinfo->pool, excluding dissectors they called */
+} dissector_profile_t;
+
+/** Enable or disable dissector profiling. Counters accumulate across
+ * packets and files until dissector_profile_reset() is called.
+ * @param enabled true to collect profile counters.
+ */
+WS_DLL_PUBLIC void dissector_profile_set_enabled(bool enabled);
+
+/** @return true if dissector profiling is enabled. */
+WS_DLL_PUBLIC bool dissector_profile_is_enabled(void);
+
+/** Clear all dissector profile counters. */
+WS_DLL_PUBLIC void dissector_profile_reset(void);
+
+/** Get the dissector profile counters.
+ * @return A GArray of dissector_profile_t, sorted by decreasing self time.
+ * The caller must free it with g_array_free().
+ */
+WS_DLL_PUBLIC GArray *dissector_profile_get(void);
+
 /** @} */
 
 #ifdef __cplusplus
@@ -4033,6 +4033,35 @@ prefs_register_modules(void)
             "of cache entries to maintain. A 0 means no limit.",
             10, &prefs.ignore_dup_frames_cache_entries);
 
+    prefs_register_uint_preference(protocols_module, "reassembly_memory_limit",
+            "Memory limit for reassembled data (MB)",
+            "If not 0, reassembled data beyond this many megabytes is written "
+            "to a temporary file, least recently used first, and read back "
+            "when it's needed again.",
+            10, &prefs.reassembly_memory_limit);
+
+    prefs_register_uint_preference(protocols_module, "decrypted_memory_limit",
+            "Memory limit for cached decrypted data (MB)",
+            "If not 0, decrypted data is kept in a cache of at most this many "
+            "megabytes, least recently used first out, so that dissecting "
+            "packets again doesn't decrypt them again.",
+            10, &prefs.decrypted_memory_limit);
+
+    prefs_register_uint_preference(protocols_module, "decompressed_memory_limit",
+            "Memory limit for cached decompressed data (MB)",
+            "If not 0, data decompressed by dissectors is kept in a cache of "
+            "at most this many megabytes, least recently used first out, so "
+            "that dissecting packets again doesn't decompress it again.",
+            10, &prefs.decompressed_memory_limit);
+
+    prefs_register_bool_preference(protocols_module, "reassembly_frame_references",
+            "Refer to frame data in reassemblies",
+            "If enabled, fragments taken directly from captured frames aren't "
+            "copied; their data is read back from the capture file when the "
+            "reassembled data is needed. This uses less memory for large "
+            "reassemblies, but is slower.",
+            &prefs.reassembly_frame_references);
+
 
     /* Obsolete preferences
      * These "modules" were reorganized/renamed to correspond to their GUI
@@ -4478,6 +4507,10 @@ pre_init_prefs(void)
     prefs.display_abs_time_ascii = ABS_TIME_ASCII_TREE;
     prefs.ignore_dup_frames = false;
     prefs.ignore_dup_frames_cache_entries = 10000;
+    prefs.reassembly_memory_limit = 0;
+    prefs.decrypted_memory_limit = 0;
+    prefs.decompressed_memory_limit = 0;
+    prefs.reassembly_frame_references = false;
 
     /* set the default values for the io graph dialog */
     prefs.gui_io_graph_automatic_update = true;
@@ -242,6 +242,10 @@ typedef struct _e_prefs {
   int          conversation_deinterlacing_key;
   bool         ignore_dup_frames;
   unsigned     ignore_dup_frames_cache_entries;
+  unsigned     reassembly_memory_limit;
+  unsigned     decrypted_memory_limit;
+  unsigned     decompressed_memory_limit;
+  bool         reassembly_frame_references;
   bool         filter_expressions_old;  /* true if old filter expressions preferences were loaded. */
   bool         cols_hide_new; /* true if the new (index-based) gui.column.hide preference was loaded. */
   bool         gui_update_enabled;
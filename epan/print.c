@@ -78,6 +78,8 @@ struct _output_fields {
     GPtrArray    *fields;
     GPtrArray    *field_dfilters;
     GHashTable   *field_indicies;
+    unsigned     *field_indicies_by_id; /* like field_indicies, indexed by hfid */
+    unsigned      field_indicies_by_id_len;
     GPtrArray   **field_values;
     wmem_map_t   *protocolfilter;
     char          quote;
@@ -2014,6 +2016,8 @@ void output_fields_free(output_fields_t* fields)
             g_hash_table_destroy(fields->field_indicies);
         }
 
+        g_free(fields->field_indicies_by_id);
+
         if (NULL != fields->field_dfilters) {
             g_ptr_array_unref(fields->field_dfilters);
         }
@@ -2426,7 +2430,11 @@ static void proto_tree_get_node_field_values(proto_node *node, void *data)
 
     /* check for a faked item with an invisible tree */
     if (fi) {
-        field_index = g_hash_table_lookup(call_data->fields->field_indicies, fi->hfinfo->abbrev);
+        if ((unsigned)fi->hfinfo->id < call_data->fields->field_indicies_by_id_len) {
+            field_index = GUINT_TO_POINTER(call_data->fields->field_indicies_by_id[fi->hfinfo->id]);
+        } else {
+            field_index = g_hash_table_lookup(call_data->fields->field_indicies, fi->hfinfo->abbrev);
+        }
         if (NULL != field_index) {
             format_field_values(call_data->fields, field_index,
                                 get_node_field_value(fi, call_data->edt) /* g_ alloc'd string */
@@ -2475,6 +2483,33 @@ static void write_specified_fields(fields_format format, output_fields_t *fields
                 g_hash_table_insert(fields->field_indicies, field, GUINT_TO_POINTER(i));
             }
         }
+
+        /* Most nodes in the tree aren't output fields, so the per-node
+         * lookup is a direct index by hfid instead of hashing the
+         * abbreviation. Fields registered after this point fall back to
+         * the hash table.
+         */
+        fields->field_indicies_by_id_len = (unsigned)proto_registrar_n();
+        fields->field_indicies_by_id = g_new0(unsigned, fields->field_indicies_by_id_len);
+
+        i = 0;
+        while (i < fields->fields->len) {
+            char *field = (char *)g_ptr_array_index(fields->fields, i);
+            header_field_info *hfinfo = proto_registrar_get_byname(field);
+
+            ++i;
+            if (hfinfo == NULL || strcmp(hfinfo->abbrev, field) != 0) {
+                continue;
+            }
+            while (hfinfo->same_name_prev_id != -1) {
+                hfinfo = proto_registrar_get_nth(hfinfo->same_name_prev_id);
+            }
+            for (; hfinfo; hfinfo = hfinfo->same_name_next) {
+                if ((unsigned)hfinfo->id < fields->field_indicies_by_id_len) {
+                    fields->field_indicies_by_id[hfinfo->id] = i;
+                }
+            }
+        }
     }
 
     /* Array buffer to store values for this packet              */
@@ -2769,6 +2804,8 @@ output_fields_t* output_fields_new(void)
     fields->fields              = NULL; /*Do lazy initialisation */
     fields->field_dfilters      = NULL;
     fields->field_indicies      = NULL;
+    fields->field_indicies_by_id = NULL;
+    fields->field_indicies_by_id_len = 0;
     fields->field_values        = NULL;
     fields->protocolfilter      = NULL;
     fields->quote               ='\0';
@@ -427,10 +427,117 @@ static GPtrArray *deregistered_slice;
 /* indexed by prefix, contains initializers */
 static GHashTable* prefixes;
 
+/* proto_nodes and field_infos are not allocated one by one; each tree keeps
+ * them in arrays of PROTO_NODE_STORE_BLOCK_SIZE entries, handed out in the
+ * order the items are added. Resetting the tree just sets the counts back to
+ * zero, so the same memory is used again for the next packet, and the store
+ * of a freed tree is kept for the next tree created. Searching the whole
+ * tree for field_infos is then a linear scan over the node arrays instead of
+ * a pointer-chasing tree walk.
+ */
+#define PROTO_NODE_STORE_BLOCK_SIZE 1024
+
+/* Number of blocks of each kind kept when a tree is reset, so that a single
+ * huge packet doesn't keep its memory around forever. */
+#define PROTO_NODE_STORE_MAX_BLOCKS 64
+
+typedef struct _proto_node_store {
+	GPtrArray *node_blocks;		/* proto_node[PROTO_NODE_STORE_BLOCK_SIZE] */
+	unsigned   node_count;
+	GPtrArray *finfo_blocks;	/* field_info[PROTO_NODE_STORE_BLOCK_SIZE] */
+	unsigned   finfo_count;
+} proto_node_store_t;
+
+/* The store of the last freed tree, to be reused by the next one */
+static proto_node_store_t *node_store_cache;
+
+#define PROTO_NODE_STORE_NTH(blocks, type, n) \
+	(&((type *)(blocks)->pdata[(n) / PROTO_NODE_STORE_BLOCK_SIZE])[(n) % PROTO_NODE_STORE_BLOCK_SIZE])
+
+static inline void *
+proto_node_store_alloc(GPtrArray *blocks, unsigned *count, size_t elem_size)
+{
+	unsigned block = *count / PROTO_NODE_STORE_BLOCK_SIZE;
+	unsigned idx = *count % PROTO_NODE_STORE_BLOCK_SIZE;
+
+	if (block == blocks->len) {
+		g_ptr_array_add(blocks, g_malloc(elem_size * PROTO_NODE_STORE_BLOCK_SIZE));
+	}
+	(*count)++;
+
+	return (uint8_t *)blocks->pdata[block] + idx * elem_size;
+}
+
+/* Frees the fvalues of all nodes in the store and makes it empty again. */
+static void
+proto_node_store_reset(proto_node_store_t *store)
+{
+	proto_node *node;
+	unsigned i;
+
+	for (i = 0; i < store->node_count; i++) {
+		node = PROTO_NODE_STORE_NTH(store->node_blocks, proto_node, i);
+		if (PNODE_FINFO(node)) {
+			fvalue_free(PNODE_FINFO(node)->value);
+			PNODE_FINFO(node)->value = NULL;
+		}
+	}
+	store->node_count = 0;
+	store->finfo_count = 0;
+
+	if (store->node_blocks->len > PROTO_NODE_STORE_MAX_BLOCKS)
+		g_ptr_array_set_size(store->node_blocks, PROTO_NODE_STORE_MAX_BLOCKS);
+	if (store->finfo_blocks->len > PROTO_NODE_STORE_MAX_BLOCKS)
+		g_ptr_array_set_size(store->finfo_blocks, PROTO_NODE_STORE_MAX_BLOCKS);
+}
+
+static proto_node_store_t *
+proto_node_store_new(void)
+{
+	proto_node_store_t *store;
+
+	if (node_store_cache != NULL) {
+		store = node_store_cache;
+		node_store_cache = NULL;
+		return store;
+	}
+
+	store = g_new(proto_node_store_t, 1);
+	store->node_blocks = g_ptr_array_new_with_free_func(g_free);
+	store->node_count = 0;
+	store->finfo_blocks = g_ptr_array_new_with_free_func(g_free);
+	store->finfo_count = 0;
+
+	return store;
+}
+
+static void
+proto_node_store_destroy(proto_node_store_t *store)
+{
+	if (store == NULL)
+		return;
+
+	g_ptr_array_free(store->node_blocks, true);
+	g_ptr_array_free(store->finfo_blocks, true);
+	g_free(store);
+}
+
+static void
+proto_node_store_free(proto_node_store_t *store)
+{
+	proto_node_store_reset(store);
+
+	if (node_store_cache == NULL)
+		node_store_cache = store;
+	else
+		proto_node_store_destroy(store);
+}
+
 /* Contains information about a field when a dissector calls
  * proto_tree_add_item.  */
-#define FIELD_INFO_NEW(pool, fi)  fi = wmem_new(pool, field_info)
-#define FIELD_INFO_FREE(pool, fi) wmem_free(pool, fi)
+#define FIELD_INFO_NEW(tree_data, fi) \
+	fi = (field_info *)proto_node_store_alloc((tree_data)->node_store->finfo_blocks, \
+			&(tree_data)->node_store->finfo_count, sizeof(field_info))
 
 /* Contains the space for proto_nodes. */
 #define PROTO_NODE_INIT(node)			\
@@ -438,8 +545,9 @@ static GHashTable* prefixes;
 	node->last_child = NULL;		\
 	node->next = NULL;
 
-#define PROTO_NODE_FREE(pool, node)			\
-	wmem_free(pool, node)
+#define PROTO_NODE_NEW(tree_data, node) \
+	node = (proto_node *)proto_node_store_alloc((tree_data)->node_store->node_blocks, \
+			&(tree_data)->node_store->node_count, sizeof(proto_node))
 
 /* String space for protocol and field items for the GUI */
 #define ITEM_LABEL_NEW(pool, il)			\
@@ -465,6 +573,38 @@ typedef struct _gpa_hfinfo_t {
 
 static gpa_hfinfo_t gpa_hfinfo;
 
+/* Every field that is ever primed gets a small, dense slot number, so that a
+ * tree can keep the field_infos of its primed fields in a plain array indexed
+ * by slot instead of a hash table keyed by hfid. Slots are never given back;
+ * the same fields are normally primed again for every packet. */
+static unsigned *interesting_slots;	/* indexed by hfid; slot + 1, 0 if none */
+static unsigned  interesting_slots_len;
+static int      *interesting_slot_hfids;	/* indexed by slot */
+static unsigned  num_interesting_slots;
+
+/* Returns the slot of a field, assigning one if it doesn't have one yet. */
+static unsigned
+proto_interesting_slot(const int hfid)
+{
+	unsigned len;
+
+	if ((unsigned)hfid >= interesting_slots_len) {
+		len = MAX(gpa_hfinfo.len, (unsigned)hfid + 1);
+		interesting_slots = g_renew(unsigned, interesting_slots, len);
+		memset(interesting_slots + interesting_slots_len, 0,
+		       (len - interesting_slots_len) * sizeof(unsigned));
+		interesting_slots_len = len;
+	}
+
+	if (interesting_slots[hfid] == 0) {
+		interesting_slot_hfids = g_renew(int, interesting_slot_hfids, num_interesting_slots + 1);
+		interesting_slot_hfids[num_interesting_slots] = hfid;
+		interesting_slots[hfid] = ++num_interesting_slots;
+	}
+
+	return interesting_slots[hfid] - 1;
+}
+
 /* Hash table of abbreviations and IDs */
 static GHashTable *gpa_name_map;
 static header_field_info *same_name_hfinfo;
@@ -762,6 +902,16 @@ proto_cleanup(void)
 
 	g_slist_free(dissector_plugins);
 	dissector_plugins = NULL;
+
+	proto_node_store_destroy(node_store_cache);
+	node_store_cache = NULL;
+
+	g_free(interesting_slots);
+	interesting_slots = NULL;
+	interesting_slots_len = 0;
+	g_free(interesting_slot_hfids);
+	interesting_slot_hfids = NULL;
+	num_interesting_slots = 0;
 }
 
 static bool
@@ -811,41 +961,38 @@ proto_tree_children_foreach(proto_tree *tree, proto_tree_foreach_func func,
 	}
 }
 
+/* Empties the field_info arrays of the primed fields found in the tree,
+ * keeping the arrays for the next packet. */
 static void
-free_GPtrArray_value(void *key, void *value, void *user_data _U_)
+tree_data_reset_interesting_fields(tree_data_t *tree_data)
 {
-	GPtrArray         *ptrs = (GPtrArray *)value;
-	int                hfid = GPOINTER_TO_UINT(key);
 	header_field_info *hfinfo;
+	unsigned           slot;
+	unsigned           i;
 
-	PROTO_REGISTRAR_GET_NTH(hfid, hfinfo);
-	if (hfinfo->ref_type != HF_REF_TYPE_NONE) {
-		/* when a field is referenced by a filter this also
-		   affects the refcount for the parent protocol so we need
-		   to adjust the refcount for the parent as well
-		*/
-		if (hfinfo->parent != -1) {
-			header_field_info *parent_hfinfo;
-			PROTO_REGISTRAR_GET_NTH(hfinfo->parent, parent_hfinfo);
-			parent_hfinfo->ref_type = HF_REF_TYPE_NONE;
-		}
-		hfinfo->ref_type = HF_REF_TYPE_NONE;
-	}
-
-	g_ptr_array_free(ptrs, true);
-}
+	if (tree_data->interesting_used == NULL)
+		return;
 
-static void
-proto_tree_free_node(proto_node *node, void *data _U_)
-{
-	field_info *finfo  = PNODE_FINFO(node);
+	for (i = 0; i < tree_data->interesting_used->len; i++) {
+		slot = g_array_index(tree_data->interesting_used, unsigned, i);
 
-	proto_tree_children_foreach(node, proto_tree_free_node, NULL);
+		PROTO_REGISTRAR_GET_NTH(interesting_slot_hfids[slot], hfinfo);
+		if (hfinfo->ref_type != HF_REF_TYPE_NONE) {
+			/* when a field is referenced by a filter this also
+			   affects the refcount for the parent protocol so we need
+			   to adjust the refcount for the parent as well
+			*/
+			if (hfinfo->parent != -1) {
+				header_field_info *parent_hfinfo;
+				PROTO_REGISTRAR_GET_NTH(hfinfo->parent, parent_hfinfo);
+				parent_hfinfo->ref_type = HF_REF_TYPE_NONE;
+			}
+			hfinfo->ref_type = HF_REF_TYPE_NONE;
+		}
 
-	if (finfo) {
-		fvalue_free(finfo->value);
-		finfo->value = NULL;
+		g_ptr_array_set_size(tree_data->interesting_finfos[slot], 0);
 	}
+	g_array_set_size(tree_data->interesting_used, 0);
 }
 
 void
@@ -853,17 +1000,10 @@ proto_tree_reset(proto_tree *tree)
 {
 	tree_data_t *tree_data = PTREE_DATA(tree);
 
-	proto_tree_children_foreach(tree, proto_tree_free_node, NULL);
+	proto_node_store_reset(tree_data->node_store);
 
 	/* free tree data */
-	if (tree_data->interesting_hfids) {
-		/* Free all the GPtrArray's in the interesting_hfids hash. */
-		g_hash_table_foreach(tree_data->interesting_hfids,
-			free_GPtrArray_value, NULL);
-
-		/* And then remove all values. */
-		g_hash_table_remove_all(tree_data->interesting_hfids);
-	}
+	tree_data_reset_interesting_fields(tree_data);
 
 	/* Reset track of the number of children */
 	tree_data->count = 0;
@@ -881,17 +1021,19 @@ proto_tree_free(proto_tree *tree)
 {
 	tree_data_t *tree_data = PTREE_DATA(tree);
 
-	proto_tree_children_foreach(tree, proto_tree_free_node, NULL);
+	proto_node_store_free(tree_data->node_store);
 
 	/* free tree data */
-	if (tree_data->interesting_hfids) {
-		/* Free all the GPtrArray's in the interesting_hfids hash. */
-		g_hash_table_foreach(tree_data->interesting_hfids,
-			free_GPtrArray_value, NULL);
-
-		/* And then destroy the hash. */
-		g_hash_table_destroy(tree_data->interesting_hfids);
+	tree_data_reset_interesting_fields(tree_data);
+	if (tree_data->interesting_finfos) {
+		for (unsigned i = 0; i < tree_data->interesting_len; i++) {
+			if (tree_data->interesting_finfos[i])
+				g_ptr_array_free(tree_data->interesting_finfos[i], true);
+		}
+		g_free(tree_data->interesting_finfos);
 	}
+	if (tree_data->interesting_used)
+		g_array_free(tree_data->interesting_used, true);
 
 	g_slice_free(tree_data_t, tree_data);
 
@@ -2652,22 +2794,28 @@ tree_data_add_maybe_interesting_field(tree_data_t *tree_data, field_info *fi)
 	const header_field_info *hfinfo = fi->hfinfo;
 
 	if (hfinfo->ref_type == HF_REF_TYPE_DIRECT || hfinfo->ref_type == HF_REF_TYPE_PRINT) {
-		GPtrArray *ptrs = NULL;
-
-		if (tree_data->interesting_hfids == NULL) {
-			/* Initialize the hash because we now know that it is needed */
-			tree_data->interesting_hfids =
-				g_hash_table_new(g_direct_hash, NULL /* g_direct_equal */);
-		} else if (g_hash_table_size(tree_data->interesting_hfids)) {
-			ptrs = (GPtrArray *)g_hash_table_lookup(tree_data->interesting_hfids,
-					   GINT_TO_POINTER(hfinfo->id));
+		GPtrArray *ptrs;
+		unsigned   slot = proto_interesting_slot(hfinfo->id);
+
+		if (slot >= tree_data->interesting_len) {
+			/* Make room for every slot handed out so far */
+			tree_data->interesting_finfos = g_renew(GPtrArray *,
+				tree_data->interesting_finfos, num_interesting_slots);
+			memset(tree_data->interesting_finfos + tree_data->interesting_len, 0,
+			       (num_interesting_slots - tree_data->interesting_len) * sizeof(GPtrArray *));
+			tree_data->interesting_len = num_interesting_slots;
+		}
+		if (tree_data->interesting_used == NULL) {
+			tree_data->interesting_used = g_array_new(false, false, sizeof(unsigned));
 		}
 
+		ptrs = tree_data->interesting_finfos[slot];
 		if (!ptrs) {
-			/* First element triggers the creation of pointer array */
 			ptrs = g_ptr_array_new();
-			g_hash_table_insert(tree_data->interesting_hfids,
-					    GINT_TO_POINTER(hfinfo->id), ptrs);
+			tree_data->interesting_finfos[slot] = ptrs;
+		}
+		if (ptrs->len == 0) {
+			g_array_append_val(tree_data->interesting_used, slot);
 		}
 
 		g_ptr_array_add(ptrs, fi);
@@ -6412,7 +6560,7 @@ proto_tree_add_fake_node(proto_tree *tree, const header_field_info *hfinfo)
 		/* XXX - is it safe to continue here? */
 	}
 
-	pnode = wmem_new(PNODE_POOL(tree), proto_node);
+	PROTO_NODE_NEW(PTREE_DATA(tree), pnode);
 	PROTO_NODE_INIT(pnode);
 	pnode->parent = tnode;
 	PNODE_HFINFO(pnode) = hfinfo;
@@ -6479,7 +6627,7 @@ proto_tree_add_node(proto_tree *tree, field_info *fi)
 	tfi = PNODE_FINFO(tnode);
 	if (tfi != NULL && (tfi->tree_type < 0 || tfi->tree_type >= num_tree_types)) {
 		/* Since we are not adding fi to a node, its fvalue won't get
-		 * freed by proto_tree_free_node(), so free it now.
+		 * freed by proto_node_store_reset(), so free it now.
 		 */
 		fvalue_free(fi->value);
 		fi->value = NULL;
@@ -6488,7 +6636,7 @@ proto_tree_add_node(proto_tree *tree, field_info *fi)
 		/* XXX - is it safe to continue here? */
 	}
 
-	pnode = wmem_new(PNODE_POOL(tree), proto_node);
+	PROTO_NODE_NEW(PTREE_DATA(tree), pnode);
 	PROTO_NODE_INIT(pnode);
 	pnode->parent = tnode;
 	PNODE_HFINFO(pnode) = fi->hfinfo;
@@ -6831,7 +6979,7 @@ new_field_info(proto_tree *tree, header_field_info *hfinfo, tvbuff_t *tvb,
 {
 	field_info *fi;
 
-	FIELD_INFO_NEW(PNODE_POOL(tree), fi);
+	FIELD_INFO_NEW(PTREE_DATA(tree), fi);
 
 	fi->hfinfo     = hfinfo;
 	fi->start      = start;
@@ -7953,7 +8101,9 @@ proto_tree_create_root(packet_info *pinfo)
 	pnode->tree_data->pinfo = pinfo;
 
 	/* Don't initialize the tree_data_t. Wait until we know we need it */
-	pnode->tree_data->interesting_hfids = NULL;
+	pnode->tree_data->interesting_finfos = NULL;
+	pnode->tree_data->interesting_len = 0;
+	pnode->tree_data->interesting_used = NULL;
 
 	/* Set the default to false so it's easier to
 	 * find errors; if we expect to see the protocol tree
@@ -7971,6 +8121,8 @@ proto_tree_create_root(packet_info *pinfo)
 	pnode->tree_data->max_start = 0;
 	pnode->tree_data->start_idle_count = 0;
 
+	pnode->tree_data->node_store = proto_node_store_new();
+
 	return (proto_tree *)pnode;
 }
 
@@ -7991,6 +8143,7 @@ proto_tree_prime_with_hfid(proto_tree *tree _U_, const int hfid)
 	if (hfinfo->ref_type != HF_REF_TYPE_PRINT) {
 		hfinfo->ref_type = HF_REF_TYPE_DIRECT;
 	}
+	proto_interesting_slot(hfid);
 	/* only increase the refcount if there is a parent.
 	   if this is a protocol and not a field then parent will be -1
 	   and there is no parent to add any refcounting for.
@@ -8019,6 +8172,7 @@ proto_tree_prime_with_hfid_print(proto_tree *tree _U_, const int hfid)
 	   also increase the refcount for the parent, i.e the protocol.
 	*/
 	hfinfo->ref_type = HF_REF_TYPE_PRINT;
+	proto_interesting_slot(hfid);
 	/* only increase the refcount if there is a parent.
 	   if this is a protocol and not a field then parent will be -1
 	   and there is no parent to add any refcounting for.
@@ -11251,6 +11405,12 @@ proto_registrar_is_protocol(const int n)
 	return (((hfinfo->id != hf_text_only) && (hfinfo->parent == -1)) ? true : false);
 }
 
+int
+proto_registrar_n(void)
+{
+	return gpa_hfinfo.len;
+}
+
 /* Returns length of field in packet (not necessarily the length
  * in our internal representation, as in the case of IPv4).
  * 0 means undeterminable at time of registration
@@ -11282,32 +11442,42 @@ proto_check_for_protocol_or_field(const proto_tree* tree, const int id)
 /* Return GPtrArray* of field_info pointers for all hfindex that appear in tree.
  * This only works if the hfindex was "primed" before the dissection
  * took place, as we just pass back the already-created GPtrArray*.
- * The caller should *not* free the GPtrArray*; proto_tree_free_node()
+ * The caller should *not* free the GPtrArray*; proto_tree_free()
  * handles that. */
 GPtrArray *
 proto_get_finfo_ptr_array(const proto_tree *tree, const int id)
 {
+	GPtrArray *ptrs;
+	unsigned   slot;
+
 	if (!tree)
 		return NULL;
 
-	if (PTREE_DATA(tree)->interesting_hfids != NULL)
-		return (GPtrArray *)g_hash_table_lookup(PTREE_DATA(tree)->interesting_hfids,
-					   GINT_TO_POINTER(id));
-	else
+	if (id < 0 || (unsigned)id >= interesting_slots_len || interesting_slots[id] == 0)
+		return NULL;
+
+	slot = interesting_slots[id] - 1;
+	if (slot >= PTREE_DATA(tree)->interesting_len)
+		return NULL;
+
+	ptrs = PTREE_DATA(tree)->interesting_finfos[slot];
+	if (ptrs == NULL || ptrs->len == 0)
 		return NULL;
+
+	return ptrs;
 }
 
 bool
 proto_tracking_interesting_fields(const proto_tree *tree)
 {
-	GHashTable *interesting_hfids;
+	GArray *interesting_used;
 
 	if (!tree)
 		return false;
 
-	interesting_hfids = PTREE_DATA(tree)->interesting_hfids;
+	interesting_used = PTREE_DATA(tree)->interesting_used;
 
-	return (interesting_hfids != NULL) && g_hash_table_size(interesting_hfids);
+	return (interesting_used != NULL) && interesting_used->len;
 }
 
 /* Helper struct for proto_find_info() and	proto_all_finfos() */
@@ -11352,6 +11522,8 @@ find_first_finfo(proto_node *node, void *data)
 /* Return GPtrArray* of field_info pointers for all hfindex that appear in a tree.
 * This works on any proto_tree, primed or unprimed, but actually searches
 * the tree, so it is slower than using proto_get_finfo_ptr_array on a primed tree.
+* The fields are in pre-order, which isn't the order they were added in
+* when a dissector adds to a subtree after adding the items that follow it.
 * The caller does need to free the returned GPtrArray with
 * g_ptr_array_free(<array>, true).
 */
@@ -11401,6 +11573,7 @@ every_finfo(proto_node *node, void * data)
 }
 
 /* Return GPtrArray* of field_info pointers containing all hfindexes that appear in a tree.
+ * As with proto_find_finfo(), the fields are in pre-order.
  * The caller does need to free the returned GPtrArray with
  * g_ptr_array_free(<array>, true).
  */
@@ -11409,8 +11582,12 @@ proto_all_finfos(proto_tree *tree)
 {
 	ffdata_t ffdata;
 
-	/* Pre allocate enough space to hold all fields in most cases */
-	ffdata.array = g_ptr_array_sized_new(512);
+	/* Pre allocate enough space to hold all fields: a root tree knows
+	 * how many nodes it has; 512 is enough for a subtree in most cases. */
+	if (tree && tree->parent == NULL)
+		ffdata.array = g_ptr_array_sized_new(PTREE_DATA(tree)->node_store->node_count);
+	else
+		ffdata.array = g_ptr_array_sized_new(512);
 	ffdata.id = 0;
 
 	proto_tree_traverse_pre_order(tree, every_finfo, &ffdata);
@@ -890,13 +890,16 @@ typedef struct
 /** One of these exists for the entire protocol tree. Each proto_node
  * in the protocol tree points to the same copy. */
 typedef struct {
-    GHashTable          *interesting_hfids;
+    GPtrArray          **interesting_finfos; /**< field_infos of primed fields, indexed by the field's slot */
+    unsigned             interesting_len;    /**< Number of entries in interesting_finfos */
+    GArray              *interesting_used;   /**< Slots that have field_infos in this tree */
     bool                 visible;
     bool                 fake_protocols;
     unsigned             count;
     struct _packet_info *pinfo;
     int                  max_start;
     unsigned             start_idle_count;
+    struct _proto_node_store *node_store; /**< Storage for the tree's nodes and field_infos */
 } tree_data_t;
 
 /** Each proto_tree, proto_item is one of these. */
@@ -2728,6 +2731,11 @@ WS_DLL_PUBLIC bool proto_registrar_is_protocol(const int n);
  @return 0 means undeterminable at registration time, -1 means unknown field */
 extern int proto_registrar_get_length(const int n);
 
+/** Get the number of registered protocols and fields, i.e. one more than
+ the highest header_field number in use.
+ @return the number of registered items */
+WS_DLL_PUBLIC int proto_registrar_n(void);
+
 
 /** Routines to use to iterate over the protocols and their fields;
  * they return the item number of the protocol in question or the
@@ -2877,7 +2885,7 @@ extern bool proto_check_for_protocol_or_field(const proto_tree* tree, const int
  @param hfindex primed hfindex
  @return GPtrArray pointer
 
-   The caller should *not* free the GPtrArray*; proto_tree_free_node()
+   The caller should *not* free the GPtrArray*; proto_tree_free()
    handles that. */
 WS_DLL_PUBLIC GPtrArray* proto_get_finfo_ptr_array(const proto_tree *tree, const int hfindex);
 
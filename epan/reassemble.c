@@ -10,15 +10,21 @@
 
 #include "config.h"
 
+#include <errno.h>
 #include <string.h>
 
 #include <epan/packet.h>
+#include <epan/epan.h>
 #include <epan/exceptions.h>
+#include <epan/prefs.h>
 #include <epan/reassemble.h>
 #include <epan/tvbuff-int.h>
 
+#include <wsutil/file_util.h>
 #include <wsutil/str_util.h>
+#include <wsutil/tempfile.h>
 #include <wsutil/ws_assert.h>
+#include <wsutil/wslog.h>
 
 /*
  * Functions for reassembly tables where the endpoint addresses, and a
@@ -316,6 +322,243 @@ reassembled_key_free(void *ptr)
 	g_slice_free(reassembled_key, (reassembled_key *)ptr);
 }
 
+/*
+ * Spilling of reassembled data.
+ *
+ * If the protocols.reassembly_memory_limit preference is set, the data
+ * of completed reassemblies is written to a temporary file when there's
+ * more than that much of it in memory, least recently used first, and
+ * read back when the reassembly is looked up again.  Data is only spilled
+ * when no other dissection is in progress, e.g. one whose protocol tree
+ * is being displayed, as that might refer to it, and never once an address
+ * has been set to point into it, as addresses are kept, e.g. in
+ * conversation keys, long after the dissection that set them.
+ */
+typedef struct {
+	uint32_t last_frame;	/* last frame in which the data was used */
+	uint32_t size;		/* bytes of data */
+	int64_t offset;		/* offset in the spill file, if on_disk */
+	bool on_disk;		/* the data has been written to the spill file */
+	bool spilled;		/* the data is only in the spill file */
+} spill_entry_t;
+
+static GHashTable *spill_heads;		/* fragment_head to spill_entry_t */
+static size_t spill_resident_bytes;	/* data of the entries that isn't spilled */
+static int spill_fd = -1;
+static char *spill_path;
+static int64_t spill_file_size;
+
+static void
+spill_forget(fragment_head *fd_head)
+{
+	spill_entry_t *entry;
+
+	if (spill_heads == NULL)
+		return;
+	entry = (spill_entry_t *)g_hash_table_lookup(spill_heads, fd_head);
+	if (entry == NULL)
+		return;
+	if (!entry->spilled)
+		spill_resident_bytes -= entry->size;
+	g_hash_table_remove(spill_heads, fd_head);
+}
+
+/*
+ * Can the data of this reassembly be spilled?  Not if it's a subset
+ * of another tvb, if any fragments still refer to it, or if an address
+ * has been pointed into it with set_address_tvb(), as something might
+ * have kept a copy of that address.  (See #19094.)
+ */
+static bool
+spill_can_spill(const fragment_head *fd_head)
+{
+	const fragment_item *fd_i;
+
+	if (fd_head->tvb_data == NULL || (fd_head->flags & FD_SUBSET_TVB) ||
+	    tvb_has_address_ref(fd_head->tvb_data))
+		return false;
+	for (fd_i = fd_head->next; fd_i != NULL; fd_i = fd_i->next) {
+		if (fd_i->tvb_data != NULL)
+			return false;
+	}
+	return true;
+}
+
+static bool
+spill_write(fragment_head *fd_head, spill_entry_t *entry)
+{
+	const uint8_t *data;
+	uint32_t len;
+	GError *err = NULL;
+
+	if (spill_fd == -1) {
+		spill_fd = create_tempfile(NULL, &spill_path, "wireshark_reassembly", NULL, &err);
+		if (spill_fd == -1) {
+			ws_warning("Can't create a file for reassembled data: %s", err->message);
+			g_error_free(err);
+			return false;
+		}
+		spill_file_size = 0;
+	}
+
+	/* Data that was read back is still in the file. */
+	len = tvb_captured_length(fd_head->tvb_data);
+	if (!entry->on_disk || len != entry->size) {
+		data = tvb_get_ptr(fd_head->tvb_data, 0, len);
+		if (ws_lseek64(spill_fd, spill_file_size, SEEK_SET) != spill_file_size ||
+		    ws_write(spill_fd, data, len) != (ws_file_ssize_t)len) {
+			ws_warning("Can't write reassembled data to %s: %s", spill_path, g_strerror(errno));
+			return false;
+		}
+		entry->offset = spill_file_size;
+		entry->on_disk = true;
+		spill_file_size += len;
+	}
+
+	spill_resident_bytes -= entry->size;
+	entry->size = len;
+	entry->spilled = true;
+	tvb_free(fd_head->tvb_data);
+	fd_head->tvb_data = NULL;
+	return true;
+}
+
+static void
+spill_read(fragment_head *fd_head, spill_entry_t *entry)
+{
+	uint8_t *data;
+
+	data = (uint8_t *)g_malloc(entry->size);
+	if (ws_lseek64(spill_fd, entry->offset, SEEK_SET) != entry->offset ||
+	    ws_read(spill_fd, data, entry->size) != (ws_file_ssize_t)entry->size) {
+		g_free(data);
+		THROW_MESSAGE(DissectorError, "Can't read spilled reassembled data");
+	}
+	fd_head->tvb_data = tvb_new_real_data(data, entry->size, entry->size);
+	tvb_set_free_cb(fd_head->tvb_data, g_free);
+	entry->spilled = false;
+	spill_resident_bytes += entry->size;
+}
+
+typedef struct {
+	fragment_head *fd_head;
+	spill_entry_t *entry;
+} spill_candidate_t;
+
+static int
+spill_candidate_compare(const void *a, const void *b)
+{
+	const spill_candidate_t *candidate_a = (const spill_candidate_t *)a;
+	const spill_candidate_t *candidate_b = (const spill_candidate_t *)b;
+
+	return (candidate_a->entry->last_frame > candidate_b->entry->last_frame) -
+	    (candidate_a->entry->last_frame < candidate_b->entry->last_frame);
+}
+
+/*
+ * If there's more reassembled data in memory than the limit, spill
+ * the least recently used data, other than that used by the current
+ * frame, until there's no more than three quarters of the limit.
+ */
+static void
+spill_check(uint32_t frame)
+{
+	size_t limit = (size_t)prefs.reassembly_memory_limit * 1024 * 1024;
+	size_t target = limit - limit / 4;
+	GHashTableIter iter;
+	void *key, *value;
+	GArray *candidates;
+
+	if (limit == 0 || spill_resident_bytes <= limit || epan_dissect_count() > 1)
+		return;
+
+	candidates = g_array_new(false, false, sizeof(spill_candidate_t));
+	g_hash_table_iter_init(&iter, spill_heads);
+	while (g_hash_table_iter_next(&iter, &key, &value)) {
+		spill_candidate_t candidate;
+
+		candidate.fd_head = (fragment_head *)key;
+		candidate.entry = (spill_entry_t *)value;
+		if (candidate.entry->spilled || candidate.entry->last_frame >= frame ||
+		    !spill_can_spill(candidate.fd_head))
+			continue;
+		g_array_append_val(candidates, candidate);
+	}
+	g_array_sort(candidates, spill_candidate_compare);
+	for (unsigned i = 0; i < candidates->len && spill_resident_bytes > target; i++) {
+		spill_candidate_t *candidate = &g_array_index(candidates, spill_candidate_t, i);
+
+		if (!spill_write(candidate->fd_head, candidate->entry))
+			break;
+	}
+	g_array_free(candidates, true);
+}
+
+/*
+ * Note that a reassembly was used in a frame, adding it to the set of
+ * reassemblies whose data can be spilled, or reading its data back if
+ * it was.
+ */
+static void
+spill_use(fragment_head *fd_head, uint32_t frame)
+{
+	spill_entry_t *entry;
+
+	if (prefs.reassembly_memory_limit == 0 && spill_heads == NULL)
+		return;
+	if (spill_heads == NULL)
+		spill_heads = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+
+	entry = (spill_entry_t *)g_hash_table_lookup(spill_heads, fd_head);
+	if (entry == NULL) {
+		/* Frame references don't keep their data in memory. */
+		if (fd_head->tvb_data == NULL || tvb_is_frame_ref(fd_head->tvb_data))
+			return;
+		entry = g_new0(spill_entry_t, 1);
+		entry->size = tvb_captured_length(fd_head->tvb_data);
+		spill_resident_bytes += entry->size;
+		g_hash_table_insert(spill_heads, fd_head, entry);
+	} else if (entry->spilled) {
+		spill_read(fd_head, entry);
+	}
+	if (frame > entry->last_frame)
+		entry->last_frame = frame;
+	spill_check(frame);
+}
+
+/*
+ * Forget about all reassemblies and remove the spill file; called when
+ * the reassembly tables are emptied.
+ */
+static void
+spill_reset(void)
+{
+	if (spill_heads != NULL) {
+		g_hash_table_destroy(spill_heads);
+		spill_heads = NULL;
+	}
+	spill_resident_bytes = 0;
+	if (spill_fd != -1) {
+		ws_close(spill_fd);
+		ws_unlink(spill_path);
+		g_free(spill_path);
+		spill_path = NULL;
+		spill_fd = -1;
+	}
+}
+
+static fragment_head *
+lookup_reassembled(reassembly_table *table, const packet_info *pinfo,
+		   const reassembled_key *key)
+{
+	fragment_head *fd_head;
+
+	fd_head = (fragment_head *)g_hash_table_lookup(table->reassembled_table, key);
+	if (fd_head != NULL)
+		spill_use(fd_head, pinfo->num);
+	return fd_head;
+}
+
 /*
  * For a fragment hash table entry, free the associated fragments.
  * The entry value (fd_chain) is freed herein and the entry is freed
@@ -333,6 +576,7 @@ free_all_fragments(void *key_arg _U_, void *value, void *user_data _U_)
 	 */
 	fd_head = (fragment_head *)value;
 	if (fd_head != NULL) {
+		spill_forget(fd_head);
 		fd_i = fd_head->next;
 		if(fd_head->tvb_data && !(fd_head->flags&FD_SUBSET_TVB))
 			tvb_free(fd_head->tvb_data);
@@ -373,6 +617,7 @@ free_fd_head(fragment_head *fd_head)
 {
 	fragment_item *fd_i, *tmp;
 
+	spill_forget(fd_head);
 	if (fd_head->flags & FD_SUBSET_TVB)
 		fd_head->tvb_data = NULL;
 	if (fd_head->tvb_data)
@@ -427,9 +672,11 @@ reassembled_table_insert(GHashTable *reassembled_table, reassembled_key *key, fr
 			 * it yet if set_address_tvb() was used.
 			 */
 			old_fd_head->tvb_data = NULL;
+			spill_forget(old_fd_head);
 		}
 	}
 	g_hash_table_insert(reassembled_table, key, fd_head);
+	spill_use(fd_head, key->frame);
 }
 
 typedef struct register_reassembly_table {
@@ -660,7 +907,7 @@ fragment_get_reassembled_id(reassembly_table *table, const packet_info *pinfo,
 	/* create key to search hash with */
 	key.frame = pinfo->num;
 	key.id = id;
-	fd_head = (fragment_head *)g_hash_table_lookup(table->reassembled_table, &key);
+	fd_head = lookup_reassembled(table, pinfo, &key);
 
 	return fd_head;
 }
@@ -1173,6 +1420,86 @@ MERGE_FRAG(fragment_head *fd_head, fragment_item *fd)
 	update_first_gap(fd_head, inserted, multi_insert);
 }
 
+/*
+ * Keep the data of a fragment. If the protocols.reassembly_frame_references
+ * preference is set, the fragment's bytes are directly in the frame being
+ * dissected, and the frame can be read again later, just remember where
+ * they are in the frame; otherwise copy them.
+ */
+static tvbuff_t *
+fragment_clone_data(tvbuff_t *tvb, const int offset, const uint32_t len,
+		    const packet_info *pinfo)
+{
+	tvbuff_t *frame_tvb;
+	const uint8_t *frame_start, *data;
+	tvbuff_t *ref_tvb;
+
+	if (!prefs.reassembly_frame_references || len == 0 ||
+	    !epan_can_get_frame_data(pinfo->epan) || pinfo->data_src == NULL)
+		return tvb_clone_offset_len(tvb, offset, len);
+
+	/*
+	 * Subsets of the frame point into its data; data that's been
+	 * decrypted, decompressed or otherwise put together is elsewhere.
+	 */
+	frame_tvb = get_data_source_tvb((const struct data_source *)pinfo->data_src->data);
+	frame_start = frame_tvb->real_data;
+	data = tvb->real_data;
+	if (frame_start == NULL || data == NULL ||
+	    (uintptr_t)data < (uintptr_t)frame_start ||
+	    (uintptr_t)data + offset + len > (uintptr_t)frame_start + frame_tvb->length)
+		return tvb_clone_offset_len(tvb, offset, len);
+
+	ref_tvb = tvb_new_frame_ref(pinfo->epan);
+	tvb_frame_ref_append(ref_tvb, pinfo->num, pinfo->fd->file_off,
+			     (unsigned)(data - frame_start) + offset, len);
+	tvb_frame_ref_finalize(ref_tvb);
+	return ref_tvb;
+}
+
+/*
+ * If the data of all the fragments refers to frame data, and the fragments
+ * follow each other without overlapping or leaving gaps, return reassembled
+ * data that refers to the same frame data. Otherwise return NULL, and the
+ * data has to be copied.
+ */
+static tvbuff_t *
+fragment_frame_ref_data(const packet_info *pinfo, const fragment_head *fd_head,
+			const uint32_t size, const bool block_sequence)
+{
+	const fragment_item *fd_i, *last_fd = NULL;
+	uint32_t dfpos = 0;
+	tvbuff_t *tvb;
+
+	if (!prefs.reassembly_frame_references || size == 0)
+		return NULL;
+
+	for (fd_i = fd_head->next; fd_i; last_fd = fd_i, fd_i = fd_i->next) {
+		if (block_sequence) {
+			if (last_fd && last_fd->offset == fd_i->offset)
+				return NULL;
+		} else if (fd_i->len && fd_i->offset != dfpos) {
+			return NULL;
+		}
+		if (fd_i->len) {
+			if (!fd_i->tvb_data || !tvb_is_frame_ref(fd_i->tvb_data) ||
+			    (fd_i->flags & FD_SUBSET_TVB))
+				return NULL;
+			dfpos += fd_i->len;
+		}
+	}
+	if (dfpos != size)
+		return NULL;
+
+	tvb = tvb_new_frame_ref(pinfo->epan);
+	for (fd_i = fd_head->next; fd_i; fd_i = fd_i->next) {
+		if (fd_i->len)
+			tvb_frame_ref_append_tvb(tvb, fd_i->tvb_data, 0, fd_i->len);
+	}
+	tvb_frame_ref_finalize(tvb);
+	return tvb;
+}
+
 /*
  * This function adds a new fragment to the fragment hash table.
  * If this is the first fragment seen for this datagram, a new entry
@@ -1351,7 +1678,7 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 		g_slice_free(fragment_item, fd);
 		THROW(BoundsError);
 	}
-	fd->tvb_data = tvb_clone_offset_len(tvb, offset, fd->len);
+	fd->tvb_data = fragment_clone_data(tvb, offset, fd->len, pinfo);
 	LINK_FRAG(fd_head,fd);
 
 
@@ -1377,9 +1704,14 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 	 */
 	/* store old data just in case */
 	old_tvb_data=fd_head->tvb_data;
-	data = (uint8_t *) g_malloc(fd_head->datalen);
-	fd_head->tvb_data = tvb_new_real_data(data, fd_head->datalen, fd_head->datalen);
-	tvb_set_free_cb(fd_head->tvb_data, g_free);
+	fd_head->tvb_data = fragment_frame_ref_data(pinfo, fd_head, fd_head->datalen, false);
+	if (fd_head->tvb_data) {
+		data = NULL;
+	} else {
+		data = (uint8_t *) g_malloc(fd_head->datalen);
+		fd_head->tvb_data = tvb_new_real_data(data, fd_head->datalen, fd_head->datalen);
+		tvb_set_free_cb(fd_head->tvb_data, g_free);
+	}
 
 	/* add all data fragments */
 	for (dfpos=0,fd_i=fd_head->next;fd_i;fd_i=fd_i->next) {
@@ -1402,7 +1734,12 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 			 * and thus within the newly g_malloc'd buffer.
 			 */
 
-			if (fd_i->offset >= fd_head->datalen) {
+			if (data == NULL) {
+				/*
+				 * The reassembled data refers to the
+				 * same frame data as the fragments.
+				 */
+			} else if (fd_i->offset >= fd_head->datalen) {
 				/*
 				 * Fragment starts after the end
 				 * of the reassembled packet.
@@ -1776,7 +2113,7 @@ fragment_add_check_with_fallback(reassembly_table *table, tvbuff_t *tvb, const i
 	if (pinfo->fd->visited) {
 		reass_key.frame = pinfo->num;
 		reass_key.id = id;
-		return (fragment_head *)g_hash_table_lookup(table->reassembled_table, &reass_key);
+		return lookup_reassembled(table, pinfo, &reass_key);
 	}
 
 	/* Looks up a key in the GHashTable, returning the original key and the associated value
@@ -1788,7 +2125,7 @@ fragment_add_check_with_fallback(reassembly_table *table, tvbuff_t *tvb, const i
 		/* Check if there is completed reassembly reachable from fallback frame */
 		reass_key.frame = fallback_frame;
 		reass_key.id = id;
-		fd_head = (fragment_head *)g_hash_table_lookup(table->reassembled_table, &reass_key);
+		fd_head = lookup_reassembled(table, pinfo, &reass_key);
 		if (fd_head != NULL) {
 			/* Found completely reassembled packet, hash it with current frame number */
 			reassembled_key *new_key = g_slice_new(reassembled_key);
@@ -1878,14 +2215,20 @@ fragment_defragment_and_free (fragment_head *fd_head, const packet_info *pinfo)
 
 	/* store old data in case the fd_i->data pointers refer to it */
 	old_tvb_data=fd_head->tvb_data;
-	data = (uint8_t *) g_malloc(size);
-	fd_head->tvb_data = tvb_new_real_data(data, size, size);
-	tvb_set_free_cb(fd_head->tvb_data, g_free);
+	fd_head->tvb_data = fragment_frame_ref_data(pinfo, fd_head, size, true);
+	if (fd_head->tvb_data) {
+		data = NULL;
+	} else {
+		data = (uint8_t *) g_malloc(size);
+		fd_head->tvb_data = tvb_new_real_data(data, size, size);
+		tvb_set_free_cb(fd_head->tvb_data, g_free);
+	}
 	fd_head->len = size;		/* record size for caller	*/
 
-	/* add all data fragments */
+	/* add all data fragments, unless the reassembled data refers to
+	 * the same frame data as they do */
 	last_fd=NULL;
-	for (fd_i=fd_head->next; fd_i; fd_i=fd_i->next) {
+	for (fd_i=fd_head->next; data && fd_i; fd_i=fd_i->next) {
 		if (fd_i->len) {
 			if(!last_fd || last_fd->offset != fd_i->offset) {
 				/* First fragment or in-sequence fragment */
@@ -2124,7 +2467,7 @@ fragment_add_seq_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 			return false;
 		}
 
-		fd->tvb_data = tvb_clone_offset_len(tvb, offset, fd->len);
+		fd->tvb_data = fragment_clone_data(tvb, offset, fd->len, pinfo);
 	}
 	LINK_FRAG(fd_head,fd);
 
@@ -2348,7 +2691,7 @@ fragment_add_seq_check_work(reassembly_table *table, tvbuff_t *tvb,
 	if (pinfo->fd->visited) {
 		reass_key.frame = pinfo->num;
 		reass_key.id = id;
-		return (fragment_head *)g_hash_table_lookup(table->reassembled_table, &reass_key);
+		return lookup_reassembled(table, pinfo, &reass_key);
 	}
 
 	fd_head = fragment_add_seq_common(table, tvb, offset, pinfo, id, data,
@@ -2504,7 +2847,7 @@ fragment_add_seq_single_work(reassembly_table *table, tvbuff_t *tvb,
 	if (pinfo->fd->visited) {
 		reass_key.frame = pinfo->num;
 		reass_key.id = id;
-		fh = (fragment_head *)g_hash_table_lookup(table->reassembled_table, &reass_key);
+		fh = lookup_reassembled(table, pinfo, &reass_key);
 		return fh;
 	}
 	/* First let's figure out where we want to add our new fragment */
@@ -2798,7 +3141,7 @@ fragment_end_seq_next(reassembly_table *table, const packet_info *pinfo,
 	if (pinfo->fd->visited) {
 		reass_key.frame = pinfo->num;
 		reass_key.id = id;
-		return (fragment_head *)g_hash_table_lookup(table->reassembled_table, &reass_key);
+		return lookup_reassembled(table, pinfo, &reass_key);
 	}
 
 	fd_head = lookup_fd_head(table, pinfo, id, data, &orig_key);
@@ -3156,6 +3499,7 @@ static void
 reassembly_table_init_reg_tables(void)
 {
 	g_list_foreach(reassembly_table_list, reassembly_table_init_reg_table, NULL);
+	spill_reset();
 }
 
 static void
@@ -3169,6 +3513,7 @@ static void
 reassembly_table_cleanup_reg_tables(void)
 {
 	g_list_foreach(reassembly_table_list, reassembly_table_cleanup_reg_table, NULL);
+	spill_reset();
 }
 
 void reassembly_tables_init(void)
@@ -3177,6 +3522,82 @@ void reassembly_tables_init(void)
 	register_cleanup_routine(&reassembly_table_cleanup_reg_tables);
 }
 
+typedef struct {
+	uint32_t frame_cutoff;
+	size_t freed;
+} reassembly_expire_t;
+
+static size_t
+fragment_data_size(const fragment_head *fd_head)
+{
+	const fragment_item *fd_i;
+	size_t size = sizeof *fd_head;
+
+	if (fd_head->tvb_data && !(fd_head->flags & FD_SUBSET_TVB))
+		size += tvb_captured_length(fd_head->tvb_data);
+	for (fd_i = fd_head->next; fd_i != NULL; fd_i = fd_i->next) {
+		size += sizeof *fd_i;
+		if (fd_i->tvb_data && !(fd_i->flags & FD_SUBSET_TVB))
+			size += tvb_captured_length(fd_i->tvb_data);
+	}
+	return size;
+}
+
+static gboolean
+expire_fragments(void *key, void *value, void *user_data)
+{
+	reassembly_expire_t *expire = (reassembly_expire_t *)user_data;
+	fragment_head *fd_head = (fragment_head *)value;
+
+	/* Leave anything that's also in the reassembled table alone. */
+	if (fd_head == NULL || fd_head->frame >= expire->frame_cutoff ||
+	    fd_head->ref_count != 0)
+		return FALSE;
+	expire->freed += fragment_data_size(fd_head);
+	return free_all_fragments(key, value, NULL);
+}
+
+static gboolean
+expire_reassembled(void *key, void *value, void *user_data)
+{
+	reassembly_expire_t *expire = (reassembly_expire_t *)user_data;
+	const reassembled_key *rkey = (const reassembled_key *)key;
+	fragment_head *fd_head = (fragment_head *)value;
+
+	if (rkey->frame >= expire->frame_cutoff)
+		return FALSE;
+	/* The data is freed along with the last reference to it. */
+	if (fd_head->ref_count == 1)
+		expire->freed += fragment_data_size(fd_head);
+	return TRUE;
+}
+
+static void
+reassembly_table_expire(void *p, void *user_data)
+{
+	register_reassembly_table_t* reg_table = (register_reassembly_table_t*)p;
+	reassembly_table *table = reg_table->table;
+
+	if (table->fragment_table != NULL)
+		g_hash_table_foreach_remove(table->fragment_table,
+					    expire_fragments, user_data);
+	if (table->reassembled_table != NULL)
+		g_hash_table_foreach_remove(table->reassembled_table,
+					    expire_reassembled, user_data);
+}
+
+size_t
+reassembly_tables_expire(uint32_t frame_cutoff)
+{
+	reassembly_expire_t expire;
+
+	expire.frame_cutoff = frame_cutoff;
+	expire.freed = 0;
+	if (frame_cutoff != 0)
+		g_list_foreach(reassembly_table_list, reassembly_table_expire, &expire);
+	return expire.freed;
+}
+
 static void
 reassembly_table_free(void *p, void *user_data _U_)
 {
@@ -186,6 +186,15 @@ reassembly_table_init(reassembly_table *table,
 WS_DLL_PUBLIC void
 reassembly_table_destroy(reassembly_table *table);
 
+/*
+ * Free the in-progress and completed reassemblies, in all registered
+ * reassembly tables, whose frames are all before frame_cutoff.  This
+ * is only safe when packets won't be dissected again, i.e. in a
+ * single pass.  Returns the approximate number of bytes freed.
+ */
+WS_DLL_PUBLIC size_t
+reassembly_tables_expire(uint32_t frame_cutoff);
+
 /*
  * This function adds a new fragment to the reassembly table
  * If this is the first fragment seen for this datagram, a new entry
@@ -38,6 +38,7 @@
 
 #include <epan/packet.h>
 #include <epan/packet_info.h>
+#include <epan/prefs.h>
 #include <epan/proto.h>
 #include <epan/tvbuff.h>
 #include <epan/reassemble.h>
@@ -1094,6 +1095,115 @@ test_fragment_add_seq_check(void)
     test_fragment_add_seq_check_work(fragment_add_seq_check);
 }
 
+/* Reassemble three datagrams of two 300 KiB fragments each with a 1 MiB
+ * limit on reassembled data; the older ones should be spilled, and read
+ * back when they're looked up again.
+ */
+#define SPILL_FRAG_LEN (300*1024)
+
+static void
+test_fragment_add_seq_check_spill(void)
+{
+    fragment_head *fd_head, *fd_heads[3];
+    uint8_t *big_data;
+    tvbuff_t *big_tvb;
+    unsigned i;
+
+    printf("Starting test test_fragment_add_seq_check_spill\n");
+
+    big_data = (uint8_t *)g_malloc(SPILL_FRAG_LEN * 2);
+    for (i = 0; i < SPILL_FRAG_LEN * 2; i++) {
+        big_data[i] = (i * 7) & 0xFF;
+    }
+    big_tvb = tvb_new_real_data(big_data, SPILL_FRAG_LEN * 2, SPILL_FRAG_LEN * 2);
+    prefs.reassembly_memory_limit = 1;
+
+    for (i = 0; i < 3; i++) {
+        pinfo.num = 2*i + 1;
+        fd_head=fragment_add_seq_check(&test_reassembly_table, big_tvb, 0, &pinfo,
+                                       20+i, NULL, 0, SPILL_FRAG_LEN, true);
+        ASSERT_EQ_POINTER(NULL,fd_head);
+
+        pinfo.num = 2*i + 2;
+        fd_head=fragment_add_seq_check(&test_reassembly_table, big_tvb, SPILL_FRAG_LEN, &pinfo,
+                                       20+i, NULL, 1, SPILL_FRAG_LEN, false);
+        ASSERT_NE_POINTER(NULL,fd_head);
+        ASSERT_NE_POINTER(NULL,fd_head->tvb_data);
+        fd_heads[i] = fd_head;
+    }
+
+    /* Only the newest reassembly fits. */
+    ASSERT_EQ_POINTER(NULL,fd_heads[0]->tvb_data);
+    ASSERT_EQ_POINTER(NULL,fd_heads[1]->tvb_data);
+    ASSERT_NE_POINTER(NULL,fd_heads[2]->tvb_data);
+
+    /* Looking up the first again reads it back. */
+    pinfo.fd->visited = 1;
+    pinfo.num = 2;
+    fd_head=fragment_add_seq_check(&test_reassembly_table, big_tvb, SPILL_FRAG_LEN, &pinfo,
+                                   20, NULL, 1, SPILL_FRAG_LEN, false);
+    ASSERT_EQ_POINTER(fd_heads[0],fd_head);
+    ASSERT_NE_POINTER(NULL,fd_head->tvb_data);
+    ASSERT_EQ(SPILL_FRAG_LEN*2,tvb_captured_length(fd_head->tvb_data));
+    ASSERT(!tvb_memeql(fd_head->tvb_data,0,big_data,SPILL_FRAG_LEN*2));
+
+    prefs.reassembly_memory_limit = 0;
+    tvb_free(big_tvb);
+    g_free(big_data);
+}
+
+
+/* As above, but with an address pointing into the first reassembly, as
+ * the IP dissector sets for a tunnelled datagram; that one must stay in
+ * memory, so the second is spilled instead.
+ */
+static void
+test_fragment_add_seq_check_spill_address(void)
+{
+    fragment_head *fd_head, *fd_heads[3];
+    uint8_t *big_data;
+    tvbuff_t *big_tvb, *sub_tvb;
+    address addr;
+    unsigned i;
+
+    printf("Starting test test_fragment_add_seq_check_spill_address\n");
+
+    big_data = (uint8_t *)g_malloc(SPILL_FRAG_LEN * 2);
+    for (i = 0; i < SPILL_FRAG_LEN * 2; i++) {
+        big_data[i] = (i * 7) & 0xFF;
+    }
+    big_tvb = tvb_new_real_data(big_data, SPILL_FRAG_LEN * 2, SPILL_FRAG_LEN * 2);
+    prefs.reassembly_memory_limit = 1;
+
+    for (i = 0; i < 3; i++) {
+        pinfo.num = 2*i + 1;
+        fd_head=fragment_add_seq_check(&test_reassembly_table, big_tvb, 0, &pinfo,
+                                       20+i, NULL, 0, SPILL_FRAG_LEN, true);
+        ASSERT_EQ_POINTER(NULL,fd_head);
+
+        pinfo.num = 2*i + 2;
+        fd_head=fragment_add_seq_check(&test_reassembly_table, big_tvb, SPILL_FRAG_LEN, &pinfo,
+                                       20+i, NULL, 1, SPILL_FRAG_LEN, false);
+        ASSERT_NE_POINTER(NULL,fd_head);
+        ASSERT_NE_POINTER(NULL,fd_head->tvb_data);
+        fd_heads[i] = fd_head;
+
+        if (i == 0) {
+            sub_tvb = tvb_new_subset_remaining(fd_head->tvb_data, 12);
+            set_address_tvb(&addr, AT_IPv4, 4, sub_tvb, 0);
+            ASSERT(tvb_has_address_ref(fd_head->tvb_data));
+        }
+    }
+
+    ASSERT_NE_POINTER(NULL,fd_heads[0]->tvb_data);
+    ASSERT_EQ_POINTER(NULL,fd_heads[1]->tvb_data);
+    ASSERT_NE_POINTER(NULL,fd_heads[2]->tvb_data);
+    ASSERT(memcmp(addr.data, big_data + 12, 4) == 0);
+
+    prefs.reassembly_memory_limit = 0;
+    tvb_free(big_tvb);
+    g_free(big_data);
+}
 
 /* This tests the case that the 802.11 hack does something different for: when
  * the terminal segment in a fragmented datagram arrives first.
@@ -3224,6 +3334,8 @@ main(int argc _U_, char **argv _U_)
         test_fragment_add_seq_duplicate_conflict,
         test_fragment_add_seq_check,               /* frag + reassemble */
         test_fragment_add_seq_check_1,
+        test_fragment_add_seq_check_spill,
+        test_fragment_add_seq_check_spill_address,
         test_fragment_add_seq_802_11_0,
         test_fragment_add_seq_802_11_1,
         test_simple_fragment_add_seq_next,
@@ -8,7 +8,14 @@
 
 #include "config.h"
 
+#include <stdio.h>
+#include <string.h>
+
 #include "strutil.h"
+#include "lru_cache.h"
+#include <wiretap/wtap.h>
+#include <wsutil/file_util.h>
+#include <wsutil/time_util.h>
 #include <wsutil/utf8_entities.h>
 
 /*
@@ -74,6 +81,254 @@ void test_label_escape_control(void)
     g_assert_cmpuint(pos, ==, strlen(dst));
 }
 
+static lru_cache_t *
+test_lru_cache_new(void)
+{
+    return lru_cache_new(g_int_hash, g_int_equal, sizeof(int));
+}
+
+static void
+test_lru_cache_add(lru_cache_t *cache, int key, unsigned length, size_t limit)
+{
+    uint8_t data[100];
+
+    memset(data, key, sizeof(data));
+    lru_cache_add(cache, &key, data, length, limit);
+}
+
+static bool
+test_lru_cache_contains(lru_cache_t *cache, int key)
+{
+    return lru_cache_contains(cache, &key);
+}
+
+void test_lru_cache_eviction(void)
+{
+    lru_cache_t *cache = test_lru_cache_new();
+    lru_cache_stats_t stats;
+    const uint8_t *data;
+    unsigned length;
+    int key;
+
+    /* Three entries of 40 bytes with a limit of 100: the first goes. */
+    test_lru_cache_add(cache, 1, 40, 100);
+    test_lru_cache_add(cache, 2, 40, 100);
+    test_lru_cache_add(cache, 3, 40, 100);
+    g_assert_false(test_lru_cache_contains(cache, 1));
+    g_assert_true(test_lru_cache_contains(cache, 2));
+    g_assert_true(test_lru_cache_contains(cache, 3));
+
+    /* Looking up 2 makes 3 the least recently used one. */
+    key = 2;
+    data = lru_cache_lookup(cache, &key, &length);
+    g_assert_nonnull(data);
+    g_assert_cmpuint(length, ==, 40);
+    g_assert_cmpuint(data[0], ==, 2);
+    test_lru_cache_add(cache, 4, 50, 100);
+    g_assert_false(test_lru_cache_contains(cache, 3));
+    g_assert_true(test_lru_cache_contains(cache, 2));
+
+    lru_cache_get_stats(cache, &stats);
+    g_assert_cmpuint(stats.additions, ==, 4);
+    g_assert_cmpuint(stats.evictions, ==, 2);
+    g_assert_cmpuint(stats.entries, ==, 2);
+    g_assert_cmpuint(stats.bytes, ==, 90);
+    lru_cache_free(cache);
+}
+
+void test_lru_cache_limit(void)
+{
+    lru_cache_t *cache = test_lru_cache_new();
+    lru_cache_stats_t stats;
+
+    test_lru_cache_add(cache, 1, 40, 100);
+    test_lru_cache_add(cache, 2, 40, 100);
+
+    /* Replacing an entry doesn't count it twice. */
+    test_lru_cache_add(cache, 2, 60, 100);
+    lru_cache_get_stats(cache, &stats);
+    g_assert_cmpuint(stats.entries, ==, 2);
+    g_assert_cmpuint(stats.bytes, ==, 100);
+    g_assert_cmpuint(stats.evictions, ==, 0);
+
+    /* A lower limit evicts down to it on the next addition. */
+    test_lru_cache_add(cache, 3, 10, 50);
+    lru_cache_get_stats(cache, &stats);
+    g_assert_cmpuint(stats.entries, ==, 1);
+    g_assert_cmpuint(stats.bytes, ==, 10);
+    g_assert_true(test_lru_cache_contains(cache, 3));
+    lru_cache_free(cache);
+}
+
+void test_lru_cache_too_long(void)
+{
+    lru_cache_t *cache = test_lru_cache_new();
+    lru_cache_stats_t stats;
+
+    test_lru_cache_add(cache, 1, 40, 100);
+
+    /* Data longer than the whole cache isn't added, and evicts nothing. */
+    test_lru_cache_add(cache, 2, 100, 99);
+    g_assert_false(test_lru_cache_contains(cache, 2));
+    g_assert_true(test_lru_cache_contains(cache, 1));
+    lru_cache_get_stats(cache, &stats);
+    g_assert_cmpuint(stats.entries, ==, 1);
+    g_assert_cmpuint(stats.bytes, ==, 40);
+    g_assert_cmpuint(stats.additions, ==, 1);
+    lru_cache_free(cache);
+}
+
+void test_lru_cache_stats(void)
+{
+    lru_cache_t *cache = test_lru_cache_new();
+    lru_cache_stats_t stats;
+    unsigned length;
+    int key;
+
+    test_lru_cache_add(cache, 1, 10, 100);
+
+    /* Only lookups count as hits and misses. */
+    g_assert_true(test_lru_cache_contains(cache, 1));
+    g_assert_false(test_lru_cache_contains(cache, 2));
+    key = 1;
+    g_assert_nonnull(lru_cache_lookup(cache, &key, &length));
+    g_assert_nonnull(lru_cache_lookup(cache, &key, &length));
+    key = 2;
+    g_assert_null(lru_cache_lookup(cache, &key, &length));
+    lru_cache_get_stats(cache, &stats);
+    g_assert_cmpuint(stats.hits, ==, 2);
+    g_assert_cmpuint(stats.misses, ==, 1);
+    lru_cache_free(cache);
+}
+
+/*
+ * Writes a little-endian pcapng file with an Ethernet interface and
+ * n_packets Enhanced Packet Blocks; every comment_every'th one, if
+ * comment_every isn't 0, has a comment option.  Returns its name.
+ */
+static char *
+test_pcapng_write(unsigned n_packets, unsigned comment_every)
+{
+    static const uint8_t shb[] = {
+        0x0A, 0x0D, 0x0D, 0x0A, 28, 0, 0, 0,
+        0x4D, 0x3C, 0x2B, 0x1A, 1, 0, 0, 0,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        28, 0, 0, 0
+    };
+    static const uint8_t idb[] = {
+        1, 0, 0, 0, 20, 0, 0, 0,
+        1, 0, 0, 0, 0, 0, 0, 0,
+        20, 0, 0, 0
+    };
+    static const uint8_t comment[] = {
+        1, 0, 4, 0, 'a', 'b', 'c', 'd',
+        0, 0, 0, 0
+    };
+    uint8_t epb[32 + 64 + sizeof comment + 4];
+    uint32_t len, le;
+    char *path;
+    FILE *fh;
+    int fd;
+
+    fd = g_file_open_tmp("test_epan_XXXXXX.pcapng", &path, NULL);
+    g_assert_cmpint(fd, !=, -1);
+    fh = ws_fdopen(fd, "wb");
+    g_assert_nonnull(fh);
+    g_assert_cmpuint(fwrite(shb, 1, sizeof shb, fh), ==, sizeof shb);
+    g_assert_cmpuint(fwrite(idb, 1, sizeof idb, fh), ==, sizeof idb);
+
+    memset(epb, 0, sizeof epb);
+    epb[0] = 6;                 /* block type */
+    epb[20] = epb[24] = 64;     /* captured and original length */
+    epb[32 + 12] = 0x88;        /* EtherType 0x88B5, local experimental */
+    epb[32 + 13] = 0xB5;
+    for (unsigned i = 0; i < n_packets; i++) {
+        len = 32 + 64 + 4;
+        if (comment_every != 0 && i % comment_every == 0) {
+            memcpy(epb + 32 + 64, comment, sizeof comment);
+            len += sizeof comment;
+        }
+        le = GUINT32_TO_LE(i);
+        memcpy(epb + 12, &le, 4);   /* low timestamp */
+        memcpy(epb + 32 + 14, &le, 4);
+        le = GUINT32_TO_LE(len);
+        memcpy(epb + 4, &le, 4);
+        memcpy(epb + len - 4, &le, 4);
+        g_assert_cmpuint(fwrite(epb, 1, len, fh), ==, len);
+    }
+    g_assert_cmpint(fclose(fh), ==, 0);
+
+    return path;
+}
+
+/* Reads a file, returning the number of records with a block. */
+static unsigned
+test_pcapng_read(const char *path, unsigned n_packets)
+{
+    wtap *wth;
+    wtap_rec rec;
+    int err;
+    char *err_info;
+    int64_t offset;
+    unsigned packets = 0, blocks = 0;
+
+    wth = wtap_open_offline(path, WTAP_TYPE_AUTO, &err, &err_info, false);
+    g_assert_nonnull(wth);
+    wtap_rec_init(&rec, 1514);
+    while (wtap_read(wth, &rec, &err, &err_info, &offset)) {
+        g_assert_cmpuint(rec.rec_header.packet_header.caplen, ==, 64);
+        if (rec.block != NULL)
+            blocks++;
+        packets++;
+        wtap_rec_reset(&rec);
+    }
+    g_assert_cmpint(err, ==, 0);
+    g_assert_cmpuint(packets, ==, n_packets);
+    wtap_rec_cleanup(&rec);
+    wtap_close(wth);
+
+    return blocks;
+}
+
+void test_pcapng_packet_block(void)
+{
+    char *path;
+
+    /* Only packets with options get a block. */
+    path = test_pcapng_write(1000, 10);
+    g_assert_cmpuint(test_pcapng_read(path, 1000), ==, 100);
+    ws_unlink(path);
+    g_free(path);
+}
+
+#define RESOURCE_USAGE_START get_resource_usage(&start_utime, &start_stime)
+
+#define RESOURCE_USAGE_END \
+    get_resource_usage(&end_utime, &end_stime); \
+    utime_ms = (end_utime - start_utime) * 1000.0; \
+    stime_ms = (end_stime - start_stime) * 1000.0
+
+/* NOTE: You have to run "test_epan -m perf" to run the performance tests. */
+void test_pcapng_read_perf(void)
+{
+#define PERF_PACKETS (1 * 1000 * 1000)
+    double start_utime, start_stime, end_utime, end_stime, utime_ms, stime_ms;
+    char *path;
+    unsigned blocks;
+
+    path = test_pcapng_write(PERF_PACKETS, 0);
+    RESOURCE_USAGE_START;
+    blocks = test_pcapng_read(path, PERF_PACKETS);
+    RESOURCE_USAGE_END;
+    /* No options, so no packet allocates a block. */
+    g_assert_cmpuint(blocks, ==, 0);
+    g_test_minimized_result(utime_ms + stime_ms,
+        "pcapng read of %u packets: u %.3f ms s %.3f ms, %u blocks",
+        PERF_PACKETS, utime_ms, stime_ms, blocks);
+    ws_unlink(path);
+    g_free(path);
+}
+
 int main(int argc, char **argv)
 {
     int ret;
@@ -85,12 +340,26 @@ int main(int argc, char **argv)
 
     g_test_init(&argc, &argv, NULL);
 
+    wtap_init(false);
+
     g_test_add_func("/label/strcat", test_label_strcat);
     g_test_add_func("/label/escape_whitespace", test_label_strcat_escape_whitespace);
     g_test_add_func("/label/escape_control", test_label_escape_control);
 
+    g_test_add_func("/lru_cache/eviction", test_lru_cache_eviction);
+    g_test_add_func("/lru_cache/limit", test_lru_cache_limit);
+    g_test_add_func("/lru_cache/too_long", test_lru_cache_too_long);
+    g_test_add_func("/lru_cache/stats", test_lru_cache_stats);
+
+    g_test_add_func("/pcapng/packet_block", test_pcapng_packet_block);
+    if (g_test_perf()) {
+        g_test_add_func("/pcapng/read_perf", test_pcapng_read_perf);
+    }
+
     ret = g_test_run();
 
+    wtap_cleanup();
+
     return ret;
 }
 
@@ -609,6 +609,82 @@ run_tests(void)
 	tvb_free_chain(tvb_parent);  /* should free all tvb's and associated data */
 }
 
+/* A composite of many small members, as made by reassembling a stream
+ * from many segments. */
+#define MANY_MEMBERS	5000
+
+static void
+composite_many_members_tests(void)
+{
+	tvbuff_t	*tvb_parent, *tvb_whole, *tvb_comp;
+	uint8_t		*data;
+	uint8_t		buf[64];
+	const uint8_t	*ptr;
+	unsigned	length = 0, offset, span;
+	unsigned	i;
+
+	for (i = 0; i < MANY_MEMBERS; i++)
+		length += 1 + i % 7;
+	data = (uint8_t *)g_malloc(length);
+	for (i = 0; i < length; i++)
+		data[i] = (uint8_t)(i * 31 + 7);
+
+	tvb_parent = tvb_new_real_data((const uint8_t*)"", 0, 0);
+	tvb_whole = tvb_new_child_real_data(tvb_parent, data, length, length);
+	tvb_set_free_cb(tvb_whole, g_free);
+
+	tvb_comp = tvb_new_composite();
+	for (i = 0, offset = 0; i < MANY_MEMBERS; i++) {
+		tvb_composite_append(tvb_comp, tvb_new_subset_length(tvb_whole, offset, 1 + i % 7));
+		offset += 1 + i % 7;
+	}
+	tvb_composite_finalize(tvb_comp);
+
+	if (tvb_captured_length(tvb_comp) != length) {
+		printf("Failed Composite of %u members: length=%u while expected length=%u\n",
+		       MANY_MEMBERS, tvb_captured_length(tvb_comp), length);
+		failed = true;
+		goto out;
+	}
+
+	/* Every byte, each of which is found in its member. */
+	for (offset = 0; offset < length; offset++) {
+		if (tvb_get_uint8(tvb_comp, offset) != data[offset]) {
+			printf("Failed Composite of %u members: byte at %u\n", MANY_MEMBERS, offset);
+			failed = true;
+			goto out;
+		}
+	}
+
+	/* Copies and pointers to ranges spanning several members. */
+	for (span = 2; span <= sizeof buf; span *= 2) {
+		for (offset = 0; offset + span <= length; offset += 997) {
+			tvb_memcpy(tvb_comp, buf, offset, span);
+			ptr = tvb_get_ptr(tvb_comp, offset, span);
+			if (memcmp(buf, &data[offset], span) != 0 ||
+			    memcmp(ptr, &data[offset], span) != 0) {
+				printf("Failed Composite of %u members: %u bytes at %u\n",
+				       MANY_MEMBERS, span, offset);
+				failed = true;
+				goto out;
+			}
+		}
+	}
+
+	/* Pointers to ranges within a member, and the whole composite. */
+	ptr = tvb_get_ptr(tvb_comp, length - 7, 7);
+	if (memcmp(ptr, &data[length - 7], 7) != 0 ||
+	    memcmp(tvb_get_ptr(tvb_comp, 0, length), data, length) != 0) {
+		printf("Failed Composite of %u members: pointers\n", MANY_MEMBERS);
+		failed = true;
+		goto out;
+	}
+
+	printf("Passed Composite of %u members\n", MANY_MEMBERS);
+out:
+	tvb_free_chain(tvb_parent);  /* should free all tvb's and associated data */
+}
+
 typedef struct
 {
 	// Raw bytes
@@ -814,6 +890,7 @@ main(void)
 
 	except_init();
 	run_tests();
+	composite_many_members_tests();
 	varint_tests();
 	zstd_tests ();
 	except_deinit();
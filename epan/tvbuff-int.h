@@ -31,6 +31,7 @@ struct tvb_ops {
  * Tvbuff flags.
  */
 #define TVBUFF_FRAGMENT		0x00000001	/* this is a fragment */
+#define TVBUFF_ADDRESS_REF	0x00000002	/* an address points into the data */
 
 struct tvbuff {
 	/* Doubly linked list pointers */
@@ -90,9 +91,44 @@ tvbuff_t *tvb_new(const struct tvb_ops *ops);
 
 tvbuff_t *tvb_new_proxy(tvbuff_t *backing);
 
+tvbuff_t *tvb_subset_backing(const tvbuff_t *tvb);
+
 void tvb_add_to_chain(tvbuff_t *parent, tvbuff_t *child);
 
 unsigned tvb_offset_from_real_beginning_counter(const tvbuff_t *tvb, const unsigned counter);
 
 void tvb_check_offset_length(const tvbuff_t *tvb, const int offset, int const length_val, unsigned *offset_ptr, unsigned *length_ptr);
+
+struct epan_session;
+
+tvbuff_t *tvb_new_frame_ref(const struct epan_session *session);
+
+void tvb_frame_ref_append(tvbuff_t *tvb, const uint32_t frame_num, const int64_t file_off, const unsigned frame_offset, const unsigned length);
+
+void tvb_frame_ref_append_tvb(tvbuff_t *tvb, tvbuff_t *member, unsigned offset, unsigned length);
+
+void tvb_frame_ref_finalize(tvbuff_t *tvb);
+
+bool tvb_is_frame_ref(const tvbuff_t *tvb);
+
+void tvb_frame_ref_unload_all(void);
+
+typedef enum {
+	TVB_UNCOMPRESS_ZLIB,
+	TVB_UNCOMPRESS_BROTLI,
+	TVB_UNCOMPRESS_SNAPPY,
+	TVB_UNCOMPRESS_ZSTD,
+	TVB_UNCOMPRESS_LZ77,
+	TVB_UNCOMPRESS_LZ77HUFF,
+	TVB_UNCOMPRESS_LZNT1
+} tvb_uncompress_algo_t;
+
+typedef tvbuff_t *(*tvb_uncompress_func_t)(tvbuff_t *tvb, const int offset, int comprlen);
+
+tvbuff_t *tvb_uncompress_cached(tvbuff_t *tvb, const int offset, int comprlen,
+				tvb_uncompress_algo_t algo, tvb_uncompress_func_t uncompress);
+
+void tvb_uncompress_cache_init(void);
+
+void tvb_uncompress_cache_cleanup(void);
 #endif
@@ -35,6 +35,7 @@
 #include "wsutil/unicode-utils.h"
 #include "wsutil/nstime.h"
 #include "wsutil/time_util.h"
+#include "wsutil/ws_memfind.h"
 #include <wsutil/ws_assert.h>
 #include "tvbuff.h"
 #include "tvbuff-int.h"
@@ -2512,6 +2513,16 @@ tvb_find_uint16(tvbuff_t *tvb, const int offset, const int maxlength,
 	unsigned searched_bytes = 0;
 	unsigned pos = abs_offset;
 
+	/* If we have real data, perform our search now. */
+	if (tvb->real_data) {
+		const uint8_t *result;
+
+		result = ws_mempair(tvb->real_data + abs_offset, limit, needle1, needle2);
+		if (result == NULL)
+			return -1;
+		return (int) (result - tvb->real_data);
+	}
+
 	do {
 		int offset1 =
 			tvb_find_uint8(tvb, pos, limit - searched_bytes, needle1);
@@ -4776,6 +4787,23 @@ tvb_set_fragment(tvbuff_t *tvb)
 	tvb->flags |= TVBUFF_FRAGMENT;
 }
 
+void
+tvb_set_address_ref(tvbuff_t *tvb)
+{
+	tvbuff_t *backing;
+
+	/* Mark the tvbuff whose memory the address is in. */
+	while ((backing = tvb_subset_backing(tvb)) != NULL)
+		tvb = backing;
+	tvb->flags |= TVBUFF_ADDRESS_REF;
+}
+
+bool
+tvb_has_address_ref(const tvbuff_t *tvb)
+{
+	return (tvb->flags & TVBUFF_ADDRESS_REF) != 0;
+}
+
 struct tvbuff *
 tvb_get_ds_tvb(tvbuff_t *tvb)
 {
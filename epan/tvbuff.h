@@ -306,6 +306,15 @@ WS_DLL_PUBLIC int tvb_raw_offset(tvbuff_t *tvb);
  * or ReportedBoundsError. */
 WS_DLL_PUBLIC void tvb_set_fragment(tvbuff_t *tvb);
 
+/** Note that an address has been set to point into the tvbuff's data,
+ * with set_address_tvb(), so that the memory the data is in mustn't be
+ * freed while the address might still be in use. */
+WS_DLL_PUBLIC void tvb_set_address_ref(tvbuff_t *tvb);
+
+/** Returns true if tvb_set_address_ref() has been called for this
+ * tvbuff or for a subset of it. */
+WS_DLL_PUBLIC bool tvb_has_address_ref(const tvbuff_t *tvb);
+
 WS_DLL_PUBLIC struct tvbuff *tvb_get_ds_tvb(tvbuff_t *tvb);
 
 
@@ -1281,6 +1290,23 @@ WS_DLL_PUBLIC tvbuff_t *tvb_uncompress_zstd(tvbuff_t *tvb,
 WS_DLL_PUBLIC tvbuff_t *tvb_child_uncompress_zstd(tvbuff_t *parent,
     tvbuff_t *tvb, const int offset, int comprlen);
 
+/* From tvbuff_uncompress_cache.c */
+
+/** Counters of the cache of the data uncompressed by the
+ * tvb_child_uncompress_* functions, since the capture file was opened.
+ * The cache is used if the protocols.decompressed_memory_limit
+ * preference isn't 0. */
+typedef struct {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    unsigned entries;   /**< Entries in the cache */
+    size_t   bytes;     /**< Uncompressed data in the cache */
+} tvb_uncompress_cache_stats_t;
+
+/** Gets the counters of the uncompressed data cache. */
+WS_DLL_PUBLIC void tvb_uncompress_cache_get_stats(tvb_uncompress_cache_stats_t *stats);
+
 /* From tvbuff_base64.c */
 
 /** Return a tvb that contains the binary representation of a base64
@@ -18,6 +18,7 @@
 #endif
 
 #include "tvbuff.h"
+#include "tvbuff-int.h"
 
 #ifdef HAVE_BROTLI
 
@@ -172,7 +173,7 @@ tvb_uncompress_brotli(tvbuff_t *tvb _U_, const int offset _U_, int comprlen _U_)
 tvbuff_t *
 tvb_child_uncompress_brotli(tvbuff_t *parent, tvbuff_t *tvb, const int offset, int comprlen)
 {
-    tvbuff_t *new_tvb = tvb_uncompress_brotli(tvb, offset, comprlen);
+    tvbuff_t *new_tvb = tvb_uncompress_cached(tvb, offset, comprlen, TVB_UNCOMPRESS_BROTLI, tvb_uncompress_brotli);
     if (new_tvb)
         tvb_set_child_real_data_tvbuff(parent, new_tvb);
     return new_tvb;
@@ -18,12 +18,20 @@
 typedef struct {
 	GQueue		*tvbs;
 
-	/* Used for quick testing to see if this
-	 * is the tvbuff that a COMPOSITE is
-	 * interested in. */
+	/* The members in an array, set when the composite is finalized,
+	 * along with their offsets, so that the member containing an
+	 * offset can be found with a binary search. */
+	tvbuff_t	**members;
+	unsigned	num_members;
 	unsigned		*start_offsets;
 	unsigned		*end_offsets;
 
+	/* Copies of ranges that span members, returned by get_ptr;
+	 * once they'd add up to more than the whole composite, it's
+	 * flattened instead. */
+	GSList		*spans;
+	unsigned	spans_length;
+
 } tvb_comp_t;
 
 struct tvb_composite {
@@ -40,8 +48,10 @@ composite_free(tvbuff_t *tvb)
 
 	g_queue_free(composite->tvbs);
 
+	g_free(composite->members);
 	g_free(composite->start_offsets);
 	g_free(composite->end_offsets);
+	g_slist_free_full(composite->spans, g_free);
 	g_free((void *)tvb->real_data);
 }
 
@@ -51,36 +61,50 @@ composite_offset(const tvbuff_t *tvb _U_, const unsigned counter)
 	return counter;
 }
 
+/* Returns the index of the member containing abs_offset, or num_members
+ * if it's past the end. */
+static unsigned
+composite_find_member(const tvb_comp_t *composite, unsigned abs_offset)
+{
+	unsigned low = 0, high = composite->num_members;
+
+	while (low < high) {
+		unsigned mid = low + (high - low) / 2;
+
+		if (abs_offset <= composite->end_offsets[mid])
+			high = mid;
+		else
+			low = mid + 1;
+	}
+	return low;
+}
+
+static void *composite_memcpy(tvbuff_t *tvb, void* _target, unsigned abs_offset, unsigned abs_length);
+
 static const uint8_t*
 composite_get_ptr(tvbuff_t *tvb, unsigned abs_offset, unsigned abs_length)
 {
 	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
 	unsigned	    i;
 	tvb_comp_t *composite;
-	tvbuff_t   *member_tvb = NULL;
+	tvbuff_t   *member_tvb;
 	unsigned	member_offset;
+	uint8_t	   *span;
 
 	/* DISSECTOR_ASSERT(tvb->ops == &tvb_composite_ops); */
 
 	/* Maybe the range specified by offset/length
 	 * is contiguous inside one of the member tvbuffs */
 	composite = &composite_tvb->composite;
-	GList *item = (GList*)composite->tvbs->head;
-
-
-	for (i = 0; i < g_queue_get_length(composite->tvbs); i++, item=item->next) {
-		if (abs_offset <= composite->end_offsets[i]) {
-			member_tvb = (tvbuff_t *)item->data;
-			break;
-		}
-	}
+	i = composite_find_member(composite, abs_offset);
 
 	/* special case */
-	if (!member_tvb) {
+	if (i == composite->num_members) {
 		DISSECTOR_ASSERT(abs_offset == tvb->length && abs_length == 0);
 		return "";
 	}
 
+	member_tvb = composite->members[i];
 	member_offset = abs_offset - composite->start_offsets[i];
 
 	if (tvb_bytes_exist(member_tvb, member_offset, abs_length)) {
@@ -90,6 +114,15 @@ composite_get_ptr(tvbuff_t *tvb, unsigned abs_offset, unsigned abs_length)
 		DISSECTOR_ASSERT(!tvb->real_data);
 		return tvb_get_ptr(member_tvb, member_offset, abs_length);
 	}
+	else if (composite->spans_length + abs_length <= tvb->length) {
+		/* Copy just the requested range; the pointer has to stay
+		 * valid as long as the tvbuff does. */
+		span = (uint8_t *)g_malloc(abs_length);
+		composite_memcpy(tvb, span, abs_offset, abs_length);
+		composite->spans = g_slist_prepend(composite->spans, span);
+		composite->spans_length += abs_length;
+		return span;
+	}
 	else {
 		/* Use a temporary variable as tvb_memcpy is also checking tvb->real_data pointer */
 		void *real_data = g_malloc(tvb->length);
@@ -109,7 +142,7 @@ composite_memcpy(tvbuff_t *tvb, void* _target, unsigned abs_offset, unsigned abs
 
 	unsigned	    i;
 	tvb_comp_t *composite;
-	tvbuff_t   *member_tvb = NULL;
+	tvbuff_t   *member_tvb;
 	unsigned	    member_offset, member_length;
 
 	/* DISSECTOR_ASSERT(tvb->ops == &tvb_composite_ops); */
@@ -117,51 +150,43 @@ composite_memcpy(tvbuff_t *tvb, void* _target, unsigned abs_offset, unsigned abs
 	/* Maybe the range specified by offset/length
 	 * is contiguous inside one of the member tvbuffs */
 	composite   = &composite_tvb->composite;
-
-	GList *item = (GList*)composite->tvbs->head;
-	for (i = 0; i < g_queue_get_length(composite->tvbs); i++, item=item->next) {
-		if (abs_offset <= composite->end_offsets[i]) {
-			member_tvb = (tvbuff_t *)item->data;
-			break;
-		}
-	}
+	i = composite_find_member(composite, abs_offset);
 
 	/* special case */
-	if (!member_tvb) {
+	if (i == composite->num_members) {
 		DISSECTOR_ASSERT(abs_offset == tvb->length && abs_length == 0);
 		return target;
 	}
 
+	member_tvb = composite->members[i];
 	member_offset = abs_offset - composite->start_offsets[i];
 
 	if (tvb_bytes_exist(member_tvb, member_offset, abs_length)) {
 		DISSECTOR_ASSERT(!tvb->real_data);
 		return tvb_memcpy(member_tvb, target, member_offset, abs_length);
 	}
-	else {
-		/* The requested data is non-contiguous inside
-		 * the member tvb. We have to memcpy() the part that's in the member tvb,
-		 * then iterate across the other member tvb's, copying their portions
-		 * until we have copied all data.
-		 */
-		member_length = tvb_captured_length_remaining(member_tvb, member_offset);
 
-		/* composite_memcpy() can't handle a member_length of zero. */
+	/* The requested data is non-contiguous inside
+	 * the member tvb. We have to memcpy() the part that's in the member tvb,
+	 * then go on to the following member tvb's, copying their portions
+	 * until we have copied all data.
+	 */
+	while (abs_length > 0) {
+		DISSECTOR_ASSERT(i < composite->num_members);
+		member_tvb = composite->members[i];
+		member_length = MIN((unsigned)tvb_captured_length_remaining(member_tvb, member_offset), abs_length);
+
+		/* This can't handle a member_length of zero. */
 		DISSECTOR_ASSERT(member_length > 0);
 
 		tvb_memcpy(member_tvb, target, member_offset, member_length);
-		abs_offset	+= member_length;
+		target		+= member_length;
 		abs_length	-= member_length;
-
-		/* Recurse */
-		if (abs_length > 0) {
-			composite_memcpy(tvb, target + member_length, abs_offset, abs_length);
-		}
-
-		return target;
+		member_offset	 = 0;
+		i++;
 	}
 
-	DISSECTOR_ASSERT_NOT_REACHED();
+	return _target;
 }
 
 static const struct tvb_ops tvb_composite_ops = {
@@ -196,8 +221,12 @@ tvb_new_composite(void)
 	tvb_comp_t *composite = &composite_tvb->composite;
 
 	composite->tvbs		 = g_queue_new();
+	composite->members	 = NULL;
+	composite->num_members	 = 0;
 	composite->start_offsets = NULL;
 	composite->end_offsets	 = NULL;
+	composite->spans	 = NULL;
+	composite->spans_length	 = 0;
 
 	return tvb;
 }
@@ -274,12 +303,15 @@ tvb_composite_finalize(tvbuff_t *tvb)
 	 */
 	DISSECTOR_ASSERT(num_members);
 
+	composite->members = g_new(tvbuff_t *, num_members);
+	composite->num_members = num_members;
 	composite->start_offsets = g_new(unsigned, num_members);
 	composite->end_offsets = g_new(unsigned, num_members);
 
 	GList *item = (GList*)composite->tvbs->head;
 	for (i=0; i < num_members; i++, item=item->next) {
 		member_tvb = (tvbuff_t *)item->data;
+		composite->members[i] = member_tvb;
 		composite->start_offsets[i] = tvb->length;
 		tvb->length += member_tvb->length;
 		tvb->reported_length += member_tvb->reported_length;
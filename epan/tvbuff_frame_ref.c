@@ -0,0 +1,269 @@
+/* tvbuff_frame_ref.c
+ *
+ * A tvbuff whose data is made of ranges of the data of captured frames,
+ * read back from the capture file when it's first accessed, rather than
+ * kept in memory.
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <wiretap/wtap.h>
+
+#include "tvbuff.h"
+#include "tvbuff-int.h"
+#include "epan.h"
+#include "proto.h"	/* XXX - only used for DISSECTOR_ASSERT, probably a new header file? */
+#include "exceptions.h"
+
+typedef struct {
+	uint32_t	frame_num;
+	int64_t		file_off;	/* of the frame in the capture file */
+	unsigned	frame_offset;
+	unsigned	length;
+} frame_ref_extent_t;
+
+struct tvb_frame_ref {
+	struct tvbuff tvb;
+
+	const epan_t	*session;
+	GArray		*extents;	/* of frame_ref_extent_t */
+
+	/* The data, while it's loaded. */
+	uint8_t		*data;
+	GList		 loaded_link;	/* in loaded_tvbs */
+};
+
+/* The frame reference tvbuffs whose data is loaded */
+static GQueue loaded_tvbs = G_QUEUE_INIT;
+
+static void
+frame_ref_unload(struct tvb_frame_ref *frame_ref_tvb)
+{
+	g_queue_unlink(&loaded_tvbs, &frame_ref_tvb->loaded_link);
+	g_free(frame_ref_tvb->data);
+	frame_ref_tvb->data = NULL;
+}
+
+static void
+frame_ref_free(tvbuff_t *tvb)
+{
+	struct tvb_frame_ref *frame_ref_tvb = (struct tvb_frame_ref *) tvb;
+
+	if (frame_ref_tvb->data)
+		frame_ref_unload(frame_ref_tvb);
+	g_array_free(frame_ref_tvb->extents, true);
+}
+
+static unsigned
+frame_ref_offset(const tvbuff_t *tvb _U_, const unsigned counter)
+{
+	return counter;
+}
+
+/*
+ * Read the data of all the extents from their frames.  We keep it in
+ * the tvbuff's private buffer, rather than in real_data, so that subset
+ * tvbuffs don't keep pointers to it after it's been unloaded.
+ */
+static uint8_t *
+frame_ref_load(struct tvb_frame_ref *frame_ref_tvb)
+{
+	tvbuff_t *tvb = &frame_ref_tvb->tvb;
+	wtap_rec rec;
+	uint8_t *data;
+	unsigned dest = 0;
+	bool ok = true;
+
+	if (frame_ref_tvb->data)
+		return frame_ref_tvb->data;
+
+	data = (uint8_t *)g_malloc(tvb->length ? tvb->length : 1);
+	wtap_rec_init(&rec, 1514);
+	for (unsigned i = 0; ok && i < frame_ref_tvb->extents->len; i++) {
+		frame_ref_extent_t *extent = &g_array_index(frame_ref_tvb->extents, frame_ref_extent_t, i);
+
+		ok = epan_get_frame_data(frame_ref_tvb->session, extent->frame_num, extent->file_off, &rec) &&
+		    (uint64_t)extent->frame_offset + extent->length <= ws_buffer_length(&rec.data);
+		if (ok) {
+			memcpy(data + dest, ws_buffer_start_ptr(&rec.data) + extent->frame_offset, extent->length);
+			dest += extent->length;
+		}
+	}
+	wtap_rec_cleanup(&rec);
+	if (!ok) {
+		g_free(data);
+		THROW_MESSAGE(DissectorError, "Can't read back the frame data of a reassembly");
+	}
+
+	frame_ref_tvb->data = data;
+	g_queue_push_tail_link(&loaded_tvbs, &frame_ref_tvb->loaded_link);
+	return data;
+}
+
+static const uint8_t *
+frame_ref_get_ptr(tvbuff_t *tvb, unsigned abs_offset, unsigned abs_length _U_)
+{
+	return frame_ref_load((struct tvb_frame_ref *) tvb) + abs_offset;
+}
+
+static void *
+frame_ref_memcpy(tvbuff_t *tvb, void *target, unsigned abs_offset, unsigned abs_length)
+{
+	return memcpy(target, frame_ref_load((struct tvb_frame_ref *) tvb) + abs_offset, abs_length);
+}
+
+static const struct tvb_ops tvb_frame_ref_ops = {
+	sizeof(struct tvb_frame_ref), /* size */
+
+	frame_ref_free,       /* free */
+	frame_ref_offset,     /* offset */
+	frame_ref_get_ptr,    /* get_ptr */
+	frame_ref_memcpy,     /* memcpy */
+	NULL,                 /* find_uint8 */
+	NULL,                 /* pbrk_uint8 */
+	NULL,                 /* clone */
+};
+
+/*
+ * Frame reference tvb
+ *
+ * Like a composite TVB, but its members are ranges of the data of
+ * frames, identified by frame number and file offset, which are read with
+ * epan_get_frame_data() when the data is accessed.  The data is then
+ * kept until tvb_frame_ref_unload_all() is called, which the epan
+ * library does when the last dissection in progress is cleaned up, so
+ * reading it back must give the same bytes each time.
+ *
+ * The caller of tvb_new_frame_ref must add the ranges with
+ * tvb_frame_ref_append and/or tvb_frame_ref_append_tvb, then call
+ * tvb_frame_ref_finalize.
+ */
+tvbuff_t *
+tvb_new_frame_ref(const epan_t *session)
+{
+	tvbuff_t *tvb = tvb_new(&tvb_frame_ref_ops);
+	struct tvb_frame_ref *frame_ref_tvb = (struct tvb_frame_ref *) tvb;
+
+	frame_ref_tvb->session = session;
+	frame_ref_tvb->extents = g_array_new(false, false, sizeof(frame_ref_extent_t));
+	frame_ref_tvb->data = NULL;
+	frame_ref_tvb->loaded_link.data = frame_ref_tvb;
+	frame_ref_tvb->loaded_link.prev = NULL;
+	frame_ref_tvb->loaded_link.next = NULL;
+
+	return tvb;
+}
+
+void
+tvb_frame_ref_append(tvbuff_t *tvb, const uint32_t frame_num, const int64_t file_off,
+		     const unsigned frame_offset, const unsigned length)
+{
+	struct tvb_frame_ref *frame_ref_tvb = (struct tvb_frame_ref *) tvb;
+	frame_ref_extent_t *last;
+	frame_ref_extent_t extent;
+
+	DISSECTOR_ASSERT(tvb && !tvb->initialized);
+	DISSECTOR_ASSERT(tvb->ops == &tvb_frame_ref_ops);
+
+	if (length == 0)
+		return;
+
+	/* Merge with the previous range if it continues it. */
+	if (frame_ref_tvb->extents->len) {
+		last = &g_array_index(frame_ref_tvb->extents, frame_ref_extent_t, frame_ref_tvb->extents->len - 1);
+		if (last->frame_num == frame_num && last->frame_offset + last->length == frame_offset) {
+			last->length += length;
+			tvb->length += length;
+			return;
+		}
+	}
+
+	extent.frame_num = frame_num;
+	extent.file_off = file_off;
+	extent.frame_offset = frame_offset;
+	extent.length = length;
+	g_array_append_val(frame_ref_tvb->extents, extent);
+	tvb->length += length;
+}
+
+bool
+tvb_is_frame_ref(const tvbuff_t *tvb)
+{
+	return tvb->ops == &tvb_frame_ref_ops;
+}
+
+void
+tvb_frame_ref_append_tvb(tvbuff_t *tvb, tvbuff_t *member, unsigned offset, unsigned length)
+{
+	struct tvb_frame_ref *member_tvb = (struct tvb_frame_ref *) member;
+
+	DISSECTOR_ASSERT(tvb_is_frame_ref(member) && member->initialized);
+	DISSECTOR_ASSERT((uint64_t)offset + length <= member->length);
+
+	for (unsigned i = 0; length > 0 && i < member_tvb->extents->len; i++) {
+		frame_ref_extent_t *extent = &g_array_index(member_tvb->extents, frame_ref_extent_t, i);
+		unsigned part;
+
+		if (offset >= extent->length) {
+			offset -= extent->length;
+			continue;
+		}
+		part = MIN(extent->length - offset, length);
+		tvb_frame_ref_append(tvb, extent->frame_num, extent->file_off, extent->frame_offset + offset, part);
+		offset = 0;
+		length -= part;
+	}
+}
+
+void
+tvb_frame_ref_finalize(tvbuff_t *tvb)
+{
+	DISSECTOR_ASSERT(tvb && !tvb->initialized);
+	DISSECTOR_ASSERT(tvb->ops == &tvb_frame_ref_ops);
+
+	tvb->reported_length = tvb->length;
+	tvb->contained_length = tvb->length;
+	tvb->initialized = true;
+	tvb->ds_tvb = tvb;
+}
+
+/*
+ * Unload the data of all the frame reference tvbuffs, other than those
+ * an address has been set to point into with set_address_tvb(); that
+ * address might be kept, e.g. as a conversation key, so the data stays
+ * until the tvbuff is freed.
+ */
+void
+tvb_frame_ref_unload_all(void)
+{
+	GList *link, *next;
+
+	for (link = g_queue_peek_head_link(&loaded_tvbs); link != NULL; link = next) {
+		struct tvb_frame_ref *frame_ref_tvb = (struct tvb_frame_ref *)link->data;
+
+		next = link->next;
+		if (!tvb_has_address_ref(&frame_ref_tvb->tvb))
+			frame_ref_unload(frame_ref_tvb);
+	}
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
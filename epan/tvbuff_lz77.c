@@ -12,6 +12,7 @@
 #include <glib.h>
 #include <epan/exceptions.h>
 #include <epan/tvbuff.h>
+#include <epan/tvbuff-int.h>
 #include <epan/wmem_scopes.h>
 
 #define MAX_INPUT_SIZE (16*1024*1024) /* 16MB */
@@ -136,7 +137,7 @@ tvb_uncompress_lz77(tvbuff_t *tvb, const int offset, int in_size)
 tvbuff_t *
 tvb_child_uncompress_lz77(tvbuff_t *parent, tvbuff_t *tvb, const int offset, int in_size)
 {
-	tvbuff_t *new_tvb = tvb_uncompress_lz77(tvb, offset, in_size);
+	tvbuff_t *new_tvb = tvb_uncompress_cached(tvb, offset, in_size, TVB_UNCOMPRESS_LZ77, tvb_uncompress_lz77);
 	if (new_tvb)
 		tvb_set_child_real_data_tvbuff(parent, new_tvb);
 	return new_tvb;
@@ -21,6 +21,7 @@
 #include <stdlib.h> /* qsort */
 #include <epan/exceptions.h>
 #include <epan/tvbuff.h>
+#include <epan/tvbuff-int.h>
 #include <epan/wmem_scopes.h>
 
 #define MAX_INPUT_SIZE (16*1024*1024) /* 16MB */
@@ -405,7 +406,7 @@ tvb_uncompress_lz77huff(tvbuff_t *tvb,
 tvbuff_t *
 tvb_child_uncompress_lz77huff(tvbuff_t *parent, tvbuff_t *tvb, const int offset, int in_size)
 {
-	tvbuff_t *new_tvb = tvb_uncompress_lz77huff(tvb, offset, in_size);
+	tvbuff_t *new_tvb = tvb_uncompress_cached(tvb, offset, in_size, TVB_UNCOMPRESS_LZ77HUFF, tvb_uncompress_lz77huff);
 	if (new_tvb)
 		tvb_set_child_real_data_tvbuff(parent, new_tvb);
 	return new_tvb;
@@ -16,6 +16,7 @@
 #include <glib.h>
 #include <epan/exceptions.h>
 #include <epan/tvbuff.h>
+#include <epan/tvbuff-int.h>
 #include <epan/wmem_scopes.h>
 
 #define MAX_INPUT_SIZE (16*1024*1024) /* 16MB */
@@ -147,7 +148,7 @@ tvb_uncompress_lznt1(tvbuff_t *tvb, const int offset, int in_size)
 tvbuff_t *
 tvb_child_uncompress_lznt1(tvbuff_t *parent, tvbuff_t *tvb, const int offset, int in_size)
 {
-	tvbuff_t *new_tvb = tvb_uncompress_lznt1(tvb, offset, in_size);
+	tvbuff_t *new_tvb = tvb_uncompress_cached(tvb, offset, in_size, TVB_UNCOMPRESS_LZNT1, tvb_uncompress_lznt1);
 	if (new_tvb)
 		tvb_set_child_real_data_tvbuff(parent, new_tvb);
 	return new_tvb;
@@ -14,6 +14,7 @@
 #endif
 
 #include "tvbuff.h"
+#include "tvbuff-int.h"
 
 #ifdef HAVE_SNAPPY
 
@@ -65,7 +66,7 @@ tvb_uncompress_snappy(tvbuff_t *tvb _U_, const int offset _U_, int comprlen _U_)
 tvbuff_t *
 tvb_child_uncompress_snappy(tvbuff_t *parent, tvbuff_t *tvb, const int offset, int comprlen)
 {
-    tvbuff_t *new_tvb = tvb_uncompress_snappy(tvb, offset, comprlen);
+    tvbuff_t *new_tvb = tvb_uncompress_cached(tvb, offset, comprlen, TVB_UNCOMPRESS_SNAPPY, tvb_uncompress_snappy);
     if (new_tvb)
         tvb_set_child_real_data_tvbuff(parent, new_tvb);
     return new_tvb;
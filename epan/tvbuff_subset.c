@@ -259,6 +259,18 @@ tvb_new_subset_remaining(tvbuff_t *backing, const int backing_offset)
 	return tvb;
 }
 
+/*
+ * If this is a subset, return the tvbuff it's a subset of; otherwise,
+ * return NULL.
+ */
+tvbuff_t *
+tvb_subset_backing(const tvbuff_t *tvb)
+{
+	if (tvb->ops != &tvb_subset_ops)
+		return NULL;
+	return ((const struct tvb_subset *) tvb)->subset.tvb;
+}
+
 tvbuff_t *
 tvb_new_proxy(tvbuff_t *backing)
 {
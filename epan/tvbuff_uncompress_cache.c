@@ -0,0 +1,159 @@
+/* tvbuff_uncompress_cache.c
+ *
+ * Cache of the data uncompressed by the tvb_child_uncompress_* functions,
+ * so that dissecting a packet again doesn't uncompress its data again.
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+#define WS_LOG_DOMAIN LOG_DOMAIN_EPAN
+
+#include <string.h>
+
+#include <glib.h>
+
+#include "tvbuff.h"
+#include "tvbuff-int.h"
+#include "lru_cache.h"
+#include "prefs.h"
+
+#include <wsutil/wslog.h>
+
+/*
+ * Compressed data shorter than this is uncompressed every time; hashing
+ * and looking it up wouldn't save much.
+ */
+#define UNCOMPRESS_CACHE_MIN_LEN	128
+
+/*
+ * Entries are identified by the algorithm and the SHA-256 hash of the
+ * compressed data, rather than by the tvbuff it came from, as the tvbuffs
+ * of a frame are created anew each time it's dissected.  Identical
+ * compressed data in different frames, e.g. the same page fetched twice,
+ * then shares its entry.
+ */
+typedef struct {
+	tvb_uncompress_algo_t	algo;
+	unsigned		comprlen;
+	uint8_t			hash[32];
+} uncompress_cache_key_t;
+
+static lru_cache_t *cache;
+
+static unsigned
+uncompress_cache_key_hash(const void *k)
+{
+	const uncompress_cache_key_t *key = (const uncompress_cache_key_t *)k;
+	unsigned hash;
+
+	memcpy(&hash, key->hash, sizeof(hash));
+	return hash;
+}
+
+static gboolean
+uncompress_cache_key_equal(const void *k1, const void *k2)
+{
+	return memcmp(k1, k2, sizeof(uncompress_cache_key_t)) == 0;
+}
+
+/*
+ * Uncompresses comprlen bytes of tvb at offset with uncompress, or gets the
+ * result of doing so from the cache.  Like uncompress, returns a new real
+ * data tvbuff, not yet a child of any tvbuff, or NULL.
+ */
+tvbuff_t *
+tvb_uncompress_cached(tvbuff_t *tvb, const int offset, int comprlen,
+		      tvb_uncompress_algo_t algo, tvb_uncompress_func_t uncompress)
+{
+	size_t limit = (size_t)prefs.decompressed_memory_limit * 1024 * 1024;
+	uncompress_cache_key_t key;
+	const uint8_t *data;
+	unsigned length;
+	GChecksum *checksum;
+	gsize hash_len = sizeof(key.hash);
+	tvbuff_t *uncompr_tvb;
+
+	if (cache == NULL || limit == 0 || comprlen < UNCOMPRESS_CACHE_MIN_LEN ||
+	    tvb_captured_length_remaining(tvb, offset) < comprlen)
+		return uncompress(tvb, offset, comprlen);
+
+	memset(&key, 0, sizeof(key));
+	key.algo = algo;
+	key.comprlen = comprlen;
+	checksum = g_checksum_new(G_CHECKSUM_SHA256);
+	g_checksum_update(checksum, tvb_get_ptr(tvb, offset, comprlen), comprlen);
+	g_checksum_get_digest(checksum, key.hash, &hash_len);
+	g_checksum_free(checksum);
+
+	data = lru_cache_lookup(cache, &key, &length);
+	if (data) {
+		/* A copy, as the entry can be dropped while the tvbuff is in use. */
+		uncompr_tvb = tvb_new_real_data((const uint8_t *)g_memdup2(data, length),
+		    length, length);
+		tvb_set_free_cb(uncompr_tvb, g_free);
+		return uncompr_tvb;
+	}
+
+	uncompr_tvb = uncompress(tvb, offset, comprlen);
+	if (uncompr_tvb) {
+		length = tvb_captured_length(uncompr_tvb);
+		lru_cache_add(cache, &key, tvb_get_ptr(uncompr_tvb, 0, length), length, limit);
+	}
+	return uncompr_tvb;
+}
+
+void
+tvb_uncompress_cache_get_stats(tvb_uncompress_cache_stats_t *stats_out)
+{
+	lru_cache_stats_t stats;
+
+	memset(stats_out, 0, sizeof(*stats_out));
+	if (cache == NULL)
+		return;
+	lru_cache_get_stats(cache, &stats);
+	stats_out->hits = stats.hits;
+	stats_out->misses = stats.misses;
+	stats_out->evictions = stats.evictions;
+	stats_out->entries = stats.entries;
+	stats_out->bytes = stats.bytes;
+}
+
+void
+tvb_uncompress_cache_init(void)
+{
+	cache = lru_cache_new(uncompress_cache_key_hash, uncompress_cache_key_equal,
+	    sizeof(uncompress_cache_key_t));
+}
+
+void
+tvb_uncompress_cache_cleanup(void)
+{
+	tvb_uncompress_cache_stats_t stats;
+
+	tvb_uncompress_cache_get_stats(&stats);
+	if (stats.hits || stats.misses) {
+		ws_info("uncompressed data cache: %" PRIu64 " hits, %" PRIu64 " misses, "
+		    "%" PRIu64 " evictions", stats.hits, stats.misses, stats.evictions);
+	}
+
+	lru_cache_free(cache);
+	cache = NULL;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
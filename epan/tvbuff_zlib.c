@@ -32,6 +32,7 @@ typedef z_stream zlib_stream;
 #endif
 
 #include "tvbuff.h"
+#include "tvbuff-int.h"
 #include <wsutil/wslog.h>
 
 #if defined (HAVE_ZLIB) || defined (HAVE_ZLIBNG)
@@ -325,7 +326,7 @@ tvb_uncompress_zlib(tvbuff_t *tvb _U_, const int offset _U_, int comprlen _U_)
 tvbuff_t *
 tvb_child_uncompress_zlib(tvbuff_t *parent, tvbuff_t *tvb, const int offset, int comprlen)
 {
-	tvbuff_t *new_tvb = tvb_uncompress_zlib(tvb, offset, comprlen);
+	tvbuff_t *new_tvb = tvb_uncompress_cached(tvb, offset, comprlen, TVB_UNCOMPRESS_ZLIB, tvb_uncompress_zlib);
 	if (new_tvb)
 		tvb_set_child_real_data_tvbuff (parent, new_tvb);
 	return new_tvb;
@@ -100,7 +100,7 @@ end:
 
 tvbuff_t *tvb_child_uncompress_zstd(tvbuff_t *parent, tvbuff_t *tvb, const int offset, int comprlen)
 {
-    tvbuff_t *uncompressed = tvb_uncompress_zstd(tvb, offset, comprlen);
+    tvbuff_t *uncompressed = tvb_uncompress_cached(tvb, offset, comprlen, TVB_UNCOMPRESS_ZSTD, tvb_uncompress_zstd);
     if (!uncompressed)
     {
         return uncompressed;
@@ -123,7 +123,7 @@ wmem_init_scopes(void)
 
     wmem_init();
 
-    packet_scope = wmem_allocator_new(WMEM_ALLOCATOR_BLOCK_FAST);
+    packet_scope = wmem_allocator_new(WMEM_ALLOCATOR_ARENA);
     file_scope   = wmem_allocator_new(WMEM_ALLOCATOR_BLOCK);
     epan_scope   = wmem_allocator_new(WMEM_ALLOCATOR_BLOCK);
 
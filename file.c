@@ -231,7 +231,8 @@ ws_epan_new(capture_file *cf)
         cap_file_provider_get_frame_ts,
         cap_file_provider_get_interface_name,
         cap_file_provider_get_interface_description,
-        cap_file_provider_get_modified_block
+        cap_file_provider_get_modified_block,
+        cap_file_provider_get_frame_data
     };
 
     return epan_new(&cf->provider, &funcs);
@@ -5055,6 +5056,13 @@ cf_get_packet_block(capture_file *cf, const frame_data *fd)
         block = wtap_block_ref(rec.block);
 
         wtap_rec_cleanup(&rec);
+
+        /*
+         * Records with no options have no block; give the caller
+         * an empty one, so that options can be added to it.
+         */
+        if (block == NULL)
+            block = wtap_block_create(WTAP_BLOCK_PACKET);
         return block;
     }
 }
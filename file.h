@@ -705,11 +705,12 @@ void cf_update_section_comments(capture_file *cf, unsigned shb_idx, char **comme
 /*
  * Get the packet block for a packet (record).
  * If the block has been edited, it returns the result of the edit,
- * otherwise it returns the block from the file.
+ * otherwise it returns the block from the file, or a new, empty packet
+ * block if the record in the file has none.
  *
  * @param cf the capture file
  * @param fd the frame_data structure for the frame
- * @returns A block (use wtap_block_unref to free) or NULL if there is none.
+ * @returns A block (use wtap_block_unref to free).
  */
 wtap_block_t cf_get_packet_block(capture_file *cf, const frame_data *fd);
 
@@ -113,3 +113,19 @@ cap_file_provider_set_modified_block(struct packet_provider_data *prov, frame_da
 
   fd->has_modified_block = 1;
 }
+
+bool
+cap_file_provider_get_frame_data(struct packet_provider_data *prov, uint32_t frame_num _U_, int64_t file_off, wtap_rec *rec)
+{
+  int err;
+  char *err_info = NULL;
+
+  if (!prov->wth)
+    return false;
+
+  if (!wtap_seek_read(prov->wth, file_off, rec, &err, &err_info)) {
+    g_free(err_info);
+    return false;
+  }
+  return true;
+}
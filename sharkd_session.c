@@ -450,6 +450,7 @@ json_prep(char* buf, const jsmntok_t* tokens, int count)
         {"load",       "file",           2, JSMN_STRING,       SHARKD_JSON_STRING,   SHARKD_MANDATORY},
         {"setcomment", "frame",          2, JSMN_PRIMITIVE,    SHARKD_JSON_UINTEGER, SHARKD_MANDATORY},
         {"setcomment", "comment",        2, JSMN_STRING,       SHARKD_JSON_STRING,   SHARKD_OPTIONAL},
+        {"status",     "dissector_profile", 2, JSMN_PRIMITIVE, SHARKD_JSON_BOOLEAN,  SHARKD_OPTIONAL},
         {"setconf",    "name",           2, JSMN_STRING,       SHARKD_JSON_STRING,   SHARKD_MANDATORY},
         {"setconf",    "value",          2, JSMN_UNDEFINED,    SHARKD_JSON_ANY,      SHARKD_MANDATORY},
         {"tap",        "tap0",           2, JSMN_STRING,       SHARKD_JSON_STRING,   SHARKD_MANDATORY},
@@ -1241,10 +1242,30 @@ sharkd_session_process_load(const char *buf, const jsmntok_t *tokens, int count)
  *                      'format'   - column format (%x or %Cus:<expr>:<occurrence> if COL_CUSTOM)
  *                      'visible'  - true if column is visible
  *                      'display'  - column display format; 'U', 'R' or 'D'
+ *   (o) dissector_profile - when dissector profiling is enabled, array of per-protocol counters, object with attributes:
+ *                      'proto'      - protocol filter name
+ *                      'calls'      - number of calls to the protocol's dissectors
+ *                      'total_ns'   - time spent in them, including dissectors they called
+ *                      'self_ns'    - time spent in them, excluding dissectors they called
+ *                      'self_bytes' - bytes they allocated from packet scope, excluding dissectors they called
+ *
+ * Input:
+ *   (o) dissector_profile - true to enable dissector profiling (with counters reset), false to disable it
  */
 static void
-sharkd_session_process_status(void)
+sharkd_session_process_status(char *buf, const jsmntok_t *tokens, int count)
 {
+    const char *tok_profile = json_find_attr(buf, tokens, count, "dissector_profile");
+
+    if (tok_profile)
+    {
+        bool enable = !strcmp(tok_profile, "true");
+
+        if (enable && !dissector_profile_is_enabled())
+            dissector_profile_reset();
+        dissector_profile_set_enabled(enable);
+    }
+
     sharkd_json_result_prologue(rpcid);
 
     sharkd_json_value_anyf("frames", "%u", cfile.count);
@@ -1294,6 +1315,27 @@ sharkd_session_process_status(void)
         sharkd_json_array_close();
     }
 
+    if (dissector_profile_is_enabled())
+    {
+        GArray *profile = dissector_profile_get();
+
+        sharkd_json_array_open("dissector_profile");
+        for (unsigned i = 0; i < profile->len; ++i)
+        {
+            dissector_profile_t *entry = &g_array_index(profile, dissector_profile_t, i);
+
+            sharkd_json_object_open(NULL);
+            sharkd_json_value_string("proto", proto_get_protocol_filter_name(entry->proto_id));
+            sharkd_json_value_anyf("calls", "%" PRIu64, entry->calls);
+            sharkd_json_value_anyf("total_ns", "%" PRIu64, entry->total_ns);
+            sharkd_json_value_anyf("self_ns", "%" PRIu64, entry->self_ns);
+            sharkd_json_value_anyf("self_bytes", "%" PRIu64, entry->self_bytes);
+            sharkd_json_object_close();
+        }
+        sharkd_json_array_close();
+        g_array_free(profile, true);
+    }
+
     sharkd_json_result_epilogue();
 }
 
@@ -5933,7 +5975,7 @@ sharkd_session_process(char *buf, const jsmntok_t *tokens, int count)
         if (!strcmp(tok_method, "load"))
             sharkd_session_process_load(buf, tokens, count);
         else if (!strcmp(tok_method, "status"))
-            sharkd_session_process_status();
+            sharkd_session_process_status(buf, tokens, count);
         else if (!strcmp(tok_method, "analyse"))
             sharkd_session_process_analyse();
         else if (!strcmp(tok_method, "info"))
@@ -189,6 +189,7 @@ def features(cmd_tshark, make_env):
         have_pkcs11='PKCS#11' in tshark_v,
         have_brotli='+brotli' in tshark_v,
         have_zstd='+Zstandard' in tshark_v,
+        have_lz4='+LZ4' in tshark_v,
         have_plugins='Plugins: supported' in tshark_v,
     )
 
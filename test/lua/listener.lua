@@ -64,6 +64,19 @@ local function checkAllFieldInfos()
             print("Too few fields!")
             return false
         end
+        -- The fields are in tree pre-order: frame.protocols, which is
+        -- added to the frame tree after the packet has been dissected,
+        -- comes before the fields of the protocols in the frame.
+        local protocols_idx, eth_idx
+        for j,name in ipairs(v.fields) do
+            if name == "frame.protocols" then protocols_idx = j end
+            if name == "eth" and not eth_idx then eth_idx = j end
+        end
+        if v.fields[1] ~= "frame" or not protocols_idx or not eth_idx or
+           protocols_idx > eth_idx then
+            print("Fields are not in tree pre-order!")
+            return false
+        end
     end
     return true
 end
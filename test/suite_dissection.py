@@ -10,7 +10,9 @@
 
 import sys
 import os.path
+import struct
 import subprocess
+import uuid
 from subprocesstest import count_output, grep_output
 import pytest
 
@@ -561,6 +563,32 @@ class TestDissectHttp2:
         # Stream ID 1 bytes, decrypted and uncompressed, human readable
         assert grep_output(stdout, '00000000  3a 6d 65 74 68 6f 64 3a')
 
+    def test_http2_header_cache_limit(self, cmd_tshark, features, dirs, capture_file, test_env):
+        '''HTTP/2 headers dropped from a tiny header cache are decompressed again'''
+        if not features.have_nghttp2:
+            pytest.skip('Requires nghttp2.')
+        key_file = os.path.join(dirs.key_dir, 'http2-data-reassembly.keys')
+        captures = (
+            (capture_file('http2-data-reassembly.pcap'),
+                '-o', 'tls.keylog_file: {}'.format(key_file),
+                '-d', 'tcp.port==8443,tls'),
+            (capture_file('http2_follow_multistream.pcapng'),),
+            (capture_file('packet-h2-14_headers.pcapng'),
+                '-d', 'tcp.port==3000,http2'),
+            (capture_file('grpc_stream_reassembly_sample.pcapng.gz'),
+                '-d', 'tcp.port==50051,http2',
+                '-d', 'tcp.port==44363,http2'),
+        )
+        for capture in captures:
+            # With two passes, the second pass needs the headers that a
+            # 1 KB cache has dropped during the first one.
+            args = (cmd_tshark, '-r') + capture + ('-2', '-V')
+            expected = subprocess.check_output(args, encoding='utf-8', env=test_env)
+            limited = subprocess.check_output(args + ('-o', 'http2.header_cache_limit:1'),
+                encoding='utf-8', env=test_env)
+            assert grep_output(expected, 'HyperText Transfer Protocol 2')
+            assert limited == expected
+
 class TestDissectHttp2:
     def test_http3_qpack_reassembly(self, cmd_tshark, features, dirs, capture_file, test_env):
         '''HTTP/3 QPACK encoder stream reassembly'''
@@ -810,6 +838,61 @@ class TestDissectTcp:
             encoding='utf-8', env=test_env)
         assert stdout == '2\t16\n'
 
+class TestDissectConversationExpiry:
+    @staticmethod
+    def write_dcerpc_capture(path):
+        '''
+        A DCE/RPC bind to the endpoint mapper and a request, on the same TCP
+        connection; 20 seconds of other traffic; then another request on the
+        same addresses and ports, which, if the first connection has been
+        expired, has no bind.
+        '''
+        def dcerpc(ptype, call_id, body):
+            return struct.pack('<BBBB4sHHI', 5, 0, ptype, 3, b'\x10\x00\x00\x00',
+                16 + len(body), 0, call_id) + body
+
+        def ipv4(proto, src, dst, payload):
+            return struct.pack('>BBHHHBBH4s4s', 0x45, 0, 20 + len(payload), 0, 0x4000, 64,
+                proto, 0, bytes(src), bytes(dst)) + payload
+
+        seq = 1000
+        def tcp(payload):
+            nonlocal seq
+            segment = struct.pack('>HHIIBBHHH', 40000, 40001, seq, 1, 5 << 4, 0x18, 65535, 0, 0) + payload
+            seq += len(payload)
+            return ipv4(6, (10, 0, 0, 1), (10, 0, 0, 2), segment)
+
+        def udp():
+            return ipv4(17, (10, 0, 0, 3), (10, 0, 0, 4), struct.pack('>HHHH', 9, 9, 8, 0))
+
+        epm = uuid.UUID('e1af8308-5d1f-11c9-91a4-08002b14a0fa').bytes_le
+        ndr = uuid.UUID('8a885d04-1ceb-11c9-9fe8-08002b104860').bytes_le
+        bind = dcerpc(11, 1, struct.pack('<HHIBBHHBB', 5840, 5840, 0, 1, 0, 0, 0, 1, 0)
+            + epm + struct.pack('<HH', 3, 0) + ndr + struct.pack('<I', 2))
+        def request(call_id):
+            return dcerpc(0, call_id, struct.pack('<IHH', 0, 0, 2))
+
+        packets = ((0, tcp(bind)), (0, tcp(request(2))), (10, udp()), (20, udp()), (21, tcp(request(3))))
+        with open(path, 'wb') as f:
+            f.write(struct.pack('<IHHiIII', 0xa1b2c3d4, 2, 4, 0, 0, 65535, 101))
+            for secs, packet in packets:
+                f.write(struct.pack('<IIII', secs, 0, len(packet), len(packet)))
+                f.write(packet)
+
+    def test_conversation_expiry_no_carry_over(self, cmd_tshark, result_file, test_env):
+        '''An expired conversation's state isn't used for a new one.'''
+        dcerpc_pcap = result_file('dcerpc-expiry.pcap')
+        self.write_dcerpc_capture(dcerpc_pcap)
+        fields = ('-Y', 'dcerpc.pkt_type == 0', '-T', 'fields', '-e', 'frame.number', '-e', '_ws.col.protocol')
+        stdout = subprocess.check_output((cmd_tshark, '-r', dcerpc_pcap) + fields,
+            encoding='utf-8', env=test_env)
+        assert stdout.splitlines() == ['2\tEPM', '5\tEPM']
+        stdout = subprocess.check_output((cmd_tshark, '-r', dcerpc_pcap,
+            '--conversation-timeout', '5') + fields,
+            encoding='utf-8', env=test_env)
+        assert stdout.splitlines() == ['2\tEPM', '5\tDCERPC']
+
+
 class TestDissectGit:
     def test_git_prot(self, cmd_tshark, capture_file, features, test_env):
         '''
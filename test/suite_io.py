@@ -9,7 +9,9 @@
 '''File I/O tests'''
 
 import io
+import json
 import os.path
+import struct
 import subprocess
 from subprocesstest import cat_dhcp_command, check_packet_count
 import sys
@@ -68,6 +70,161 @@ class TestTsharkIO:
         check_io_4_packets(capture_file, result_file, cmd_tshark, cmd_capinfos, env=test_env)
 
 
+class TestTsharkBatchIO:
+    def make_read_list(self, capture_file, result_file):
+        read_list = result_file('read-list.txt')
+        with open(read_list, 'w') as f:
+            f.write('# capture files\n')
+            f.write(capture_file('dhcp.pcap') + '\n')
+            f.write('\n')
+            f.write(capture_file('dhcp.pcapng') + '\n')
+        return read_list
+
+    def test_tshark_batch_read_list(self, cmd_tshark, capture_file, result_file, test_env):
+        '''Read a list of files in one TShark process'''
+        stdout = subprocess.check_output((cmd_tshark,
+            '--read-list', self.make_read_list(capture_file, result_file),
+            '-T', 'fields', '-e', 'frame.number',
+        ), encoding='utf-8', env=test_env)
+        # Frame numbers restart for each file.
+        assert stdout.split() == ['1', '2', '3', '4'] * 2
+
+    def test_tshark_batch_output(self, cmd_tshark, cmd_capinfos, capture_file, result_file, test_env):
+        '''Write per-file output for a list of files'''
+        out_dir = result_file('batch-out')
+        os.mkdir(out_dir)
+        subprocess.check_call((cmd_tshark,
+            '--read-list', self.make_read_list(capture_file, result_file),
+            '--batch-output', out_dir,
+            '-w', out_dir,
+            '--batch-jobs', '2',
+        ), env=test_env)
+        for name in ('dhcp.pcap', 'dhcp.pcapng'):
+            assert os.path.isfile(os.path.join(out_dir, name + '.txt'))
+            check_packet_count(cmd_capinfos, 4, os.path.join(out_dir, name + '.pcapng'))
+
+    def test_tshark_batch_json_output(self, cmd_tshark, capture_file, result_file, test_env):
+        '''Write a complete JSON document for each file of a list'''
+        out_dir = result_file('batch-json')
+        os.mkdir(out_dir)
+        read_list = self.make_read_list(capture_file, result_file)
+        # Concatenated documents wouldn't be JSON.
+        proc = subprocess.run((cmd_tshark, '--read-list', read_list, '-T', 'json'),
+            stdout=subprocess.PIPE, stderr=subprocess.PIPE, encoding='utf-8', env=test_env)
+        assert proc.returncode != 0
+        assert '--batch-output' in proc.stderr
+        proc = subprocess.run((cmd_tshark, '--read-list', read_list, '-T', 'json',
+            '--batch-output', out_dir, '-c', '1'),
+            stdout=subprocess.PIPE, encoding='utf-8', env=test_env)
+        assert proc.returncode == 0
+        # The standard output is restored after each file.
+        assert proc.stdout == ''
+        for name in ('dhcp.pcap', 'dhcp.pcapng'):
+            with open(os.path.join(out_dir, name + '.txt')) as f:
+                assert len(json.load(f)) == 1
+
+
+class TestTsharkDecompressThreads:
+    @pytest.mark.parametrize('compression,extension', [('gzip', 'gz'), ('lz4', 'lz4')])
+    def test_tshark_decompress_threads(self, compression, extension, cmd_editcap, cmd_tshark, result_file, features, test_env):
+        '''Read a file compressed in chunks with several decompression threads'''
+        if compression == 'lz4' and not features.have_lz4:
+            pytest.skip('Requires LZ4')
+        # About 4 MB of Ethernet frames, i.e. several 1 MiB chunks.
+        in_file = result_file('pdec.pcap')
+        with open(in_file, 'wb') as f:
+            f.write(struct.pack('<IHHiIII', 0xa1b2c3d4, 2, 4, 0, 0, 65535, 1))
+            for i in range(4000):
+                packet = b'\x00\x00\x5e\x00\x53\x01' * 2 + b'\x88\xb5' + struct.pack('>I', i) * 250
+                f.write(struct.pack('<IIII', i, 0, len(packet), len(packet)))
+                f.write(packet)
+        out_file = result_file('pdec.pcap.' + extension)
+        subprocess.check_call((cmd_editcap,
+            '--compress', compression, '--compress-chunked',
+            in_file, out_file,
+        ), env=test_env)
+        fields = ('-T', 'fields', '-e', 'frame.number', '-e', 'data.data')
+        serial = subprocess.check_output((cmd_tshark, '-r', out_file) + fields,
+            encoding='utf-8', env=test_env)
+        parallel = subprocess.check_output((cmd_tshark, '-r', out_file,
+            '--decompress-threads', '4') + fields,
+            encoding='utf-8', env=test_env)
+        assert len(serial.splitlines()) == 4000
+        assert parallel == serial
+
+
+class TestTsharkMmap:
+    @pytest.mark.parametrize('in_name', ['dhcp.pcap', 'dhcp.pcapng'])
+    def test_tshark_mmap_opt_out(self, in_name, cmd_tshark, capture_file, test_env):
+        '''Reading a file with and without the memory mapping gives the same output'''
+        in_file = capture_file(in_name)
+        no_mmap_env = test_env.copy()
+        no_mmap_env['WIRESHARK_NO_MMAP'] = '1'
+        mapped = subprocess.check_output((cmd_tshark, '-r', in_file, '-V', '-x'),
+            encoding='utf-8', env=test_env)
+        unmapped = subprocess.check_output((cmd_tshark, '-r', in_file, '-V', '-x'),
+            encoding='utf-8', env=no_mmap_env)
+        assert mapped == unmapped
+
+
+def ones_complement_checksum(data):
+    if len(data) % 2:
+        data += b'\x00'
+    total = sum(struct.unpack('>%dH' % (len(data) // 2), data))
+    while total > 0xffff:
+        total = (total & 0xffff) + (total >> 16)
+    return ~total & 0xffff
+
+
+class TestTsharkChecksumThreads:
+    @pytest.mark.parametrize('bad_checksums', [False, True])
+    def test_tshark_checksum_threads(self, bad_checksums, cmd_tshark, result_file, test_env):
+        '''Validate checksums ahead of dissection with several threads'''
+        # Full-size TCP and UDP packets over IPv4, so that batches are
+        # validated with several threads, and with some bad checksums that
+        # the dissectors then have to report exactly as without the option.
+        in_file = result_file('cksum.pcap')
+        src, dst = bytes((10, 0, 0, 1)), bytes((10, 0, 0, 2))
+        with open(in_file, 'wb') as f:
+            f.write(struct.pack('<IHHiIII', 0xa1b2c3d4, 2, 4, 0, 0, 65535, 1))
+            for i in range(640):
+                payload = struct.pack('>I', i) * 365
+                if i % 2:
+                    proto = 17
+                    l4 = struct.pack('>HHHH', 40000, 40001, 8 + len(payload), 0) + payload
+                    cksum_off = 6
+                else:
+                    proto = 6
+                    l4 = struct.pack('>HHIIBBHHH', 40000, 40001, 1 + (i // 2) * len(payload), 1,
+                        0x50, 0x18, 65535, 0, 0) + payload
+                    cksum_off = 16
+                pseudo = src + dst + struct.pack('>BBH', 0, proto, len(l4))
+                l4_cksum = ones_complement_checksum(pseudo + l4)
+                ip = struct.pack('>BBHHHBBH4s4s', 0x45, 0, 20 + len(l4), i, 0, 64, proto, 0, src, dst)
+                ip_cksum = ones_complement_checksum(ip)
+                if bad_checksums and i % 7 == 0:
+                    l4_cksum ^= 0x1234
+                if bad_checksums and i % 11 == 0:
+                    ip_cksum ^= 0x4321
+                l4 = l4[:cksum_off] + struct.pack('>H', l4_cksum) + l4[cksum_off + 2:]
+                ip = ip[:10] + struct.pack('>H', ip_cksum) + ip[12:]
+                packet = b'\x00\x00\x5e\x00\x53\x01' * 2 + b'\x08\x00' + ip + l4
+                f.write(struct.pack('<IIII', i, 0, len(packet), len(packet)))
+                f.write(packet)
+        options = ('-r', in_file, '-V',
+            '-o', 'ip.check_checksum:TRUE',
+            '-o', 'tcp.check_checksum:TRUE',
+            '-o', 'udp.check_checksum:TRUE',
+        )
+        serial = subprocess.check_output((cmd_tshark,) + options,
+            encoding='utf-8', env=test_env)
+        parallel = subprocess.check_output((cmd_tshark, '--checksum-threads', '4') + options,
+            encoding='utf-8', env=test_env)
+        assert serial.count('[Checksum Status: Good]') > 0
+        assert (serial.count('[Checksum Status: Bad]') > 0) == bad_checksums
+        assert parallel == serial
+
+
 @pytest.mark.skipif(sys.byteorder != 'little', reason='Requires a little endian system')
 class TestRawsharkIO:
     def test_rawshark_io_stdin(self, cmd_rawshark, capture_file, result_file, io_baseline_str, test_env):
@@ -8,8 +8,11 @@
 #
 '''sharkd tests'''
 
+import base64
 import json
+import struct
 import subprocess
+import sys
 import pytest
 from matchers import *
 
@@ -123,6 +126,30 @@ class TestSharkd:
             }},
         ))
 
+    def test_sharkd_req_status_dissector_profile(self, check_sharkd_session, capture_file):
+        matchProfile = MatchList({
+            "proto": MatchAny(str),
+            "calls": MatchAny(int),
+            "total_ns": MatchAny(int),
+            "self_ns": MatchAny(int),
+            "self_bytes": MatchAny(int),
+        })
+        check_sharkd_session((
+            {"jsonrpc":"2.0", "id":1, "method":"status",
+            "params":{"dissector_profile": True}
+            },
+            {"jsonrpc":"2.0", "id":2, "method":"load",
+            "params":{"file": capture_file('dhcp.pcap')}
+            },
+            {"jsonrpc":"2.0", "id":3, "method":"status"},
+        ), (
+            {"jsonrpc":"2.0","id":1,"result":MatchObject({"dissector_profile": []})},
+            {"jsonrpc":"2.0","id":2,"result":{"status":"OK"}},
+            {"jsonrpc":"2.0","id":3,"result":MatchObject({"frames": 4,
+                "dissector_profile": matchProfile,
+            })},
+        ))
+
     def test_sharkd_req_analyse(self, check_sharkd_session, capture_file):
         check_sharkd_session((
             {"jsonrpc":"2.0", "id":1, "method":"load",
@@ -1404,6 +1431,74 @@ class TestSharkd:
             {"jsonrpc":"2.0","id":4,"result":{"comment":["foo\nbar"],"fol": MatchAny(list), "followers": MatchAny(list)}},
         ))
 
+    def test_sharkd_req_frame_bytes_reread(self, run_sharkd_session, result_file):
+        # An NFLOG packet in a pcap file written in the other byte order;
+        # its TLV headers are byte-swapped when the packet is read, and
+        # reading it again has to give the same bytes.
+        other = '<' if sys.byteorder == 'big' else '>'
+        packet = b'\x02\x00\x00\x00' + struct.pack(other + 'HH', 8, 1) + b'\x08\x00\x00\x00'
+        swapped_pcap = result_file('nflog-swapped.pcap')
+        with open(swapped_pcap, 'wb') as f:
+            f.write(struct.pack(other + 'IHHiIII', 0xa1b2c3d4, 2, 4, 0, 0, 65535, 239))
+            f.write(struct.pack(other + 'IIII', 1, 0, len(packet), len(packet)))
+            f.write(packet)
+
+        outputs = run_sharkd_session([json.dumps(x) for x in (
+            {"jsonrpc":"2.0", "id":1, "method":"load",
+            "params":{"file": swapped_pcap}
+            },
+            {"jsonrpc":"2.0", "id":2, "method":"frame",
+            "params":{"frame": 1, "bytes": True}
+            },
+            {"jsonrpc":"2.0", "id":3, "method":"frame",
+            "params":{"frame": 1, "bytes": True}
+            },
+        )])
+        assert outputs[0]["result"] == {"status": "OK"}
+        expected = b'\x02\x00\x00\x00' + struct.pack('=HH', 8, 1) + b'\x08\x00\x00\x00'
+        for output in outputs[1:]:
+            assert base64.b64decode(output["result"]["bytes"]) == expected
+
+    def test_sharkd_req_frame_reassembled_reread(self, run_sharkd_session, result_file):
+        # A UDP datagram in two IPv4 fragments.  With frame references
+        # the reassembled data is read back from the file each time the
+        # frame is dissected, after being unloaded by the dissection of
+        # another frame, and has to come back the same.
+        payload = bytes((i * 7) & 0xff for i in range(1992))
+        datagram = struct.pack('>HHHH', 40000, 40001, 8 + len(payload), 0) + payload
+        frag_pcap = result_file('ipv4-frags.pcap')
+        with open(frag_pcap, 'wb') as f:
+            f.write(struct.pack('<IHHiIII', 0xa1b2c3d4, 2, 4, 0, 0, 65535, 101))
+            for num, (frag_off, data) in enumerate(((0x2000, datagram[:1480]), (185, datagram[1480:]))):
+                packet = struct.pack('>BBHHHBBH4s4s', 0x45, 0, 20 + len(data), 1, frag_off,
+                    64, 17, 0, bytes((10, 0, 0, 1)), bytes((10, 0, 0, 2))) + data
+                f.write(struct.pack('<IIII', num + 1, 0, len(packet), len(packet)))
+                f.write(packet)
+
+        outputs = run_sharkd_session([json.dumps(x) for x in (
+            {"jsonrpc":"2.0", "id":1, "method":"setconf",
+            "params":{"name": "protocols.reassembly_frame_references", "value": "TRUE"}
+            },
+            {"jsonrpc":"2.0", "id":2, "method":"load",
+            "params":{"file": frag_pcap}
+            },
+            {"jsonrpc":"2.0", "id":3, "method":"frame",
+            "params":{"frame": 2, "bytes": True}
+            },
+            {"jsonrpc":"2.0", "id":4, "method":"frame",
+            "params":{"frame": 1, "bytes": True}
+            },
+            {"jsonrpc":"2.0", "id":5, "method":"frame",
+            "params":{"frame": 2, "bytes": True}
+            },
+        )])
+        assert outputs[0]["result"] == {"status": "OK"}
+        assert outputs[1]["result"] == {"status": "OK"}
+        for output in (outputs[2], outputs[4]):
+            reassembled = [ds for ds in output["result"]["ds"] if ds["name"].startswith("Reassembled")]
+            assert len(reassembled) == 1
+            assert base64.b64decode(reassembled[0]["bytes"]) == datagram
+
     def test_sharkd_req_setconf_bad(self, check_sharkd_session):
         check_sharkd_session((
             {"jsonrpc":"2.0", "id":1, "method":"setconf",
@@ -30,6 +30,8 @@
 
 #ifndef _WIN32
 #include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
 #endif
 
 #include <glib.h>
@@ -91,12 +93,15 @@
 #include <epan/epan_dissect.h>
 #include <epan/tap.h>
 #include <epan/stat_tap_ui.h>
+#include <epan/conversation.h>
 #include <epan/conversation_table.h>
 #include <epan/srt_table.h>
 #include <epan/rtd_table.h>
 #include <epan/ex-opt.h>
 #include <epan/exported_pdu.h>
 #include <epan/secrets.h>
+#include <epan/reassemble.h>
+#include <epan/checksum_prepass.h>
 
 #include "capture/capture-pcap-util.h"
 
@@ -142,6 +147,14 @@
 #define LONGOPT_PRINT_TIMERS            LONGOPT_BASE_APPLICATION+9
 #define LONGOPT_GLOBAL_PROFILE          LONGOPT_BASE_APPLICATION+10
 #define LONGOPT_COMPRESS                LONGOPT_BASE_APPLICATION+11
+#define LONGOPT_READ_LIST               LONGOPT_BASE_APPLICATION+12
+#define LONGOPT_BATCH_OUTPUT            LONGOPT_BASE_APPLICATION+13
+#define LONGOPT_BATCH_JOBS              LONGOPT_BASE_APPLICATION+14
+#define LONGOPT_DISSECTOR_PROFILE       LONGOPT_BASE_APPLICATION+15
+#define LONGOPT_READAHEAD               LONGOPT_BASE_APPLICATION+16
+#define LONGOPT_DECOMPRESS_THREADS      LONGOPT_BASE_APPLICATION+17
+#define LONGOPT_CONVERSATION_TIMEOUT    LONGOPT_BASE_APPLICATION+18
+#define LONGOPT_CHECKSUM_THREADS        LONGOPT_BASE_APPLICATION+19
 
 capture_file cfile;
 
@@ -253,9 +266,12 @@ typedef enum {
     PROCESS_FILE_INTERRUPTED
 } process_file_status_t;
 static process_file_status_t process_cap_file(capture_file *, char *, int, bool, int, int64_t, int, wtap_compression_type);
+static bool batch_add_files(const char *list);
+static process_file_status_t process_batch(int, int, bool, int, int64_t, int, wtap_compression_type);
 
 static bool process_packet_single_pass(capture_file *cf,
-        epan_dissect_t *edt, int64_t offset, wtap_rec *rec, unsigned tap_flags);
+        epan_dissect_t *edt, int64_t offset, wtap_rec *rec, uint8_t cksum_good,
+        unsigned tap_flags);
 static void show_print_file_io_error(void);
 static bool write_preamble(capture_file *cf);
 static bool print_packet(capture_file *cf, epan_dissect_t *edt);
@@ -264,10 +280,40 @@ static bool write_finale(void);
 static GHashTable *output_only_tables;
 
 static bool opt_print_timers;
+
+/*
+ * Conversation expiry: in a single pass, conversations idle for
+ * conversation_timeout seconds, or closed ones idle for
+ * CLOSED_CONVERSATION_TIMEOUT seconds, have their protocol data and
+ * reassemblies freed, checking every CONVERSATION_EXPIRY_INTERVAL
+ * seconds of packet time.
+ */
+#define CLOSED_CONVERSATION_TIMEOUT     10
+#define CONVERSATION_EXPIRY_INTERVAL    2
+static unsigned conversation_timeout;
+static nstime_t conversation_expiry_last;
+static uint64_t reassembly_bytes_reclaimed;
+
+/*
+ * Validate the checksums of the records of each batch read from the file
+ * ahead of dissecting them.
+ */
+static bool checksum_prepass;
+
+/*
+ * Batch mode: a list of capture files processed one after the other
+ * in this process, so that the (expensive) epan initialization is
+ * done only once.
+ */
+static GPtrArray *batch_files;
+static char *batch_output_dir;
+static unsigned batch_jobs = 1;
+
 struct elapsed_pass_s {
     int64_t dissect;
     int64_t dfilter_read;
     int64_t dfilter_filter;
+    int64_t io_wait;
 };
 static struct {
     int64_t                dfilter_expand;
@@ -320,6 +366,7 @@ print_elapsed_json(const char *cf_name, const char *dfilter)
     DUMP("dissect", tshark_elapsed.first_pass.dissect);
     DUMP("display_filter", tshark_elapsed.first_pass.dfilter_filter);
     DUMP("read_filter", tshark_elapsed.first_pass.dfilter_read);
+    DUMP("io_wait", tshark_elapsed.first_pass.io_wait);
     json_dumper_end_object(&dumper);
     if (tshark_elapsed.elapsed_second_pass) {
         json_dumper_begin_object(&dumper);
@@ -327,6 +374,7 @@ print_elapsed_json(const char *cf_name, const char *dfilter)
         DUMP("dissect", tshark_elapsed.second_pass.dissect);
         DUMP("display_filter", tshark_elapsed.second_pass.dfilter_filter);
         DUMP("read_filter", tshark_elapsed.second_pass.dfilter_read);
+        DUMP("io_wait", tshark_elapsed.second_pass.io_wait);
         json_dumper_end_object(&dumper);
     }
     json_dumper_end_array(&dumper);
@@ -334,6 +382,27 @@ print_elapsed_json(const char *cf_name, const char *dfilter)
     json_dumper_finish(&dumper);
 }
 
+static void
+print_dissector_profile(void)
+{
+    GArray *profile = dissector_profile_get();
+
+    fprintf(stderr, "Dissector profile:\n");
+    fprintf(stderr, "%-24s %12s %14s %14s %16s\n",
+            "Protocol", "Calls", "Total (ms)", "Self (ms)", "Self (bytes)");
+    for (unsigned i = 0; i < profile->len; i++) {
+        dissector_profile_t *entry = &g_array_index(profile, dissector_profile_t, i);
+
+        fprintf(stderr, "%-24s %12" PRIu64 " %14.3f %14.3f %16" PRIu64 "\n",
+                proto_get_protocol_filter_name(entry->proto_id),
+                entry->calls,
+                entry->total_ns / 1000000.0,
+                entry->self_ns / 1000000.0,
+                entry->self_bytes);
+    }
+    g_array_free(profile, true);
+}
+
 static void
 list_capture_types(void)
 {
@@ -477,11 +546,28 @@ print_usage(FILE *output)
     fprintf(output, "Input file:\n");
     fprintf(output, "  -r <infile>, --read-file <infile>\n");
     fprintf(output, "                           set the filename to read from (or '-' for stdin)\n");
+    fprintf(output, "  --read-list <list|dir|-> read each capture file named in a list file, in a\n");
+    fprintf(output, "                           directory, or on the standard input ('-'), in turn\n");
+    fprintf(output, "  --batch-output <dir>     with --read-list, write the printed output of each\n");
+    fprintf(output, "                           file to <dir>/<file name>.txt; -w names a directory\n");
+    fprintf(output, "  --batch-jobs <count>     with --read-list, process up to <count> files in\n");
+    fprintf(output, "                           parallel (requires --batch-output)\n");
+    fprintf(output, "  --readahead <MiB>        read up to <MiB> megabytes of the file ahead in the\n");
+    fprintf(output, "                           background\n");
+    fprintf(output, "  --decompress-threads <count>\n");
+    fprintf(output, "                           decompress chunked gzip, zstd and lz4 files with up\n");
+    fprintf(output, "                           to <count> threads\n");
 
     fprintf(output, "\n");
     fprintf(output, "Processing:\n");
     fprintf(output, "  -2                       perform a two-pass analysis\n");
     fprintf(output, "  -M <packet count>        perform session auto reset\n");
+    fprintf(output, "  --conversation-timeout <seconds>\n");
+    fprintf(output, "                           free the TCP and UDP data and reassemblies of\n");
+    fprintf(output, "                           conversations idle for <seconds> (not with -2)\n");
+    fprintf(output, "  --checksum-threads <count>\n");
+    fprintf(output, "                           validate the checksums that are set to be validated\n");
+    fprintf(output, "                           ahead of dissection, with up to <count> threads\n");
     fprintf(output, "  -R <read filter>, --read-filter <read filter>\n");
     fprintf(output, "                           packet Read filter in Wireshark display filter syntax\n");
     fprintf(output, "                           (requires -2)\n");
@@ -585,6 +671,8 @@ print_usage(FILE *output)
     fprintf(output, "  --temp-dir <directory>   write temporary files to this directory\n");
     fprintf(output, "                           (default: %s)\n", g_get_tmp_dir());
     fprintf(output, "  --compress <type>        compress the output file using the type compression format\n");
+    fprintf(output, "  --dissector-profile      print per-protocol dissection call counts, times and\n");
+    fprintf(output, "                           memory allocation to stderr when done\n");
     fprintf(output, "\n");
 
     ws_log_print_usage(output);
@@ -1060,6 +1148,14 @@ main(int argc, char *argv[])
         {"print-timers", ws_no_argument, NULL, LONGOPT_PRINT_TIMERS},
         {"global-profile", ws_no_argument, NULL, LONGOPT_GLOBAL_PROFILE},
         {"compress", ws_required_argument, NULL, LONGOPT_COMPRESS},
+        {"read-list", ws_required_argument, NULL, LONGOPT_READ_LIST},
+        {"batch-output", ws_required_argument, NULL, LONGOPT_BATCH_OUTPUT},
+        {"batch-jobs", ws_required_argument, NULL, LONGOPT_BATCH_JOBS},
+        {"dissector-profile", ws_no_argument, NULL, LONGOPT_DISSECTOR_PROFILE},
+        {"readahead", ws_required_argument, NULL, LONGOPT_READAHEAD},
+        {"decompress-threads", ws_required_argument, NULL, LONGOPT_DECOMPRESS_THREADS},
+        {"conversation-timeout", ws_required_argument, NULL, LONGOPT_CONVERSATION_TIMEOUT},
+        {"checksum-threads", ws_required_argument, NULL, LONGOPT_CHECKSUM_THREADS},
         {0, 0, 0, 0}
     };
     bool                 arg_error = false;
@@ -1420,6 +1516,10 @@ main(int argc, char *argv[])
                     cmdarg_err("-2 does not support auto session reset.");
                     arg_error=true;
                 }
+                if(conversation_timeout){
+                    cmdarg_err("-2 does not support conversation expiry.");
+                    arg_error=true;
+                }
                 perform_two_pass_analysis = true;
                 break;
             case 'M':
@@ -1922,9 +2022,43 @@ main(int argc, char *argv[])
             case LONGOPT_PRINT_TIMERS:
                 opt_print_timers = true;
                 break;
+            case LONGOPT_DISSECTOR_PROFILE:
+                dissector_profile_set_enabled(true);
+                break;
             case LONGOPT_GLOBAL_PROFILE:
                 /* already processed; just ignore it now */
                 break;
+            case LONGOPT_READ_LIST:
+                if (!batch_add_files(ws_optarg)) {
+                    exit_status = WS_EXIT_INVALID_OPTION;
+                    goto clean_exit;
+                }
+                is_capturing = false;
+                break;
+            case LONGOPT_BATCH_OUTPUT:
+                g_free(batch_output_dir);
+                batch_output_dir = g_strdup(ws_optarg);
+                break;
+            case LONGOPT_BATCH_JOBS:
+                batch_jobs = get_positive_int(ws_optarg, "batch job count");
+                break;
+            case LONGOPT_READAHEAD:
+                wtap_set_readahead_window((size_t)get_positive_int(ws_optarg, "readahead size") * 1024 * 1024);
+                break;
+            case LONGOPT_DECOMPRESS_THREADS:
+                wtap_set_decompress_threads((unsigned)get_positive_int(ws_optarg, "decompression thread count"));
+                break;
+            case LONGOPT_CONVERSATION_TIMEOUT:
+                if(perform_two_pass_analysis){
+                    cmdarg_err("--conversation-timeout does not support two-pass analysis.");
+                    arg_error=true;
+                }
+                conversation_timeout = (unsigned)get_positive_int(ws_optarg, "conversation timeout");
+                break;
+            case LONGOPT_CHECKSUM_THREADS:
+                checksum_prepass_set_threads((unsigned)get_positive_int(ws_optarg, "checksum thread count"));
+                checksum_prepass = true;
+                break;
             case LONGOPT_COMPRESS:        /* compress type */
                 compression_type = wtap_name_to_compression_type(ws_optarg);
                 if (compression_type == WTAP_UNKNOWN_COMPRESSION) {
@@ -2002,12 +2136,56 @@ main(int argc, char *argv[])
         }
     }
 
+    if (batch_files != NULL) {
+        if (cf_name != NULL) {
+            cmdarg_err("\"-r\" and \"--read-list\" can't both be specified.");
+            exit_status = WS_EXIT_INVALID_OPTION;
+            goto clean_exit;
+        }
+        if (batch_files->len == 0) {
+            cmdarg_err("The list of capture files to read is empty.");
+            exit_status = WS_EXIT_INVALID_OPTION;
+            goto clean_exit;
+        }
+        if (output_file_name != NULL && strcmp(output_file_name, "-") == 0) {
+            cmdarg_err("With \"--read-list\", \"-w\" must name a directory.");
+            exit_status = WS_EXIT_INVALID_OPTION;
+            goto clean_exit;
+        }
+        if (batch_jobs > 1 && batch_output_dir == NULL) {
+            cmdarg_err("\"--batch-jobs\" requires \"--batch-output\".");
+            exit_status = WS_EXIT_INVALID_OPTION;
+            goto clean_exit;
+        }
+        /*
+         * The output of each file is a complete document in those
+         * formats; several of them in a row wouldn't be one.
+         */
+        if (batch_output_dir == NULL && batch_files->len > 1 &&
+                (output_action == WRITE_XML || output_action == WRITE_JSON ||
+                 output_action == WRITE_JSON_RAW || output_action == WRITE_EK)) {
+            cmdarg_err("\"--read-list\" with -T ek, json, jsonraw, pdml or psml requires \"--batch-output\".");
+            exit_status = WS_EXIT_INVALID_OPTION;
+            goto clean_exit;
+        }
+#ifdef _WIN32
+        if (batch_jobs > 1) {
+            cmdarg_err("\"--batch-jobs\" isn't supported on Windows; processing files one at a time.");
+            batch_jobs = 1;
+        }
+#endif
+    } else if (batch_output_dir != NULL || batch_jobs > 1) {
+        cmdarg_err("\"--batch-output\" and \"--batch-jobs\" require \"--read-list\".");
+        exit_status = WS_EXIT_INVALID_OPTION;
+        goto clean_exit;
+    }
+
     /* If no capture filter or display filter has been specified, and there are
        still command-line arguments, treat them as the tokens of a capture
        filter (if no "-r" flag was specified) or a display filter (if a "-r"
        flag was specified. */
     if (ws_optind < argc) {
-        if (cf_name != NULL) {
+        if (cf_name != NULL || batch_files != NULL) {
             if (dfilter != NULL) {
                 cmdarg_err("Display filters were specified both with \"-Y\" "
                         "and with additional command-line arguments.");
@@ -2156,7 +2334,7 @@ main(int argc, char *argv[])
     if (caps_queries) {
         /* We're supposed to list the link-layer/timestamp types for an interface;
            did the user also specify a capture file to be read? */
-        if (cf_name) {
+        if (cf_name || batch_files) {
             /* Yes - that's bogus. */
             cmdarg_err("You can't specify %s and a capture file to be read.",
                     caps_queries & CAPS_QUERY_LINK_TYPES ? "-L" : "--list-time-stamp-types");
@@ -2170,7 +2348,7 @@ main(int argc, char *argv[])
             goto clean_exit;
         }
     } else {
-        if (cf_name) {
+        if (cf_name || batch_files) {
             /*
              * "-r" was specified, so we're reading a capture file.
              * Capture options don't apply here.
@@ -2514,6 +2692,11 @@ main(int argc, char *argv[])
             exit_status = WS_EXIT_INVALID_OPTION;
             goto clean_exit;
         }
+        if (batch_files) {
+            cmdarg_err("PDUs export isn't supported with \"--read-list\".");
+            exit_status = WS_EXIT_INVALID_OPTION;
+            goto clean_exit;
+        }
         /* Take ownership of the '-w' output file. */
         exp_pdu_filename = output_file_name;
         output_file_name = NULL;
@@ -2564,7 +2747,31 @@ main(int argc, char *argv[])
         }
     }
 
-    if (cf_name) {
+    if (batch_files) {
+        ws_debug("tshark: processing a batch of %u capture files", batch_files->len);
+
+        /* Start statistics taps once; their results are drawn and reset
+           after each file of the batch. */
+        start_requested_stats();
+
+        do_dissection = must_do_dissection(rfcode, dfcode, pdu_export_arg);
+        ws_debug("tshark: do_dissection = %s", do_dissection ? "TRUE" : "FALSE");
+
+        status = process_batch(in_file_type, out_file_type, out_file_name_res,
+#ifdef HAVE_LIBPCAP
+                global_capture_opts.has_autostop_packets ? global_capture_opts.autostop_packets : 0,
+                global_capture_opts.has_autostop_filesize ? global_capture_opts.autostop_filesize : 0,
+                global_capture_opts.has_autostop_written_packets ? global_capture_opts.autostop_written_packets : 0,
+                compression_type);
+#else
+                max_packet_count,
+                0,
+                0,
+                WTAP_UNCOMPRESSED);
+#endif
+        if (status != PROCESS_FILE_SUCCEEDED)
+            exit_status = 2;
+    } else if (cf_name) {
         ws_debug("tshark: Opening capture file: %s", cf_name);
         /*
          * We're reading a capture file.
@@ -2872,7 +3079,8 @@ main(int argc, char *argv[])
         g_free(keylist);
     }
 
-    if (opt_print_timers) {
+    if (opt_print_timers && batch_files == NULL) {
+        /* In batch mode, the timers were printed after each file. */
         if (cf_name == NULL) {
             /* We're doind a live capture. That isn't currently supported
              * with timers. */
@@ -2883,6 +3091,21 @@ main(int argc, char *argv[])
         }
     }
 
+    if (conversation_timeout) {
+        conversation_stats_t conv_stats;
+
+        conversation_get_stats(&conv_stats);
+        fprintf(stderr, "Conversations: %u live, %" PRIu64 " expired, %" PRIu64 " bytes reclaimed"
+                " (%" PRIu64 " bytes of reassemblies)\n",
+                conv_stats.live, conv_stats.expired,
+                conv_stats.reclaimed_bytes + reassembly_bytes_reclaimed,
+                reassembly_bytes_reclaimed);
+    }
+
+    if (dissector_profile_is_enabled()) {
+        print_dissector_profile();
+    }
+
     /* Memory cleanup */
     reset_tap_listeners();
     funnel_dump_all_text_windows();
@@ -2896,6 +3119,10 @@ main(int argc, char *argv[])
 clean_exit:
     cf_close(&cfile);
     g_free(cf_name);
+    if (batch_files) {
+        g_ptr_array_free(batch_files, true);
+    }
+    g_free(batch_output_dir);
     destroy_print_stream(print_stream);
     g_free(output_file_name);
 #ifdef HAVE_LIBPCAP
@@ -2923,9 +3150,18 @@ tshark_epan_new(capture_file *cf)
         cap_file_provider_get_interface_name,
         cap_file_provider_get_interface_description,
         NULL,
+        NULL,
+    };
+    /* Frames can only be read back if the file is read twice. */
+    static const struct packet_provider_funcs two_pass_funcs = {
+        cap_file_provider_get_frame_ts,
+        cap_file_provider_get_interface_name,
+        cap_file_provider_get_interface_description,
+        NULL,
+        cap_file_provider_get_frame_data,
     };
 
-    return epan_new(&cf->provider, &funcs);
+    return epan_new(&cf->provider, perform_two_pass_analysis ? &two_pass_funcs : &funcs);
 }
 
 #ifdef HAVE_LIBPCAP
@@ -3221,7 +3457,7 @@ capture_input_new_packets(capture_session *cap_session, int to_read)
                 wtap_close(cf->provider.wth);
                 cf->provider.wth = NULL;
             } else {
-                ret = process_packet_single_pass(cf, edt, data_offset, &rec,
+                ret = process_packet_single_pass(cf, edt, data_offset, &rec, 0,
                         tap_flags);
             }
             if (ret != false) {
@@ -3382,9 +3618,29 @@ capture_cleanup(int signum _U_)
 #endif /* _WIN32 */
 #endif /* HAVE_LIBPCAP */
 
+/*
+ * Returns the CKSUM_PREPASS_ flags of the checksums found to be good in
+ * the record last read from batch, validating those of all the records of
+ * the batch when it's the first of them.
+ */
+static uint8_t
+checksum_prepass_result(const wtap_batch *batch)
+{
+    static uint8_t results[WTAP_BATCH_SIZE];
+    const wtap_rec *recs;
+    unsigned count, index;
+
+    if (!checksum_prepass)
+        return 0;
+    recs = wtap_batch_records(batch, &count, &index);
+    if (index == 0)
+        checksum_prepass_run(recs, count, results);
+    return results[index];
+}
+
 static bool
 process_packet_first_pass(capture_file *cf, epan_dissect_t *edt,
-        int64_t offset, wtap_rec *rec)
+        int64_t offset, wtap_rec *rec, uint8_t cksum_good)
 {
     frame_data     fdlocal;
     uint32_t       framenum;
@@ -3401,6 +3657,7 @@ process_packet_first_pass(capture_file *cf, epan_dissect_t *edt,
     passed = true;
 
     frame_data_init(&fdlocal, framenum, rec, offset, cum_bytes);
+    fdlocal.cksum_good = cksum_good;
 
     /* If we're going to run a read filter or a display filter, set up to
        do a dissection and do so.  (This is the first pass of two passes
@@ -3558,13 +3815,14 @@ static pass_status_t
 process_cap_file_first_pass(capture_file *cf, int max_packet_count,
         int64_t max_byte_count, int *err, char **err_info)
 {
-    wtap_rec        rec;
+    wtap_rec       *rec;
+    wtap_batch     *batch;
     epan_dissect_t *edt = NULL;
     int64_t         data_offset;
     pass_status_t   status = PASS_SUCCEEDED;
     int             framenum = 0;
 
-    wtap_rec_init(&rec, 1514);
+    batch = wtap_batch_new(1514);
 
     /* Allocate a frame_data_sequence for all the frames. */
     cf->provider.frames = new_frame_data_sequence();
@@ -3595,14 +3853,15 @@ process_cap_file_first_pass(capture_file *cf, int max_packet_count,
 
     ws_debug("tshark: reading records for first pass");
     *err = 0;
-    while (wtap_read(cf->provider.wth, &rec, err, err_info, &data_offset)) {
+    while ((rec = wtap_batch_read(cf->provider.wth, batch, err, err_info, &data_offset)) != NULL) {
         if (read_interrupted) {
             status = PASS_INTERRUPTED;
             break;
         }
         framenum++;
 
-        if (process_packet_first_pass(cf, edt, data_offset, &rec)) {
+        if (process_packet_first_pass(cf, edt, data_offset, rec,
+                checksum_prepass_result(batch))) {
             /* Stop reading if we hit a stop condition */
             if (max_packet_count > 0 && framenum >= max_packet_count) {
                 ws_debug("tshark: max_packet_count (%d) reached", max_packet_count);
@@ -3616,8 +3875,9 @@ process_cap_file_first_pass(capture_file *cf, int max_packet_count,
                 break;
             }
         }
-        wtap_rec_reset(&rec);
+        wtap_rec_reset(rec);
     }
+    wtap_batch_free(batch);
     if (*err != 0)
         status = PASS_READ_ERROR;
 
@@ -3889,7 +4149,8 @@ process_cap_file_single_pass(capture_file *cf, wtap_dumper *pdh,
         int *err, char **err_info,
         volatile uint32_t *err_framenum)
 {
-    wtap_rec        rec;
+    wtap_rec       *rec;
+    wtap_batch     *batch;
     bool create_proto_tree = false;
     bool            filtering_tap_listeners;
     unsigned        tap_flags;
@@ -3899,7 +4160,7 @@ process_cap_file_single_pass(capture_file *cf, wtap_dumper *pdh,
     int64_t         data_offset;
     pass_status_t   status = PASS_SUCCEEDED;
 
-    wtap_rec_init(&rec, 1514);
+    batch = wtap_batch_new(1514);
 
     /* Do we have any tap listeners with filters? */
     filtering_tap_listeners = have_filtering_tap_listeners();
@@ -3952,7 +4213,7 @@ process_cap_file_single_pass(capture_file *cf, wtap_dumper *pdh,
     set_resolution_synchrony(true);
 
     *err = 0;
-    while (wtap_read(cf->provider.wth, &rec, err, err_info, &data_offset)) {
+    while ((rec = wtap_batch_read(cf->provider.wth, batch, err, err_info, &data_offset)) != NULL) {
         if (read_interrupted) {
             status = PASS_INTERRUPTED;
             break;
@@ -3972,7 +4233,8 @@ process_cap_file_single_pass(capture_file *cf, wtap_dumper *pdh,
 
         reset_epan_mem(cf, edt, create_proto_tree, print_packet_info && print_details);
 
-        if (process_packet_single_pass(cf, edt, data_offset, &rec, tap_flags)) {
+        if (process_packet_single_pass(cf, edt, data_offset, rec,
+                checksum_prepass_result(batch), tap_flags)) {
             /* Either there's no read filtering or this packet passed the
                filter, so, if we're writing to a capture file, write
                this packet out. */
@@ -3980,7 +4242,7 @@ process_cap_file_single_pass(capture_file *cf, wtap_dumper *pdh,
             if (pdh != NULL) {
                 ws_debug("tshark: writing packet #%d to outfile as #%d",
                         framenum, write_framenum);
-                if (!wtap_dump(pdh, &rec, ws_buffer_start_ptr(&rec.data), err, err_info)) {
+                if (!wtap_dump(pdh, rec, ws_buffer_start_ptr(&rec->data), err, err_info)) {
                     /* Error writing to the output file. */
                     ws_debug("tshark: error writing to a capture file (%d)", *err);
                     *err_framenum = framenum;
@@ -4006,7 +4268,7 @@ process_cap_file_single_pass(capture_file *cf, wtap_dumper *pdh,
             *err = 0; /* This is not an error */
             break;
         }
-        wtap_rec_reset(&rec);
+        wtap_rec_reset(rec);
     }
     if (status == PASS_SUCCEEDED) {
         if (*err != 0) {
@@ -4026,7 +4288,7 @@ process_cap_file_single_pass(capture_file *cf, wtap_dumper *pdh,
     if (edt)
         epan_dissect_free(edt);
 
-    wtap_rec_cleanup(&rec);
+    wtap_batch_free(batch);
 
     return status;
 }
@@ -4048,6 +4310,7 @@ process_cap_file(capture_file *cf, char *save_file, int out_file_type,
     char        *shb_user_appl;
     pass_status_t first_pass_status, second_pass_status;
     int64_t elapsed_start;
+    int64_t io_wait_start;
 
     if (save_file != NULL) {
         /* Set up to write to the capture file. */
@@ -4126,11 +4389,13 @@ process_cap_file(capture_file *cf, char *save_file, int out_file_type,
         ws_debug("tshark: perform_two_pass_analysis, do_dissection=%s", do_dissection ? "TRUE" : "FALSE");
 
         elapsed_start = g_get_monotonic_time();
+        io_wait_start = wtap_io_wait_time(cf->provider.wth);
         first_pass_status = process_cap_file_first_pass(cf, max_packet_count,
                 max_byte_count,
                 &err_pass1,
                 &err_info_pass1);
         tshark_elapsed.elapsed_first_pass = g_get_monotonic_time() - elapsed_start;
+        tshark_elapsed.first_pass.io_wait = wtap_io_wait_time(cf->provider.wth) - io_wait_start;
 
         ws_debug("tshark: done with first pass");
 
@@ -4147,10 +4412,12 @@ process_cap_file(capture_file *cf, char *save_file, int out_file_type,
              * at the end.
              */
             elapsed_start = g_get_monotonic_time();
+            io_wait_start = wtap_io_wait_time(cf->provider.wth);
             second_pass_status = process_cap_file_second_pass(cf, pdh, &err, &err_info,
                     &err_framenum,
                     max_write_packet_count);
             tshark_elapsed.elapsed_second_pass = g_get_monotonic_time() - elapsed_start;
+            tshark_elapsed.second_pass.io_wait = wtap_io_wait_time(cf->provider.wth) - io_wait_start;
 
             ws_debug("tshark: done with second pass");
         }
@@ -4162,6 +4429,7 @@ process_cap_file(capture_file *cf, char *save_file, int out_file_type,
         first_pass_status = PASS_SUCCEEDED; /* There is no first pass */
 
         elapsed_start = g_get_monotonic_time();
+        io_wait_start = wtap_io_wait_time(cf->provider.wth);
         second_pass_status = process_cap_file_single_pass(cf, pdh,
                 max_packet_count,
                 max_byte_count,
@@ -4169,6 +4437,7 @@ process_cap_file(capture_file *cf, char *save_file, int out_file_type,
                 &err, &err_info,
                 &err_framenum);
         tshark_elapsed.elapsed_first_pass = g_get_monotonic_time() - elapsed_start;
+        tshark_elapsed.first_pass.io_wait = wtap_io_wait_time(cf->provider.wth) - io_wait_start;
 
         ws_debug("tshark: done with single pass");
     }
@@ -4316,9 +4585,273 @@ out:
     return status;
 }
 
+static int
+batch_file_compare(const void *a, const void *b)
+{
+    return strcmp(*(const char * const *)a, *(const char * const *)b);
+}
+
+static void
+batch_add_line(char *line)
+{
+    g_strstrip(line);
+    /* Skip blank lines and comments. */
+    if (line[0] == '\0' || line[0] == '#')
+        return;
+    g_ptr_array_add(batch_files, g_strdup(line));
+}
+
+/*
+ * Add the capture files named by "list" to the batch: "-" means read
+ * file names from the standard input, a directory means every regular
+ * file in it (in name order), and anything else is a file containing
+ * one file name per line.
+ */
+static bool
+batch_add_files(const char *list)
+{
+    if (batch_files == NULL)
+        batch_files = g_ptr_array_new_with_free_func(g_free);
+
+    if (strcmp(list, "-") == 0) {
+        char line[4096];
+
+        while (fgets(line, sizeof line, stdin) != NULL)
+            batch_add_line(line);
+        return true;
+    }
+
+    if (g_file_test(list, G_FILE_TEST_IS_DIR)) {
+        WS_DIR *dir;
+        WS_DIRENT *file;
+        unsigned first = batch_files->len;
+
+        dir = ws_dir_open(list, 0, NULL);
+        if (dir == NULL) {
+            cmdarg_err("Can't open directory %s: %s", list, g_strerror(errno));
+            return false;
+        }
+        while ((file = ws_dir_read_name(dir)) != NULL) {
+            char *path = g_build_filename(list, ws_dir_get_name(file), NULL);
+
+            if (g_file_test(path, G_FILE_TEST_IS_REGULAR))
+                g_ptr_array_add(batch_files, path);
+            else
+                g_free(path);
+        }
+        ws_dir_close(dir);
+        if (batch_files->len > first) {
+            qsort(&batch_files->pdata[first], batch_files->len - first,
+                    sizeof (void *), batch_file_compare);
+        }
+        return true;
+    }
+
+    char *contents;
+    GError *gerr = NULL;
+
+    if (!g_file_get_contents(list, &contents, NULL, &gerr)) {
+        cmdarg_err("Can't read the list of capture files: %s", gerr->message);
+        g_error_free(gerr);
+        return false;
+    }
+    char **lines = g_strsplit(contents, "\n", -1);
+    for (char **lp = lines; *lp != NULL; lp++)
+        batch_add_line(*lp);
+    g_strfreev(lines);
+    g_free(contents);
+    return true;
+}
+
+/*
+ * Process one file of the batch. The dissection state of the previous
+ * file is discarded by cf_open(), which replaces the epan session.
+ */
+static process_file_status_t
+process_batch_file(const char *fname, int in_file_type, int out_file_type,
+        bool out_file_name_res, int max_packet_count, int64_t max_byte_count,
+        int max_write_packet_count, wtap_compression_type compression_type)
+{
+    volatile process_file_status_t status = PROCESS_FILE_NO_FILE_PROCESSED;
+    char *basename = g_path_get_basename(fname);
+    char *save_file = NULL;
+    int saved_stdout_fd = -1;
+    int err;
+
+    if (output_file_name != NULL) {
+        const char *ext = wtap_default_file_extension(out_file_type);
+
+        save_file = ws_strdup_printf("%s" G_DIR_SEPARATOR_S "%s%s%s",
+                output_file_name, basename, ext ? "." : "", ext ? ext : "");
+    }
+    if (batch_output_dir != NULL) {
+        char *out_path = g_build_filename(batch_output_dir, basename, NULL);
+        char *out_name = ws_strdup_printf("%s.txt", out_path);
+        int out_fd;
+
+        g_free(out_path);
+        /*
+         * Point the standard output's file descriptor at the file
+         * rather than reopening stdout, so that the standard output
+         * can be restored afterwards, whatever happens.
+         */
+        out_fd = ws_open(out_name, O_WRONLY|O_CREAT|O_TRUNC|O_BINARY, 0666);
+        if (out_fd == -1) {
+            cmdarg_err("%s: %s", out_name, file_open_error_message(errno, true));
+            g_free(out_name);
+            goto out;
+        }
+        g_free(out_name);
+        fflush(stdout);
+        saved_stdout_fd = ws_dup(ws_fileno(stdout));
+        if (saved_stdout_fd == -1 || ws_dup2(out_fd, ws_fileno(stdout)) == -1) {
+            cmdarg_err("Can't redirect the standard output: %s", g_strerror(errno));
+            ws_close(out_fd);
+            if (saved_stdout_fd != -1) {
+                ws_close(saved_stdout_fd);
+                saved_stdout_fd = -1;
+            }
+            goto out;
+        }
+        ws_close(out_fd);
+    }
+
+    ws_debug("tshark: Opening capture file: %s", fname);
+    if (cf_open(&cfile, fname, in_file_type, false, &err) != CF_OK)
+        goto out;
+
+    cum_bytes = 0;
+    nstime_set_zero(&conversation_expiry_last);
+    reassembly_bytes_reclaimed = 0;
+    memset(&tshark_elapsed.first_pass, 0, sizeof tshark_elapsed.first_pass);
+    memset(&tshark_elapsed.second_pass, 0, sizeof tshark_elapsed.second_pass);
+    tshark_elapsed.elapsed_first_pass = 0;
+    tshark_elapsed.elapsed_second_pass = 0;
+
+    TRY {
+        status = process_cap_file(&cfile, save_file, out_file_type, out_file_name_res,
+                max_packet_count, max_byte_count, max_write_packet_count,
+                compression_type);
+    }
+    CATCH(OutOfMemoryError) {
+        fprintf(stderr,
+                "Out Of Memory.\n"
+                "\n"
+                "Sorry, but TShark has to terminate now.\n"
+                "\n"
+                "More information and workarounds can be found at\n"
+                WS_WIKI_URL("KnownBugs/OutOfMemory") "\n");
+        status = PROCESS_FILE_ERROR;
+    }
+    ENDTRY;
+
+    if (status == PROCESS_FILE_SUCCEEDED || status == PROCESS_FILE_ERROR) {
+        /* We might have read some packets; draw this file's tap results
+           and start the next file from scratch. */
+        draw_tap_listeners(true);
+    }
+    reset_tap_listeners();
+
+    if (opt_print_timers)
+        print_elapsed_json(fname, cfile.dfcode ? dfilter_text(cfile.dfcode) : NULL);
+
+    if (cfile.provider.frames != NULL) {
+        free_frame_data_sequence(cfile.provider.frames);
+        cfile.provider.frames = NULL;
+    }
+    cf_close(&cfile);
+
+out:
+    if (saved_stdout_fd != -1) {
+        fflush(stdout);
+        ws_dup2(saved_stdout_fd, ws_fileno(stdout));
+        ws_close(saved_stdout_fd);
+    }
+    g_free(save_file);
+    g_free(basename);
+    return status;
+}
+
+/*
+ * Process every file of the batch, either sequentially in this process
+ * or, with --batch-jobs, in up to batch_jobs child processes forked
+ * after initialization, so they share the registered dissectors and
+ * preferences without repeating the setup.
+ */
+static process_file_status_t
+process_batch(int in_file_type, int out_file_type, bool out_file_name_res,
+        int max_packet_count, int64_t max_byte_count,
+        int max_write_packet_count, wtap_compression_type compression_type)
+{
+    process_file_status_t status = PROCESS_FILE_SUCCEEDED;
+    process_file_status_t file_status;
+    unsigned i;
+
+#ifndef _WIN32
+    if (batch_jobs > 1) {
+        unsigned running = 0;
+        int child_status;
+        pid_t pid;
+
+        fflush(stdout);
+        fflush(stderr);
+        for (i = 0; i < batch_files->len && !read_interrupted; i++) {
+            const char *fname = (const char *)g_ptr_array_index(batch_files, i);
+
+            if (running == batch_jobs) {
+                if (waitpid(-1, &child_status, 0) > 0) {
+                    running--;
+                    if (!WIFEXITED(child_status) || WEXITSTATUS(child_status) != 0)
+                        status = PROCESS_FILE_ERROR;
+                }
+            }
+
+            pid = fork();
+            if (pid == 0) {
+                /* Child: process one file and report through the exit status. */
+                file_status = process_batch_file(fname, in_file_type, out_file_type,
+                        out_file_name_res, max_packet_count, max_byte_count,
+                        max_write_packet_count, compression_type);
+                fflush(stdout);
+                fflush(stderr);
+                _exit(file_status == PROCESS_FILE_SUCCEEDED ? EXIT_SUCCESS : 2);
+            } else if (pid < 0) {
+                cmdarg_err("Can't fork to process %s: %s; processing it in this process",
+                        fname, g_strerror(errno));
+                file_status = process_batch_file(fname, in_file_type, out_file_type,
+                        out_file_name_res, max_packet_count, max_byte_count,
+                        max_write_packet_count, compression_type);
+                if (file_status != PROCESS_FILE_SUCCEEDED)
+                    status = PROCESS_FILE_ERROR;
+            } else {
+                running++;
+            }
+        }
+        while (running > 0 && waitpid(-1, &child_status, 0) > 0) {
+            running--;
+            if (!WIFEXITED(child_status) || WEXITSTATUS(child_status) != 0)
+                status = PROCESS_FILE_ERROR;
+        }
+        return read_interrupted ? PROCESS_FILE_INTERRUPTED : status;
+    }
+#endif
+
+    for (i = 0; i < batch_files->len; i++) {
+        file_status = process_batch_file((const char *)g_ptr_array_index(batch_files, i),
+                in_file_type, out_file_type, out_file_name_res,
+                max_packet_count, max_byte_count, max_write_packet_count,
+                compression_type);
+        if (file_status == PROCESS_FILE_INTERRUPTED)
+            return file_status;
+        if (file_status != PROCESS_FILE_SUCCEEDED)
+            status = PROCESS_FILE_ERROR;
+    }
+    return status;
+}
+
 static bool
 process_packet_single_pass(capture_file *cf, epan_dissect_t *edt, int64_t offset,
-        wtap_rec *rec, unsigned tap_flags _U_)
+        wtap_rec *rec, uint8_t cksum_good, unsigned tap_flags _U_)
 {
     frame_data      fdata;
     column_info    *cinfo;
@@ -4335,6 +4868,7 @@ process_packet_single_pass(capture_file *cf, epan_dissect_t *edt, int64_t offset
     passed = true;
 
     frame_data_init(&fdata, cf->count, rec, offset, cum_bytes);
+    fdata.cksum_good = cksum_good;
 
     /* If we're going to print packet information, or we're going to
        run a read filter, or we're going to process taps, set up to
@@ -4436,6 +4970,19 @@ process_packet_single_pass(capture_file *cf, epan_dissect_t *edt, int64_t offset
         frame_data_destroy(&fdata);
         rec->block = block;
     }
+
+    if (conversation_timeout && edt && (rec->presence_flags & WTAP_HAS_TS)) {
+        if (nstime_is_zero(&conversation_expiry_last) ||
+                rec->ts.secs - conversation_expiry_last.secs >= CONVERSATION_EXPIRY_INTERVAL ||
+                rec->ts.secs < conversation_expiry_last.secs) {
+            uint32_t frame_cutoff;
+
+            conversation_expire(cf->count, &rec->ts, conversation_timeout,
+                    MIN(conversation_timeout, CLOSED_CONVERSATION_TIMEOUT), &frame_cutoff);
+            reassembly_bytes_reclaimed += reassembly_tables_expire(frame_cutoff);
+            conversation_expiry_last = rec->ts;
+        }
+    }
     return passed;
 }
 
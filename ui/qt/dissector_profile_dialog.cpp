@@ -0,0 +1,102 @@
+/* dissector_profile_dialog.cpp
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <ui/qt/dissector_profile_dialog.h>
+#include <ui_dissector_profile_dialog.h>
+
+#include <epan/packet.h>
+#include <epan/proto.h>
+
+#include <QPushButton>
+#include <QTreeWidgetItem>
+
+#include "main_application.h"
+
+enum {
+    col_protocol_,
+    col_calls_,
+    col_total_ms_,
+    col_self_ms_,
+    col_self_bytes_
+};
+
+DissectorProfileDialog::DissectorProfileDialog(QWidget *parent) :
+    GeometryStateDialog(parent),
+    ui(new Ui::DissectorProfileDialog)
+{
+    ui->setupUi(this);
+
+    if (parent)
+        loadGeometry(parent->width() * 2 / 3, parent->height() * 2 / 3);
+
+    setAttribute(Qt::WA_DeleteOnClose, true);
+    setWindowTitle(mainApp->windowTitleString(tr("Dissector Profile")));
+
+    reset_button_ = ui->buttonBox->addButton(tr("Reset"), QDialogButtonBox::ResetRole);
+    reset_button_->setToolTip(tr("Clear the collected counters."));
+    refresh_button_ = ui->buttonBox->addButton(tr("Refresh"), QDialogButtonBox::ApplyRole);
+    refresh_button_->setToolTip(tr("Show the counters collected so far."));
+
+    ui->enableCheckBox->setChecked(dissector_profile_is_enabled());
+    fillTree();
+}
+
+DissectorProfileDialog::~DissectorProfileDialog()
+{
+    delete ui;
+}
+
+void DissectorProfileDialog::fillTree()
+{
+    GArray *profile = dissector_profile_get();
+
+    ui->profileTreeWidget->setSortingEnabled(false);
+    ui->profileTreeWidget->clear();
+    for (unsigned i = 0; i < profile->len; i++) {
+        dissector_profile_t *entry = &g_array_index(profile, dissector_profile_t, i);
+        QTreeWidgetItem *ti = new QTreeWidgetItem(ui->profileTreeWidget);
+
+        ti->setText(col_protocol_, proto_get_protocol_short_name(find_protocol_by_id(entry->proto_id)));
+        ti->setToolTip(col_protocol_, proto_get_protocol_long_name(find_protocol_by_id(entry->proto_id)));
+        ti->setData(col_calls_, Qt::DisplayRole, static_cast<qulonglong>(entry->calls));
+        ti->setData(col_total_ms_, Qt::DisplayRole, entry->total_ns / 1000000.0);
+        ti->setData(col_self_ms_, Qt::DisplayRole, entry->self_ns / 1000000.0);
+        ti->setData(col_self_bytes_, Qt::DisplayRole, static_cast<qulonglong>(entry->self_bytes));
+        for (int col = col_calls_; col <= col_self_bytes_; col++) {
+            ti->setTextAlignment(col, Qt::AlignRight);
+        }
+    }
+    g_array_free(profile, true);
+
+    ui->profileTreeWidget->setSortingEnabled(true);
+    ui->profileTreeWidget->sortByColumn(col_self_ms_, Qt::DescendingOrder);
+    for (int col = 0; col < ui->profileTreeWidget->columnCount(); col++) {
+        ui->profileTreeWidget->resizeColumnToContents(col);
+    }
+
+    reset_button_->setEnabled(ui->profileTreeWidget->topLevelItemCount() > 0);
+}
+
+void DissectorProfileDialog::on_enableCheckBox_toggled(bool checked)
+{
+    dissector_profile_set_enabled(checked);
+    fillTree();
+}
+
+void DissectorProfileDialog::on_buttonBox_clicked(QAbstractButton *button)
+{
+    if (button == reset_button_) {
+        dissector_profile_reset();
+        fillTree();
+    } else if (button == refresh_button_) {
+        fillTree();
+    }
+}
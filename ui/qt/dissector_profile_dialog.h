@@ -0,0 +1,41 @@
+/** @file
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef DISSECTOR_PROFILE_DIALOG_H
+#define DISSECTOR_PROFILE_DIALOG_H
+
+#include <ui/qt/geometry_state_dialog.h>
+
+class QAbstractButton;
+
+namespace Ui {
+class DissectorProfileDialog;
+}
+
+class DissectorProfileDialog : public GeometryStateDialog
+{
+    Q_OBJECT
+
+public:
+    explicit DissectorProfileDialog(QWidget *parent = 0);
+    ~DissectorProfileDialog();
+
+private slots:
+    void on_enableCheckBox_toggled(bool checked);
+    void on_buttonBox_clicked(QAbstractButton *button);
+
+private:
+    Ui::DissectorProfileDialog *ui;
+    QAbstractButton *reset_button_;
+    QAbstractButton *refresh_button_;
+
+    void fillTree();
+};
+
+#endif // DISSECTOR_PROFILE_DIALOG_H
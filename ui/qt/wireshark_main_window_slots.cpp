@@ -101,6 +101,7 @@ DIAG_ON(frame-larger-than=)
 #include "conversation_dialog.h"
 #include "conversation_colorize_action.h"
 #include "conversation_hash_tables_dialog.h"
+#include "dissector_profile_dialog.h"
 #include "enabled_protocols_dialog.h"
 #include "decode_as_dialog.h"
 #include <ui/qt/widgets/display_filter_edit.h>
@@ -2631,6 +2632,11 @@ void WiresharkMainWindow::connectViewMenuActions()
         conversation_hash_tables_dlg->show();
     });
 
+    connect(main_ui_->actionViewInternalsDissectorProfile, &QAction::triggered, this, [this]() {
+        DissectorProfileDialog *dissector_profile_dlg = new DissectorProfileDialog(this);
+        dissector_profile_dlg->show();
+    });
+
     connect(main_ui_->actionViewInternalsDissectorTables, &QAction::triggered, this, [this]() {
         DissectorTablesDialog *dissector_tables_dlg = new DissectorTablesDialog(this);
         dissector_tables_dlg->show();
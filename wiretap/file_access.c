@@ -438,6 +438,57 @@ static const struct open_info open_info_base[] = {
  */
 #define N_OPEN_INFO_ROUTINES  array_length(open_info_base)
 
+/*
+ * Magic numbers at the start of the file for OPEN_INFO_MAGIC routines
+ * that reject any file not starting with one of them.  try_open() reads
+ * the start of the file once, and only calls those routines if one of
+ * their magic numbers matches, rather than having each of them seek to
+ * the start of the file and read it.
+ *
+ * An entry must list *all* the magic numbers the routine accepts, or
+ * files it could open will be missed; routines not listed here, such as
+ * Lua readers, are always called.
+ */
+struct open_magic {
+	const char *name;	/* name of the open routine, as in open_info_base */
+	const char *magic;
+	size_t len;
+};
+
+#define OPEN_MAGIC(name, magic)	{ name, magic, sizeof magic - 1 }
+
+static const struct open_magic open_magics[] = {
+	/* PCAP_MAGIC, PCAP_MODIFIED_MAGIC, PCAP_IXIAHW_MAGIC,
+	   PCAP_IXIASW_MAGIC, and PCAP_NSEC_MAGIC, in both byte orders */
+	OPEN_MAGIC("Wireshark/tcpdump/... - pcap",	"\xa1\xb2\xc3\xd4"),
+	OPEN_MAGIC("Wireshark/tcpdump/... - pcap",	"\xd4\xc3\xb2\xa1"),
+	OPEN_MAGIC("Wireshark/tcpdump/... - pcap",	"\xa1\xb2\xcd\x34"),
+	OPEN_MAGIC("Wireshark/tcpdump/... - pcap",	"\x34\xcd\xb2\xa1"),
+	OPEN_MAGIC("Wireshark/tcpdump/... - pcap",	"\x1c\x00\x01\xac"),
+	OPEN_MAGIC("Wireshark/tcpdump/... - pcap",	"\xac\x01\x00\x1c"),
+	OPEN_MAGIC("Wireshark/tcpdump/... - pcap",	"\x1c\x00\x01\xab"),
+	OPEN_MAGIC("Wireshark/tcpdump/... - pcap",	"\xab\x01\x00\x1c"),
+	OPEN_MAGIC("Wireshark/tcpdump/... - pcap",	"\xa1\xb2\x3c\x4d"),
+	OPEN_MAGIC("Wireshark/tcpdump/... - pcap",	"\x4d\x3c\xb2\xa1"),
+	/* Section Header Block type, the same in both byte orders */
+	OPEN_MAGIC("Wireshark/... - pcapng",		"\x0a\x0d\x0d\x0a"),
+	OPEN_MAGIC("Sniffer (DOS)",			"TRSNIFF data    \x1a"),
+	OPEN_MAGIC("Snoop, Shomiti/Finisar Surveyor",	"snoop\0\0\0"),
+	OPEN_MAGIC("Microsoft Network Monitor",	"RTSS"),
+	OPEN_MAGIC("Microsoft Network Monitor",	"GMBU"),
+	OPEN_MAGIC("Cinco NetXray/Sniffer (Windows)",	"XCP\0"),
+	OPEN_MAGIC("Cinco NetXray/Sniffer (Windows)",	"VL\0\0"),
+	OPEN_MAGIC("Visual Networks traffic capture",	"\x05VNF"),
+	OPEN_MAGIC("Viavi Observer",			"ObserverPktBuffer"),
+	OPEN_MAGIC("Colasoft Capsa",			"cpse"),
+	OPEN_MAGIC("Tektronix K12xx 32-bit .rf5 format", "\x00\x00\x02\x00\x12\x05\x00\x10"),
+	OPEN_MAGIC("Symbian OS btsnoop",		"btsnoop\0"),
+	OPEN_MAGIC("BLF Logfile",			"LOGG"),
+};
+
+/* Bytes at the start of the file that try_open() reads to check them. */
+#define OPEN_MAGIC_HEAD_LEN	32
+
 static GArray *open_info_arr;
 
 /* this always points to the top of the created array */
@@ -446,6 +497,56 @@ struct open_info *open_routines;
 /* this points to the first OPEN_INFO_HEURISTIC type in the array */
 static unsigned heuristic_open_routine_idx;
 
+/*
+ * For each open routine, the index in open_magics[] of its first magic
+ * number, or -1 if it has none; its magic numbers follow that one.
+ */
+static GArray *open_magic_idx;
+
+static void
+set_open_magics(void)
+{
+	unsigned i, j;
+	int idx;
+
+	if (open_magic_idx == NULL)
+		open_magic_idx = g_array_new(false, false, sizeof(int));
+	g_array_set_size(open_magic_idx, open_info_arr->len);
+	for (i = 0; i < open_info_arr->len; i++) {
+		idx = -1;
+		if (open_routines[i].type == OPEN_INFO_MAGIC) {
+			for (j = 0; j < array_length(open_magics); j++) {
+				if (strcmp(open_routines[i].name, open_magics[j].name) == 0) {
+					idx = (int)j;
+					break;
+				}
+			}
+		}
+		g_array_index(open_magic_idx, int, i) = idx;
+	}
+}
+
+/*
+ * Could the file starting with head be one for open routine i?
+ */
+static bool
+open_magic_matches(unsigned i, const uint8_t *head, size_t head_len)
+{
+	int idx = g_array_index(open_magic_idx, int, i);
+	const char *name;
+
+	if (idx == -1)
+		return true;	/* no magic numbers; try it */
+	name = open_magics[idx].name;
+	for (; (unsigned)idx < array_length(open_magics) &&
+	    strcmp(open_magics[idx].name, name) == 0; idx++) {
+		if (head_len >= open_magics[idx].len &&
+		    memcmp(head, open_magics[idx].magic, open_magics[idx].len) == 0)
+			return true;
+	}
+	return false;
+}
+
 static void
 set_heuristic_routine(void)
 {
@@ -486,6 +587,7 @@ init_open_routines(void)
 	}
 
 	set_heuristic_routine();
+	set_open_magics();
 }
 
 /*
@@ -538,6 +640,7 @@ wtap_register_open_info(struct open_info *oi, const bool first_routine)
 
 	open_routines = (struct open_info *)(void*) open_info_arr->data;
 	set_heuristic_routine();
+	set_open_magics();
 }
 
 /* De-registers a file reader by removing it from the GArray based on its name.
@@ -560,6 +663,7 @@ wtap_deregister_open_info(const char *name)
 			g_strfreev(open_routines[i].extensions_set);
 			open_info_arr = g_array_remove_index(open_info_arr, i);
 			set_heuristic_routine();
+			set_open_magics();
 			return;
 		}
 	}
@@ -781,6 +885,9 @@ heuristic_uses_extension(unsigned int i, const char *extension)
 static int
 try_one_open(wtap *wth, const struct open_info *candidate, int *err, char **err_info)
 {
+	int64_t start_time;
+	int result;
+
 	/* Seek back to the beginning of the file; the open routine for the
 	 * previous file type may have left the file position somewhere other
 	 * than the beginning, and the open routine for this file type will
@@ -799,7 +906,13 @@ try_one_open(wtap *wth, const struct open_info *candidate, int *err, char **err_
 	 */
 	wth->wslua_data = candidate->wslua_data;
 
-	return candidate->open_routine(wth, err, err_info);
+	start_time = g_get_monotonic_time();
+	result = candidate->open_routine(wth, err, err_info);
+	ws_info("%s: %s, %" PRId64 " us", candidate->name,
+	    result == WTAP_OPEN_MINE ? "mine" :
+	    result == WTAP_OPEN_NOT_MINE ? "not mine" : "error",
+	    g_get_monotonic_time() - start_time);
+	return result;
 }
 
 /*
@@ -818,6 +931,9 @@ try_open(wtap *wth, unsigned int type, int *err, char **err_info)
 	int result = WTAP_OPEN_NOT_MINE;
 	unsigned i;
 	char *extension;
+	uint8_t head[OPEN_MAGIC_HEAD_LEN];
+	int head_len;
+	unsigned skipped = 0;
 
 	/* 'type' is 1-based. */
 	if (type != WTAP_TYPE_AUTO && type <= open_info_arr->len) {
@@ -825,10 +941,27 @@ try_open(wtap *wth, unsigned int type, int *err, char **err_info)
 		return try_one_open(wth, &open_routines[type - 1], err, err_info);
 	}
 
+	/*
+	 * Read the start of the file, so we can skip the magic number
+	 * routines whose magic numbers it doesn't have.
+	 */
+	if (file_seek(wth->fh, 0, SEEK_SET, err) == -1)
+		return WTAP_OPEN_ERROR;
+	head_len = file_read(head, sizeof head, wth->fh);
+	if (head_len == -1) {
+		*err = file_error(wth->fh, err_info);
+		return WTAP_OPEN_ERROR;
+	}
+
 	/* First, all file types that support magic numbers. */
 	for (i = 0; i < heuristic_open_routine_idx && result == WTAP_OPEN_NOT_MINE; i++) {
+		if (!open_magic_matches(i, head, (size_t)head_len)) {
+			skipped++;
+			continue;
+		}
 		result = try_one_open(wth, &open_routines[i], err, err_info);
 	}
+	ws_info("skipped %u magic number open routines", skipped);
 
 	if (result != WTAP_OPEN_NOT_MINE) {
 		return result;
@@ -885,6 +1018,30 @@ try_open(wtap *wth, unsigned int type, int *err, char **err_info)
 	return result;
 }
 
+/*
+ * Number of bytes to read ahead on the sequential handle of files
+ * opened from now on; 0 means don't read ahead.
+ */
+static size_t readahead_window;
+
+void
+wtap_set_readahead_window(size_t window)
+{
+	readahead_window = window;
+}
+
+/*
+ * Number of threads with which to decompress files opened from now on;
+ * 0 or 1 means decompress on the reading thread.
+ */
+static unsigned decompress_threads;
+
+void
+wtap_set_decompress_threads(unsigned threads)
+{
+	decompress_threads = threads;
+}
+
 /* Opens a file and prepares a wtap struct.
  * If "do_random" is true, it opens the file twice; the second open
  * allows the application to do random-access I/O without moving
@@ -1004,6 +1161,8 @@ wtap_open_offline(const char *filename, unsigned int type, int *err, char **err_
 		}
 	}
 
+	file_set_readahead(wth->fh, readahead_window);
+
 	if (do_random) {
 		if (!(wth->random_fh = file_open(filename))) {
 			*err = errno;
@@ -1017,6 +1176,8 @@ wtap_open_offline(const char *filename, unsigned int type, int *err, char **err_
 	/* initialization */
 	wth->ispipe = ispipe;
 	wth->file_encap = WTAP_ENCAP_UNKNOWN;
+	wth->subtype_read_batch = NULL;
+	wth->subtype_scan_index = NULL;
 	wth->subtype_sequential_close = NULL;
 	wth->subtype_close = NULL;
 	wth->file_tsprec = WTAP_TSPREC_USEC;
@@ -1060,6 +1221,14 @@ wtap_open_offline(const char *filename, unsigned int type, int *err, char **err_
 		wth = NULL;
 	}
 
+	/*
+	 * Only now that we've found the file's type, so that probing for
+	 * it doesn't start decompressing ahead, set up for decompressing
+	 * the rest of it in parallel.
+	 */
+	if (wth != NULL)
+		file_set_decompress_threads(wth->fh, decompress_threads);
+
 	return wth;
 }
 
@@ -27,12 +27,26 @@
 
 #include <wsutil/file_util.h>
 
+#ifdef HAVE_MMAP
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#if defined(__linux__)
+#include <sys/vfs.h>
+#elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__) || defined(__DragonFly__)
+#define HAVE_MNT_LOCAL
+#include <sys/param.h>
+#include <sys/mount.h>
+#endif
+#endif /* HAVE_MMAP */
+
 #if defined(HAVE_ZLIB) && !defined(HAVE_ZLIBNG)
 #define USE_ZLIB_OR_ZLIBNG
 #define ZLIB_CONST
 #define ZLIB_PREFIX(x) x
 #include <zlib.h>
 typedef z_stream zlib_stream;
+typedef gz_header zlib_gz_header;
 #endif /* defined(HAVE_ZLIB) && !defined(HAVE_ZLIBNG) */
 
 #ifdef HAVE_ZLIBNG
@@ -41,6 +55,7 @@ typedef z_stream zlib_stream;
 #define ZLIB_PREFIX(x) zng_ ## x
 #include <zlib-ng.h>
 typedef zng_stream zlib_stream;
+typedef zng_gz_header zlib_gz_header;
 #endif /* HAVE_ZLIBNG */
 
 #ifdef HAVE_ZSTD
@@ -113,6 +128,19 @@ wtap_can_write_compression_type(wtap_compression_type compression_type)
     return false;
 }
 
+/*
+ * If non-zero, compressed files we write are split into independently
+ * decompressible gzip members or lz4 frames of about this many bytes
+ * of uncompressed data each.
+ */
+static size_t compression_chunk_size;
+
+void
+wtap_set_compression_chunk_size(size_t size)
+{
+    compression_chunk_size = size;
+}
+
 wtap_compression_type
 wtap_get_compression_type(wtap *wth)
 {
@@ -227,6 +255,12 @@ struct wtap_reader_buf {
     unsigned avail;  /* number of bytes available to deliver at next */
 };
 
+/* a memory mapping of a file */
+struct file_map {
+    uint8_t *map;
+    size_t map_size;
+};
+
 struct wtap_reader {
     int fd;                     /* file descriptor */
     int64_t raw_pos;            /* current position in file (just to not call lseek()) */
@@ -273,6 +307,25 @@ struct wtap_reader {
     /* fast seeking */
     GPtrArray *fast_seek;
     void *fast_seek_cur;
+
+    /* memory-mapped view of an uncompressed regular file */
+    bool map_wanted;            /* map the file if it's not compressed */
+    uint8_t *map;               /* read-only mapping of the file, or NULL */
+    size_t map_size;            /* size of the mapping */
+    int64_t map_len;            /* length of the mapping still in the file */
+    int map_faults;             /* map_guard_faults when we last checked */
+    bool mapped;                /* true if reads are served from the mapping */
+    GSList *old_maps;           /* mappings of files we had open before */
+
+    /* readahead */
+    struct readahead *ra;       /* background reader, if running */
+    unsigned ra_chunks;         /* number of chunks to read ahead, 0 if none */
+    unsigned ra_seq_reads;      /* reads since the last seek */
+    int64_t io_wait;            /* microseconds spent waiting for reads */
+
+    /* parallel decompression */
+    struct pdec *pdec;          /* decompression thread pool, if started */
+    unsigned pdec_threads;      /* number of threads to use, 0 if none */
 };
 
 /* Current read offset within a buffer. */
@@ -311,6 +364,183 @@ buf_reset(struct wtap_reader_buf *buf)
     buf->avail = 0;
 }
 
+/*
+ * Readahead.
+ *
+ * If file_set_readahead() has been called for a regular file, once
+ * it's being read sequentially a background thread keeps reading it
+ * into a ring of chunks ahead of us, so that decompression and
+ * dissection don't stall waiting for the file system, which can take
+ * a while with network file systems.
+ *
+ * The thread owns the file descriptor while it's running, so anything
+ * that seeks the descriptor, or closes it, must stop it first with
+ * readahead_stop(), which leaves the descriptor at raw_pos.
+ *
+ * Memory-mapped files don't use this, as the OS reads them ahead.
+ */
+#define READAHEAD_CHUNK_SIZE        (1024U * 1024U)
+#define READAHEAD_MIN_SEQ_READS     2
+
+struct readahead_chunk {
+    uint8_t *data;
+    unsigned len;               /* bytes read; 0 at EOF or on an error */
+    unsigned next;              /* offset of the next byte to deliver */
+    int err;                    /* errno value if the read failed */
+};
+
+struct readahead {
+    GThread *thread;
+    GMutex lock;
+    GCond cond;                 /* signaled when a chunk is filled or freed */
+    int fd;
+    unsigned nchunks;
+    struct readahead_chunk *chunks;
+    unsigned head;              /* next chunk to deliver */
+    unsigned count;             /* number of filled chunks */
+    bool done;                  /* the thread has hit EOF or an error */
+    bool stop;                  /* the thread should exit */
+};
+
+static void *
+readahead_thread(void *arg)
+{
+    struct readahead *ra = (struct readahead *)arg;
+    struct readahead_chunk *chunk;
+    ssize_t ret;
+
+    g_mutex_lock(&ra->lock);
+    while (!ra->stop && !ra->done) {
+        if (ra->count == ra->nchunks) {
+            /* Wait for the reader to use up a chunk. */
+            g_cond_wait(&ra->cond, &ra->lock);
+            continue;
+        }
+
+        /*
+         * The reader doesn't look at this chunk until we count it as
+         * filled, so we can read into it without holding the lock.
+         */
+        chunk = &ra->chunks[(ra->head + ra->count) % ra->nchunks];
+        g_mutex_unlock(&ra->lock);
+        ret = ws_read(ra->fd, chunk->data, READAHEAD_CHUNK_SIZE);
+        chunk->err = (ret < 0) ? errno : 0;
+        g_mutex_lock(&ra->lock);
+
+        chunk->len = (ret > 0) ? (unsigned)ret : 0;
+        chunk->next = 0;
+        if (ret <= 0)
+            ra->done = true;
+        ra->count++;
+        g_cond_broadcast(&ra->cond);
+    }
+    g_mutex_unlock(&ra->lock);
+    return NULL;
+}
+
+static void
+readahead_start(FILE_T state)
+{
+    struct readahead *ra;
+
+    ra = g_new0(struct readahead, 1);
+    g_mutex_init(&ra->lock);
+    g_cond_init(&ra->cond);
+    ra->fd = state->fd;
+    ra->nchunks = state->ra_chunks;
+    ra->chunks = g_new0(struct readahead_chunk, ra->nchunks);
+    for (unsigned i = 0; i < ra->nchunks; i++)
+        ra->chunks[i].data = (uint8_t *)g_malloc(READAHEAD_CHUNK_SIZE);
+    ra->thread = g_thread_new("readahead", readahead_thread, ra);
+    state->ra = ra;
+}
+
+/*
+ * Stop reading ahead, discarding whatever has been read ahead but not
+ * delivered, and put the file descriptor back where we'd be if we
+ * hadn't read ahead.
+ */
+static int
+readahead_stop(FILE_T state)
+{
+    struct readahead *ra = state->ra;
+
+    state->ra_seq_reads = 0;
+    if (ra == NULL)
+        return 0;
+
+    g_mutex_lock(&ra->lock);
+    ra->stop = true;
+    g_cond_broadcast(&ra->cond);
+    g_mutex_unlock(&ra->lock);
+    g_thread_join(ra->thread);
+
+    for (unsigned i = 0; i < ra->nchunks; i++)
+        g_free(ra->chunks[i].data);
+    g_free(ra->chunks);
+    g_cond_clear(&ra->cond);
+    g_mutex_clear(&ra->lock);
+    g_free(ra);
+    state->ra = NULL;
+
+    if (ws_lseek64(state->fd, state->raw_pos, SEEK_SET) == -1) {
+        state->err = errno;
+        state->err_info = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Deliver up to len bytes of read-ahead data, waiting for the thread
+ * if necessary; returns what ws_read() would.
+ */
+static ssize_t
+readahead_read(FILE_T state, uint8_t *buf, unsigned len)
+{
+    struct readahead *ra = state->ra;
+    struct readahead_chunk *chunk;
+    int64_t wait_start;
+    unsigned n;
+    int err;
+
+    g_mutex_lock(&ra->lock);
+    if (ra->count == 0) {
+        wait_start = g_get_monotonic_time();
+        while (ra->count == 0)
+            g_cond_wait(&ra->cond, &ra->lock);
+        state->io_wait += g_get_monotonic_time() - wait_start;
+    }
+    chunk = &ra->chunks[ra->head];
+    if (chunk->len == 0) {
+        /*
+         * EOF or an error.  Stop reading ahead for good, in case the
+         * file is still being written and we try again later.
+         */
+        err = chunk->err;
+        g_mutex_unlock(&ra->lock);
+        state->ra_chunks = 0;
+        if (readahead_stop(state) == -1)
+            return -1;
+        if (err != 0) {
+            errno = err;
+            return -1;
+        }
+        return 0;
+    }
+
+    n = MIN(len, chunk->len - chunk->next);
+    memcpy(buf, chunk->data + chunk->next, n);
+    chunk->next += n;
+    if (chunk->next == chunk->len) {
+        ra->head = (ra->head + 1) % ra->nchunks;
+        ra->count--;
+        g_cond_broadcast(&ra->cond);
+    }
+    g_mutex_unlock(&ra->lock);
+    return n;
+}
+
 static int
 buf_read(FILE_T state, struct wtap_reader_buf *buf)
 {
@@ -336,7 +566,17 @@ buf_read(FILE_T state, struct wtap_reader_buf *buf)
         to_read = space_left;
     }
 
-    ret = ws_read(state->fd, read_ptr, to_read);
+    if (state->ra == NULL && state->ra_chunks != 0 &&
+        ++state->ra_seq_reads >= READAHEAD_MIN_SEQ_READS)
+        readahead_start(state);
+    if (state->ra != NULL) {
+        ret = readahead_read(state, read_ptr, to_read);
+    } else {
+        int64_t read_start = g_get_monotonic_time();
+
+        ret = ws_read(state->fd, read_ptr, to_read);
+        state->io_wait += g_get_monotonic_time() - read_start;
+    }
     if (ret < 0) {
         state->err = errno;
         state->err_info = NULL;
@@ -1442,67 +1682,1093 @@ check_for_compression(FILE_T state)
             return 0;
     }
 
-    /*
-     * Check for the compression types we support.
-     */
-    for (size_t i = 0; i < G_N_ELEMENTS(compression_type_tests); i++) {
-        int ret;
+    /*
+     * Check for the compression types we support.
+     */
+    for (size_t i = 0; i < G_N_ELEMENTS(compression_type_tests); i++) {
+        int ret;
+
+        ret = compression_type_tests[i](state);
+        if (ret == -1)
+            return -1;    /* error */
+        if (ret == 1)
+            return 0;     /* found it */
+    }
+
+    /*
+     * Some other compressed file formats we might want to support:
+     *
+     *   XZ format:
+     *     https://tukaani.org/xz/
+     *     https://github.com/tukaani-project/xz
+     *     https://github.com/tukaani-project/xz/blob/master/doc/xz-file-format.txt
+     *
+     *    Bzip2 format:
+     *      https://www.sourceware.org/bzip2/
+     *      https://gitlab.com/bzip2/bzip2/
+     *      https://github.com/dsnet/compress/blob/master/doc/bzip2-format.pdf
+     *        (GitHub won't render it; download and open it)
+     *
+     *    Lzip format:
+     *      https://www.nongnu.org/lzip/
+     */
+
+    /*
+     * We didn't see anything that looks like a header for any type of
+     * compressed file that we support, so just do uncompressed I/O.
+     *
+     * XXX - This fast seek data is for the case where a compressed stream
+     * ends and is followed by an uncompressed portion.  It only works if
+     * the uncompressed portion is at the end, as we don't constantly scan
+     * for magic bytes in the middle of uncompressed data. (Concatenated
+     * compressed streams _do_ work, even streams of different compression types.)
+     */
+    if (state->fast_seek)
+        fast_seek_header(state, state->raw_pos - state->in.avail, state->pos, UNCOMPRESSED);
+
+
+    /* doing raw i/o, save start of raw data for seeking, copy any leftover
+       input to output -- this assumes that the output buffer is larger than
+       the input buffer, which also assures space for gzungetc() */
+    state->raw = state->pos;
+    state->out.next = state->out.buf;
+    /* not a compressed file -- copy everything we've read into the
+       input buffer to the output buffer and fall to raw i/o */
+    if (state->in.avail) {
+        memcpy(state->out.buf, state->in.next, state->in.avail);
+        state->out.avail = state->in.avail;
+
+        /* Now discard everything in the input buffer */
+        buf_reset(&state->in);
+    }
+    state->compression = UNCOMPRESSED;
+    return 0;
+}
+
+#ifdef HAVE_MMAP
+/*
+ * Regular files on local file systems opened with file_open() are mapped
+ * into memory once check_for_compression() has found that they aren't
+ * compressed at all; reads are then served directly from the mapping
+ * rather than being copied through the input and output buffers, and
+ * file_read_mapped() can hand out pointers into it.  Setting the
+ * WIRESHARK_NO_MMAP environment variable turns this off.
+ *
+ * The mapping covers the file as it was when we mapped it; if the file
+ * has grown since then (e.g., because it's still being written by a
+ * capture), we go back to reading from the file descriptor when we get
+ * to the end of the mapping.
+ *
+ * If the file shrinks instead, touching the pages past its new end gets
+ * a SIGBUS.  Our handler for it replaces such a page with a page of
+ * zeroes and counts the fault; when the count changes, readers check
+ * the size of the file and stop using the part of the mapping that's no
+ * longer in it, so reads past the new end come up short as they would
+ * without the mapping.  Data already handed out by file_read_mapped()
+ * or file_get_mapping() might read as zeroes, but we don't crash.
+ * Network file systems can also fail page-ins with a SIGBUS, for reasons
+ * other than truncation, which is why we only map files on local ones.
+ */
+
+/* Ranges of our mappings, for the SIGBUS handler. */
+#define MAP_GUARD_SLOTS 256
+static volatile uintptr_t map_guard_start[MAP_GUARD_SLOTS];
+static volatile uintptr_t map_guard_end[MAP_GUARD_SLOTS];
+static GMutex map_guard_mutex;
+static uintptr_t map_guard_pagesize;
+static struct sigaction map_guard_old_action;
+/* Pages replaced so far; atomic, so that reading it isn't moved before
+ * the accesses it's meant to check. */
+static int map_guard_faults;
+
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+static void
+map_guard_handler(int sig, siginfo_t *info, void *context)
+{
+    uintptr_t addr = (uintptr_t)info->si_addr;
+    uintptr_t page;
+    unsigned i;
+
+    for (i = 0; i < MAP_GUARD_SLOTS; i++) {
+        if (addr >= map_guard_start[i] && addr < map_guard_end[i]) {
+            page = addr & ~(map_guard_pagesize - 1);
+            if (mmap((void *)page, map_guard_pagesize, PROT_READ,
+                     MAP_PRIVATE|MAP_ANONYMOUS|MAP_FIXED, -1, 0) == MAP_FAILED)
+                break;
+            g_atomic_int_inc(&map_guard_faults);
+            return;
+        }
+    }
+
+    /* Not one of ours; hand it to whoever had it before. */
+    if (map_guard_old_action.sa_flags & SA_SIGINFO)
+        map_guard_old_action.sa_sigaction(sig, info, context);
+    else if (map_guard_old_action.sa_handler != SIG_DFL &&
+             map_guard_old_action.sa_handler != SIG_IGN)
+        map_guard_old_action.sa_handler(sig);
+    else
+        /* the faulting access is retried and gets the default action */
+        sigaction(SIGBUS, &map_guard_old_action, NULL);
+}
+
+static void *
+map_guard_install(void *arg _U_)
+{
+    struct sigaction action;
+    long pagesize;
+
+    pagesize = sysconf(_SC_PAGESIZE);
+    if (pagesize <= 0)
+        return GINT_TO_POINTER(false);
+    map_guard_pagesize = (uintptr_t)pagesize;
+
+    memset(&action, 0, sizeof action);
+    action.sa_sigaction = map_guard_handler;
+    action.sa_flags = SA_SIGINFO;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(SIGBUS, &action, &map_guard_old_action) == -1)
+        return GINT_TO_POINTER(false);
+    return GINT_TO_POINTER(true);
+}
+
+/* Start guarding a mapping; returns false if we can't. */
+static bool
+map_guard_add(uint8_t *map, size_t size)
+{
+    static GOnce install_once = G_ONCE_INIT;
+    bool added = false;
+    unsigned i;
+
+    if (!GPOINTER_TO_INT(g_once(&install_once, map_guard_install, NULL)))
+        return false;
+
+    g_mutex_lock(&map_guard_mutex);
+    for (i = 0; i < MAP_GUARD_SLOTS; i++) {
+        if (map_guard_end[i] == 0) {
+            map_guard_start[i] = (uintptr_t)map;
+            map_guard_end[i] = (uintptr_t)map + size;
+            added = true;
+            break;
+        }
+    }
+    g_mutex_unlock(&map_guard_mutex);
+    return added;
+}
+
+/* Stop guarding a mapping, before unmapping it. */
+static void
+map_guard_remove(uint8_t *map)
+{
+    unsigned i;
+
+    g_mutex_lock(&map_guard_mutex);
+    for (i = 0; i < MAP_GUARD_SLOTS; i++) {
+        if (map_guard_start[i] == (uintptr_t)map && map_guard_end[i] != 0) {
+            map_guard_end[i] = 0;
+            map_guard_start[i] = 0;
+            break;
+        }
+    }
+    g_mutex_unlock(&map_guard_mutex);
+}
+
+static void
+map_close(uint8_t *map, size_t size)
+{
+    map_guard_remove(map);
+    munmap(map, size);
+}
+
+/*
+ * Is the file on a file system where we know that pages are only lost
+ * if the file is truncated?
+ */
+static bool
+map_fs_is_local(int fd)
+{
+#if defined(__linux__)
+    struct statfs sfs;
+
+    if (fstatfs(fd, &sfs) == -1)
+        return false;
+    switch ((uint32_t)sfs.f_type) {
+
+    case 0x00006969:    /* NFS */
+    case 0x0000517B:    /* SMB */
+    case 0xFE534D42:    /* SMB2 */
+    case 0xFF534D42:    /* CIFS */
+    case 0x01021997:    /* 9P */
+    case 0x5346414F:    /* AFS */
+    case 0x6B414653:    /* kAFS */
+    case 0x73757245:    /* Coda */
+    case 0x00C36400:    /* Ceph */
+    case 0x47504653:    /* GPFS */
+    case 0x0BD00BD0:    /* Lustre */
+    case 0x65735546:    /* FUSE, e.g. sshfs */
+        return false;
+    }
+    return true;
+#elif defined(HAVE_MNT_LOCAL)
+    struct statfs sfs;
+
+    return fstatfs(fd, &sfs) == 0 && (sfs.f_flags & MNT_LOCAL);
+#else
+    (void)fd;
+    return false;
+#endif
+}
+
+/*
+ * Map the file, now that we know it isn't compressed, if file_open()
+ * found that we could.  If we can't, we just read the file the usual
+ * way.
+ *
+ * The mapping is read-only; code that modifies packet data in place
+ * (e.g., byte-swapping pseudo-headers) must copy it first, so that
+ * reading the same record again gets the same data.
+ */
+static void
+map_open(FILE_T state)
+{
+    ws_statb64 st;
+    void *map;
+
+    state->map_wanted = false;
+    if (ws_fstat64(state->fd, &st) == -1 || !S_ISREG(st.st_mode) ||
+        st.st_size <= 0 || (uint64_t)st.st_size > SIZE_MAX)
+        return;
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, state->fd, 0);
+    if (map == MAP_FAILED)
+        return;
+    if (!map_guard_add((uint8_t *)map, (size_t)st.st_size)) {
+        munmap(map, (size_t)st.st_size);
+        return;
+    }
+    state->map = (uint8_t *)map;
+    state->map_size = (size_t)st.st_size;
+    state->map_len = st.st_size;
+    state->map_faults = g_atomic_int_get(&map_guard_faults);
+}
+
+/*
+ * A page of some mapping has been lost; if the file has been truncated,
+ * stop using the part of the mapping past its new end.
+ */
+static void
+map_check(FILE_T state)
+{
+    ws_statb64 st;
+
+    state->map_faults = g_atomic_int_get(&map_guard_faults);
+    if (ws_fstat64(state->fd, &st) == 0 && st.st_size < state->map_len)
+        state->map_len = st.st_size;
+}
+
+#define MAP_CHECK(state) \
+    do { \
+        if (G_UNLIKELY((state)->map_faults != \
+                       g_atomic_int_get(&map_guard_faults))) \
+            map_check(state); \
+    } while (0)
+
+#define MAP_USABLE(state) \
+    ((state)->map != NULL && (state)->compression == UNCOMPRESSED && \
+     !(state)->is_compressed && (state)->raw == 0)
+
+/* Start serving reads from the mapping, at the current position. */
+static void
+map_enter(FILE_T state)
+{
+    buf_reset(&state->out);
+    buf_reset(&state->in);
+    state->eof = false;
+    state->err = 0;
+    state->err_info = NULL;
+    state->raw_pos = state->pos;
+    state->mapped = true;
+}
+
+/* Go back to reading from the file descriptor, at the current position. */
+static int
+map_leave(FILE_T state)
+{
+    state->mapped = false;
+    if (readahead_stop(state) == -1)
+        return -1;
+    if (ws_lseek64(state->fd, state->pos, SEEK_SET) == -1) {
+        state->err = errno;
+        state->err_info = NULL;
+        return -1;
+    }
+    state->raw_pos = state->pos;
+    return 0;
+}
+
+/*
+ * Copy up to len bytes from the mapping, or discard them if buf is
+ * NULL; anything past the end of the mapping is read from the file
+ * descriptor.
+ */
+static int
+map_read(void *buf, unsigned len, FILE_T state)
+{
+    unsigned n = 0;
+    int ret;
+
+    MAP_CHECK(state);
+    if (state->pos < state->map_len) {
+        n = (state->map_len - state->pos) < len ?
+            (unsigned)(state->map_len - state->pos) : len;
+        if (buf != NULL) {
+            memcpy(buf, state->map + state->pos, n);
+            if (G_UNLIKELY(state->map_faults !=
+                           g_atomic_int_get(&map_guard_faults))) {
+                /* Some of what we copied might be gone; start over. */
+                map_check(state);
+                return map_read(buf, len, state);
+            }
+            buf = (char *)buf + n;
+        }
+        state->pos += n;
+        state->raw_pos = state->pos;
+        if (n == len)
+            return (int)n;
+    }
+    if (map_leave(state) == -1)
+        return -1;
+    ret = file_read(buf, len - n, state);
+    return ret == -1 ? -1 : (int)n + ret;
+}
+#endif /* HAVE_MMAP */
+
+/*
+ * Parallel decompression.
+ *
+ * If file_set_decompress_threads() has been called for a regular file,
+ * then, whenever we're at the start of a gzip member, zstd frame or lz4
+ * frame whose end we can find without decompressing it, we read it in
+ * and hand it to a pool of threads to decompress, along with as many of
+ * the following ones as we're allowed to have in flight, and deliver
+ * their output in file order.
+ *
+ * The end of a zstd or lz4 frame can be found by walking the block
+ * headers.  A gzip member's end can only be found if the member says
+ * how long it is, which members we write with a compression chunk size
+ * set do, as do BGZF (bgzip) files; for other gzip files, and anything
+ * we can't split up, we just decompress on the reading thread as usual.
+ *
+ * Like readahead, this reads ahead of the decompressed data being
+ * delivered, so anything that seeks the descriptor must first discard
+ * what's in flight with pdec_stop().
+ */
+#define PDEC_MAX_THREADS            64
+#define PDEC_MAX_UNIT_SIZE          (16U * 1024U * 1024U)
+#define PDEC_MAX_OUT_SIZE           (64U * 1024U * 1024U)
+
+/*
+ * gzip members we write in chunks carry their own length, in an extra
+ * field subfield, so that a reader can find the next member without
+ * decompressing this one.  This is the same idea as BGZF's "BC"
+ * subfield, but with a 32-bit length, as our members can be bigger
+ * than 64 KiB.
+ */
+#define GZ_CHUNK_SI1                'W'
+#define GZ_CHUNK_SI2                'S'
+#define GZ_CHUNK_XLEN               8   /* SI1, SI2, LEN, and the member length */
+
+struct pdec_unit {
+    compression_t compression;  /* ZLIB, ZSTD, or LZ4 */
+    int64_t in_pos;             /* offset of the unit in the file */
+    unsigned hdr_len;           /* length of the gzip member or lz4 frame header */
+    bool check_crc;             /* true if the gzip CRC should be checked */
+    uint8_t *in;                /* compressed data */
+    size_t in_len;
+    size_t in_size;             /* allocated size of in */
+    uint8_t *out;               /* decompressed data */
+    size_t out_len;
+    size_t next;                /* offset of the next byte of out to deliver */
+    bool done;                  /* true once it's been decompressed */
+    bool too_big;               /* true if it decompresses to more than PDEC_MAX_OUT_SIZE */
+    int err;                    /* error decompressing it, if any */
+    const char *err_info;
+};
+
+struct pdec {
+    GThreadPool *pool;
+    GMutex lock;
+    GCond cond;                 /* signaled when a unit is done */
+    GQueue units;               /* units in flight, in file order */
+    unsigned max_units;
+};
+
+static void
+pdec_unit_free(struct pdec_unit *unit)
+{
+    g_free(unit->in);
+    g_free(unit->out);
+    g_free(unit);
+}
+
+/*
+ * Make sure there's room for at least len more bytes of output; returns
+ * false, and marks the unit as too big, if that would take the output
+ * past PDEC_MAX_OUT_SIZE, so that a unit whose headers understate its
+ * size can't make us hold more than that in memory.
+ */
+static bool
+pdec_out_reserve(struct pdec_unit *unit, size_t *out_size, size_t len)
+{
+    if (len > PDEC_MAX_OUT_SIZE - MIN(unit->out_len, PDEC_MAX_OUT_SIZE)) {
+        unit->too_big = true;
+        return false;
+    }
+    if (*out_size - unit->out_len < len) {
+        *out_size = MIN(MAX(*out_size * 2, unit->out_len + len), PDEC_MAX_OUT_SIZE);
+        unit->out = (uint8_t *)g_realloc(unit->out, *out_size);
+    }
+    return true;
+}
+
+#ifdef USE_ZLIB_OR_ZLIBNG
+static void
+pdec_inflate(struct pdec_unit *unit)
+{
+    zlib_stream strm;
+    const uint8_t *trailer = unit->in + unit->in_len - 8;
+    uint32_t isize = pletoh32(trailer + 4);
+    size_t out_size = (size_t)isize + 1;
+    uint32_t crc;
+    int ret;
+
+    memset(&strm, 0, sizeof strm);
+    if (ZLIB_PREFIX(inflateInit2)(&strm, -15) != Z_OK) {    /* raw inflate */
+        unit->err = ENOMEM;
+        return;
+    }
+    strm.next_in = unit->in + unit->hdr_len;
+    strm.avail_in = (unsigned)(unit->in_len - unit->hdr_len - 8);
+    unit->out = (uint8_t *)g_malloc(out_size);
+    do {
+        if (!pdec_out_reserve(unit, &out_size, 1))
+            break;
+        strm.next_out = unit->out + unit->out_len;
+        strm.avail_out = (unsigned)(out_size - unit->out_len);
+        ret = ZLIB_PREFIX(inflate)(&strm, Z_NO_FLUSH);
+        unit->out_len = out_size - strm.avail_out;
+        if (ret == Z_MEM_ERROR) {
+            unit->err = ENOMEM;
+            break;
+        }
+        if (ret == Z_BUF_ERROR && strm.avail_in == 0) {
+            unit->err = WTAP_ERR_DECOMPRESS;
+            unit->err_info = "member length field wrong";
+            break;
+        }
+        if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) {
+            unit->err = WTAP_ERR_DECOMPRESS;
+            unit->err_info = (ret == Z_NEED_DICT) ? "preset dictionary needed" : strm.msg;
+            break;
+        }
+    } while (ret != Z_STREAM_END);
+    ZLIB_PREFIX(inflateEnd)(&strm);
+    if (unit->err != 0 || unit->too_big)
+        return;
+
+    if (strm.avail_in != 0) {
+        unit->err = WTAP_ERR_DECOMPRESS;
+        unit->err_info = "member length field wrong";
+        return;
+    }
+    crc = ZLIB_PREFIX(crc32)(0L, Z_NULL, 0);
+    crc = ZLIB_PREFIX(crc32)(crc, unit->out, (unsigned)unit->out_len);
+    if (crc != pletoh32(trailer) && unit->check_crc) {
+        unit->err = WTAP_ERR_DECOMPRESS;
+        unit->err_info = "bad CRC";
+    } else if (isize != (uint32_t)unit->out_len) {
+        unit->err = WTAP_ERR_DECOMPRESS;
+        unit->err_info = "length field wrong";
+    }
+}
+#endif /* USE_ZLIB_OR_ZLIBNG */
+
+#ifdef HAVE_ZSTD
+static void
+pdec_zstd_decompress(struct pdec_unit *unit)
+{
+    ZSTD_DCtx *dctx;
+    ZSTD_inBuffer input = {unit->in, unit->in_len, 0};
+    unsigned long long content_size;
+    size_t out_size;
+    size_t ret;
+
+    content_size = ZSTD_getFrameContentSize(unit->in, unit->in_len);
+    if (content_size <= PDEC_MAX_OUT_SIZE)
+        out_size = (size_t)content_size + 1;
+    else
+        out_size = MIN(unit->in_len * 4, PDEC_MAX_OUT_SIZE);
+
+    dctx = ZSTD_createDCtx();
+    if (dctx == NULL) {
+        unit->err = ENOMEM;
+        return;
+    }
+    unit->out = (uint8_t *)g_malloc(out_size);
+    do {
+        if (!pdec_out_reserve(unit, &out_size, 1))
+            break;
+        ZSTD_outBuffer output = {unit->out + unit->out_len, out_size - unit->out_len, 0};
+        ret = ZSTD_decompressStream(dctx, &output, &input);
+        if (ZSTD_isError(ret)) {
+            unit->err = WTAP_ERR_DECOMPRESS;
+            unit->err_info = ZSTD_getErrorName(ret);
+            break;
+        }
+        unit->out_len += output.pos;
+        if (ret != 0 && input.pos == input.size && output.pos < output.size) {
+            /* We walked the blocks, so this "can't happen". */
+            unit->err = WTAP_ERR_SHORT_READ;
+            break;
+        }
+    } while (ret != 0);
+    ZSTD_freeDCtx(dctx);
+}
+#endif /* HAVE_ZSTD */
+
+#ifdef HAVE_LZ4FRAME_H
+static void
+pdec_lz4_decompress(struct pdec_unit *unit)
+{
+    LZ4F_dctx *dctx;
+    size_t in_pos = 0;
+    size_t out_size;
+    size_t src_size, dst_size;
+    size_t ret;
+
+    /* FLG has the Content Size flag set if the frame has it. */
+    if ((unit->in[4] & 0x08) && pletoh64(unit->in + 6) <= PDEC_MAX_OUT_SIZE)
+        out_size = (size_t)pletoh64(unit->in + 6) + 1;
+    else
+        out_size = MIN(unit->in_len * 4, PDEC_MAX_OUT_SIZE);
+
+    ret = LZ4F_createDecompressionContext(&dctx, LZ4F_VERSION);
+    if (LZ4F_isError(ret)) {
+        unit->err = ENOMEM;
+        return;
+    }
+    unit->out = (uint8_t *)g_malloc(out_size);
+    do {
+        if (!pdec_out_reserve(unit, &out_size, 1))
+            break;
+        src_size = unit->in_len - in_pos;
+        dst_size = out_size - unit->out_len;
+        ret = LZ4F_decompress(dctx, unit->out + unit->out_len, &dst_size,
+                              unit->in + in_pos, &src_size, NULL);
+        if (LZ4F_isError(ret)) {
+            unit->err = WTAP_ERR_DECOMPRESS;
+            unit->err_info = LZ4F_getErrorName(ret);
+            break;
+        }
+        in_pos += src_size;
+        unit->out_len += dst_size;
+        if (ret != 0 && in_pos == unit->in_len && dst_size == 0) {
+            /* We walked the blocks, so this "can't happen". */
+            unit->err = WTAP_ERR_SHORT_READ;
+            break;
+        }
+    } while (ret != 0);
+    LZ4F_freeDecompressionContext(dctx);
+}
+#endif /* HAVE_LZ4FRAME_H */
+
+static void
+pdec_worker(void *data, void *user_data)
+{
+    struct pdec_unit *unit = (struct pdec_unit *)data;
+    struct pdec *pd = (struct pdec *)user_data;
+
+    switch (unit->compression) {
+
+#ifdef USE_ZLIB_OR_ZLIBNG
+    case ZLIB:
+        pdec_inflate(unit);
+        break;
+#endif /* USE_ZLIB_OR_ZLIBNG */
+
+#ifdef HAVE_ZSTD
+    case ZSTD:
+        pdec_zstd_decompress(unit);
+        break;
+#endif /* HAVE_ZSTD */
+
+#ifdef HAVE_LZ4FRAME_H
+    case LZ4:
+        pdec_lz4_decompress(unit);
+        break;
+#endif /* HAVE_LZ4FRAME_H */
+
+    default:
+        /* This "cannot happen" */
+        ws_assert_not_reached();
+        break;
+    }
+
+    g_mutex_lock(&pd->lock);
+    unit->done = true;
+    g_cond_broadcast(&pd->cond);
+    g_mutex_unlock(&pd->lock);
+}
+
+/*
+ * Discard whatever is being decompressed, and stop the threads.
+ */
+static void
+pdec_stop(FILE_T state)
+{
+    struct pdec *pd = state->pdec;
+    struct pdec_unit *unit;
+
+    if (pd == NULL)
+        return;
+
+    /* Don't start on any more units, and wait for the ones in progress. */
+    g_thread_pool_free(pd->pool, true, true);
+    while ((unit = (struct pdec_unit *)g_queue_pop_head(&pd->units)) != NULL)
+        pdec_unit_free(unit);
+    g_cond_clear(&pd->cond);
+    g_mutex_clear(&pd->lock);
+    g_free(pd);
+    state->pdec = NULL;
+}
+
+/*
+ * Is there decompressed data yet to be delivered?
+ */
+static bool
+pdec_pending(FILE_T state)
+{
+    return state->pdec != NULL && !g_queue_is_empty(&state->pdec->units);
+}
+
+/*
+ * Have we run out of input?
+ */
+static bool
+input_done(FILE_T state)
+{
+    return state->eof && state->in.avail == 0 && !pdec_pending(state);
+}
+
+/*
+ * Make sure the next n bytes of input are in the input buffer, at its
+ * start; returns false if we can't.
+ */
+static bool
+pdec_peek(FILE_T state, unsigned n)
+{
+    if (n > state->size)
+        return false;
+    if (state->in.next != state->in.buf) {
+        memmove(state->in.buf, state->in.next, state->in.avail);
+        state->in.next = state->in.buf;
+    }
+    while (state->in.avail < n) {
+        if (state->eof || fill_in_buffer(state) == -1)
+            return false;
+    }
+    return true;
+}
+
+/*
+ * Move the next n bytes of input to the end of the unit's compressed
+ * data; returns false if we can't.
+ */
+static bool
+pdec_gather(FILE_T state, struct pdec_unit *unit, size_t n)
+{
+    size_t m;
+
+    if (n > PDEC_MAX_UNIT_SIZE - unit->in_len)
+        return false;
+    if (unit->in_size < unit->in_len + n) {
+        unit->in_size = MAX(unit->in_size * 2, unit->in_len + n);
+        unit->in = (uint8_t *)g_realloc(unit->in, unit->in_size);
+    }
+    while (n != 0) {
+        if (state->in.avail == 0) {
+            if (state->eof)
+                return false;
+            buf_reset(&state->in);
+            if (fill_in_buffer(state) == -1)
+                return false;
+            continue;
+        }
+        m = MIN(n, state->in.avail);
+        memcpy(unit->in + unit->in_len, state->in.next, m);
+        state->in.next += m;
+        state->in.avail -= (unsigned)m;
+        unit->in_len += m;
+        n -= m;
+    }
+    return true;
+}
+
+#ifdef USE_ZLIB_OR_ZLIBNG
+/*
+ * If the gzip member at the start of the input buffer says how long it
+ * is, read it in.
+ */
+static int
+pdec_gather_gzip(FILE_T state, struct pdec_unit *unit)
+{
+    const uint8_t *p;
+    uint8_t flags;
+    unsigned xlen, off, slen;
+    uint32_t member_len = 0;
+    unsigned hdr_len;
+
+    /* ID1, ID2, CM, FLG, MTIME, XFL, OS, and XLEN */
+    if (!pdec_peek(state, 12))
+        return 0;
+    p = state->in.next;
+    flags = p[3];
+    if (p[2] != 8 || (flags & 0xe0) || !(flags & 4))
+        return 0;
+    xlen = pletoh16(p + 10);
+    hdr_len = 12 + xlen;
+    if (!pdec_peek(state, hdr_len))
+        return 0;
+    p = state->in.next;
+    for (off = 12; off + 4 <= hdr_len; off += 4 + slen) {
+        slen = pletoh16(p + off + 2);
+        if (p[off] == GZ_CHUNK_SI1 && p[off + 1] == GZ_CHUNK_SI2 && slen == 4 &&
+            off + 8 <= hdr_len)
+            member_len = pletoh32(p + off + 4);
+        else if (p[off] == 'B' && p[off + 1] == 'C' && slen == 2 &&
+                 off + 6 <= hdr_len)
+            member_len = pletoh16(p + off + 4) + 1;    /* BGZF BSIZE */
+    }
+    if (member_len == 0 || member_len > PDEC_MAX_UNIT_SIZE)
+        return 0;
+
+    /* Skip any file name, comment, and header CRC. */
+    if (flags & (8|16|2)) {
+        if (!pdec_peek(state, MIN(member_len, state->size)))
+            return 0;
+        p = state->in.next;
+        for (unsigned flag = 8; flag <= 16; flag <<= 1) {
+            if (flags & flag) {
+                const uint8_t *nul = (const uint8_t *)memchr(p + hdr_len, '\0', state->in.avail - hdr_len);
+
+                if (nul == NULL)
+                    return 0;
+                hdr_len = (unsigned)(nul - p) + 1;
+            }
+        }
+        if (flags & 2)
+            hdr_len += 2;
+    }
+    if (member_len < hdr_len + 8)
+        return 0;
+
+    unit->compression = ZLIB;
+    unit->hdr_len = hdr_len;
+    unit->check_crc = !state->dont_check_crc;
+    if (!pdec_gather(state, unit, member_len))
+        return -1;
+    if (pletoh32(unit->in + unit->in_len - 4) > PDEC_MAX_OUT_SIZE)
+        return -1;
+    return 1;
+}
+#endif /* USE_ZLIB_OR_ZLIBNG */
+
+#ifdef HAVE_ZSTD
+/*
+ * Read in the zstd frame at the start of the input buffer, walking its
+ * blocks to find its end.
+ */
+static int
+pdec_gather_zstd(FILE_T state, struct pdec_unit *unit)
+{
+    static const unsigned did_sizes[4] = { 0, 1, 2, 4 };
+    static const unsigned fcs_sizes[4] = { 0, 2, 4, 8 };
+    const uint8_t *p;
+    uint8_t fhd;
+    unsigned hdr_len, fcs_size;
+    uint64_t fcs = 0;
+    uint32_t bh, block_size;
+
+    /* Magic_Number and Frame_Header_Descriptor */
+    if (!pdec_peek(state, 5))
+        return 0;
+    fhd = state->in.next[4];
+    if (fhd & 0x08)                     /* reserved bit */
+        return 0;
+    fcs_size = fcs_sizes[fhd >> 6];
+    if (fcs_size == 0 && (fhd & 0x20))  /* Single_Segment_flag */
+        fcs_size = 1;
+    hdr_len = 5 + ((fhd & 0x20) ? 0 : 1) + did_sizes[fhd & 3] + fcs_size;
+    if (!pdec_peek(state, hdr_len))
+        return 0;
+
+    /* Don't try to hold huge frames in memory. */
+    p = state->in.next + hdr_len - fcs_size;
+    for (unsigned i = fcs_size; i != 0; i--)
+        fcs = (fcs << 8) | p[i - 1];
+    if (fcs_size == 2)
+        fcs += 256;
+    if (fcs > PDEC_MAX_OUT_SIZE)
+        return 0;
+
+    unit->compression = ZSTD;
+    if (!pdec_gather(state, unit, hdr_len))
+        return -1;
+    do {
+        /* Block_Header: Last_Block, Block_Type, Block_Size */
+        if (!pdec_gather(state, unit, 3))
+            return -1;
+        p = unit->in + unit->in_len - 3;
+        bh = p[0] | (p[1] << 8) | ((uint32_t)p[2] << 16);
+        switch ((bh >> 1) & 3) {
+
+        case 1:     /* RLE_Block: a single byte, repeated */
+            block_size = 1;
+            break;
+
+        case 3:     /* Reserved */
+            return -1;
+
+        default:
+            block_size = bh >> 3;
+            break;
+        }
+        if (!pdec_gather(state, unit, block_size))
+            return -1;
+    } while (!(bh & 1));
+    if ((fhd & 0x04) && !pdec_gather(state, unit, 4))   /* Content_Checksum */
+        return -1;
+    return 1;
+}
+#endif /* HAVE_ZSTD */
+
+#ifdef HAVE_LZ4FRAME_H
+/*
+ * Read in the lz4 frame at the start of the input buffer, walking its
+ * blocks to find its end.
+ */
+static int
+pdec_gather_lz4(FILE_T state, struct pdec_unit *unit)
+{
+    uint8_t flg;
+    unsigned hdr_len;
+    uint32_t block_size;
+
+    /* Magic Number, FLG, BD, and (if present) Content Size */
+    if (!pdec_peek(state, 7))
+        return 0;
+    flg = state->in.next[4];
+    if ((flg & 0xc0) != 0x40 || (flg & 0x01))  /* version 01, no Dictionary ID */
+        return 0;
+    hdr_len = 7 + ((flg & 0x08) ? 8 : 0);
+    if ((flg & 0x08) && (!pdec_peek(state, hdr_len) ||
+                         pletoh64(state->in.next + 6) > PDEC_MAX_OUT_SIZE))
+        return 0;
+
+    unit->compression = LZ4;
+    unit->hdr_len = hdr_len;
+    if (!pdec_gather(state, unit, hdr_len))
+        return -1;
+    for (;;) {
+        if (!pdec_gather(state, unit, LZ4F_BLOCK_HEADER_SIZE))
+            return -1;
+        block_size = pletoh32(unit->in + unit->in_len - LZ4F_BLOCK_HEADER_SIZE);
+        if (block_size == 0)            /* EndMark */
+            break;
+        block_size &= 0x7fffffff;       /* uncompressed block flag */
+        if (flg & 0x10)                 /* Block Checksum */
+            block_size += 4;
+        if (!pdec_gather(state, unit, block_size))
+            return -1;
+    }
+    if ((flg & 0x04) && !pdec_gather(state, unit, 4))   /* Content Checksum */
+        return -1;
+    return 1;
+}
+#endif /* HAVE_LZ4FRAME_H */
+
+/*
+ * Go back to in_pos, the start of a unit, so that the usual code reads
+ * it and whatever follows it, and don't bother decompressing in parallel
+ * again with this file.
+ */
+static void
+pdec_fall_back(FILE_T state, int64_t in_pos)
+{
+    state->pdec_threads = 0;
+    if (readahead_stop(state) == 0) {
+        if (ws_lseek64(state->fd, in_pos, SEEK_SET) == -1) {
+            state->err = errno;
+            state->err_info = NULL;
+        } else {
+            state->raw_pos = in_pos;
+            buf_reset(&state->in);
+            state->eof = false;
+        }
+    }
+}
+
+/*
+ * If what's next in the file is something we can decompress on its own,
+ * read it in and return it; otherwise, return NULL, leaving the input
+ * where it was.
+ */
+static struct pdec_unit *
+pdec_next_unit(FILE_T state)
+{
+    struct pdec_unit *unit;
+    const uint8_t *p;
+    int ret = 0;
+
+    if (state->err != 0 || !pdec_peek(state, 4))
+        return NULL;
+
+    unit = g_new0(struct pdec_unit, 1);
+    unit->in_pos = state->raw_pos - state->in.avail;
+    p = state->in.next;
+#ifdef USE_ZLIB_OR_ZLIBNG
+    if (p[0] == 31 && p[1] == 139)
+        ret = pdec_gather_gzip(state, unit);
+#endif /* USE_ZLIB_OR_ZLIBNG */
+#ifdef HAVE_ZSTD
+    if (p[0] == 0x28 && p[1] == 0xb5 && p[2] == 0x2f && p[3] == 0xfd)
+        ret = pdec_gather_zstd(state, unit);
+#endif /* HAVE_ZSTD */
+#ifdef HAVE_LZ4FRAME_H
+    if (p[0] == 0x04 && p[1] == 0x22 && p[2] == 0x4d && p[3] == 0x18)
+        ret = pdec_gather_lz4(state, unit);
+#endif /* HAVE_LZ4FRAME_H */
+
+    if (ret == -1) {
+        /*
+         * We started reading it in, but it's too big, or truncated,
+         * or we got an error; leave it to the usual code, which will
+         * also report any problem.
+         */
+        pdec_fall_back(state, unit->in_pos);
+    }
+    if (ret != 1) {
+        pdec_unit_free(unit);
+        return NULL;
+    }
+    return unit;
+}
+
+/*
+ * Deliver the next piece of data decompressed in parallel.  Returns 1
+ * if we did, 0 if there's nothing to deliver and the caller should
+ * decompress what's next itself, and -1 on an error.
+ */
+static int
+pdec_fill_out_buffer(FILE_T state)
+{
+    struct pdec *pd = state->pdec;
+    struct pdec_unit *unit;
+    unsigned n;
+
+    if (pd == NULL) {
+        if (state->pdec_threads == 0)
+            return 0;
+        pd = g_new0(struct pdec, 1);
+        g_mutex_init(&pd->lock);
+        g_cond_init(&pd->cond);
+        g_queue_init(&pd->units);
+        pd->max_units = state->pdec_threads * 2;
+        pd->pool = g_thread_pool_new(pdec_worker, pd, state->pdec_threads, false, NULL);
+        state->pdec = pd;
+    }
+
+    /* Keep the threads busy. */
+    while (state->pdec_threads != 0 && g_queue_get_length(&pd->units) < pd->max_units) {
+        unit = pdec_next_unit(state);
+        if (unit == NULL)
+            break;
+        g_queue_push_tail(&pd->units, unit);
+        g_thread_pool_push(pd->pool, unit, NULL);
+    }
 
-        ret = compression_type_tests[i](state);
-        if (ret == -1)
-            return -1;    /* error */
-        if (ret == 1)
-            return 0;     /* found it */
+    unit = (struct pdec_unit *)g_queue_peek_head(&pd->units);
+    if (unit == NULL)
+        return 0;
+
+    g_mutex_lock(&pd->lock);
+    while (!unit->done)
+        g_cond_wait(&pd->cond, &pd->lock);
+    g_mutex_unlock(&pd->lock);
+
+    if (unit->too_big) {
+        /*
+         * It decompresses to more than we'll hold in memory; throw
+         * away what's in flight, including it, and decompress from
+         * its start on this thread.
+         */
+        int64_t in_pos = unit->in_pos;
+
+        pdec_stop(state);
+        pdec_fall_back(state, in_pos);
+        return state->err != 0 ? -1 : 0;
     }
 
-    /*
-     * Some other compressed file formats we might want to support:
-     *
-     *   XZ format:
-     *     https://tukaani.org/xz/
-     *     https://github.com/tukaani-project/xz
-     *     https://github.com/tukaani-project/xz/blob/master/doc/xz-file-format.txt
-     *
-     *    Bzip2 format:
-     *      https://www.sourceware.org/bzip2/
-     *      https://gitlab.com/bzip2/bzip2/
-     *      https://github.com/dsnet/compress/blob/master/doc/bzip2-format.pdf
-     *        (GitHub won't render it; download and open it)
-     *
-     *    Lzip format:
-     *      https://www.nongnu.org/lzip/
-     */
+    if (unit->next == 0) {
+        /*
+         * Starting a new stream; note what it is, and where, so
+         * that random access can get to it quickly.
+         */
+        state->is_compressed = true;
+        state->last_compression = unit->compression;
+        switch (unit->compression) {
 
-    /*
-     * We didn't see anything that looks like a header for any type of
-     * compressed file that we support, so just do uncompressed I/O.
-     *
-     * XXX - This fast seek data is for the case where a compressed stream
-     * ends and is followed by an uncompressed portion.  It only works if
-     * the uncompressed portion is at the end, as we don't constantly scan
-     * for magic bytes in the middle of uncompressed data. (Concatenated
-     * compressed streams _do_ work, even streams of different compression types.)
-     */
-    if (state->fast_seek)
-        fast_seek_header(state, state->raw_pos - state->in.avail, state->pos, UNCOMPRESSED);
+        case ZLIB:
+            fast_seek_header(state, unit->in_pos + unit->hdr_len, state->pos, GZIP_AFTER_HEADER);
+            break;
 
+#ifdef HAVE_LZ4FRAME_H
+        case LZ4: {
+            size_t hdr_size = unit->hdr_len;
 
-    /* doing raw i/o, save start of raw data for seeking, copy any leftover
-       input to output -- this assumes that the output buffer is larger than
-       the input buffer, which also assures space for gzungetc() */
-    state->raw = state->pos;
-    state->out.next = state->out.buf;
-    /* not a compressed file -- copy everything we've read into the
-       input buffer to the output buffer and fall to raw i/o */
-    if (state->in.avail) {
-        memcpy(state->out.buf, state->in.next, state->in.avail);
-        state->out.avail = state->in.avail;
+            LZ4F_resetDecompressionContext(state->lz4_dctx);
+            memcpy(state->lz4_hdr, unit->in, MIN(unit->hdr_len, LZ4F_HEADER_SIZE_MAX));
+            LZ4F_getFrameInfo(state->lz4_dctx, &state->lz4_info, unit->in, &hdr_size);
+            fast_seek_header(state, unit->in_pos + unit->hdr_len, state->pos, LZ4);
+            break;
+        }
+#endif /* HAVE_LZ4FRAME_H */
 
-        /* Now discard everything in the input buffer */
-        buf_reset(&state->in);
+        default:
+            fast_seek_header(state, unit->in_pos, state->pos, unit->compression);
+            break;
+        }
     }
-    state->compression = UNCOMPRESSED;
-    return 0;
+
+    /* Hand out what we can fit in the output buffer. */
+    n = (unsigned)MIN(unit->out_len - unit->next, (size_t)state->size << 1);
+    memcpy(state->out.buf, unit->out + unit->next, n);
+    state->out.next = state->out.buf;
+    state->out.avail = n;
+    unit->next += n;
+    if (unit->next == unit->out_len) {
+        g_queue_pop_head(&pd->units);
+        if (unit->err != 0) {
+            /* Report the error once we've delivered what we got. */
+            state->err = unit->err;
+            state->err_info = unit->err_info;
+        }
+        pdec_unit_free(unit);
+    }
+    if (state->out.avail == 0 && state->err != 0)
+        return -1;
+    return 1;
 }
 
 /*
@@ -1512,12 +2778,32 @@ static int
 fill_out_buffer(FILE_T state)
 {
     if (state->compression == UNKNOWN) {
+        /*
+         * If we're decompressing in parallel, deliver what's been
+         * decompressed; if there isn't anything, carry on as usual.
+         */
+        if (state->pdec_threads != 0 || state->pdec != NULL) {
+            int ret = pdec_fill_out_buffer(state);
+
+            if (ret != 0)
+                return ret == -1 ? -1 : 0;
+        }
+
         /*
          * We don't yet know whether the file is compressed,
          * so check for a compressed-file header.
          */
         if (check_for_compression(state) == -1)
             return -1;
+#ifdef HAVE_MMAP
+        /* An uncompressed file we can map; read from the mapping. */
+        if (state->map_wanted && state->compression == UNCOMPRESSED)
+            map_open(state);
+        if (MAP_USABLE(state) && state->pos < state->map_len) {
+            map_enter(state);
+            return 0;
+        }
+#endif /* HAVE_MMAP */
         if (state->out.avail != 0)                /* got some data from check_for_compression() */
             return 0;
     }
@@ -1571,6 +2857,20 @@ gz_skip(FILE_T state, int64_t len)
 
     /* skip over len bytes or reach end-of-file, whichever comes first */
     while (len)
+#ifdef HAVE_MMAP
+        if (state->mapped) {
+            /* Skip within the mapping, and read past its end. */
+            MAP_CHECK(state);
+            if (state->pos < state->map_len) {
+                int64_t skip = state->map_len - state->pos < len ?
+                    state->map_len - state->pos : len;
+                state->pos += skip;
+                state->raw_pos = state->pos;
+                len -= skip;
+            } else if (map_leave(state) == -1)
+                return -1;
+        } else
+#endif /* HAVE_MMAP */
         if (state->out.avail != 0) {
             /* We have stuff in the output buffer; skip over
                it. */
@@ -1586,7 +2886,7 @@ gz_skip(FILE_T state, int64_t len)
                any more data into the output buffer, so
                return an error indication. */
             return -1;
-        } else if (state->eof && state->in.avail == 0) {
+        } else if (input_done(state)) {
             /* We have nothing in the output buffer, and
                we're at the end of the input; just return. */
             break;
@@ -1828,6 +3128,16 @@ file_open(const char *path)
         return NULL;
     }
 
+#ifdef HAVE_MMAP
+    /*
+     * If this file turns out not to be compressed, map it, so that we
+     * can read it without copying it, unless we've been told not to or
+     * it's not on a local file system.
+     */
+    ft->map_wanted = g_getenv("WIRESHARK_NO_MMAP") == NULL &&
+        map_fs_is_local(fd);
+#endif /* HAVE_MMAP */
+
 #ifdef USE_ZLIB_OR_ZLIBNG
     /*
      * If this file's name ends in ".caz", it's probably a compressed
@@ -1872,6 +3182,33 @@ file_seek(FILE_T file, int64_t offset, int whence, int *err)
 */
     }
 
+#ifdef HAVE_MMAP
+    if (MAP_USABLE(file)) {
+        /*
+         * Seeking anywhere within the mapping is just a matter of
+         * setting the position; anywhere else, we go back to reading
+         * from the file descriptor and seek the usual way.
+         */
+        if (whence != SEEK_END) {
+            int64_t target = (whence == SEEK_SET) ? offset : file_tell(file) + offset;
+
+            if (target >= 0 && target <= file->map_len) {
+                file->seek_pending = false;
+                file->pos = target;
+                if (file->mapped)
+                    file->raw_pos = target;
+                else
+                    map_enter(file);
+                return target;
+            }
+        }
+        if (file->mapped && map_leave(file) == -1) {
+            *err = file->err;
+            return -1;
+        }
+    }
+#endif /* HAVE_MMAP */
+
     /* Normalize offset to a SEEK_CUR specification */
     if (whence == SEEK_END) {
         /* Seek relative to the end of the file; given that we might be
@@ -2026,6 +3363,11 @@ file_seek(FILE_T file, int64_t offset, int whence, int *err)
             break;
         }
 
+        pdec_stop(file);
+        if (readahead_stop(file) == -1) {
+            *err = file->err;
+            return -1;
+        }
         if (ws_lseek64(file->fd, off, SEEK_SET) == -1) {
             *err = errno;
             return -1;
@@ -2155,6 +3497,11 @@ file_seek(FILE_T file, int64_t offset, int whence, int *err)
         /*
          * Yes.  Just seek there within the file.
          */
+        pdec_stop(file);
+        if (readahead_stop(file) == -1) {
+            *err = file->err;
+            return -1;
+        }
         if (ws_lseek64(file->fd, offset - file->out.avail, SEEK_CUR) == -1) {
             *err = errno;
             return -1;
@@ -2189,6 +3536,11 @@ file_seek(FILE_T file, int64_t offset, int whence, int *err)
         /* rewind, then skip to offset */
 
         /* back up and start over */
+        pdec_stop(file);
+        if (readahead_stop(file) == -1) {
+            *err = file->err;
+            return -1;
+        }
         if (ws_lseek64(file->fd, file->start, SEEK_SET) == -1) {
             *err = errno;
             return -1;
@@ -2306,6 +3658,14 @@ file_read(void *buf, unsigned int len, FILE_T file)
      */
     got = 0;
     do {
+#ifdef HAVE_MMAP
+        if (file->mapped) {
+            /* We're reading from the mapping; that gets the rest. */
+            int ret = map_read(buf, len, file);
+
+            return ret == -1 ? -1 : (int)got + ret;
+        }
+#endif /* HAVE_MMAP */
         if (file->out.avail != 0) {
             /* We have stuff in the output buffer; copy
                what we have. */
@@ -2326,7 +3686,7 @@ file_read(void *buf, unsigned int len, FILE_T file)
                any more data into the output buffer, so
                return an error indication. */
             return -1;
-        } else if (file->eof && file->in.avail == 0) {
+        } else if (input_done(file)) {
             /* We have nothing in the output buffer, and
                we're at the end of the input; just return
                with what we've gotten so far. */
@@ -2345,6 +3705,117 @@ file_read(void *buf, unsigned int len, FILE_T file)
     return (int)got;
 }
 
+/*
+ * If we're reading the file from its memory mapping, and the next len
+ * bytes are all within the mapping, return a pointer to them and skip
+ * over them; otherwise, return NULL without reading anything, and the
+ * caller should use file_read().
+ *
+ * The data remains valid until the file is closed; the mapping is
+ * read-only, so the caller must copy the data if it's to modify it.
+ */
+#ifdef HAVE_MMAP
+uint8_t *
+file_read_mapped(unsigned int len, FILE_T file)
+{
+    uint8_t *data;
+
+    if (!file->mapped)
+        return NULL;
+
+    /* process a skip request */
+    if (file->seek_pending) {
+        file->seek_pending = false;
+        if (gz_skip(file, file->skip) == -1 || !file->mapped)
+            return NULL;
+    }
+
+    MAP_CHECK(file);
+    if (file->pos > file->map_len || len > file->map_len - file->pos)
+        return NULL;
+    data = file->map + file->pos;
+    file->pos += len;
+    file->raw_pos = file->pos;
+    return data;
+}
+#else /* HAVE_MMAP */
+uint8_t *
+file_read_mapped(unsigned int len _U_, FILE_T file _U_)
+{
+    return NULL;
+}
+#endif /* HAVE_MMAP */
+
+/*
+ * If the file is uncompressed and memory-mapped, return a pointer to
+ * the mapping and set *len to its length, so that the whole file can
+ * be scanned without reading it; otherwise, return NULL.
+ *
+ * This doesn't change the file's state, so the mapping may be read
+ * by several threads at once; it remains valid until the file is
+ * closed.
+ */
+#ifdef HAVE_MMAP
+const uint8_t *
+file_get_mapping(FILE_T file, int64_t *len)
+{
+    if (!MAP_USABLE(file))
+        return NULL;
+    *len = file->map_len;
+    return file->map;
+}
+#else /* HAVE_MMAP */
+const uint8_t *
+file_get_mapping(FILE_T file _U_, int64_t *len _U_)
+{
+    return NULL;
+}
+#endif /* HAVE_MMAP */
+
+/*
+ * Read up to window bytes ahead of the reader in a background thread,
+ * if this is a regular file; 0 turns readahead off.
+ */
+void
+file_set_readahead(FILE_T file, size_t window)
+{
+    ws_statb64 statb;
+
+    readahead_stop(file);
+    file->ra_chunks = 0;
+    if (window == 0 || ws_fstat64(file->fd, &statb) == -1 ||
+        !S_ISREG(statb.st_mode))
+        return;
+    file->ra_chunks = (unsigned)MIN(MAX(window / READAHEAD_CHUNK_SIZE, 2), 1024);
+}
+
+/*
+ * Return the number of microseconds we've spent waiting for data from
+ * the file, either in reads or waiting for the readahead thread.
+ */
+int64_t
+file_get_io_wait(FILE_T file)
+{
+    return file->io_wait;
+}
+
+/*
+ * Decompress with up to threads threads, if this is a regular file;
+ * 0 or 1 means decompress on the calling thread.
+ */
+void
+file_set_decompress_threads(FILE_T file, unsigned threads)
+{
+    ws_statb64 statb;
+
+    /* Anything already in flight still gets delivered. */
+    file->pdec_threads = 0;
+    if (threads < 2 || ws_fstat64(file->fd, &statb) == -1 ||
+        !S_ISREG(statb.st_mode))
+        return;
+    file->pdec_threads = MIN(threads, PDEC_MAX_THREADS);
+}
+
 /*
  * XXX - this *peeks* at next byte, not a character.
  */
@@ -2375,13 +3846,22 @@ file_peekc(FILE_T file)
      * file_read() but only for peeking not consuming a byte
      */
     while (1) {
+#ifdef HAVE_MMAP
+        if (file->mapped) {
+            MAP_CHECK(file);
+            if (file->pos < file->map_len)
+                return file->map[file->pos];
+            if (map_leave(file) == -1)
+                return -1;
+        }
+#endif /* HAVE_MMAP */
         if (file->out.avail != 0) {
             return *(file->out.next);
         }
         else if (file->err != 0) {
             return -1;
         }
-        else if (file->eof && file->in.avail == 0) {
+        else if (input_done(file)) {
             return -1;
         }
         else if (fill_out_buffer(file) == -1) {
@@ -2448,6 +3928,32 @@ file_getsp(char *buf, int len, FILE_T file)
     curp = buf;
     left = (unsigned)len - 1;
     if (left) do {
+#ifdef HAVE_MMAP
+            if (file->mapped) {
+                MAP_CHECK(file);
+                if (file->pos >= file->map_len) {
+                    /* past the end of the mapping */
+                    if (map_leave(file) == -1)
+                        return NULL;
+                    eol = NULL;
+                    continue;
+                }
+
+                /* look for end-of-line in the mapping */
+                n = (file->map_len - file->pos) < left ?
+                    (unsigned)(file->map_len - file->pos) : left;
+                eol = (unsigned char *)memchr(file->map + file->pos, '\n', n);
+                if (eol != NULL)
+                    n = (unsigned)(eol - (file->map + file->pos)) + 1;
+
+                memcpy(curp, file->map + file->pos, n);
+                file->pos += n;
+                file->raw_pos = file->pos;
+                left -= n;
+                curp += n;
+                continue;
+            }
+#endif /* HAVE_MMAP */
             /* assure that something is in the output buffer */
             if (file->out.avail == 0) {
                 /* We have nothing in the output buffer. */
@@ -2461,6 +3967,12 @@ file_getsp(char *buf, int len, FILE_T file)
                 }
                 if (fill_out_buffer(file) == -1)
                     return NULL;            /* error */
+#ifdef HAVE_MMAP
+                if (file->mapped) {         /* switched to the mapping */
+                    eol = NULL;
+                    continue;
+                }
+#endif /* HAVE_MMAP */
                 if (file->out.avail == 0)  {     /* end of file */
                     if (curp == buf)        /* got bupkus */
                         return NULL;
@@ -2504,7 +4016,7 @@ int
 file_eof(FILE_T file)
 {
     /* return end-of-file state */
-    return (file->eof && file->in.avail == 0 && file->out.avail == 0);
+    return (input_done(file) && file->out.avail == 0);
 }
 
 /*
@@ -2534,6 +4046,8 @@ file_clearerr(FILE_T stream)
 void
 file_fdclose(FILE_T file)
 {
+    pdec_stop(file);
+    readahead_stop(file);
     if (file->fd != -1)
         ws_close(file->fd);
     file->fd = -1;
@@ -2547,6 +4061,27 @@ file_fdreopen(FILE_T file, const char *path)
     if ((fd = ws_open(path, O_RDONLY|O_BINARY, 0000)) == -1)
         return false;
     file->fd = fd;
+#ifdef HAVE_MMAP
+    /*
+     * The mapping is of the file we had open before, which might
+     * not have the same contents; stop using it.  Buffers filled by
+     * earlier reads might still point into it, so keep it until the
+     * file is closed.
+     */
+    if (file->map != NULL) {
+        struct file_map *old_map;
+
+        if (file->mapped && map_leave(file) == -1)
+            return false;
+        old_map = g_new(struct file_map, 1);
+        old_map->map = file->map;
+        old_map->map_size = file->map_size;
+        file->old_maps = g_slist_prepend(file->old_maps, old_map);
+        file->map = NULL;
+        file->map_size = 0;
+        file->map_len = 0;
+    }
+#endif /* HAVE_MMAP */
     return true;
 }
 
@@ -2555,6 +4090,9 @@ file_close(FILE_T file)
 {
     int fd = file->fd;
 
+    pdec_stop(file);
+    readahead_stop(file);
+
     /* free memory and close file */
     if (file->size) {
 #ifdef USE_ZLIB_OR_ZLIBNG
@@ -2570,6 +4108,16 @@ file_close(FILE_T file)
         g_free(file->in.buf);
     }
     g_free(file->fast_seek_cur);
+#ifdef HAVE_MMAP
+    if (file->map != NULL)
+        map_close(file->map, file->map_size);
+    for (GSList *l = file->old_maps; l != NULL; l = l->next) {
+        struct file_map *old_map = (struct file_map *)l->data;
+
+        map_close(old_map->map, old_map->map_size);
+    }
+    g_slist_free_full(file->old_maps, g_free);
+#endif /* HAVE_MMAP */
     file->err = 0;
     file->err_info = NULL;
     g_free(file);
@@ -2598,6 +4146,12 @@ struct wtap_writer {
     const char *err_info;   /* additional error information string for some errors */
     /* zlib deflate stream */
     zlib_stream strm;          /* stream structure in-place (not a pointer) */
+    /* chunked output */
+    size_t chunk_size;      /* uncompressed bytes per member, or 0 for one member */
+    int64_t member_start;   /* uncompressed offset at which the current member started */
+    GByteArray *member;     /* the current member, until we know its length */
+    zlib_gz_header header;  /* gzip header for the current member */
+    unsigned char extra[GZ_CHUNK_XLEN]; /* its extra field */
 };
 
 GZWFILE_T
@@ -2641,10 +4195,32 @@ gzwfile_fdopen(int fd)
     state->pos = 0;                 /* no uncompressed data yet */
     state->strm.avail_in = 0;       /* no input data yet */
 
+    state->chunk_size = compression_chunk_size;
+    state->member_start = 0;
+    state->member = NULL;
+
     /* return stream */
     return state;
 }
 
+/* Set up the header for a new member.  Its extra field says how long the
+   member is, which we fill in when we've finished it. */
+static void
+gz_member_begin(GZWFILE_T state)
+{
+    memset(&state->header, 0, sizeof state->header);
+    state->extra[0] = GZ_CHUNK_SI1;
+    state->extra[1] = GZ_CHUNK_SI2;
+    state->extra[2] = 4;            /* LEN */
+    state->extra[3] = 0;
+    phtole32(&state->extra[4], 0);
+    state->header.extra = state->extra;
+    state->header.extra_len = GZ_CHUNK_XLEN;
+    state->header.os = 255;         /* unknown */
+    (void)ZLIB_PREFIX(deflateSetHeader)(&state->strm, &state->header);
+    state->member_start = state->pos;
+}
+
 /* Initialize state for writing a gzip file.  Mark initialization by setting
    state->size to non-zero.  Return -1, and set state->err and possibly
    state->err_info, on failure; return 0 on success. */
@@ -2695,6 +4271,36 @@ gz_init(GZWFILE_T state)
     strm->avail_out = state->size;
     strm->next_out = state->out;
     state->next = strm->next_out;
+
+    /* if writing in chunks, hold on to each member until it's done */
+    if (state->chunk_size != 0) {
+        state->member = g_byte_array_new();
+        gz_member_begin(state);
+    }
+    return 0;
+}
+
+/* Write len bytes of compressed data, or, if writing in chunks, add them
+   to the current member.  Return -1, and set state->err, on failure;
+   return 0 on success. */
+static int
+gz_write_out(GZWFILE_T state, const unsigned char *buf, size_t len)
+{
+    ssize_t got;
+
+    if (state->member != NULL) {
+        g_byte_array_append(state->member, buf, (unsigned)len);
+        return 0;
+    }
+    got = ws_write(state->fd, buf, (unsigned int)len);
+    if (got < 0) {
+        state->err = errno;
+        return -1;
+    }
+    if ((size_t)got != len) {
+        state->err = WTAP_ERR_SHORT_WRITE;
+        return -1;
+    }
     return 0;
 }
 
@@ -2707,7 +4313,6 @@ static int
 gz_comp(GZWFILE_T state, int flush)
 {
     int ret;
-    ssize_t got;
     ptrdiff_t have;
 #ifdef HAVE_ZLIBNG
     zng_streamp strm = &(state->strm);
@@ -2726,17 +4331,8 @@ gz_comp(GZWFILE_T state, int flush)
         if (strm->avail_out == 0 || (flush != Z_NO_FLUSH &&
                                      (flush != Z_FINISH || ret == Z_STREAM_END))) {
             have = strm->next_out - state->next;
-            if (have) {
-                got = ws_write(state->fd, state->next, (unsigned int)have);
-                if (got < 0) {
-                    state->err = errno;
-                    return -1;
-                }
-                if ((ptrdiff_t)got != have) {
-                    state->err = WTAP_ERR_SHORT_WRITE;
-                    return -1;
-                }
-            }
+            if (have && gz_write_out(state, state->next, (size_t)have) == -1)
+                return -1;
             if (strm->avail_out == 0) {
                 strm->avail_out = state->size;
                 strm->next_out = state->out;
@@ -2764,6 +4360,35 @@ gz_comp(GZWFILE_T state, int flush)
     return 0;
 }
 
+/* Finish the current member, fill in its length, write it out, and start
+   another.  Return -1, and set state->err, on failure; return 0 on
+   success. */
+static int
+gz_member_finish(GZWFILE_T state)
+{
+    GByteArray *member = state->member;
+    ssize_t got;
+
+    if (gz_comp(state, Z_FINISH) == -1)
+        return -1;
+
+    /* The length goes after the fixed header, XLEN, SI1, SI2, and LEN. */
+    ws_assert(member->len >= 20);
+    phtole32(member->data + 16, member->len);
+    got = ws_write(state->fd, member->data, member->len);
+    if (got < 0) {
+        state->err = errno;
+        return -1;
+    }
+    if ((unsigned)got != member->len) {
+        state->err = WTAP_ERR_SHORT_WRITE;
+        return -1;
+    }
+    g_byte_array_set_size(member, 0);
+    gz_member_begin(state);
+    return 0;
+}
+
 /* Write out len bytes from buf.  Return 0, and set state->err, on
    failure or on an attempt to write 0 bytes (in which case state->err
    is Z_OK); return the number of bytes written on success. */
@@ -2835,6 +4460,12 @@ DIAG_ON(cast-qual)
             return 0;
     }
 
+    /* if writing in chunks, start a new member once this one's big enough */
+    if (state->member != NULL &&
+        state->pos - state->member_start >= (int64_t)state->chunk_size &&
+        gz_member_finish(state) == -1)
+        return 0;
+
     /* input was all buffered or compressed (put will fit in int) */
     return (int)put;
 }
@@ -2848,6 +4479,15 @@ gzwfile_flush(GZWFILE_T state)
     if (state->err != Z_OK)
         return -1;
 
+    /* if writing in chunks, finish the member, so that all of it can be
+       read */
+    if (state->chunk_size != 0) {
+        if (state->member != NULL && state->pos != state->member_start &&
+            gz_member_finish(state) == -1)
+            return -1;
+        return 0;
+    }
+
     /* compress remaining data with Z_SYNC_FLUSH */
     gz_comp(state, Z_SYNC_FLUSH);
     if (state->err != Z_OK)
@@ -2863,9 +4503,15 @@ gzwfile_close(GZWFILE_T state)
     int ret = 0;
 
     /* flush, free memory, and close file */
-    if (gz_comp(state, Z_FINISH) == -1)
+    if (state->chunk_size != 0) {
+        if ((state->size == 0 && gz_init(state) == -1) ||
+            gz_member_finish(state) == -1)
+            ret = state->err;
+    } else if (gz_comp(state, Z_FINISH) == -1)
         ret = state->err;
     (void)ZLIB_PREFIX(deflateEnd)(&(state->strm));
+    if (state->member != NULL)
+        g_byte_array_free(state->member, true);
     g_free(state->out);
     g_free(state->in);
     state->err = Z_OK;
@@ -2896,6 +4542,8 @@ struct lz4_writer {
     const char *err_info;   /* additional error information string for some errors */
     LZ4F_preferences_t lz4_prefs;
     LZ4F_cctx *lz4_cctx;
+    size_t chunk_size;      /* uncompressed bytes per frame, or 0 for one frame */
+    int64_t frame_start;    /* uncompressed offset at which the current frame started */
 };
 
 LZ4WFILE_T
@@ -2961,6 +4609,8 @@ lz4wfile_fdopen(int fd)
     state->err_info = NULL;         /* clear additional error information */
     state->pos = 0;                 /* no uncompressed data yet */
     state->pos_out = 0;
+    state->chunk_size = compression_chunk_size;
+    state->frame_start = 0;
 
     /* return stream */
     return state;
@@ -3028,6 +4678,34 @@ lz4_init(LZ4WFILE_T state)
     return 0;
 }
 
+/* End the current frame and start another, so that the frames can be
+   decompressed independently.  Return -1, and set state->err and
+   possibly state->err_info, on failure; return 0 on success. */
+static int
+lz4_frame_restart(LZ4WFILE_T state)
+{
+    size_t ret;
+
+    ret = LZ4F_compressEnd(state->lz4_cctx, state->out, state->size_out, NULL);
+    if (LZ4F_isError(ret)) {
+        state->err = WTAP_ERR_INTERNAL;
+        state->err_info = LZ4F_getErrorName(ret);
+        return -1;
+    }
+    if (!lz4_write_out(state, ret))
+        return -1;
+    ret = LZ4F_compressBegin(state->lz4_cctx, state->out, state->size_out, &state->lz4_prefs);
+    if (LZ4F_isError(ret)) {
+        state->err = WTAP_ERR_CANT_WRITE; // XXX - WTAP_ERR_COMPRESS?
+        state->err_info = LZ4F_getErrorName(ret);
+        return -1;
+    }
+    if (!lz4_write_out(state, ret))
+        return -1;
+    state->frame_start = state->pos;
+    return 0;
+}
+
 /* Write out len bytes from buf.  Return 0, and set state->err, on
    failure or on an attempt to write 0 bytes (in which case state->err
    is 0); return the number of bytes written on success. */
@@ -3065,6 +4743,12 @@ lz4wfile_write(LZ4WFILE_T state, const void *buf, size_t len)
         len -= to_write;
     } while (len);
 
+    /* if writing in chunks, start a new frame once this one's big enough */
+    if (state->chunk_size != 0 &&
+        state->pos - state->frame_start >= (int64_t)state->chunk_size &&
+        lz4_frame_restart(state) == -1)
+        return 0;
+
     /* input was all buffered or compressed */
     return put;
 }
@@ -3079,6 +4763,17 @@ lz4wfile_flush(LZ4WFILE_T state)
     if (state->err != 0)
         return -1;
 
+    /* nothing to flush if we haven't started */
+    if (state->size_out == 0)
+        return 0;
+
+    /* if writing in chunks, end the frame, so that all of it can be read */
+    if (state->chunk_size != 0) {
+        if (state->pos != state->frame_start && lz4_frame_restart(state) == -1)
+            return -1;
+        return 0;
+    }
+
     bytesWritten = LZ4F_flush(state->lz4_cctx, state->out, state->size_out, NULL);
     if (LZ4F_isError(bytesWritten)) {
         // Should never happen if size_out >= LZ4F_compressBound(0, prefsPtr)
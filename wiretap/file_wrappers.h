@@ -22,6 +22,11 @@ extern int64_t file_tell_raw(FILE_T stream);
 extern int file_fstat(FILE_T stream, ws_statb64 *statb, int *err);
 WS_DLL_PUBLIC bool file_iscompressed(FILE_T stream);
 WS_DLL_PUBLIC int file_read(void *buf, unsigned int count, FILE_T file);
+extern uint8_t *file_read_mapped(unsigned int count, FILE_T file);
+extern const uint8_t *file_get_mapping(FILE_T file, int64_t *len);
+extern void file_set_readahead(FILE_T file, size_t window);
+extern int64_t file_get_io_wait(FILE_T file);
+extern void file_set_decompress_threads(FILE_T file, unsigned threads);
 WS_DLL_PUBLIC int file_peekc(FILE_T stream);
 WS_DLL_PUBLIC int file_getc(FILE_T stream);
 WS_DLL_PUBLIC char *file_gets(char *buf, int len, FILE_T stream);
@@ -73,8 +73,12 @@ static try_record_ret_t libpcap_try_record(wtap *wth, pcap_variant_t variant,
 
 static bool libpcap_read(wtap *wth, wtap_rec *rec,
     int *err, char **err_info, int64_t *data_offset);
+static unsigned libpcap_read_batch(wtap *wth, wtap_rec *recs, unsigned max,
+    int *err, char **err_info, int64_t *data_offsets);
 static bool libpcap_seek_read(wtap *wth, int64_t seek_off,
     wtap_rec *rec, int *err, char **err_info);
+static bool libpcap_scan_index(wtap *wth, unsigned threads, GArray *index,
+    int *err, char **err_info);
 static bool libpcap_read_packet(wtap *wth, FILE_T fh,
     wtap_rec *rec, int *err, char **err_info);
 static bool libpcap_read_header(wtap *wth, FILE_T fh, int *err, char **err_info,
@@ -347,6 +351,8 @@ wtap_open_return_val libpcap_open(wtap *wth, int *err, char **err_info)
 	/* This is a libpcap file */
 	wth->subtype_read = libpcap_read;
 	wth->subtype_seek_read = libpcap_seek_read;
+	wth->subtype_read_batch = libpcap_read_batch;
+	wth->subtype_scan_index = libpcap_scan_index;
 	wth->subtype_close = libpcap_close;
 	wth->snapshot_length = hdr.snaplen;
 	libpcap = g_new0(libpcap_t, 1);
@@ -1286,6 +1292,178 @@ static bool libpcap_read(wtap *wth, wtap_rec *rec,
 	return libpcap_read_packet(wth, wth->fh, rec, err, err_info);
 }
 
+/* Read up to max packets */
+static unsigned libpcap_read_batch(wtap *wth, wtap_rec *recs, unsigned max,
+    int *err, char **err_info, int64_t *data_offsets)
+{
+	unsigned n;
+
+	for (n = 0; n < max; n++) {
+		data_offsets[n] = file_tell(wth->fh);
+		if (!libpcap_read_packet(wth, wth->fh, &recs[n], err, err_info))
+			break;
+	}
+	return n;
+}
+
+/*
+ * Parameters for a parallel scan of the records of a pcap file.
+ */
+typedef struct {
+	bool byte_swapped;
+	uint32_t max_caplen;	/* largest valid captured length */
+	uint32_t frac_per_sec;	/* microseconds or nanoseconds */
+} libpcap_scan_t;
+
+/*
+ * Number of records following a candidate record that have to look
+ * valid for a parallel scan to synchronize on it.
+ */
+#define LIBPCAP_SCAN_SYNC_RECORDS	8
+
+/*
+ * Get the header of the record at offset, if it's all in the file,
+ * and return the length of the record, or 0 if it isn't a record
+ * libpcap_read_packet() would read.  If strict is true, also check
+ * that the header looks like one that a program would have written,
+ * as we're looking for the start of a record.
+ */
+static uint32_t
+libpcap_scan_record(const uint8_t *map, int64_t map_len, int64_t offset,
+    const libpcap_scan_t *scan, bool strict, struct pcaprec_hdr *hdr)
+{
+	if (map_len - offset < (int64_t)sizeof *hdr)
+		return 0;
+	memcpy(hdr, map + offset, sizeof *hdr);
+	if (scan->byte_swapped) {
+		hdr->ts_sec = GUINT32_SWAP_LE_BE(hdr->ts_sec);
+		hdr->ts_usec = GUINT32_SWAP_LE_BE(hdr->ts_usec);
+		hdr->incl_len = GUINT32_SWAP_LE_BE(hdr->incl_len);
+		hdr->orig_len = GUINT32_SWAP_LE_BE(hdr->orig_len);
+	}
+	if (hdr->incl_len > scan->max_caplen ||
+	    hdr->incl_len > map_len - offset - (int64_t)sizeof *hdr)
+		return 0;
+	if (strict && (hdr->incl_len > hdr->orig_len ||
+	    hdr->ts_usec >= scan->frac_per_sec))
+		return 0;
+	return (uint32_t)sizeof *hdr + hdr->incl_len;
+}
+
+/* wtap_scan_blocks() routine for a range of a pcap file */
+static void
+libpcap_scan_range(const uint8_t *map, int64_t map_len, const void *data,
+    wtap_scan_range *range)
+{
+	const libpcap_scan_t *scan = (const libpcap_scan_t *)data;
+	struct pcaprec_hdr hdr;
+	wtap_scan_block block;
+	int64_t offset, next;
+	uint32_t length;
+	unsigned n;
+
+	offset = range->start;
+	if (!range->exact) {
+		/*
+		 * Records have no alignment or markers, so look for the
+		 * first offset at which there's a run of plausible
+		 * records, or the last records in the file.
+		 */
+		for (; offset < range->end; offset++) {
+			next = offset;
+			for (n = 0; n < LIBPCAP_SCAN_SYNC_RECORDS && next < map_len; n++) {
+				length = libpcap_scan_record(map, map_len,
+				    next, scan, true, &hdr);
+				if (length == 0)
+					break;
+				next += length;
+			}
+			if (n == LIBPCAP_SCAN_SYNC_RECORDS || next == map_len)
+				break;
+		}
+		if (offset >= range->end)
+			return;
+	}
+	range->sync = offset;
+
+	memset(&block, 0, sizeof block);
+	while (offset < range->end) {
+		length = libpcap_scan_record(map, map_len, offset, scan, false,
+		    &hdr);
+		if (length == 0) {
+			range->bad = true;
+			return;
+		}
+		block.offset = offset;
+		block.length = length;
+		block.ts_high = hdr.ts_sec;
+		block.ts_low = hdr.ts_usec;
+		block.caplen = hdr.incl_len;
+		block.len = hdr.orig_len;
+		g_array_append_val(range->blocks, block);
+		offset += length;
+	}
+	range->stop = offset;
+}
+
+/* Index the rest of the file */
+static bool
+libpcap_scan_index(wtap *wth, unsigned threads, GArray *index,
+    int *err, char **err_info _U_)
+{
+	libpcap_t *libpcap = (libpcap_t *)wth->priv;
+	union wtap_pseudo_header pseudo_header;
+	libpcap_scan_t scan;
+	GArray *blocks;
+	wtap_index_entry entry;
+	int64_t end;
+
+	/*
+	 * Only handle the common variants, with record headers we can
+	 * find without reading the packet data, and the time stamp in
+	 * them.
+	 */
+	if (libpcap->variant != PCAP && libpcap->variant != PCAP_NSEC)
+		return false;
+	if (libpcap->lengths_swapped != NOT_SWAPPED)
+		return false;
+	memset(&pseudo_header, 0, sizeof pseudo_header);
+	if (wth->file_encap == WTAP_ENCAP_ERF ||
+	    pcap_get_phdr_size(wth->file_encap, &pseudo_header) != 0)
+		return false;
+
+	scan.byte_swapped = libpcap->byte_swapped;
+	scan.max_caplen = wtap_max_snaplen_for_encap(wth->file_encap);
+	scan.frac_per_sec = (libpcap->variant == PCAP_NSEC) ? 1000000000 : 1000000;
+	end = file_tell(wth->fh);
+	blocks = wtap_scan_blocks(wth, threads, end, libpcap_scan_range, &scan);
+	if (blocks == NULL)
+		return false;
+
+	memset(&entry, 0, sizeof entry);
+	entry.presence_flags = WTAP_HAS_TS|WTAP_HAS_CAP_LEN;
+	entry.tsprec = wth->file_tsprec;
+	entry.pkt_encap = wth->file_encap;
+	for (unsigned i = 0; i < blocks->len; i++) {
+		const wtap_scan_block *block = &g_array_index(blocks, wtap_scan_block, i);
+
+		entry.offset = block->offset;
+		entry.ts.secs = block->ts_high;
+		if (libpcap->variant == PCAP_NSEC)
+			entry.ts.nsecs = block->ts_low;
+		else
+			entry.ts.nsecs = block->ts_low * 1000;
+		entry.caplen = block->caplen;
+		entry.len = block->len;
+		g_array_append_val(index, entry);
+		end = block->offset + block->length;
+	}
+	g_array_free(blocks, true);
+
+	/* Leave the file at its end, as if we'd read it all. */
+	return file_seek(wth->fh, end, SEEK_SET, err) != -1;
+}
+
 static bool
 libpcap_seek_read(wtap *wth, int64_t seek_off, wtap_rec *rec,
     int *err, char **err_info)
@@ -1393,7 +1571,8 @@ libpcap_read_packet(wtap *wth, FILE_T fh, wtap_rec *rec,
 	/*
 	 * Read the packet data.
 	 */
-	if (!wtap_read_bytes_buffer(fh, &rec->data, packet_size, err, err_info))
+	if (!wtap_read_bytes_buffer_mapped(fh, &rec->data, packet_size, err,
+	    err_info))
 		return false;	/* failed */
 
 	pcap_read_post_process(is_nokia, wth->file_encap, rec,
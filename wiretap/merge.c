@@ -81,13 +81,15 @@ cleanup_in_file(merge_in_file_t *in_file)
 {
     ws_assert(in_file != NULL);
 
+    wtap_batch_free(in_file->batch);
+    in_file->batch = NULL;
+    in_file->rec = NULL;
+
     wtap_close(in_file->wth);
     in_file->wth = NULL;
 
     g_array_free(in_file->idb_index_map, true);
     in_file->idb_index_map = NULL;
-
-    wtap_rec_cleanup(&in_file->rec);
 }
 
 static void
@@ -236,7 +238,7 @@ merge_open_in_files(unsigned in_file_count, const char *const *in_file_names,
             *err_fileno = i;
             return 0;
         }
-        wtap_rec_init(&files[i].rec, 1514);
+        files[i].batch = wtap_batch_new(1514);
         files[i].size = size;
         files[i].idb_index_map = g_array_new(false, false, sizeof(unsigned));
 
@@ -365,8 +367,9 @@ merge_read_packet(int in_file_count, merge_in_file_t in_files[],
              * No packet available, and we haven't seen an error or EOF yet,
              * so try to read the next packet.
              */
-            if (!wtap_read(in_files[i].wth, &in_files[i].rec, err, err_info,
-                           &data_offset)) {
+            in_files[i].rec = wtap_batch_read(in_files[i].wth, in_files[i].batch,
+                                              err, err_info, &data_offset);
+            if (in_files[i].rec == NULL) {
                 if (*err != 0) {
                     in_files[i].state = GOT_ERROR;
                     return &in_files[i];
@@ -377,7 +380,7 @@ merge_read_packet(int in_file_count, merge_in_file_t in_files[],
         }
 
         if (in_files[i].state == RECORD_PRESENT) {
-            rec = &in_files[i].rec;
+            rec = in_files[i].rec;
             if (!(rec->presence_flags & WTAP_HAS_TS)) {
                 /*
                  * No time stamp.  Pick this record, and stop looking.
@@ -450,8 +453,9 @@ merge_append_read_packet(int in_file_count, merge_in_file_t in_files[],
     for (i = 0; i < in_file_count; i++) {
         if (in_files[i].state == AT_EOF)
             continue; /* This file is already at EOF */
-        if (wtap_read(in_files[i].wth, &in_files[i].rec, err, err_info,
-                      &data_offset))
+        in_files[i].rec = wtap_batch_read(in_files[i].wth, in_files[i].batch,
+                                          err, err_info, &data_offset);
+        if (in_files[i].rec != NULL)
             break; /* We have a packet */
         if (*err != 0) {
             /* Read error - quit immediately. */
@@ -1093,7 +1097,7 @@ merge_process_packets(wtap_dumper *pdh, const int file_type,
          */
         if (snaplen != 0) {
             /* Yes - apply it. */
-            wtap_rec_apply_snapshot(&in_file->rec, snaplen);
+            wtap_rec_apply_snapshot(in_file->rec, snaplen);
         }
 
         /*
@@ -1111,8 +1115,8 @@ merge_process_packets(wtap_dumper *pdh, const int file_type,
              * now, we hardcode that, but we need to figure
              * out a more general way to handle this.
              */
-            if (in_file->rec.rec_type == REC_TYPE_PACKET) {
-                if (!map_rec_interface_id(&in_file->rec, in_file)) {
+            if (in_file->rec->rec_type == REC_TYPE_PACKET) {
+                if (!map_rec_interface_id(in_file->rec, in_file)) {
                     status = MERGE_ERR_BAD_PHDR_INTERFACE_ID;
                     break;
                 }
@@ -1139,13 +1143,13 @@ merge_process_packets(wtap_dumper *pdh, const int file_type,
             }
         }
 
-        if (!wtap_dump(pdh, &in_file->rec,
-                       ws_buffer_start_ptr(&in_file->rec.data),
+        if (!wtap_dump(pdh, in_file->rec,
+                       ws_buffer_start_ptr(&in_file->rec->data),
                        err, err_info)) {
             status = MERGE_ERR_CANT_WRITE_OUTFILE;
             break;
         }
-        wtap_rec_reset(&in_file->rec);
+        wtap_rec_reset(in_file->rec);
     }
 
     if (cb)
@@ -30,7 +30,8 @@ typedef enum {
 typedef struct merge_in_file_s {
     const char     *filename;
     wtap           *wth;
-    wtap_rec        rec;
+    wtap_batch     *batch;          /* records read ahead from the file */
+    wtap_rec       *rec;            /* current record, from batch */
     in_file_state_e state;
     uint32_t        packet_num;     /* current packet number */
     int64_t         size;           /* file size */
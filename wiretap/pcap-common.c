@@ -2028,6 +2028,8 @@ pcap_byteswap_linux_sll_pseudoheader(wtap_rec *rec)
 	unsigned packet_size;
 	uint16_t protocol;
 
+	/* The data might be in a read-only mapping of the file. */
+	ws_buffer_make_writable(&rec->data);
 	pd = ws_buffer_start_ptr(&rec->data);
 
 	/*
@@ -2059,6 +2061,7 @@ pcap_byteswap_linux_sll2_pseudoheader(wtap_rec *rec)
 	unsigned packet_size;
 	uint16_t protocol;
 
+	ws_buffer_make_writable(&rec->data);
 	pd = ws_buffer_start_ptr(&rec->data);
 
 	/*
@@ -2092,6 +2095,7 @@ pcap_byteswap_linux_usb_pseudoheader(wtap_rec *rec, bool header_len_64_bytes)
 	struct linux_usb_isodesc *pisodesc;
 	int32_t iso_numdesc, i;
 
+	ws_buffer_make_writable(&rec->data);
 	pd = ws_buffer_start_ptr(&rec->data);
 
 	/*
@@ -2189,6 +2193,7 @@ pcap_byteswap_nflog_pseudoheader(wtap_rec *rec)
 	struct nflog_tlv *tlv;
 	unsigned size;
 
+	ws_buffer_make_writable(&rec->data);
 	pd = ws_buffer_start_ptr(&rec->data);
 
 	/*
@@ -2275,6 +2280,7 @@ pcap_byteswap_pflog_pseudoheader(wtap_rec *rec)
 	unsigned packet_size;
 	struct pfloghdr *pflhdr;
 
+	ws_buffer_make_writable(&rec->data);
 	pd = ws_buffer_start_ptr(&rec->data);
 
 	/*
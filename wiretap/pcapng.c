@@ -45,9 +45,15 @@
 static bool
 pcapng_read(wtap *wth, wtap_rec *rec, int *err,
             char **err_info, int64_t *data_offset);
+static unsigned
+pcapng_read_batch(wtap *wth, wtap_rec *recs, unsigned max, int *err,
+                  char **err_info, int64_t *data_offsets);
 static bool
 pcapng_seek_read(wtap *wth, int64_t seek_off,
                  wtap_rec *rec, int *err, char **err_info);
+static bool
+pcapng_scan_index(wtap *wth, unsigned threads, GArray *index, int *err,
+                  char **err_info);
 static void
 pcapng_close(wtap *wth);
 
@@ -1066,7 +1072,9 @@ pcapng_process_options(FILE_T fh, wtapng_block_t *wblock,
                        pcapng_opt_byte_order_e byte_order,
                        int *err, char **err_info)
 {
-    uint8_t *option_content; /* Allocate as large as the options block */
+    uint32_t option_stack_buf[64]; /* Most option blocks fit here */
+    uint8_t *option_alloc = NULL;  /* Allocated if they don't */
+    uint8_t *option_content;
     unsigned opt_bytes_remaining;
     const uint8_t *option_ptr;
     const pcapng_option_header_t *oh;
@@ -1079,25 +1087,35 @@ pcapng_process_options(FILE_T fh, wtapng_block_t *wblock,
         return true;
     }
 
-    /* Allocate enough memory to hold all options */
-    option_content = (uint8_t *)g_try_malloc(opt_cont_buf_len);
-    if (option_content == NULL) {
-        *err = ENOMEM;  /* we assume we're out of memory */
-        return false;
+    /*
+     * Options are read for almost every block, so avoid a heap
+     * allocation unless they don't fit in our stack buffer.
+     */
+    if (opt_cont_buf_len <= sizeof option_stack_buf) {
+        option_content = (uint8_t *)option_stack_buf;
+    } else {
+        /* Allocate enough memory to hold all options */
+        option_alloc = (uint8_t *)g_try_malloc(opt_cont_buf_len);
+        if (option_alloc == NULL) {
+            *err = ENOMEM;  /* we assume we're out of memory */
+            return false;
+        }
+        option_content = option_alloc;
     }
 
     /* Read all the options into the buffer */
     if (!wtap_read_bytes(fh, option_content, opt_cont_buf_len, err, err_info)) {
         ws_debug("failed to read options");
-        g_free(option_content);
+        g_free(option_alloc);
         return false;
     }
 
     /*
      * Now process them.
      * option_ptr starts out aligned on at least a 4-byte boundary, as
-     * that's what g_try_malloc() gives us, and each option is padded
-     * to a length that's a multiple of 4 bytes, so it remains aligned.
+     * that's what both the stack buffer and g_try_malloc() give us,
+     * and each option is padded to a length that's a multiple of 4
+     * bytes, so it remains aligned.
      */
     option_ptr = &option_content[0];
     opt_bytes_remaining = opt_cont_buf_len;
@@ -1108,7 +1126,7 @@ pcapng_process_options(FILE_T fh, wtapng_block_t *wblock,
         if (sizeof (*oh) > opt_bytes_remaining) {
             *err = WTAP_ERR_BAD_FILE;
             *err_info = ws_strdup_printf("pcapng: Not enough data for option header");
-            g_free(option_content);
+            g_free(option_alloc);
             return false;
         }
         option_code = oh->option_code;
@@ -1137,6 +1155,7 @@ pcapng_process_options(FILE_T fh, wtapng_block_t *wblock,
             *err = WTAP_ERR_INTERNAL;
             *err_info = ws_strdup_printf("pcapng: invalid byte order %d passed to pcapng_process_options()",
                                         byte_order);
+            g_free(option_alloc);
             return false;
         }
         option_ptr += sizeof (*oh); /* 4 bytes, so it remains aligned */
@@ -1150,7 +1169,7 @@ pcapng_process_options(FILE_T fh, wtapng_block_t *wblock,
             *err = WTAP_ERR_BAD_FILE;
             *err_info = ws_strdup_printf("pcapng: Not enough data to handle option of length %u",
                                         option_length);
-            g_free(option_content);
+            g_free(option_alloc);
             return false;
         }
 
@@ -1175,7 +1194,7 @@ pcapng_process_options(FILE_T fh, wtapng_block_t *wblock,
                                                   option_ptr,
                                                   byte_order,
                                                   err, err_info)) {
-                    g_free(option_content);
+                    g_free(option_alloc);
                     return false;
                 }
                 break;
@@ -1184,7 +1203,7 @@ pcapng_process_options(FILE_T fh, wtapng_block_t *wblock,
                     !(*process_option)(wblock, (const section_info_t *)section_info, option_code,
                                        option_length, option_ptr,
                                        err, err_info)) {
-                    g_free(option_content);
+                    g_free(option_alloc);
                     return false;
                 }
                 break;
@@ -1192,7 +1211,7 @@ pcapng_process_options(FILE_T fh, wtapng_block_t *wblock,
         option_ptr += rounded_option_length; /* multiple of 4 bytes, so it remains aligned */
         opt_bytes_remaining -= rounded_option_length;
     }
-    g_free(option_content);
+    g_free(option_alloc);
     return true;
 }
 
@@ -2140,8 +2159,6 @@ pcapng_read_packet_block(FILE_T fh, pcapng_block_header_t *bh,
     int pseudo_header_len;
     int fcslen;
 
-    wblock->block = wtap_block_create(WTAP_BLOCK_PACKET);
-
     /* "(Enhanced) Packet Block" read fixed part */
     if (enhanced) {
         /*
@@ -2312,8 +2329,8 @@ pcapng_read_packet_block(FILE_T fh, pcapng_block_header_t *bh,
     wblock->rec->ts.secs = (time_t)(wblock->rec->ts.secs + iface_info.tsoffset);
 
     /* "(Enhanced) Packet Block" read capture data */
-    if (!wtap_read_bytes_buffer(fh, &wblock->rec->data,
-                                packet.cap_len - pseudo_header_len, err, err_info))
+    if (!wtap_read_bytes_buffer_mapped(fh, &wblock->rec->data,
+                                       packet.cap_len - pseudo_header_len, err, err_info))
         return false;
     block_read += packet.cap_len - pseudo_header_len;
 
@@ -2332,6 +2349,15 @@ pcapng_read_packet_block(FILE_T fh, pcapng_block_header_t *bh,
         (int)sizeof(pcapng_block_header_t) -
         block_read -    /* fixed and variable part, including padding */
         (int)sizeof(bh->block_total_length);
+
+    /*
+     * Most packets have no options, so only allocate a block if
+     * there's something to put in it; otherwise, as with Simple
+     * Packet Blocks, the record has no block.
+     */
+    if (opt_cont_buf_len != 0 || packet.drops_count != 0xFFFF)
+        wblock->block = wtap_block_create(WTAP_BLOCK_PACKET);
+
     if (!pcapng_process_options(fh, wblock, section_info, opt_cont_buf_len,
                                 pcapng_process_packet_block_option,
                                 OPT_SECTION_BYTE_ORDER, err, err_info))
@@ -2495,8 +2521,8 @@ pcapng_read_simple_packet_block(FILE_T fh, pcapng_block_header_t *bh,
     memset((void *)&wblock->rec->rec_header.packet_header.pseudo_header, 0, sizeof(union wtap_pseudo_header));
 
     /* "Simple Packet Block" read capture data */
-    if (!wtap_read_bytes_buffer(fh, &wblock->rec->data,
-                                simple_packet.cap_len, err, err_info))
+    if (!wtap_read_bytes_buffer_mapped(fh, &wblock->rec->data,
+                                       simple_packet.cap_len, err, err_info))
         return false;
 
     /* jump over potential padding bytes at end of the packet data */
@@ -4038,6 +4064,8 @@ pcapng_open(wtap *wth, int *err, char **err_info)
 
     wth->subtype_read = pcapng_read;
     wth->subtype_seek_read = pcapng_seek_read;
+    wth->subtype_read_batch = pcapng_read_batch;
+    wth->subtype_scan_index = pcapng_scan_index;
     wth->subtype_close = pcapng_close;
     wth->file_type_subtype = pcapng_file_type_subtype;
 
@@ -4192,6 +4220,303 @@ pcapng_read(wtap *wth, wtap_rec *rec, int *err, char **err_info,
     return true;
 }
 
+/* classic wtap: read up to max records */
+static unsigned
+pcapng_read_batch(wtap *wth, wtap_rec *recs, unsigned max, int *err,
+                  char **err_info, int64_t *data_offsets)
+{
+    unsigned n;
+
+    for (n = 0; n < max; n++) {
+        if (!pcapng_read(wth, &recs[n], err, err_info, &data_offsets[n]))
+            break;
+    }
+    return n;
+}
+
+/*
+ * Number of blocks following a candidate block that have to look valid
+ * for a parallel scan to synchronize on it.
+ */
+#define PCAPNG_SCAN_SYNC_BLOCKS 8
+
+/*
+ * If there's a block at offset that a parallel scan can handle, return
+ * its length, otherwise 0.  Only the block types that are processed
+ * internally, or that are returned as packet records, are handled, and
+ * only in the byte order the scan started with.
+ */
+static uint32_t
+pcapng_scan_block_length(const uint8_t *map, int64_t map_len, int64_t offset,
+                         bool byte_swapped, uint32_t *block_type)
+{
+    pcapng_block_header_t bh;
+    uint32_t magic;
+    uint32_t trailer;
+
+    if (map_len - offset < MIN_BLOCK_SIZE)
+        return 0;
+    memcpy(&bh, map + offset, sizeof bh);
+    if (bh.block_type == BLOCK_TYPE_SHB) {
+        if (map_len - offset < MIN_SHB_SIZE)
+            return 0;
+        memcpy(&magic, map + offset + sizeof bh, sizeof magic);
+        if (magic != (byte_swapped ? 0x4D3C2B1A : 0x1A2B3C4D))
+            return 0;
+    }
+    if (byte_swapped) {
+        bh.block_type         = GUINT32_SWAP_LE_BE(bh.block_type);
+        bh.block_total_length = GUINT32_SWAP_LE_BE(bh.block_total_length);
+    }
+
+    switch (bh.block_type) {
+
+    case BLOCK_TYPE_SHB:
+    case BLOCK_TYPE_IDB:
+    case BLOCK_TYPE_PB:
+    case BLOCK_TYPE_SPB:
+    case BLOCK_TYPE_EPB:
+    case BLOCK_TYPE_NRB:
+    case BLOCK_TYPE_ISB:
+    case BLOCK_TYPE_DSB:
+        break;
+
+    default:
+        return 0;
+    }
+
+    if (bh.block_total_length < MIN_BLOCK_SIZE ||
+        bh.block_total_length > MAX_BLOCK_SIZE ||
+        bh.block_total_length % 4 != 0 ||
+        bh.block_total_length > map_len - offset)
+        return 0;
+    memcpy(&trailer, map + offset + bh.block_total_length - sizeof trailer,
+           sizeof trailer);
+    if (byte_swapped)
+        trailer = GUINT32_SWAP_LE_BE(trailer);
+    if (trailer != bh.block_total_length)
+        return 0;
+
+    *block_type = bh.block_type;
+    return bh.block_total_length;
+}
+
+/* wtap_scan_blocks() routine for a range of a pcapng file */
+static void
+pcapng_scan_range(const uint8_t *map, int64_t map_len, const void *data,
+                  wtap_scan_range *range)
+{
+    bool byte_swapped = *(const bool *)data;
+    int64_t offset, next;
+    uint32_t block_type, length;
+    wtap_scan_block block;
+    pcapng_enhanced_packet_block_t epb;
+    pcapng_packet_block_t pb;
+
+    offset = range->start;
+    if (!range->exact) {
+        /*
+         * We could be in the middle of a block; blocks are 4-byte
+         * aligned, so look for the first 4-byte boundary at which
+         * there's a run of valid blocks, or the last blocks in the
+         * file.
+         */
+        offset = ROUND_TO_4BYTE(offset);
+        for (; offset < range->end; offset += 4) {
+            unsigned n;
+
+            next = offset;
+            for (n = 0; n < PCAPNG_SCAN_SYNC_BLOCKS && next < map_len; n++) {
+                length = pcapng_scan_block_length(map, map_len, next,
+                                                  byte_swapped, &block_type);
+                if (length == 0)
+                    break;
+                next += length;
+            }
+            if (n == PCAPNG_SCAN_SYNC_BLOCKS || next == map_len)
+                break;
+        }
+        if (offset >= range->end)
+            return;
+    }
+    range->sync = offset;
+
+    while (offset < range->end) {
+        length = pcapng_scan_block_length(map, map_len, offset, byte_swapped,
+                                          &block_type);
+        if (length == 0) {
+            range->bad = true;
+            return;
+        }
+
+        memset(&block, 0, sizeof block);
+        block.offset = offset;
+        block.type = block_type;
+        block.length = length;
+        if (block_type == BLOCK_TYPE_EPB && length >= MIN_EPB_SIZE) {
+            memcpy(&epb, map + offset + sizeof(pcapng_block_header_t),
+                   sizeof epb);
+            block.interface_id = epb.interface_id;
+            block.ts_high = epb.timestamp_high;
+            block.ts_low = epb.timestamp_low;
+            block.caplen = epb.captured_len;
+            block.len = epb.packet_len;
+        } else if (block_type == BLOCK_TYPE_PB && length >= MIN_PB_SIZE) {
+            memcpy(&pb, map + offset + sizeof(pcapng_block_header_t),
+                   sizeof pb);
+            block.interface_id = byte_swapped ?
+                GUINT16_SWAP_LE_BE(pb.interface_id) : pb.interface_id;
+            block.ts_high = pb.timestamp_high;
+            block.ts_low = pb.timestamp_low;
+            block.caplen = pb.captured_len;
+            block.len = pb.packet_len;
+        }
+        if (byte_swapped) {
+            if (block_type == BLOCK_TYPE_EPB)
+                block.interface_id = GUINT32_SWAP_LE_BE(block.interface_id);
+            block.ts_high = GUINT32_SWAP_LE_BE(block.ts_high);
+            block.ts_low = GUINT32_SWAP_LE_BE(block.ts_low);
+            block.caplen = GUINT32_SWAP_LE_BE(block.caplen);
+            block.len = GUINT32_SWAP_LE_BE(block.len);
+        }
+        g_array_append_val(range->blocks, block);
+        offset += length;
+    }
+    range->stop = offset;
+}
+
+/*
+ * Fill in an index entry for an EPB or PB found by a scan, if it's one
+ * that pcapng_read_packet_block() would return without looking at the
+ * packet data (i.e., with no pseudo-header) or reporting an error.
+ */
+static bool
+pcapng_scan_packet(const section_info_t *section_info,
+                   const wtap_scan_block *block, wtap_index_entry *entry)
+{
+    const interface_info_t *iface_info;
+    union wtap_pseudo_header pseudo_header;
+    uint32_t min_size, padding;
+    uint64_t ts;
+
+    if (block->type == BLOCK_TYPE_EPB)
+        min_size = MIN_EPB_SIZE;
+    else if (block->type == BLOCK_TYPE_PB)
+        min_size = MIN_PB_SIZE;
+    else
+        return false;
+    padding = (block->caplen % 4) != 0 ? 4 - (block->caplen % 4) : 0;
+    if ((uint64_t)block->length < (uint64_t)min_size + block->caplen + padding)
+        return false;
+    if (block->interface_id >= section_info->interfaces->len)
+        return false;
+    iface_info = &g_array_index(section_info->interfaces, interface_info_t,
+                                block->interface_id);
+    if (block->caplen > wtap_max_snaplen_for_encap(iface_info->wtap_encap))
+        return false;
+    memset(&pseudo_header, 0, sizeof pseudo_header);
+    if (pcap_get_phdr_size(iface_info->wtap_encap, &pseudo_header) != 0)
+        return false;
+
+    entry->offset = block->offset;
+    entry->presence_flags = WTAP_HAS_TS|WTAP_HAS_CAP_LEN|WTAP_HAS_INTERFACE_ID|WTAP_HAS_SECTION_NUMBER;
+    ts = (((uint64_t)block->ts_high) << 32) | ((uint64_t)block->ts_low);
+    entry->ts.secs = (time_t)(ts / iface_info->time_units_per_second);
+    entry->ts.nsecs = (int)(((ts % iface_info->time_units_per_second) * 1000000000) / iface_info->time_units_per_second);
+    entry->ts.secs = (time_t)(entry->ts.secs + iface_info->tsoffset);
+    entry->tsprec = iface_info->tsprecision;
+    entry->caplen = block->caplen;
+    entry->len = block->len;
+    entry->pkt_encap = iface_info->wtap_encap;
+    entry->interface_id = block->interface_id;
+    return true;
+}
+
+/* classic wtap: index the rest of the file */
+static bool
+pcapng_scan_index(wtap *wth, unsigned threads, GArray *index, int *err,
+                  char **err_info)
+{
+    pcapng_t *pcapng = (pcapng_t *)wth->priv;
+    section_info_t *current_section, new_section;
+    bool byte_swapped;
+    GArray *blocks;
+    wtapng_block_t wblock;
+    wtap_rec rec;
+    wtap_index_entry entry;
+    int64_t end;
+    bool ret = true;
+
+    current_section = &g_array_index(pcapng->sections, section_info_t,
+                                     pcapng->current_section_number);
+    byte_swapped = current_section->byte_swapped;
+    end = file_tell(wth->fh);
+    blocks = wtap_scan_blocks(wth, threads, end, pcapng_scan_range,
+                              &byte_swapped);
+    if (blocks == NULL)
+        return false;
+    if (blocks->len != 0) {
+        const wtap_scan_block *last = &g_array_index(blocks, wtap_scan_block,
+                                                     blocks->len - 1);
+        end = last->offset + last->length;
+    }
+
+    /*
+     * Now go through the blocks in order, so that we know which
+     * interfaces the packets are on; anything but the common sort
+     * of packet is read as pcapng_read() would read it.
+     */
+    wtap_rec_init(&rec, 0);
+    wblock.rec = &rec;
+    for (unsigned i = 0; i < blocks->len; i++) {
+        const wtap_scan_block *block = &g_array_index(blocks, wtap_scan_block, i);
+
+        current_section = &g_array_index(pcapng->sections, section_info_t,
+                                         pcapng->current_section_number);
+        if (pcapng_scan_packet(current_section, block, &entry)) {
+            entry.section_number = pcapng->current_section_number;
+            g_array_append_val(index, entry);
+            continue;
+        }
+
+        if (file_seek(wth->fh, block->offset, SEEK_SET, err) == -1) {
+            ret = false;
+            break;
+        }
+        if (!pcapng_read_block(wth, wth->fh, pcapng, current_section,
+                               &new_section, &wblock, err, err_info)) {
+            wtap_block_unref(wblock.block);
+            if (*err == 0)
+                *err = WTAP_ERR_SHORT_READ;
+            ret = false;
+            break;
+        }
+        if (wblock.internal) {
+            pcapng_process_internal_block(wth, pcapng, current_section,
+                                          new_section, &wblock, &block->offset);
+        } else if (rec.rec_type == REC_TYPE_PACKET) {
+            entry.offset = block->offset;
+            entry.presence_flags = rec.presence_flags | WTAP_HAS_SECTION_NUMBER;
+            entry.ts = rec.ts;
+            entry.tsprec = rec.tsprec;
+            entry.caplen = rec.rec_header.packet_header.caplen;
+            entry.len = rec.rec_header.packet_header.len;
+            entry.pkt_encap = rec.rec_header.packet_header.pkt_encap;
+            entry.interface_id = rec.rec_header.packet_header.interface_id;
+            entry.section_number = pcapng->current_section_number;
+            g_array_append_val(index, entry);
+        }
+        wtap_rec_reset(&rec);
+    }
+    wtap_rec_cleanup(&rec);
+    g_array_free(blocks, true);
+
+    /* Leave the file at its end, as if we'd read it all. */
+    if (ret && file_seek(wth->fh, end, SEEK_SET, err) == -1)
+        ret = false;
+    return ret;
+}
+
 /* classic wtap: seek to file position and read packet */
 static bool
 pcapng_seek_read(wtap *wth, int64_t seek_off, wtap_rec *rec,
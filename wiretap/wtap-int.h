@@ -30,6 +30,10 @@ typedef bool (*subtype_read_func)(struct wtap*, wtap_rec *,
                                   int *, char **, int64_t *);
 typedef bool (*subtype_seek_read_func)(struct wtap*, int64_t, wtap_rec *,
                                        int *, char **);
+typedef unsigned (*subtype_read_batch_func)(struct wtap*, wtap_rec *, unsigned,
+                                            int *, char **, int64_t *);
+typedef bool (*subtype_scan_index_func)(struct wtap*, unsigned, GArray *,
+                                        int *, char **);
 
 /**
  * Struct holding data of the currently read file.
@@ -37,6 +41,7 @@ typedef bool (*subtype_seek_read_func)(struct wtap*, int64_t, wtap_rec *,
 struct wtap {
     FILE_T                      fh;
     FILE_T                      random_fh;              /**< Secondary FILE_T for random access */
+    int64_t                     closed_io_wait;         /**< I/O wait time of the sequential FILE_T, once closed */
     bool                        ispipe;                 /**< true if the file is a pipe */
     int                         file_type_subtype;
     unsigned                    snapshot_length;
@@ -55,6 +60,8 @@ struct wtap {
 
     subtype_read_func           subtype_read;
     subtype_seek_read_func      subtype_seek_read;
+    subtype_read_batch_func     subtype_read_batch;     /**< Reads several records; NULL to use subtype_read */
+    subtype_scan_index_func     subtype_scan_index;     /**< Indexes the rest of the file; NULL if not supported */
     void                        (*subtype_sequential_close)(struct wtap*);
     void                        (*subtype_close)(struct wtap*);
     int                         file_encap;    /* per-file, for those
@@ -328,6 +335,14 @@ bool
 wtap_read_bytes_buffer(FILE_T fh, Buffer *buf, unsigned length, int *err,
     char **err_info);
 
+/*
+ * Like wtap_read_bytes_buffer(), but might point the buffer at the data
+ * in a read-only memory mapping of the file rather than copying it.
+ */
+bool
+wtap_read_bytes_buffer_mapped(FILE_T fh, Buffer *buf, unsigned length,
+    int *err, char **err_info);
+
 /*
  * Implementation of wth->subtype_read that reads the full file contents
  * as a single packet.
@@ -445,6 +460,65 @@ wtap_block_t wtap_rec_generate_idb(const wtap_rec *rec);
  */
 GArray* wtap_file_get_nrb_for_new_file(wtap *wth);
 
+/**
+ * A block found by a parallel scan of a memory-mapped file, with the
+ * header fields of packet blocks, for the file type's scan routine to
+ * interpret.
+ */
+typedef struct {
+    int64_t  offset;        /**< Offset of the block in the file */
+    uint32_t type;          /**< File-type-specific block type */
+    uint32_t length;        /**< Length of the block */
+    uint32_t interface_id;
+    uint32_t ts_high;       /**< Upper half, or seconds */
+    uint32_t ts_low;        /**< Lower half, or fraction of a second */
+    uint32_t caplen;
+    uint32_t len;
+} wtap_scan_block;
+
+/**
+ * One of the byte ranges of a file scanned in parallel.
+ */
+typedef struct {
+    int64_t  start;         /**< Where to start looking for a block */
+    int64_t  end;           /**< Blocks starting here or later aren't ours */
+    bool     exact;         /**< true if start is known to be a block */
+    int64_t  sync;          /**< Set to the first block found, or -1 */
+    int64_t  stop;          /**< Set to the offset of the first block not scanned */
+    bool     bad;           /**< Set if the scan found something it can't handle */
+    GArray   *blocks;       /**< Set to the wtap_scan_block entries found */
+} wtap_scan_range;
+
+/**
+ * Scan a range of a memory-mapped file.  If range->exact is false, the
+ * routine must look for the first offset >= range->start at which a
+ * plausible sequence of blocks starts, as it could be in the middle of
+ * a block; blocks are then appended to range->blocks until one starts
+ * at or after range->end.  It's called from several threads at once,
+ * so it mustn't touch anything but the mapping, its range, and data.
+ */
+typedef void (*wtap_scan_range_func)(const uint8_t *map, int64_t map_len,
+                                     const void *data, wtap_scan_range *range);
+
+/**
+ * @brief Find all the blocks from @start to the end of the file,
+ *      scanning byte ranges of the file's memory mapping in parallel.
+ * @details Ranges whose first block doesn't follow on from the last
+ *      block of the previous range are rescanned from that block, so
+ *      the result is the same as for a sequential scan.
+ *
+ * @param wth The wiretap session.
+ * @param threads The number of threads to use, 0 for one per processor.
+ * @param start The offset of the first block.
+ * @param scan The file type's scan routine.
+ * @param data Passed to @scan.
+ * @return A GArray of wtap_scan_block, or NULL if the file isn't
+ *      memory-mapped, or the scan didn't end exactly at the end of the
+ *      file or found something @scan couldn't handle.
+ */
+GArray *wtap_scan_blocks(wtap *wth, unsigned threads, int64_t start,
+                         wtap_scan_range_func scan, const void *data);
+
 #endif /* __WTAP_INT_H__ */
 
 /*
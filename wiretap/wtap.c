@@ -85,6 +85,18 @@ wtap_file_size(wtap *wth, int *err)
 	return statb.st_size;
 }
 
+int64_t
+wtap_io_wait_time(wtap *wth)
+{
+	int64_t io_wait = wth->closed_io_wait;
+
+	if (wth->fh != NULL)
+		io_wait += file_get_io_wait(wth->fh);
+	if (wth->random_fh != NULL)
+		io_wait += file_get_io_wait(wth->random_fh);
+	return io_wait;
+}
+
 /*
  * Do an fstat on the file.
  */
@@ -1538,6 +1550,7 @@ wtap_sequential_close(wtap *wth)
 		(*wth->subtype_sequential_close)(wth);
 
 	if (wth->fh != NULL) {
+		wth->closed_io_wait += file_get_io_wait(wth->fh);
 		file_close(wth->fh);
 		wth->fh = NULL;
 	}
@@ -1787,6 +1800,276 @@ wtap_read(wtap *wth, wtap_rec *rec, int *err, char **err_info, int64_t *offset)
 	return true;	/* success */
 }
 
+unsigned
+wtap_read_batch(wtap *wth, wtap_rec *recs, unsigned max, int *err,
+    char **err_info, int64_t *offsets)
+{
+	unsigned n, i;
+
+	/*
+	 * Initialize the records to default values.
+	 */
+	for (i = 0; i < max; i++)
+		wtap_init_rec(wth, &recs[i]);
+
+	*err = 0;
+	*err_info = NULL;
+	if (wth->subtype_read_batch != NULL) {
+		n = wth->subtype_read_batch(wth, recs, max, err, err_info,
+		    offsets);
+	} else {
+		for (n = 0; n < max; n++) {
+			if (!wth->subtype_read(wth, &recs[n], err, err_info,
+			    &offsets[n]))
+				break;
+		}
+	}
+
+	if (n < max) {
+		/*
+		 * We failed to read recs[n]; as in wtap_read(), see
+		 * if there's a deferred error, and unreference any
+		 * block created for that record.
+		 */
+		if (*err == 0)
+			*err = file_error(wth->fh, err_info);
+		if (recs[n].block != NULL) {
+			wtap_block_unref(recs[n].block);
+			recs[n].block = NULL;
+		}
+	}
+
+	for (i = 0; i < n; i++) {
+		if (recs[i].rec_type == REC_TYPE_PACKET) {
+			ws_assert(recs[i].rec_header.packet_header.pkt_encap != WTAP_ENCAP_PER_PACKET);
+			ws_assert(recs[i].rec_header.packet_header.pkt_encap != WTAP_ENCAP_NONE);
+		}
+	}
+
+	return n;
+}
+
+struct wtap_batch {
+	wtap_rec recs[WTAP_BATCH_SIZE];
+	int64_t offsets[WTAP_BATCH_SIZE];
+	unsigned count;		/* number of records read into recs */
+	unsigned next;		/* next record to hand out */
+	bool at_end;		/* the last read got an EOF or error */
+	int err;		/* that error, or 0 for EOF */
+	char *err_info;
+};
+
+wtap_batch *
+wtap_batch_new(size_t space)
+{
+	wtap_batch *batch = g_new0(wtap_batch, 1);
+
+	for (unsigned i = 0; i < WTAP_BATCH_SIZE; i++)
+		wtap_rec_init(&batch->recs[i], space);
+	return batch;
+}
+
+wtap_rec *
+wtap_batch_read(wtap *wth, wtap_batch *batch, int *err, char **err_info,
+    int64_t *offset)
+{
+	if (batch->next == batch->count && !batch->at_end) {
+		/*
+		 * We've handed out everything we have; drop any blocks
+		 * the caller didn't, and read some more.
+		 *
+		 * If we're reading from a pipe, read only one record at
+		 * a time, so that we don't hold on to records that have
+		 * arrived while waiting for more to do so.
+		 */
+		unsigned max = wth->ispipe ? 1 : WTAP_BATCH_SIZE;
+
+		for (unsigned i = 0; i < batch->count; i++)
+			wtap_rec_reset(&batch->recs[i]);
+		batch->count = wtap_read_batch(wth, batch->recs, max,
+		    &batch->err, &batch->err_info, batch->offsets);
+		batch->next = 0;
+		batch->at_end = batch->count < max;
+	}
+
+	if (batch->next == batch->count) {
+		/*
+		 * Report the EOF or error, handing the error string
+		 * to the caller.
+		 */
+		*err = batch->err;
+		*err_info = batch->err_info;
+		batch->err_info = NULL;
+		return NULL;
+	}
+
+	*err = 0;
+	*err_info = NULL;
+	*offset = batch->offsets[batch->next];
+	return &batch->recs[batch->next++];
+}
+
+const wtap_rec *
+wtap_batch_records(const wtap_batch *batch, unsigned *count, unsigned *index)
+{
+	*count = batch->count;
+	*index = batch->next - 1;
+	return batch->recs;
+}
+
+void
+wtap_batch_free(wtap_batch *batch)
+{
+	if (batch == NULL)
+		return;
+	for (unsigned i = 0; i < WTAP_BATCH_SIZE; i++)
+		wtap_rec_cleanup(&batch->recs[i]);
+	g_free(batch->err_info);
+	g_free(batch);
+}
+
+bool
+wtap_scan_index(wtap *wth, unsigned threads, GArray **index, int *err,
+    char **err_info)
+{
+	*index = NULL;
+	*err = 0;
+	*err_info = NULL;
+	if (wth->subtype_scan_index == NULL || wth->ispipe)
+		return false;
+
+	*index = g_array_new(false, false, sizeof(wtap_index_entry));
+	if (!wth->subtype_scan_index(wth, threads, *index, err, err_info)) {
+		g_array_free(*index, true);
+		*index = NULL;
+		return false;
+	}
+	return true;
+}
+
+/*
+ * Don't split a file into ranges smaller than this; for small files,
+ * starting threads would take longer than scanning.
+ */
+#define WTAP_SCAN_MIN_RANGE	(16*1024*1024)
+
+typedef struct {
+	const uint8_t *map;
+	int64_t map_len;
+	wtap_scan_range_func scan;
+	const void *data;
+	wtap_scan_range range;
+} wtap_scan_job;
+
+static void *
+wtap_scan_worker(void *arg)
+{
+	wtap_scan_job *job = (wtap_scan_job *)arg;
+
+	job->range.sync = -1;
+	job->range.stop = job->range.start;
+	job->range.bad = false;
+	if (job->range.blocks == NULL)
+		job->range.blocks = g_array_new(false, false, sizeof(wtap_scan_block));
+	else
+		g_array_set_size(job->range.blocks, 0);
+	job->scan(job->map, job->map_len, job->data, &job->range);
+	return NULL;
+}
+
+GArray *
+wtap_scan_blocks(wtap *wth, unsigned threads, int64_t start,
+    wtap_scan_range_func scan, const void *data)
+{
+	const uint8_t *map;
+	int64_t map_len, range_len, next;
+	unsigned nranges, i;
+	wtap_scan_job *jobs;
+	GThread **workers;
+	GArray *blocks = NULL;
+
+	map = file_get_mapping(wth->fh, &map_len);
+	if (map == NULL || start > map_len)
+		return NULL;
+
+	if (threads == 0)
+		threads = g_get_num_processors();
+	nranges = (unsigned)MIN((int64_t)threads,
+	    (map_len - start) / WTAP_SCAN_MIN_RANGE);
+	if (nranges == 0)
+		nranges = 1;
+	range_len = (map_len - start) / nranges;
+
+	jobs = g_new0(wtap_scan_job, nranges);
+	workers = g_new0(GThread *, nranges);
+	for (i = 0; i < nranges; i++) {
+		jobs[i].map = map;
+		jobs[i].map_len = map_len;
+		jobs[i].scan = scan;
+		jobs[i].data = data;
+		jobs[i].range.start = start + i * range_len;
+		jobs[i].range.end = (i == nranges - 1) ?
+		    map_len : jobs[i].range.start + range_len;
+		jobs[i].range.exact = (i == 0);
+		if (i != 0)
+			workers[i] = g_thread_new("wtap_scan_worker",
+			    wtap_scan_worker, &jobs[i]);
+	}
+	/* We scan the first range ourselves. */
+	wtap_scan_worker(&jobs[0]);
+	for (i = 1; i < nranges; i++)
+		g_thread_join(workers[i]);
+
+	/*
+	 * Stitch the ranges together.  A range's blocks can only be used
+	 * if its first block is the one following the last block of the
+	 * previous range, i.e. if it synchronized on the real block
+	 * boundaries rather than on something that just looked like one;
+	 * if not, scan it again, starting at that block.
+	 */
+	next = start;
+	for (i = 0; i < nranges; i++) {
+		wtap_scan_range *range = &jobs[i].range;
+
+		if (next >= range->end) {
+			/* The previous range's last block covers this one. */
+			continue;
+		}
+		if (range->sync != next) {
+			range->start = next;
+			range->exact = true;
+			wtap_scan_worker(&jobs[i]);
+		}
+		if (range->bad)
+			break;
+		if (blocks == NULL) {
+			blocks = range->blocks;
+			range->blocks = NULL;
+		} else {
+			g_array_append_vals(blocks, range->blocks->data,
+			    range->blocks->len);
+		}
+		next = range->stop;
+	}
+	if (i < nranges || next != map_len) {
+		/*
+		 * The scan found something it couldn't handle, or the last
+		 * block didn't end at the end of the file.
+		 */
+		if (blocks != NULL)
+			g_array_free(blocks, true);
+		blocks = NULL;
+	}
+
+	for (i = 0; i < nranges; i++) {
+		if (jobs[i].range.blocks != NULL)
+			g_array_free(jobs[i].range.blocks, true);
+	}
+	g_free(workers);
+	g_free(jobs);
+	return blocks;
+}
+
 /*
  * Read a given number of bytes from a file into a buffer or, if
  * buf is NULL, just discard them.
@@ -1872,6 +2155,29 @@ wtap_read_bytes_buffer(FILE_T fh, Buffer *buf, unsigned length, int *err,
 	return rv;
 }
 
+/*
+ * Like wtap_read_bytes_buffer(), but, if the buffer is empty and the
+ * file is being read from a memory mapping, the buffer is just pointed
+ * at the data in the mapping, rather than having the data copied into
+ * it.
+ *
+ * The mapping is read-only, so a reader that uses this must call
+ * ws_buffer_make_writable() before changing the data in place.
+ */
+bool
+wtap_read_bytes_buffer_mapped(FILE_T fh, Buffer *buf, unsigned length,
+    int *err, char **err_info)
+{
+	uint8_t *data;
+
+	if (length != 0 && ws_buffer_length(buf) == 0 &&
+	    (data = file_read_mapped(length, fh)) != NULL) {
+		ws_buffer_set_external(buf, data, length);
+		return true;
+	}
+	return wtap_read_bytes_buffer(fh, buf, length, err, err_info);
+}
+
 /*
  * Return an approximation of the amount of data we've read sequentially
  * from the file so far.  (int64_t, in case that's 64 bits.)
@@ -1887,6 +1887,31 @@ WS_DLL_PUBLIC
 struct wtap* wtap_open_offline(const char *filename, unsigned int type, int *err,
     char **err_info, bool do_random);
 
+/**
+ * Set how many bytes a background thread reads ahead of the sequential
+ * reader of files subsequently opened with wtap_open_offline(); 0, the
+ * default, turns readahead off.  This keeps slow (e.g., network) file
+ * systems from stalling the reading of regular files that are being
+ * decompressed or aren't memory-mapped; the OS reads memory-mapped
+ * files ahead itself.
+ *
+ * @param window the number of bytes to read ahead.
+ */
+WS_DLL_PUBLIC
+void wtap_set_readahead_window(size_t window);
+
+/**
+ * Decompress compressed files subsequently opened with wtap_open_offline()
+ * using up to threads threads, if they're regular files made of
+ * independently compressed pieces (such as those written after calling
+ * wtap_set_compression_chunk_size()); 0 or 1, the default, decompresses
+ * on the reading thread.
+ *
+ * @param threads the number of decompression threads.
+ */
+WS_DLL_PUBLIC
+void wtap_set_decompress_threads(unsigned threads);
+
 /**
  * If we were compiled with zlib and we're at EOF, unset EOF so that
  * wtap_read/gzread has a chance to succeed. This is necessary if
@@ -1928,11 +1953,125 @@ void wtap_set_cb_new_secrets(wtap *wth, wtap_new_secrets_callback_t add_new_secr
  * that should be used on calls to wtap_seek_read() to reread that record,
  * if the read succeeded.
  * @return true on success, false on failure.
+ *
+ * The record data might refer directly to the file's contents in memory,
+ * in which case it's valid only until the next read into @rec or until
+ * the file is closed; copy it if it's needed for longer than that.  It
+ * might also be read-only; call ws_buffer_make_writable() on rec->data
+ * before changing it in place.
  */
 WS_DLL_PUBLIC
 bool wtap_read(wtap *wth, wtap_rec *rec, int *err, char **err_info,
     int64_t *offset);
 
+/** Read up to @max records from the file, as if by calling wtap_read()
+ * once for each of them, but without the per-call overhead.
+ *
+ * @wth a wtap * returned by a call that opened a file for reading.
+ * @recs an array of at least @max wtap_recs, each initialized with
+ * wtap_rec_init(), to be filled in with the records.
+ * @param max the maximum number of records to read.
+ * @param err set to 0 on EOF, or to the error if the read failed.
+ * @param err_info for some errors, a string giving more details of
+ * the error
+ * @param offsets an array of at least @max int64_ts, set to the offsets
+ * of the records read, for use with wtap_seek_read().
+ * @return the number of records read; if that's less than @max, the
+ * end of the file was reached, or a read error occurred, after the
+ * last of those records, and *err indicates which.
+ *
+ * Blocks other than records (e.g., interface descriptions, name
+ * resolution or decryption secrets blocks) are processed as they're
+ * read, so they might become available up to @max records earlier
+ * than they would with wtap_read().
+ */
+WS_DLL_PUBLIC
+unsigned wtap_read_batch(wtap *wth, wtap_rec *recs, unsigned max, int *err,
+    char **err_info, int64_t *offsets);
+
+/** Number of records a wtap_batch reads at a time. */
+#define WTAP_BATCH_SIZE 64
+
+/** A set of records read with wtap_read_batch() and handed out one at a
+ * time by wtap_batch_read(). */
+typedef struct wtap_batch wtap_batch;
+
+/** Create a wtap_batch, with @space bytes initially allocated for each
+ * record's data. */
+WS_DLL_PUBLIC
+wtap_batch *wtap_batch_new(size_t space);
+
+/** Return the next record in the file, reading another batch of records
+ * if all the ones in @batch have been returned; this is a drop-in
+ * replacement for wtap_read() in a sequential read loop.  Records are
+ * read one at a time from pipes, so as not to delay them.
+ *
+ * The record remains valid until the next call; the caller should call
+ * wtap_rec_reset() on it when done with it, as with wtap_read().
+ *
+ * @return the record, or NULL at the end of the file (with *err set to
+ * 0) or on a read error.
+ */
+WS_DLL_PUBLIC
+wtap_rec *wtap_batch_read(wtap *wth, wtap_batch *batch, int *err,
+    char **err_info, int64_t *offset);
+
+/** Return the records currently in @batch, setting *@count to their
+ * number and *@index to the index of the one last returned by
+ * wtap_batch_read(), so that a caller can look at the records of a batch
+ * ahead of processing them, when *@index is 0. */
+WS_DLL_PUBLIC
+const wtap_rec *wtap_batch_records(const wtap_batch *batch, unsigned *count,
+    unsigned *index);
+
+/** Free a wtap_batch, along with any records it holds. */
+WS_DLL_PUBLIC
+void wtap_batch_free(wtap_batch *batch);
+
+/** A packet record found by wtap_scan_index(). */
+typedef struct {
+    int64_t  offset;          /**< Offset of the record, for wtap_seek_read() */
+    uint32_t presence_flags;  /**< WTAP_HAS_ flags, as for a wtap_rec */
+    nstime_t ts;              /**< Time stamp */
+    int      tsprec;          /**< Time stamp precision */
+    uint32_t caplen;          /**< Captured length */
+    uint32_t len;             /**< Length on the network */
+    int      pkt_encap;       /**< Encapsulation type */
+    uint32_t interface_id;    /**< Interface ID, if WTAP_HAS_INTERFACE_ID */
+    unsigned section_number;  /**< Section number, if WTAP_HAS_SECTION_NUMBER */
+} wtap_index_entry;
+
+/** Find all the remaining packet records in the file without reading
+ * their data, splitting the file into byte ranges that are scanned in
+ * parallel by @threads threads (0 meaning one per processor).  This is
+ * much faster than a wtap_read() loop for large uncompressed files.
+ *
+ * Only some file types can be scanned, and only when the file is
+ * uncompressed, memory-mapped, and has nothing but packet records and
+ * blocks that are processed internally; otherwise false is returned
+ * with *err set to 0, and nothing has been read, so the caller should
+ * fall back on a wtap_read() loop.  Damaged files are also left to
+ * that loop, so that it can report the error at the right place.
+ *
+ * On success, non-packet blocks have been processed as wtap_read()
+ * would have (so that, for example, all the interface descriptions
+ * are available, and the new-address and new-secrets callbacks have
+ * been called), and the file is at its end.
+ *
+ * @param wth a wtap * returned by a call that opened a file for reading.
+ * @param threads the number of threads to use.
+ * @param index set to a GArray of wtap_index_entry, in file order, on
+ * success; free it with g_array_free().
+ * @param err set to 0 if the file can't be scanned, or to the error if
+ * the scan failed.
+ * @param err_info for some errors, a string giving more details of
+ * the error
+ * @return true on success, false otherwise.
+ */
+WS_DLL_PUBLIC
+bool wtap_scan_index(wtap *wth, unsigned threads, GArray **index, int *err,
+    char **err_info);
+
 /** Read the record at a specified offset in a capture file, filling in
  * *phdr and *buf.
  *
@@ -1998,12 +2137,32 @@ GSList *wtap_get_all_output_compression_type_names_list(void);
 WS_DLL_PUBLIC
 bool wtap_can_write_compression_type(wtap_compression_type compression_type);
 
+/** Default size of the independently compressed pieces written with
+ * wtap_set_compression_chunk_size(). */
+#define WTAP_COMPRESSION_CHUNK_SIZE (1024 * 1024)
+
+/**
+ * Write compressed files opened from now on as a series of independently
+ * compressed gzip members or lz4 frames, each holding about size bytes
+ * of uncompressed data, so that they can be decompressed in parallel;
+ * gzip members record their own length, so that readers can find the
+ * next one without decompressing.  0, the default, writes one stream.
+ *
+ * @param size the number of bytes of uncompressed data per piece.
+ */
+WS_DLL_PUBLIC
+void wtap_set_compression_chunk_size(size_t size);
+
 /*** get various information snippets about the current file ***/
 
 /** Return an approximation of the amount of data we've read sequentially
  * from the file so far. */
 WS_DLL_PUBLIC
 int64_t wtap_read_so_far(wtap *wth);
+/** Return the number of microseconds spent waiting for data from the
+ * file, including waiting for the readahead thread. */
+WS_DLL_PUBLIC
+int64_t wtap_io_wait_time(wtap *wth);
 WS_DLL_PUBLIC
 int64_t wtap_file_size(wtap *wth, int *err);
 WS_DLL_PUBLIC
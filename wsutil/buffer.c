@@ -50,7 +50,8 @@ ws_buffer_free(Buffer* buffer)
 	if (buffer->allocated == SMALL_BUFFER_SIZE) {
 		ws_assert(buffer->data);
 		g_ptr_array_add(small_buffers, buffer->data);
-	} else {
+	} else if (buffer->allocated != 0) {
+		/* allocated == 0 means external data; see ws_buffer_set_external() */
 		g_free(buffer->data);
 	}
 	buffer->allocated = 0;
@@ -65,10 +66,25 @@ void
 ws_buffer_assure_space(Buffer* buffer, size_t space)
 {
 	ws_assert(buffer);
-	size_t available_at_end = buffer->allocated - buffer->first_free;
+	size_t available_at_end;
 	size_t space_used;
 	bool space_at_beginning;
 
+	/* If the data belongs to someone else, copy it into storage of
+		our own first. */
+	if (buffer->allocated == 0 && buffer->data != NULL) {
+		uint8_t *external = buffer->data + buffer->start;
+
+		space_used = buffer->first_free - buffer->start;
+		ws_buffer_init(buffer, space_used + space);
+		if (space_used != 0)
+			memcpy(buffer->data, external, space_used);
+		buffer->first_free = space_used;
+		return;
+	}
+
+	available_at_end = buffer->allocated - buffer->first_free;
+
 	/* If we've got the space already, good! */
 	if (space <= available_at_end) {
 		return;
@@ -100,6 +116,33 @@ ws_buffer_assure_space(Buffer* buffer, size_t space)
 	buffer->data = (uint8_t*)g_realloc(buffer->data, buffer->allocated);
 }
 
+/* Makes the buffer refer to 'bytes' bytes of data at 'data' without
+	copying them, freeing any space the buffer had allocated. The data
+	belong to the caller and must stay valid for as long as the buffer
+	refers to them; if the buffer is later grown, they are copied into
+	newly allocated space first. */
+void
+ws_buffer_set_external(Buffer* buffer, uint8_t *data, size_t bytes)
+{
+	ws_assert(buffer);
+	ws_buffer_free(buffer);
+	buffer->data = data;
+	buffer->allocated = 0;
+	buffer->start = 0;
+	buffer->first_free = bytes;
+}
+
+/* Makes sure the buffer's data is its own, copying it if it refers to
+	data set with ws_buffer_set_external(), so that it can be modified
+	in place. */
+void
+ws_buffer_make_writable(Buffer* buffer)
+{
+	ws_assert(buffer);
+	if (buffer->allocated == 0 && buffer->data != NULL)
+		ws_buffer_assure_space(buffer, 0);
+}
+
 void
 ws_buffer_append(Buffer* buffer, const uint8_t *from, size_t bytes)
 {
@@ -33,6 +33,10 @@ void ws_buffer_free(Buffer* buffer);
 WS_DLL_PUBLIC
 void ws_buffer_assure_space(Buffer* buffer, size_t space);
 WS_DLL_PUBLIC
+void ws_buffer_set_external(Buffer* buffer, uint8_t *data, size_t bytes);
+WS_DLL_PUBLIC
+void ws_buffer_make_writable(Buffer* buffer);
+WS_DLL_PUBLIC
 void ws_buffer_append(Buffer* buffer, const uint8_t *from, size_t bytes);
 WS_DLL_PUBLIC
 void ws_buffer_remove_start(Buffer* buffer, size_t bytes);
@@ -16,6 +16,11 @@
 #include "config.h"
 
 #include <wsutil/crc32.h>
+#include "crc32_int.h"
+
+#if defined(HAVE_SSE4_2) || defined(HAVE_PCLMUL)
+#include "ws_cpuid.h"
+#endif
 
 #ifdef HAVE_ZLIBNG
 #include <zlib-ng.h>
@@ -373,21 +378,30 @@ crc32_ccitt_table_lookup (unsigned char pos)
 	return crc32_ccitt_table[pos];
 }
 
+#ifdef HAVE_SSE4_2
+WS_CPUID_CACHED(crc32c_use_sse42, ws_cpuid_sse42)
+#endif
+
+#ifdef HAVE_PCLMUL
+WS_CPUID_CACHED(crc32_use_pclmul, ws_cpuid_pclmul)
+#endif
+
 uint32_t
 crc32c_calculate(const void *buf, int len, uint32_t crc)
 {
-	const uint8_t *p = (const uint8_t *)buf;
-	crc = CRC32C_SWAP(crc);
-	while (len-- > 0) {
-		CRC32C(crc, *p++);
-	}
-	return CRC32C_SWAP(crc);
+	return CRC32C_SWAP(crc32c_calculate_no_swap(buf, len, CRC32C_SWAP(crc)));
 }
 
 uint32_t
 crc32c_calculate_no_swap(const void *buf, int len, uint32_t crc)
 {
 	const uint8_t *p = (const uint8_t *)buf;
+
+#ifdef HAVE_SSE4_2
+	if (len > 0 && crc32c_use_sse42())
+		return crc32c_calculate_sse42(p, len, crc);
+#endif
+
 	while (len-- > 0) {
 		CRC32C(crc, *p++);
 	}
@@ -404,20 +418,32 @@ crc32_ccitt(const uint8_t *buf, unsigned len)
 uint32_t
 crc32_ccitt_seed(const uint8_t *buf, unsigned len, uint32_t seed)
 {
-#if defined (HAVE_ZLIB) || defined (HAVE_ZLIBNG)
 #ifdef HAVE_ZLIBNG
+	/* zlib-ng picks a vectorized implementation itself. */
 	return (unsigned)zng_crc32(~seed, buf, len);
 #else
-	return (unsigned)crc32(~seed, buf, len);
+	uint32_t crc = seed;
+
+#ifdef HAVE_PCLMUL
+	if (len >= 64 && crc32_use_pclmul()) {
+		unsigned folded = len & ~15U;
+
+		crc = crc32_ccitt_pclmul(buf, folded, crc);
+		buf += folded;
+		len -= folded;
+	}
 #endif
+
+#ifdef HAVE_ZLIB
+	return (unsigned)crc32(~crc, buf, len);
 #else
 	unsigned i;
-	uint32_t crc32 = seed;
 
 	for (i = 0; i < len; i++)
-		CRC32_ACCUMULATE(crc32, buf[i], crc32_ccitt_table);
+		CRC32_ACCUMULATE(crc, buf[i], crc32_ccitt_table);
 
-	return ( ~crc32 );
+	return ( ~crc );
+#endif
 #endif
 }
 
@@ -0,0 +1,27 @@
+/** @file
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __CRC32_INT_H__
+#define __CRC32_INT_H__
+
+/*
+ * These take and return the CRC register itself, neither inverted nor
+ * byte-swapped, like crc32c_calculate_no_swap().
+ */
+
+#ifdef HAVE_SSE4_2
+uint32_t crc32c_calculate_sse42(const uint8_t *buf, size_t len, uint32_t crc);
+#endif
+
+#ifdef HAVE_PCLMUL
+/* len must be at least 64 and a multiple of 16. */
+uint32_t crc32_ccitt_pclmul(const uint8_t *buf, size_t len, uint32_t crc);
+#endif
+
+#endif /* __CRC32_INT_H__ */
@@ -0,0 +1,116 @@
+/* crc32_pclmul.c
+ * CRC-32 (the one of Ethernet, zlib, ...) with the PCLMULQDQ carry-less
+ * multiplication instruction; this file is compiled with PCLMULQDQ and
+ * SSE4.1 enabled, and its routines are only called if the processor
+ * supports them.
+ *
+ * This is the folding method of "Fast CRC Computation for Generic
+ * Polynomials Using PCLMULQDQ Instruction", Intel, 2009: four 128-bit
+ * lanes are folded 64 bytes ahead at a time, then into one lane, which
+ * is reduced to 32 bits with a Barrett reduction.  The constants are
+ * x^n mod P(x), bit-reflected, for the reflected polynomial 0x04C11DB7.
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#ifdef HAVE_PCLMUL
+
+#include <smmintrin.h>
+#include <wmmintrin.h>
+
+#include <wsutil/crc32.h>
+#include "crc32_int.h"
+
+/* x^(4*128+32) and x^(4*128-32) mod P(x), to fold 64 bytes ahead */
+#define K1 0x0154442bd4U
+#define K2 0x01c6e41596U
+/* x^(128+32) and x^(128-32) mod P(x), to fold 16 bytes ahead */
+#define K3 0x01751997d0U
+#define K4 0x00ccaa009eU
+/* x^64 mod P(x), to fold 96 bits into 64 */
+#define K5 0x0163cd6124U
+/* P(x) and floor(x^64 / P(x)), for the Barrett reduction */
+#define P_X  0x01db710641U
+#define MU   0x01f7011641U
+
+static inline __m128i
+fold_16(__m128i x, __m128i k, __m128i data)
+{
+	__m128i lo = _mm_clmulepi64_si128(x, k, 0x00);
+	__m128i hi = _mm_clmulepi64_si128(x, k, 0x11);
+
+	return _mm_xor_si128(_mm_xor_si128(lo, hi), data);
+}
+
+uint32_t
+crc32_ccitt_pclmul(const uint8_t *buf, size_t len, uint32_t crc)
+{
+	const __m128i mask32 = _mm_setr_epi32(-1, 0, -1, 0);
+	__m128i k, x0, x1, x2, x3, t;
+
+	x0 = _mm_loadu_si128((const __m128i *)(const void *)(buf + 0));
+	x1 = _mm_loadu_si128((const __m128i *)(const void *)(buf + 16));
+	x2 = _mm_loadu_si128((const __m128i *)(const void *)(buf + 32));
+	x3 = _mm_loadu_si128((const __m128i *)(const void *)(buf + 48));
+	x0 = _mm_xor_si128(x0, _mm_cvtsi32_si128((int)crc));
+	buf += 64;
+	len -= 64;
+
+	k = _mm_set_epi64x(K2, K1);
+	while (len >= 64) {
+		x0 = fold_16(x0, k, _mm_loadu_si128((const __m128i *)(const void *)(buf + 0)));
+		x1 = fold_16(x1, k, _mm_loadu_si128((const __m128i *)(const void *)(buf + 16)));
+		x2 = fold_16(x2, k, _mm_loadu_si128((const __m128i *)(const void *)(buf + 32)));
+		x3 = fold_16(x3, k, _mm_loadu_si128((const __m128i *)(const void *)(buf + 48)));
+		buf += 64;
+		len -= 64;
+	}
+
+	/* Fold the four lanes into one, then any remaining 16-byte blocks. */
+	k = _mm_set_epi64x(K4, K3);
+	x0 = fold_16(x0, k, x1);
+	x0 = fold_16(x0, k, x2);
+	x0 = fold_16(x0, k, x3);
+	while (len >= 16) {
+		x0 = fold_16(x0, k, _mm_loadu_si128((const __m128i *)(const void *)buf));
+		buf += 16;
+		len -= 16;
+	}
+
+	/* 128 bits to 64 */
+	t = _mm_clmulepi64_si128(x0, k, 0x10);
+	x0 = _mm_xor_si128(_mm_srli_si128(x0, 8), t);
+	k = _mm_set_epi64x(0, K5);
+	t = _mm_srli_si128(x0, 4);
+	x0 = _mm_clmulepi64_si128(_mm_and_si128(x0, mask32), k, 0x00);
+	x0 = _mm_xor_si128(x0, t);
+
+	/* Barrett reduction to 32 bits */
+	k = _mm_set_epi64x(MU, P_X);
+	t = _mm_clmulepi64_si128(_mm_and_si128(x0, mask32), k, 0x10);
+	t = _mm_clmulepi64_si128(_mm_and_si128(t, mask32), k, 0x00);
+	x0 = _mm_xor_si128(x0, t);
+
+	return (uint32_t)_mm_extract_epi32(x0, 1);
+}
+
+#endif /* HAVE_PCLMUL */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
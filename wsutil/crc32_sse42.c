@@ -0,0 +1,80 @@
+/* crc32_sse42.c
+ * CRC32C with the SSE4.2 crc32 instruction; this file is compiled with
+ * SSE4.2 enabled, and its routines are only called if the processor
+ * supports SSE4.2.
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#ifdef HAVE_SSE4_2
+
+#include <string.h>
+
+#include <nmmintrin.h>
+
+#include <wsutil/crc32.h>
+#include "crc32_int.h"
+
+/*
+ * The instruction computes the reflected CRC with the Castagnoli
+ * polynomial, without inverting it, so it updates the same register as
+ * the table in crc32.c does.
+ */
+uint32_t
+crc32c_calculate_sse42(const uint8_t *buf, size_t len, uint32_t crc)
+{
+	while (len > 0 && ((uintptr_t)buf & 7) != 0) {
+		crc = _mm_crc32_u8(crc, *buf++);
+		len--;
+	}
+
+#if defined(__x86_64__) || defined(_M_X64)
+	uint64_t crc64 = crc;
+	uint64_t data64;
+
+	while (len >= 8) {
+		memcpy(&data64, buf, sizeof data64);
+		crc64 = _mm_crc32_u64(crc64, data64);
+		buf += 8;
+		len -= 8;
+	}
+	crc = (uint32_t)crc64;
+#endif
+
+	uint32_t data32;
+
+	while (len >= 4) {
+		memcpy(&data32, buf, sizeof data32);
+		crc = _mm_crc32_u32(crc, data32);
+		buf += 4;
+		len -= 4;
+	}
+
+	while (len > 0) {
+		crc = _mm_crc32_u8(crc, *buf++);
+		len--;
+	}
+
+	return crc;
+}
+
+#endif /* HAVE_SSE4_2 */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
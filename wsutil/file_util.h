@@ -109,6 +109,7 @@ typedef signed int ws_file_ssize_t;
 #define ws_write   _write
 #define ws_close   _close
 #define ws_dup     _dup
+#define ws_dup2    _dup2
 #define ws_fseek64 _fseeki64	/* use _fseeki64 for 64-bit offset support */
 #define ws_fstat64 _fstati64	/* use _fstati64 for 64-bit size support */
 #define ws_ftell64 _ftelli64	/* use _ftelli64 for 64-bit offset support */
@@ -201,6 +202,7 @@ typedef ssize_t ws_file_ssize_t;
 #define ws_close_if_possible ws_close
 
 #define ws_dup     dup
+#define ws_dup2    dup2
 #ifdef HAVE_FSEEKO
 #define ws_fseek64 fseeko	/* AC_SYS_LARGEFILE should make off_t 64-bit */
 #define ws_ftell64 ftello	/* AC_SYS_LARGEFILE should make off_t 64-bit */
@@ -9,10 +9,15 @@
 #include "config.h"
 
 #include <stdio.h>
+#include <string.h>
 #include <glib.h>
 #include <wsutil/utf8_entities.h>
 #include <wsutil/time_util.h>
 #include <wsutil/to_str.h>
+#include <wsutil/crc32.h>
+#include <wsutil/ws_memfind.h>
+#include <wsutil/ws_mempbrk.h>
+#include <wsutil/ws_ones_sum.h>
 
 #include "inet_addr.h"
 
@@ -279,6 +284,233 @@ static void test_format_text_perf(void)
         "format_text_string(): u %.3f ms s %.3f ms", utime_ms, stime_ms);
 }
 
+static void test_memchr2(void)
+{
+    /* Long enough for the vector loops and the byte-at-a-time tails. */
+    uint8_t buf[100];
+    const uint8_t *p;
+    size_t i;
+
+    memset(buf, 'x', sizeof buf);
+    g_assert_null(ws_memchr2(buf, sizeof buf, '\r', '\n'));
+
+    for (i = 0; i < sizeof buf; i++) {
+        memset(buf, 'x', sizeof buf);
+        buf[i] = '\n';
+        if (i + 1 < sizeof buf)
+            buf[i + 1] = '\r';
+        p = ws_memchr2(buf, sizeof buf, '\r', '\n');
+        g_assert_true(p == &buf[i]);
+        /* Not beyond the end of the haystack */
+        g_assert_null(ws_memchr2(buf, i, '\r', '\n'));
+    }
+}
+
+static void test_mempair(void)
+{
+    uint8_t buf[100];
+    const uint8_t *p;
+    size_t i;
+
+    memset(buf, '\r', sizeof buf);
+    g_assert_null(ws_mempair(buf, sizeof buf, '\r', '\n'));
+
+    for (i = 0; i + 1 < sizeof buf; i++) {
+        memset(buf, '\r', sizeof buf);
+        buf[i + 1] = '\n';
+        p = ws_mempair(buf, sizeof buf, '\r', '\n');
+        g_assert_true(p == &buf[i]);
+        /* The pair has to be entirely in the haystack */
+        g_assert_null(ws_mempair(buf, i + 1, '\r', '\n'));
+        g_assert_null(ws_mempair(buf + i + 1, sizeof buf - i - 1, '\r', '\n'));
+    }
+}
+
+static void test_mempbrk_crlf(void)
+{
+    ws_mempbrk_pattern pattern;
+    const uint8_t *text = (const uint8_t *)"GET / HTTP/1.1\r\nHost: www.example.com\r\n\r\n";
+    unsigned char found = 0;
+    const uint8_t *p;
+
+    ws_mempbrk_compile(&pattern, "\r\n");
+    p = ws_mempbrk_exec(text, strlen((const char *)text), &pattern, &found);
+    g_assert_true(p == text + 14);
+    g_assert_cmpint(found, ==, '\r');
+    p = ws_mempbrk_exec(text + 15, strlen((const char *)text) - 15, &pattern, &found);
+    g_assert_true(p == text + 15);
+    g_assert_cmpint(found, ==, '\n');
+    g_assert_null(ws_mempbrk_exec(text, 14, &pattern, &found));
+}
+
+static void test_mempbrk_crlf_perf(void)
+{
+#define CRLF_LOOP_COUNT (10 * 1000)
+    ws_mempbrk_pattern pattern;
+    uint8_t            *text;
+    const uint8_t      *p, *end;
+    size_t              text_len = 64 * 1024;
+    unsigned            lines;
+    int                 i;
+    double              start_utime, start_stime, end_utime, end_stime, utime_ms, stime_ms;
+
+    /* Header-like lines of about 60 bytes */
+    text = g_malloc(text_len);
+    for (size_t j = 0; j < text_len; j++)
+        text[j] = (j % 60 == 58) ? '\r' : (j % 60 == 59) ? '\n' : 'a' + j % 26;
+    ws_mempbrk_compile(&pattern, "\r\n");
+
+    RESOURCE_USAGE_START;
+    for (i = 0; i < CRLF_LOOP_COUNT; i++) {
+        lines = 0;
+        end = text + text_len;
+        for (p = text; (p = ws_mempbrk_exec(p, end - p, &pattern, NULL)) != NULL; p += 2)
+            lines++;
+        g_assert_cmpuint(lines, ==, text_len / 60);
+    }
+    RESOURCE_USAGE_END;
+    g_test_minimized_result(utime_ms + stime_ms,
+        "ws_mempbrk_exec() CRLF: u %.3f ms s %.3f ms", utime_ms, stime_ms);
+    g_free(text);
+}
+
+/*
+ * Byte-at-a-time versions of the checksums, using the tables of the
+ * original implementations, to check the accelerated ones against.
+ */
+static uint32_t ref_crc32c(const uint8_t *buf, size_t len, uint32_t crc)
+{
+    while (len-- > 0)
+        crc = (crc >> 8) ^ crc32c_table_lookup((crc ^ *buf++) & 0xFF);
+    return crc;
+}
+
+static uint32_t ref_crc32_ccitt(const uint8_t *buf, size_t len, uint32_t crc)
+{
+    while (len-- > 0)
+        crc = (crc >> 8) ^ crc32_ccitt_table_lookup((crc ^ *buf++) & 0xFF);
+    return ~crc;
+}
+
+static uint16_t ref_ones_sum16(const uint8_t *buf, size_t len)
+{
+    uint32_t sum = 0;
+    uint16_t word;
+
+    for (size_t i = 0; i < len; i += 2) {
+        uint8_t bytes[2] = { buf[i], i + 1 < len ? buf[i + 1] : 0 };
+
+        memcpy(&word, bytes, sizeof word);
+        sum += word;
+        if (sum > 0xFFFF)
+            sum -= 0xFFFF;
+    }
+    return (uint16_t)sum;
+}
+
+/* Random data, with every alignment and length up to a few vectors. */
+#define CKSUM_BUF_LEN 600
+
+static uint8_t *cksum_test_data(void)
+{
+    uint8_t *buf = g_malloc(CKSUM_BUF_LEN);
+
+    for (size_t i = 0; i < CKSUM_BUF_LEN; i++)
+        buf[i] = (uint8_t)g_test_rand_int();
+    return buf;
+}
+
+static void test_crc32c(void)
+{
+    uint8_t *buf = cksum_test_data();
+
+    /* The check value of CRC-32C, from RFC 3720 section B.4 */
+    g_assert_cmphex(~crc32c_calculate_no_swap("123456789", 9, CRC32C_PRELOAD), ==, 0xE3069283);
+
+    for (size_t offset = 0; offset < 16; offset++) {
+        for (size_t len = 0; offset + len <= CKSUM_BUF_LEN; len++) {
+            g_assert_cmphex(crc32c_calculate_no_swap(buf + offset, (int)len, CRC32C_PRELOAD), ==,
+                            ref_crc32c(buf + offset, len, CRC32C_PRELOAD));
+            g_assert_cmphex(crc32c_calculate(buf + offset, (int)len, 0x12345678), ==,
+                            CRC32C_SWAP(ref_crc32c(buf + offset, len, CRC32C_SWAP(0x12345678U))));
+        }
+    }
+    g_free(buf);
+}
+
+static void test_crc32_ccitt(void)
+{
+    uint8_t *buf = cksum_test_data();
+
+    /* The check value of CRC-32 */
+    g_assert_cmphex(crc32_ccitt((const uint8_t *)"123456789", 9), ==, 0xCBF43926);
+
+    for (size_t offset = 0; offset < 16; offset++) {
+        for (size_t len = 0; offset + len <= CKSUM_BUF_LEN; len++) {
+            g_assert_cmphex(crc32_ccitt(buf + offset, (unsigned)len), ==,
+                            ref_crc32_ccitt(buf + offset, len, CRC32_CCITT_SEED));
+            g_assert_cmphex(crc32_ccitt_seed(buf + offset, (unsigned)len, 0x12345678), ==,
+                            ref_crc32_ccitt(buf + offset, len, 0x12345678));
+        }
+    }
+    g_free(buf);
+}
+
+static void test_ones_sum16(void)
+{
+    uint8_t *buf = cksum_test_data();
+
+    for (size_t offset = 0; offset < 32; offset++) {
+        for (size_t len = 0; offset + len <= CKSUM_BUF_LEN; len++) {
+            g_assert_cmphex(ws_ones_sum16(buf + offset, len), ==,
+                            ref_ones_sum16(buf + offset, len));
+        }
+    }
+
+    /* A sum of zeros is 0, any other multiple of 0xFFFF is 0xFFFF. */
+    memset(buf, 0, CKSUM_BUF_LEN);
+    g_assert_cmphex(ws_ones_sum16(buf, CKSUM_BUF_LEN), ==, 0);
+    memset(buf, 0xFF, CKSUM_BUF_LEN);
+    g_assert_cmphex(ws_ones_sum16(buf, CKSUM_BUF_LEN), ==, 0xFFFF);
+    g_free(buf);
+}
+
+static void test_cksum_perf(void)
+{
+#define CKSUM_LOOP_COUNT (100 * 1000)
+    uint8_t            *buf;
+    size_t              len = 1500;
+    int                 i;
+    double              start_utime, start_stime, end_utime, end_stime, utime_ms, stime_ms;
+
+    buf = g_malloc(len);
+    for (size_t j = 0; j < len; j++)
+        buf[j] = (uint8_t)j;
+
+    RESOURCE_USAGE_START;
+    for (i = 0; i < CKSUM_LOOP_COUNT; i++)
+        crc32c_calculate_no_swap(buf, (int)len, CRC32C_PRELOAD);
+    RESOURCE_USAGE_END;
+    g_test_minimized_result(utime_ms + stime_ms,
+        "crc32c_calculate_no_swap() 1500 bytes: u %.3f ms s %.3f ms", utime_ms, stime_ms);
+
+    RESOURCE_USAGE_START;
+    for (i = 0; i < CKSUM_LOOP_COUNT; i++)
+        crc32_ccitt(buf, (unsigned)len);
+    RESOURCE_USAGE_END;
+    g_test_minimized_result(utime_ms + stime_ms,
+        "crc32_ccitt() 1500 bytes: u %.3f ms s %.3f ms", utime_ms, stime_ms);
+
+    RESOURCE_USAGE_START;
+    for (i = 0; i < CKSUM_LOOP_COUNT; i++)
+        ws_ones_sum16(buf, len);
+    RESOURCE_USAGE_END;
+    g_test_minimized_result(utime_ms + stime_ms,
+        "ws_ones_sum16() 1500 bytes: u %.3f ms s %.3f ms", utime_ms, stime_ms);
+
+    g_free(buf);
+}
+
 #include "to_str.h"
 
 static void test_word_to_hex(void)
@@ -874,6 +1106,22 @@ int main(int argc, char **argv)
         g_test_add_func("/str_util/format_text_perf", test_format_text_perf);
     }
 
+    g_test_add_func("/ws_memfind/memchr2", test_memchr2);
+    g_test_add_func("/ws_memfind/mempair", test_mempair);
+    g_test_add_func("/ws_mempbrk/crlf", test_mempbrk_crlf);
+
+    if (g_test_perf()) {
+        g_test_add_func("/ws_mempbrk/crlf_perf", test_mempbrk_crlf_perf);
+    }
+
+    g_test_add_func("/checksum/crc32c", test_crc32c);
+    g_test_add_func("/checksum/crc32_ccitt", test_crc32_ccitt);
+    g_test_add_func("/checksum/ones_sum16", test_ones_sum16);
+
+    if (g_test_perf()) {
+        g_test_add_func("/checksum/perf", test_cksum_perf);
+    }
+
     g_test_add_func("/to_str/word_to_hex", test_word_to_hex);
     g_test_add_func("/to_str/bytes_to_str", test_bytes_to_str);
     g_test_add_func("/to_str/bytes_to_str_punct", test_bytes_to_str_punct);
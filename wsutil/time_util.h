@@ -68,6 +68,13 @@ void ws_tzset(void);
 WS_DLL_PUBLIC
 struct timespec *ws_clock_get_realtime(struct timespec *ts);
 
+/**
+ * Fetch a monotonic clock value in nanoseconds, suitable for measuring
+ * short intervals. The origin is unspecified.
+ */
+WS_DLL_PUBLIC
+uint64_t ws_monotonic_time_ns(void);
+
 WS_DLL_PUBLIC
 struct tm *ws_localtime_r(const time_t *timep, struct tm *result);
 
@@ -35,6 +35,10 @@ struct _wmem_allocator_t {
     void  (*gc)(void *private_data);
     void  (*cleanup)(void *private_data);
 
+    /* Optional: the number of bytes handed out since the allocator was
+     * created, for allocators that can keep it without per-object cost */
+    uint64_t (*bytes_used)(void *private_data);
+
     /* Callback List */
     struct _wmem_user_cb_container_t *callbacks;
 
@@ -42,6 +46,14 @@ struct _wmem_allocator_t {
     void                        *private_data;
     enum _wmem_allocator_type_t  type;
     bool                         in_scope;
+
+    /* For profiling: the bytes counted so far while counting was on,
+     * whether it is on, and the reading of bytes_used() when it was
+     * turned on. Allocators without bytes_used() have the bytes requested
+     * counted by wmem_alloc() and wmem_realloc() instead. */
+    uint64_t                     bytes_allocated;
+    bool                         count_bytes;
+    uint64_t                     bytes_used_start;
 };
 
 #ifdef __cplusplus
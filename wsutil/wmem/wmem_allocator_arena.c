@@ -0,0 +1,452 @@
+/* wmem_allocator_arena.c
+ * Wireshark Memory Manager Bump-Pointer Arena Allocator
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib.h>
+
+#include "wmem_core.h"
+#include "wmem_allocator.h"
+#include "wmem_allocator_arena.h"
+
+/* This allocator is meant for the packet scope: a very large number of small
+ * allocations that are all released together a few microseconds later.
+ *
+ * - Allocations are carved out of large chunks by bumping a pointer. There is
+ *   no per-object header, so small objects are packed as densely as the
+ *   alignment allows.
+ * - free_all() rewinds the pointer to the start of the first chunk and keeps
+ *   every chunk for the next round, so it does not touch the chunks at all.
+ * - Chunks released by gc() or by destroying the allocator go to a small
+ *   per-thread cache and are handed to the next arena allocator created on
+ *   that thread instead of going back to malloc. The cache is freed when the
+ *   thread exits.
+ *
+ * Since there are no headers, realloc() cannot know the size of the original
+ * object. The most recent allocation is grown or shrunk in place; otherwise a
+ * new object is allocated and the old bytes are copied, bounded by what is
+ * addressable in the chunk the old object lives in.
+ */
+
+/* Same alignment as the other block allocators (and GNU libc). */
+#define WMEM_ALIGN_AMOUNT (2 * sizeof (size_t))
+#define WMEM_ALIGN_SIZE(SIZE) ((~(WMEM_ALIGN_AMOUNT-1)) & \
+        ((SIZE) + (WMEM_ALIGN_AMOUNT-1)))
+
+/* Size of the chunks requested from the OS. Same reasoning as for
+ * WMEM_ALLOCATOR_BLOCK_FAST: big enough to hold many packets' worth of
+ * allocations, small enough that an idle one doesn't waste too much. */
+#define WMEM_ARENA_CHUNK_SIZE (2 * 1024 * 1024)
+
+/* Anything larger than this gets its own allocation, so that a single large
+ * object doesn't waste most of a chunk. */
+#define WMEM_ARENA_MAX_ALLOC_SIZE (WMEM_ARENA_CHUNK_SIZE / 8)
+
+/* Number of free chunks each thread keeps around for reuse. */
+#define WMEM_ARENA_CACHE_MAX 8
+
+typedef struct _wmem_arena_chunk {
+    struct _wmem_arena_chunk *next;
+} wmem_arena_chunk_t;
+#define WMEM_ARENA_CHUNK_HEADER_SIZE WMEM_ALIGN_SIZE(sizeof(wmem_arena_chunk_t))
+
+#define WMEM_ARENA_CHUNK_DATA(CHUNK) ((uint8_t*)(CHUNK) + WMEM_ARENA_CHUNK_HEADER_SIZE)
+#define WMEM_ARENA_CHUNK_END(CHUNK)  ((uint8_t*)(CHUNK) + WMEM_ARENA_CHUNK_SIZE)
+
+typedef struct _wmem_arena_jumbo {
+    struct _wmem_arena_jumbo *prev, *next;
+    size_t size;
+} wmem_arena_jumbo_t;
+#define WMEM_ARENA_JUMBO_HEADER_SIZE WMEM_ALIGN_SIZE(sizeof(wmem_arena_jumbo_t))
+
+#define WMEM_ARENA_JUMBO_TO_DATA(JUMBO) ((void*)((uint8_t*)(JUMBO) + WMEM_ARENA_JUMBO_HEADER_SIZE))
+#define WMEM_ARENA_DATA_TO_JUMBO(DATA)  ((wmem_arena_jumbo_t*)((uint8_t*)(DATA) - WMEM_ARENA_JUMBO_HEADER_SIZE))
+
+typedef struct {
+    uint8_t *pos;   /* next free byte in the current chunk */
+    uint8_t *end;   /* end of the current chunk */
+    uint8_t *last;  /* most recent allocation, NULL if unknown */
+
+    /* Chunks in the order they are used; the ones after 'current' are
+     * retained from before the last free_all() and used again before any
+     * new chunk is requested. */
+    wmem_arena_chunk_t *chunk_list;
+    wmem_arena_chunk_t *current;
+
+    wmem_arena_jumbo_t *jumbo_list;
+
+    /* Bytes handed out since the allocator was created, for
+     * wmem_bytes_allocated(): the aligned size of each object carved out of
+     * a chunk, what a realloc in place adds, and the size of jumbo objects */
+    uint64_t bytes_used;
+} wmem_arena_allocator_t;
+
+typedef struct {
+    wmem_arena_chunk_t *chunks;
+    unsigned            len;
+} wmem_arena_chunk_cache_t;
+
+static void
+wmem_arena_chunk_cache_free(void *data)
+{
+    wmem_arena_chunk_cache_t *cache = (wmem_arena_chunk_cache_t*) data;
+    wmem_arena_chunk_t       *cur, *nxt;
+
+    cur = cache->chunks;
+    while (cur) {
+        nxt = cur->next;
+        wmem_free(NULL, cur);
+        cur = nxt;
+    }
+
+    wmem_free(NULL, cache);
+}
+
+/* A GPrivate rather than a thread-local variable, so that the chunks cached
+ * by a worker thread are freed when it exits. */
+static GPrivate chunk_cache_key = G_PRIVATE_INIT(wmem_arena_chunk_cache_free);
+
+static wmem_arena_chunk_t *
+wmem_arena_chunk_get(void)
+{
+    wmem_arena_chunk_cache_t *cache;
+    wmem_arena_chunk_t       *chunk;
+
+    cache = (wmem_arena_chunk_cache_t*) g_private_get(&chunk_cache_key);
+    if (cache && cache->chunks) {
+        chunk = cache->chunks;
+        cache->chunks = chunk->next;
+        cache->len--;
+    }
+    else {
+        chunk = (wmem_arena_chunk_t *)wmem_alloc(NULL, WMEM_ARENA_CHUNK_SIZE);
+    }
+
+    chunk->next = NULL;
+    return chunk;
+}
+
+static void
+wmem_arena_chunk_put(wmem_arena_chunk_t *chunk)
+{
+    wmem_arena_chunk_cache_t *cache;
+
+    cache = (wmem_arena_chunk_cache_t*) g_private_get(&chunk_cache_key);
+    if (!cache) {
+        cache = wmem_new0(NULL, wmem_arena_chunk_cache_t);
+        g_private_set(&chunk_cache_key, cache);
+    }
+
+    if (cache->len < WMEM_ARENA_CACHE_MAX) {
+        chunk->next = cache->chunks;
+        cache->chunks = chunk;
+        cache->len++;
+    }
+    else {
+        wmem_free(NULL, chunk);
+    }
+}
+
+/* Moves to the next retained chunk, or appends a new one. */
+static void
+wmem_arena_next_chunk(wmem_arena_allocator_t *arena)
+{
+    wmem_arena_chunk_t *chunk;
+
+    if (arena->current && arena->current->next) {
+        chunk = arena->current->next;
+    }
+    else {
+        chunk = wmem_arena_chunk_get();
+        if (arena->current) {
+            arena->current->next = chunk;
+        }
+        else {
+            arena->chunk_list = chunk;
+        }
+    }
+
+    arena->current = chunk;
+    arena->pos     = WMEM_ARENA_CHUNK_DATA(chunk);
+    arena->end     = WMEM_ARENA_CHUNK_END(chunk);
+}
+
+/* Returns the in-use chunk containing ptr, or NULL if ptr is a jumbo
+ * allocation. */
+static wmem_arena_chunk_t *
+wmem_arena_find_chunk(wmem_arena_allocator_t *arena, const uint8_t *ptr)
+{
+    wmem_arena_chunk_t *chunk;
+
+    for (chunk = arena->chunk_list; chunk; chunk = chunk->next) {
+        if (ptr >= WMEM_ARENA_CHUNK_DATA(chunk) && ptr < WMEM_ARENA_CHUNK_END(chunk)) {
+            return chunk;
+        }
+        if (chunk == arena->current) {
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+static void *
+wmem_arena_alloc_jumbo(wmem_arena_allocator_t *arena, const size_t size)
+{
+    wmem_arena_jumbo_t *jumbo;
+
+    jumbo = (wmem_arena_jumbo_t *)wmem_alloc(NULL,
+            size + WMEM_ARENA_JUMBO_HEADER_SIZE);
+    jumbo->size = size;
+    arena->bytes_used += size;
+
+    jumbo->prev = NULL;
+    jumbo->next = arena->jumbo_list;
+    if (jumbo->next) {
+        jumbo->next->prev = jumbo;
+    }
+    arena->jumbo_list = jumbo;
+
+    return WMEM_ARENA_JUMBO_TO_DATA(jumbo);
+}
+
+static void
+wmem_arena_free_jumbo(wmem_arena_allocator_t *arena, wmem_arena_jumbo_t *jumbo)
+{
+    if (jumbo->prev) {
+        jumbo->prev->next = jumbo->next;
+    }
+    else {
+        arena->jumbo_list = jumbo->next;
+    }
+    if (jumbo->next) {
+        jumbo->next->prev = jumbo->prev;
+    }
+
+    wmem_free(NULL, jumbo);
+}
+
+/* API */
+
+static void *
+wmem_arena_alloc(void *private_data, const size_t size)
+{
+    wmem_arena_allocator_t *arena = (wmem_arena_allocator_t*) private_data;
+    size_t                  real_size;
+
+    if (size > WMEM_ARENA_MAX_ALLOC_SIZE) {
+        return wmem_arena_alloc_jumbo(arena, size);
+    }
+
+    real_size = WMEM_ALIGN_SIZE(size);
+
+    if ((size_t)(arena->end - arena->pos) < real_size) {
+        wmem_arena_next_chunk(arena);
+    }
+
+    arena->last = arena->pos;
+    arena->pos += real_size;
+    arena->bytes_used += real_size;
+
+    return arena->last;
+}
+
+static void
+wmem_arena_free(void *private_data, void *ptr)
+{
+    wmem_arena_allocator_t *arena = (wmem_arena_allocator_t*) private_data;
+
+    if ((uint8_t *)ptr == arena->last) {
+        /* freeing the most recent allocation just rewinds the pointer */
+        arena->pos  = arena->last;
+        arena->last = NULL;
+        return;
+    }
+
+    if (arena->jumbo_list && !wmem_arena_find_chunk(arena, (uint8_t *)ptr)) {
+        wmem_arena_free_jumbo(arena, WMEM_ARENA_DATA_TO_JUMBO(ptr));
+    }
+
+    /* anything else is released by the next free_all */
+}
+
+static void *
+wmem_arena_realloc(void *private_data, void *ptr, const size_t size)
+{
+    wmem_arena_allocator_t *arena = (wmem_arena_allocator_t*) private_data;
+    wmem_arena_chunk_t     *chunk;
+    wmem_arena_jumbo_t     *jumbo;
+    uint8_t                *old = (uint8_t *)ptr;
+    size_t                  avail;
+    void                   *newptr;
+
+    if (old == arena->last && size <= WMEM_ARENA_MAX_ALLOC_SIZE &&
+            (size_t)(arena->end - old) >= WMEM_ALIGN_SIZE(size)) {
+        if (old + WMEM_ALIGN_SIZE(size) > arena->pos) {
+            arena->bytes_used += (size_t)(old + WMEM_ALIGN_SIZE(size) - arena->pos);
+        }
+        arena->pos = old + WMEM_ALIGN_SIZE(size);
+        return ptr;
+    }
+
+    chunk = wmem_arena_find_chunk(arena, old);
+
+    if (chunk) {
+        /* We don't know how big the old object was, only that it can't
+         * extend past the used part of its chunk. Allocating first is fine:
+         * free is (mostly) a no-op and the old bytes stay where they are. */
+        if (chunk == arena->current) {
+            avail = (size_t)(arena->pos - old);
+        }
+        else {
+            avail = (size_t)(WMEM_ARENA_CHUNK_END(chunk) - old);
+        }
+
+        newptr = wmem_arena_alloc(private_data, size);
+        memcpy(newptr, ptr, MIN(size, avail));
+
+        return newptr;
+    }
+
+    /* jumbo allocation */
+    jumbo = WMEM_ARENA_DATA_TO_JUMBO(ptr);
+    if (size > jumbo->size) {
+        arena->bytes_used += size - jumbo->size;
+    }
+    jumbo = (wmem_arena_jumbo_t *)wmem_realloc(NULL, jumbo,
+            size + WMEM_ARENA_JUMBO_HEADER_SIZE);
+    jumbo->size = size;
+    if (jumbo->prev) {
+        jumbo->prev->next = jumbo;
+    }
+    else {
+        arena->jumbo_list = jumbo;
+    }
+    if (jumbo->next) {
+        jumbo->next->prev = jumbo;
+    }
+
+    return WMEM_ARENA_JUMBO_TO_DATA(jumbo);
+}
+
+static void
+wmem_arena_free_all(void *private_data)
+{
+    wmem_arena_allocator_t *arena = (wmem_arena_allocator_t*) private_data;
+    wmem_arena_jumbo_t     *cur, *nxt;
+
+    /* rewind to the first chunk, keeping all of them */
+    arena->current = arena->chunk_list;
+    if (arena->current) {
+        arena->pos = WMEM_ARENA_CHUNK_DATA(arena->current);
+        arena->end = WMEM_ARENA_CHUNK_END(arena->current);
+    }
+    else {
+        arena->pos = NULL;
+        arena->end = NULL;
+    }
+    arena->last = NULL;
+
+    cur = arena->jumbo_list;
+    while (cur) {
+        nxt = cur->next;
+        wmem_free(NULL, cur);
+        cur = nxt;
+    }
+    arena->jumbo_list = NULL;
+}
+
+static void
+wmem_arena_gc(void *private_data)
+{
+    wmem_arena_allocator_t *arena = (wmem_arena_allocator_t*) private_data;
+    wmem_arena_chunk_t     *cur, *nxt;
+
+    if (!arena->current) {
+        return;
+    }
+
+    /* give back the chunks that aren't currently in use */
+    cur = arena->current->next;
+    arena->current->next = NULL;
+
+    while (cur) {
+        nxt = cur->next;
+        wmem_arena_chunk_put(cur);
+        cur = nxt;
+    }
+}
+
+static void
+wmem_arena_allocator_cleanup(void *private_data)
+{
+    wmem_arena_allocator_t *arena = (wmem_arena_allocator_t*) private_data;
+    wmem_arena_chunk_t     *cur, *nxt;
+
+    /* wmem guarantees that free_all() is called directly before this, so
+     * only the chunks are left */
+    cur = arena->chunk_list;
+    while (cur) {
+        nxt = cur->next;
+        wmem_arena_chunk_put(cur);
+        cur = nxt;
+    }
+
+    wmem_free(NULL, private_data);
+}
+
+void
+wmem_arena_allocator_cleanup_cache(void)
+{
+    /* frees the calling thread's cache; other threads free theirs when they
+     * exit */
+    g_private_replace(&chunk_cache_key, NULL);
+}
+
+static uint64_t
+wmem_arena_bytes_used(void *private_data)
+{
+    return ((wmem_arena_allocator_t*) private_data)->bytes_used;
+}
+
+void
+wmem_arena_allocator_init(wmem_allocator_t *allocator)
+{
+    wmem_arena_allocator_t *arena;
+
+    arena = wmem_new0(NULL, wmem_arena_allocator_t);
+
+    allocator->walloc   = &wmem_arena_alloc;
+    allocator->wrealloc = &wmem_arena_realloc;
+    allocator->wfree    = &wmem_arena_free;
+
+    allocator->free_all = &wmem_arena_free_all;
+    allocator->gc       = &wmem_arena_gc;
+    allocator->cleanup  = &wmem_arena_allocator_cleanup;
+
+    allocator->bytes_used = &wmem_arena_bytes_used;
+
+    allocator->private_data = (void*) arena;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -21,6 +21,7 @@
 #include "wmem_allocator_simple.h"
 #include "wmem_allocator_block.h"
 #include "wmem_allocator_block_fast.h"
+#include "wmem_allocator_arena.h"
 #include "wmem_allocator_strict.h"
 
 /* Set according to the WIRESHARK_DEBUG_WMEM_OVERRIDE environment variable in
@@ -28,6 +29,11 @@
 static bool do_override;
 static wmem_allocator_type_t override_type;
 
+/* Whether wmem_alloc() and wmem_realloc() have to count the bytes
+ * requested, rather than the allocator counting what it hands out. */
+#define WMEM_COUNT_REQUESTED(allocator) \
+    ((allocator)->count_bytes && (allocator)->bytes_used == NULL)
+
 void *
 wmem_alloc(wmem_allocator_t *allocator, const size_t size)
 {
@@ -41,6 +47,10 @@ wmem_alloc(wmem_allocator_t *allocator, const size_t size)
         return NULL;
     }
 
+    if (G_UNLIKELY(WMEM_COUNT_REQUESTED(allocator))) {
+        allocator->bytes_allocated += size;
+    }
+
     return allocator->walloc(allocator->private_data, size);
 }
 
@@ -93,6 +103,11 @@ wmem_realloc(wmem_allocator_t *allocator, void *ptr, const size_t size)
 
     ws_assert(allocator->in_scope);
 
+    if (G_UNLIKELY(WMEM_COUNT_REQUESTED(allocator))) {
+        /* The size of the original object isn't known. */
+        allocator->bytes_allocated += size;
+    }
+
     return allocator->wrealloc(allocator->private_data, ptr, size);
 }
 
@@ -110,6 +125,36 @@ wmem_free_all(wmem_allocator_t *allocator)
     wmem_free_all_real(allocator, false);
 }
 
+void
+wmem_count_bytes_allocated(wmem_allocator_t *allocator, bool count)
+{
+    if (count == allocator->count_bytes) {
+        return;
+    }
+
+    if (allocator->bytes_used) {
+        uint64_t used = allocator->bytes_used(allocator->private_data);
+
+        if (count) {
+            allocator->bytes_used_start = used;
+        }
+        else {
+            allocator->bytes_allocated += used - allocator->bytes_used_start;
+        }
+    }
+    allocator->count_bytes = count;
+}
+
+uint64_t
+wmem_bytes_allocated(wmem_allocator_t *allocator)
+{
+    if (allocator->count_bytes && allocator->bytes_used) {
+        return allocator->bytes_allocated +
+            allocator->bytes_used(allocator->private_data) - allocator->bytes_used_start;
+    }
+    return allocator->bytes_allocated;
+}
+
 void
 wmem_gc(wmem_allocator_t *allocator)
 {
@@ -121,6 +166,7 @@ wmem_destroy_allocator(wmem_allocator_t *allocator)
 {
 
     wmem_free_all_real(allocator, true);
+    wmem_count_bytes_allocated(allocator, false);
     allocator->cleanup(allocator->private_data);
     wmem_free(NULL, allocator);
 }
@@ -142,6 +188,10 @@ wmem_allocator_new(const wmem_allocator_type_t type)
     allocator->type      = real_type;
     allocator->callbacks = NULL;
     allocator->in_scope  = true;
+    allocator->bytes_used = NULL;
+    allocator->bytes_allocated = 0;
+    allocator->count_bytes = false;
+    allocator->bytes_used_start = 0;
 
     switch (real_type) {
         case WMEM_ALLOCATOR_SIMPLE:
@@ -153,6 +203,9 @@ wmem_allocator_new(const wmem_allocator_type_t type)
         case WMEM_ALLOCATOR_BLOCK_FAST:
             wmem_block_fast_allocator_init(allocator);
             break;
+        case WMEM_ALLOCATOR_ARENA:
+            wmem_arena_allocator_init(allocator);
+            break;
         case WMEM_ALLOCATOR_STRICT:
             wmem_strict_allocator_init(allocator);
             break;
@@ -192,6 +245,9 @@ wmem_init(void)
         else if (strncmp(override_env, "block_fast", strlen("block_fast")) == 0) {
             override_type = WMEM_ALLOCATOR_BLOCK_FAST;
         }
+        else if (strncmp(override_env, "arena", strlen("arena")) == 0) {
+            override_type = WMEM_ALLOCATOR_ARENA;
+        }
         else {
             g_warning("Unrecognized wmem override");
             do_override = false;
@@ -204,6 +260,7 @@ wmem_init(void)
 void
 wmem_cleanup(void)
 {
+    wmem_arena_allocator_cleanup_cache();
 }
 
 void
@@ -57,11 +57,16 @@ typedef enum _wmem_allocator_type_t {
                 memory usage via things like canaries and scrubbing freed
                 memory. Valgrind is the better choice on platforms that support
                 it. */
-    WMEM_ALLOCATOR_BLOCK_FAST /**< A block allocator like WMEM_ALLOCATOR_BLOCK
+    WMEM_ALLOCATOR_BLOCK_FAST, /**< A block allocator like WMEM_ALLOCATOR_BLOCK
                 but even faster by tracking absolutely minimal metadata and
                 making 'free' a no-op. Useful only for very short-lived scopes
                 where there's no reason to free individual allocations because
                 the next free_all is always just around the corner. */
+    WMEM_ALLOCATOR_ARENA /**< A bump-pointer allocator for the packet scope.
+                Allocations carry no header at all, free_all only rewinds to
+                the first chunk and keeps the others for reuse, and chunks are
+                recycled between pools on the same thread. As with
+                WMEM_ALLOCATOR_BLOCK_FAST, 'free' is (almost) a no-op. */
 } wmem_allocator_type_t;
 
 /** Allocate the requested amount of memory in the given pool.
@@ -176,6 +181,31 @@ WS_DLL_PUBLIC
 void
 wmem_free_all(wmem_allocator_t *allocator);
 
+/** Starts or stops counting the bytes allocated from a pool, for
+ * wmem_bytes_allocated(). Counting is off by default.
+ *
+ * @param allocator The allocator to count the bytes of.
+ * @param count true to count them.
+ */
+WS_DLL_PUBLIC
+void
+wmem_count_bytes_allocated(wmem_allocator_t *allocator, bool count);
+
+/** Returns the total number of bytes allocated from a pool while counting
+ * them was enabled with wmem_count_bytes_allocated(). Arena pools report
+ * the (aligned) bytes they hand out, and a realloc they can grow in place
+ * counts only what it adds; other pools count the bytes requested with
+ * wmem_alloc() and wmem_realloc(), a realloc counting its whole new size.
+ * The counter is not reset by wmem_free_all(), so callers interested in
+ * an interval should take the difference of two readings.
+ *
+ * @param allocator The allocator to query.
+ * @return The number of bytes requested so far.
+ */
+WS_DLL_PUBLIC
+uint64_t
+wmem_bytes_allocated(wmem_allocator_t *allocator);
+
 /** Triggers a garbage-collection in the allocator. This does not free any
  * memory, but it can return unused blocks to the operating system or perform
  * other optimizations.
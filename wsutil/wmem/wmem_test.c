@@ -19,6 +19,7 @@
 #include "wmem_allocator.h"
 #include "wmem_allocator_block.h"
 #include "wmem_allocator_block_fast.h"
+#include "wmem_allocator_arena.h"
 #include "wmem_allocator_simple.h"
 #include "wmem_allocator_strict.h"
 
@@ -43,6 +44,10 @@ wmem_allocator_force_new(const wmem_allocator_type_t type)
     allocator->type = type;
     allocator->callbacks = NULL;
     allocator->in_scope = true;
+    allocator->bytes_used = NULL;
+    allocator->bytes_allocated = 0;
+    allocator->count_bytes = false;
+    allocator->bytes_used_start = 0;
 
     switch (type) {
         case WMEM_ALLOCATOR_SIMPLE:
@@ -54,6 +59,9 @@ wmem_allocator_force_new(const wmem_allocator_type_t type)
         case WMEM_ALLOCATOR_BLOCK_FAST:
             wmem_block_fast_allocator_init(allocator);
             break;
+        case WMEM_ALLOCATOR_ARENA:
+            wmem_arena_allocator_init(allocator);
+            break;
         case WMEM_ALLOCATOR_STRICT:
             wmem_strict_allocator_init(allocator);
             break;
@@ -266,6 +274,7 @@ wmem_test_allocator(wmem_allocator_type_t type, wmem_verify_func verify,
     int i;
     char *ptrs[MAX_SIMULTANEOUS_ALLOCS];
     wmem_allocator_t *allocator;
+    uint64_t before;
 
     allocator = wmem_allocator_force_new(type);
 
@@ -279,9 +288,24 @@ wmem_test_allocator(wmem_allocator_type_t type, wmem_verify_func verify,
 
     wmem_test_allocator_det(allocator, verify, 512);
 
+    /* Not counted by default */
+    before = wmem_bytes_allocated(allocator);
+    ptrs[0] = (char *)wmem_alloc(allocator, 32);
+    g_assert_true(wmem_bytes_allocated(allocator) == before);
+    wmem_free(allocator, ptrs[0]);
+
+    wmem_count_bytes_allocated(allocator, true);
     for (i=0; i<MAX_SIMULTANEOUS_ALLOCS; i++) {
         ptrs[i] = wmem_alloc0_array(allocator, char, 32);
     }
+    g_assert_true(wmem_bytes_allocated(allocator) - before ==
+            MAX_SIMULTANEOUS_ALLOCS * 32);
+    /* A realloc counts at least what it adds, and at most its new size */
+    before = wmem_bytes_allocated(allocator);
+    ptrs[0] = (char *)wmem_realloc(allocator, ptrs[0], 48);
+    g_assert_true(wmem_bytes_allocated(allocator) - before >= 16);
+    g_assert_true(wmem_bytes_allocated(allocator) - before <= 48);
+    wmem_count_bytes_allocated(allocator, false);
 
     if (verify) (*verify)(allocator);
     wmem_free_all(allocator);
@@ -353,6 +377,58 @@ wmem_test_allocator_block_fast(void)
     wmem_test_allocator_jumbo(WMEM_ALLOCATOR_BLOCK, NULL);
 }
 
+static void *
+wmem_test_allocator_arena_thread(void *data _U_)
+{
+    wmem_allocator_t *allocator;
+
+    /* leaves a chunk in this thread's cache, which is freed when the
+     * thread exits (as leak checkers will tell) */
+    allocator = wmem_allocator_force_new(WMEM_ALLOCATOR_ARENA);
+    wmem_alloc(allocator, 8);
+    wmem_destroy_allocator(allocator);
+
+    return NULL;
+}
+
+static void
+wmem_test_allocator_arena(void)
+{
+    wmem_allocator_t *allocator;
+    GThread *thread;
+    char *ptr, *ptr1;
+
+    wmem_test_allocator(WMEM_ALLOCATOR_ARENA, NULL,
+            MAX_SIMULTANEOUS_ALLOCS*4);
+    wmem_test_allocator_jumbo(WMEM_ALLOCATOR_ARENA, NULL);
+
+    allocator = wmem_allocator_force_new(WMEM_ALLOCATOR_ARENA);
+
+    /* the most recent allocation grows in place and keeps its contents */
+    ptr = (char *)wmem_strdup(allocator, STRING_80);
+    ptr1 = (char *)wmem_realloc(allocator, ptr, 200);
+    g_assert_true(ptr1 == ptr);
+    g_assert_cmpstr(ptr1, ==, STRING_80);
+
+    /* older allocations are copied */
+    ptr = (char *)wmem_alloc0(allocator, 8);
+    ptr1 = (char *)wmem_realloc(allocator, ptr1, 400);
+    g_assert_true(ptr1 != ptr);
+    g_assert_cmpstr(ptr1, ==, STRING_80);
+
+    /* free_all keeps the chunks, so we start over at the same address */
+    wmem_free_all(allocator);
+    ptr = (char *)wmem_alloc(allocator, 8);
+    wmem_free_all(allocator);
+    ptr1 = (char *)wmem_alloc(allocator, 8);
+    g_assert_true(ptr1 == ptr);
+
+    wmem_destroy_allocator(allocator);
+
+    thread = g_thread_new("wmem arena", wmem_test_allocator_arena_thread, NULL);
+    g_thread_join(thread);
+}
+
 static void
 wmem_test_allocator_simple(void)
 {
@@ -628,6 +704,55 @@ wmem_test_stringperf(void)
     g_free(str_ptr);
 }
 
+/* Mimics the packet scope: a few hundred small objects of typical tree node
+ * and field_info sizes, some strings and a growing buffer, then free_all. */
+static void
+wmem_test_allocatorperf(void)
+{
+#define PERF_PACKET_COUNT    (200 * 1000)
+#define PERF_ALLOCS_PER_PKT  200
+    static const size_t sizes[] = { 48, 88, 16, 24, 48, 88, 32, 64, 48, 88, 128, 40 };
+    static const struct {
+        wmem_allocator_type_t type;
+        const char *name;
+    } types[] = {
+        { WMEM_ALLOCATOR_SIMPLE,     "simple" },
+        { WMEM_ALLOCATOR_BLOCK,      "block" },
+        { WMEM_ALLOCATOR_BLOCK_FAST, "block_fast" },
+        { WMEM_ALLOCATOR_ARENA,      "arena" },
+    };
+    wmem_allocator_t   *allocator;
+    wmem_strbuf_t      *strbuf;
+    char               *ptr;
+    unsigned            t, p, i;
+    double              start_utime, start_stime, end_utime, end_stime, utime_ms, stime_ms;
+
+    for (t = 0; t < G_N_ELEMENTS(types); t++) {
+        allocator = wmem_allocator_force_new(types[t].type);
+
+        RESOURCE_USAGE_START;
+        for (p = 0; p < PERF_PACKET_COUNT; p++) {
+            for (i = 0; i < PERF_ALLOCS_PER_PKT; i++) {
+                ptr = (char *)wmem_alloc(allocator, sizes[i % G_N_ELEMENTS(sizes)]);
+                ptr[0] = (char)i;
+            }
+            for (i = 0; i < 10; i++) {
+                wmem_strdup(allocator, STRING_80);
+            }
+            strbuf = wmem_strbuf_new(allocator, "");
+            for (i = 0; i < 20; i++) {
+                wmem_strbuf_append(strbuf, "0123456789abcdef");
+            }
+            wmem_free_all(allocator);
+        }
+        RESOURCE_USAGE_END;
+        g_test_minimized_result(utime_ms + stime_ms,
+            "%s: u %.3f ms s %.3f ms", types[t].name, utime_ms, stime_ms);
+
+        wmem_destroy_allocator(allocator);
+    }
+}
+
 /* DATA STRUCTURE TESTING FUNCTIONS (/wmem/datastruct/) */
 
 static void
@@ -1467,6 +1592,7 @@ main(int argc, char **argv)
 
     g_test_add_func("/wmem/allocator/block",     wmem_test_allocator_block);
     g_test_add_func("/wmem/allocator/blk_fast",  wmem_test_allocator_block_fast);
+    g_test_add_func("/wmem/allocator/arena",     wmem_test_allocator_arena);
     g_test_add_func("/wmem/allocator/simple",    wmem_test_allocator_simple);
     g_test_add_func("/wmem/allocator/strict",    wmem_test_allocator_strict);
     g_test_add_func("/wmem/allocator/callbacks", wmem_test_allocator_callbacks);
@@ -1476,6 +1602,7 @@ main(int argc, char **argv)
 
     if (g_test_perf()) {
         g_test_add_func("/wmem/utils/stringperf", wmem_test_stringperf);
+        g_test_add_func("/wmem/allocator/perf",   wmem_test_allocatorperf);
     }
 
     g_test_add_func("/wmem/datastruct/array",  wmem_test_array);
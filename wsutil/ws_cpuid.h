@@ -128,7 +128,7 @@ ws_cpuid(uint32_t *CPUInfo _U_, int selector _U_)
 }
 #endif
 
-static int
+static inline int
 ws_cpuid_sse42(void)
 {
 	uint32_t CPUInfo[4];
@@ -139,3 +139,89 @@ ws_cpuid_sse42(void)
 	/* in ECX bit 20 toggled on */
 	return (CPUInfo[2] & (1 << 20));
 }
+
+/*
+ * Get the value of XCR0, which says which register state the OS saves,
+ * or 0 if it can't be read.  Only call this if cpuid says that the
+ * processor supports the xgetbv instruction and that the OS has enabled
+ * it (OSXSAVE).
+ */
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#include <immintrin.h>
+
+static inline uint64_t
+ws_xgetbv0(void)
+{
+	return _xgetbv(0);
+}
+#elif defined(__GNUC__) && defined(__x86_64__)
+static inline uint64_t
+ws_xgetbv0(void)
+{
+	uint32_t eax, edx;
+
+	__asm__ __volatile__("xgetbv"
+						: "=a" (eax),
+							"=d" (edx)
+						: "c" (0));
+	return ((uint64_t)edx << 32) | eax;
+}
+#else
+static inline uint64_t
+ws_xgetbv0(void)
+{
+	return 0;
+}
+#endif
+
+static inline int
+ws_cpuid_avx2(void)
+{
+	uint32_t CPUInfo[4];
+
+	if (!ws_cpuid(CPUInfo, 1))
+		return 0;
+
+	/* in ECX bits 27 (OSXSAVE) and 28 (AVX) toggled on */
+	if ((CPUInfo[2] & ((1 << 27) | (1 << 28))) != ((1 << 27) | (1 << 28)))
+		return 0;
+
+	/* the OS saves the XMM and YMM registers */
+	if ((ws_xgetbv0() & 0x6) != 0x6)
+		return 0;
+
+	if (!ws_cpuid(CPUInfo, 7))
+		return 0;
+
+	/* in EBX bit 5 toggled on */
+	return (CPUInfo[1] & (1 << 5));
+}
+
+static inline int
+ws_cpuid_pclmul(void)
+{
+	uint32_t CPUInfo[4];
+
+	if (!ws_cpuid(CPUInfo, 1))
+		return 0;
+
+	/* in ECX bits 1 (PCLMULQDQ) and 19 (SSE4.1) toggled on */
+	return (CPUInfo[2] & ((1 << 1) | (1 << 19))) == ((1 << 1) | (1 << 19));
+}
+
+/*
+ * Defines "static bool name(void)", which returns whether probe(), one of
+ * the ws_cpuid_ routines above, found the feature.  The CPU is only probed
+ * on the first call; a race between threads making that first call only
+ * means it's probed more than once.
+ */
+#define WS_CPUID_CACHED(name, probe) \
+static bool \
+name(void) \
+{ \
+	static int cached = -1; \
+ \
+	if (cached == -1) \
+		cached = probe() ? 1 : 0; \
+	return cached; \
+}
@@ -0,0 +1,157 @@
+/* ws_memfind.c
+ * Searches for one of two bytes, or for a pair of bytes, in a buffer,
+ * with SSE2 or AVX2 where the processor has them.
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include "ws_memfind.h"
+#include "ws_memfind_int.h"
+
+#include <string.h>
+
+#include "bits_ctz.h"
+
+#ifdef HAVE_AVX2
+#include "ws_cpuid.h"
+#endif
+
+/* SSE2 is part of x86-64, so it needs neither a compiler flag nor a check. */
+#if defined(__x86_64__) || defined(_M_X64)
+#define WS_MEMFIND_SSE2
+#include <emmintrin.h>
+#endif
+
+const uint8_t *
+ws_memchr2_portable(const uint8_t* haystack, size_t haystacklen, uint8_t c1, uint8_t c2)
+{
+	const uint8_t *haystack_end = haystack + haystacklen;
+
+	while (haystack < haystack_end) {
+		if (*haystack == c1 || *haystack == c2)
+			return haystack;
+		haystack++;
+	}
+
+	return NULL;
+}
+
+const uint8_t *
+ws_mempair_portable(const uint8_t* haystack, size_t haystacklen, uint8_t c1, uint8_t c2)
+{
+	const uint8_t *haystack_end = haystack + haystacklen;
+	const uint8_t *p;
+
+	while (haystack_end - haystack >= 2) {
+		p = (const uint8_t *)memchr(haystack, c1, haystack_end - haystack - 1);
+		if (p == NULL)
+			return NULL;
+		if (p[1] == c2)
+			return p;
+		haystack = p + 1;
+	}
+
+	return NULL;
+}
+
+#ifdef WS_MEMFIND_SSE2
+static const uint8_t *
+ws_memchr2_sse2(const uint8_t* haystack, size_t haystacklen, uint8_t c1, uint8_t c2)
+{
+	const uint8_t *haystack_end = haystack + haystacklen;
+	const __m128i v1 = _mm_set1_epi8((char)c1);
+	const __m128i v2 = _mm_set1_epi8((char)c2);
+	__m128i data;
+	unsigned mask;
+
+	while (haystack_end - haystack >= 16) {
+		data = _mm_loadu_si128((const __m128i *)(const void *)haystack);
+		mask = (unsigned)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(data, v1),
+								_mm_cmpeq_epi8(data, v2)));
+		if (mask)
+			return haystack + ws_ctz(mask);
+		haystack += 16;
+	}
+
+	return ws_memchr2_portable(haystack, haystack_end - haystack, c1, c2);
+}
+
+static const uint8_t *
+ws_mempair_sse2(const uint8_t* haystack, size_t haystacklen, uint8_t c1, uint8_t c2)
+{
+	const uint8_t *haystack_end = haystack + haystacklen;
+	const __m128i v1 = _mm_set1_epi8((char)c1);
+	const __m128i v2 = _mm_set1_epi8((char)c2);
+	__m128i first, second;
+	unsigned mask;
+
+	/* Compare each byte with c1 and the byte after it with c2. */
+	while (haystack_end - haystack >= 17) {
+		first = _mm_loadu_si128((const __m128i *)(const void *)haystack);
+		second = _mm_loadu_si128((const __m128i *)(const void *)(haystack + 1));
+		mask = (unsigned)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, v1),
+								 _mm_cmpeq_epi8(second, v2)));
+		if (mask)
+			return haystack + ws_ctz(mask);
+		haystack += 16;
+	}
+
+	return ws_mempair_portable(haystack, haystack_end - haystack, c1, c2);
+}
+#endif
+
+#ifdef HAVE_AVX2
+WS_CPUID_CACHED(ws_memfind_use_avx2, ws_cpuid_avx2)
+#endif
+
+const uint8_t *
+ws_memchr2(const uint8_t* haystack, size_t haystacklen, uint8_t c1, uint8_t c2)
+{
+	if (c1 == c2)
+		return (const uint8_t *)memchr(haystack, c1, haystacklen);
+
+#ifdef HAVE_AVX2
+	if (haystacklen >= 32 && ws_memfind_use_avx2())
+		return ws_memchr2_avx2(haystack, haystacklen, c1, c2);
+#endif
+#ifdef WS_MEMFIND_SSE2
+	if (haystacklen >= 16)
+		return ws_memchr2_sse2(haystack, haystacklen, c1, c2);
+#endif
+
+	return ws_memchr2_portable(haystack, haystacklen, c1, c2);
+}
+
+const uint8_t *
+ws_mempair(const uint8_t* haystack, size_t haystacklen, uint8_t c1, uint8_t c2)
+{
+#ifdef HAVE_AVX2
+	if (haystacklen >= 33 && ws_memfind_use_avx2())
+		return ws_mempair_avx2(haystack, haystacklen, c1, c2);
+#endif
+#ifdef WS_MEMFIND_SSE2
+	if (haystacklen >= 17)
+		return ws_mempair_sse2(haystack, haystacklen, c1, c2);
+#endif
+
+	return ws_mempair_portable(haystack, haystacklen, c1, c2);
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
@@ -0,0 +1,37 @@
+/** @file
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __WS_MEMFIND_H__
+#define __WS_MEMFIND_H__
+
+#include <wireshark.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/** Find the first byte of the haystack that's either c1 or c2, like
+ * memchr() with two needles.
+ *
+ * @return A pointer to the byte, or NULL if there's none.
+ */
+WS_DLL_PUBLIC const uint8_t *ws_memchr2(const uint8_t* haystack, size_t haystacklen, uint8_t c1, uint8_t c2);
+
+/** Find the first occurrence of the byte c1 followed by the byte c2 in
+ * the haystack.
+ *
+ * @return A pointer to c1, or NULL if the pair doesn't occur.
+ */
+WS_DLL_PUBLIC const uint8_t *ws_mempair(const uint8_t* haystack, size_t haystacklen, uint8_t c1, uint8_t c2);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __WS_MEMFIND_H__ */
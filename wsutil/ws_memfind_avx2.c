@@ -0,0 +1,80 @@
+/* ws_memfind_avx2.c
+ * AVX2 versions of the searches in ws_memfind.c; this file is compiled
+ * with AVX2 enabled, and its routines are only called if the processor
+ * and OS support AVX2.
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#ifdef HAVE_AVX2
+
+#include <immintrin.h>
+
+#include "ws_memfind.h"
+#include "ws_memfind_int.h"
+#include "bits_ctz.h"
+
+const uint8_t *
+ws_memchr2_avx2(const uint8_t* haystack, size_t haystacklen, uint8_t c1, uint8_t c2)
+{
+	const uint8_t *haystack_end = haystack + haystacklen;
+	const __m256i v1 = _mm256_set1_epi8((char)c1);
+	const __m256i v2 = _mm256_set1_epi8((char)c2);
+	__m256i data;
+	uint32_t mask;
+
+	while (haystack_end - haystack >= 32) {
+		data = _mm256_loadu_si256((const __m256i *)(const void *)haystack);
+		mask = (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(data, v1),
+								      _mm256_cmpeq_epi8(data, v2)));
+		if (mask)
+			return haystack + ws_ctz(mask);
+		haystack += 32;
+	}
+
+	return ws_memchr2_portable(haystack, haystack_end - haystack, c1, c2);
+}
+
+const uint8_t *
+ws_mempair_avx2(const uint8_t* haystack, size_t haystacklen, uint8_t c1, uint8_t c2)
+{
+	const uint8_t *haystack_end = haystack + haystacklen;
+	const __m256i v1 = _mm256_set1_epi8((char)c1);
+	const __m256i v2 = _mm256_set1_epi8((char)c2);
+	__m256i first, second;
+	uint32_t mask;
+
+	/* Compare each byte with c1 and the byte after it with c2. */
+	while (haystack_end - haystack >= 33) {
+		first = _mm256_loadu_si256((const __m256i *)(const void *)haystack);
+		second = _mm256_loadu_si256((const __m256i *)(const void *)(haystack + 1));
+		mask = (uint32_t)_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(first, v1),
+								       _mm256_cmpeq_epi8(second, v2)));
+		if (mask)
+			return haystack + ws_ctz(mask);
+		haystack += 32;
+	}
+
+	return ws_mempair_portable(haystack, haystack_end - haystack, c1, c2);
+}
+
+#endif /* HAVE_AVX2 */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
@@ -0,0 +1,21 @@
+/** @file
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __WS_MEMFIND_INT_H__
+#define __WS_MEMFIND_INT_H__
+
+const uint8_t *ws_memchr2_portable(const uint8_t* haystack, size_t haystacklen, uint8_t c1, uint8_t c2);
+const uint8_t *ws_mempair_portable(const uint8_t* haystack, size_t haystacklen, uint8_t c1, uint8_t c2);
+
+#ifdef HAVE_AVX2
+const uint8_t *ws_memchr2_avx2(const uint8_t* haystack, size_t haystacklen, uint8_t c1, uint8_t c2);
+const uint8_t *ws_mempair_avx2(const uint8_t* haystack, size_t haystacklen, uint8_t c1, uint8_t c2);
+#endif
+
+#endif /* __WS_MEMFIND_INT_H__ */
@@ -24,6 +24,7 @@
 
 #include "ws_mempbrk.h"
 #include "ws_mempbrk_int.h"
+#include "ws_memfind.h"
 
 #include <string.h>
 
@@ -37,6 +38,10 @@ ws_mempbrk_compile(ws_mempbrk_pattern* pattern, const char *needles)
         n++;
     }
 
+    pattern->num_needles = (unsigned)(n - needles);
+    if (pattern->num_needles <= 2)
+        memcpy(pattern->needles, needles, pattern->num_needles);
+
 #ifdef HAVE_SSE4_2
     ws_mempbrk_sse42_compile(pattern, needles);
 #endif
@@ -64,6 +69,19 @@ ws_mempbrk_portable_exec(const uint8_t* haystack, size_t haystacklen, const ws_m
 WS_DLL_PUBLIC const uint8_t *
 ws_mempbrk_exec(const uint8_t* haystack, size_t haystacklen, const ws_mempbrk_pattern* pattern, unsigned char *found_needle)
 {
+    const uint8_t *result;
+
+    /* e.g. CR and LF, looking for the end of a line */
+    if (pattern->num_needles == 1 || pattern->num_needles == 2) {
+        if (pattern->num_needles == 1)
+            result = (const uint8_t *)memchr(haystack, pattern->needles[0], haystacklen);
+        else
+            result = ws_memchr2(haystack, haystacklen, pattern->needles[0], pattern->needles[1]);
+        if (result && found_needle)
+            *found_needle = *result;
+        return result;
+    }
+
 #ifdef HAVE_SSE4_2
     if (haystacklen >= 16 && pattern->use_sse42)
         return ws_mempbrk_sse42_exec(haystack, haystacklen, pattern, found_needle);
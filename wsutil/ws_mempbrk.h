@@ -20,6 +20,9 @@
  */
 typedef struct {
     char patt[256];
+    /* With one or two needles, they're searched for like memchr() does. */
+    unsigned num_needles;
+    uint8_t needles[2];
 #ifdef HAVE_SSE4_2
     bool use_sse42;
     __m128i mask;
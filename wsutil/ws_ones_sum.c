@@ -0,0 +1,135 @@
+/* ws_ones_sum.c
+ * One's complement sum of 16-bit words, for the Internet checksum, with
+ * SSE2 or AVX2 where the processor has them.
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include "ws_ones_sum.h"
+#include "ws_ones_sum_int.h"
+
+#include <string.h>
+
+#ifdef HAVE_AVX2
+#include "ws_cpuid.h"
+#endif
+
+/* SSE2 is part of x86-64, so it needs neither a compiler flag nor a check. */
+#if defined(__x86_64__) || defined(_M_X64)
+#define WS_ONES_SUM_SSE2
+#include <emmintrin.h>
+#endif
+
+/*
+ * The one's complement sum is the sum modulo 0xFFFF, so the carries out
+ * of the low 16 bits can be added back at the end rather than after
+ * each word.
+ */
+static uint16_t
+ones_sum_fold(uint64_t sum)
+{
+	while (sum >> 16)
+		sum = (sum & 0xffff) + (sum >> 16);
+	return (uint16_t)sum;
+}
+
+uint64_t
+ws_ones_sum_portable(const uint8_t *buf, size_t len)
+{
+	uint64_t sum = 0;
+	uint16_t word;
+
+	while (len >= 2) {
+		memcpy(&word, buf, sizeof word);
+		sum += word;
+		buf += 2;
+		len -= 2;
+	}
+	if (len) {
+		uint8_t last[2] = { *buf, 0 };
+
+		memcpy(&word, last, sizeof word);
+		sum += word;
+	}
+
+	return sum;
+}
+
+#ifdef WS_ONES_SUM_SSE2
+/* Each 32-bit lane gets two words per 16 bytes */
+#define SSE2_BATCH	32768
+
+static uint64_t
+ws_ones_sum_sse2(const uint8_t *buf, size_t len)
+{
+	const __m128i zero = _mm_setzero_si128();
+	__m128i data, acc;
+	uint32_t lanes[4];
+	uint64_t sum = 0;
+	size_t count;
+
+	while (len >= 16) {
+		count = MIN(len / 16, SSE2_BATCH);
+		len -= count * 16;
+
+		acc = zero;
+		while (count-- > 0) {
+			data = _mm_loadu_si128((const __m128i *)(const void *)buf);
+			acc = _mm_add_epi32(acc, _mm_unpacklo_epi16(data, zero));
+			acc = _mm_add_epi32(acc, _mm_unpackhi_epi16(data, zero));
+			buf += 16;
+		}
+
+		_mm_storeu_si128((__m128i *)(void *)lanes, acc);
+		sum += (uint64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+	}
+
+	return sum;
+}
+#endif
+
+#ifdef HAVE_AVX2
+WS_CPUID_CACHED(ws_ones_sum_use_avx2, ws_cpuid_avx2)
+#endif
+
+uint16_t
+ws_ones_sum16(const uint8_t *buf, size_t len)
+{
+	size_t vector_len = 0;
+	uint64_t sum = 0;
+
+#ifdef HAVE_AVX2
+	if (len >= 64 && ws_ones_sum_use_avx2()) {
+		vector_len = len & ~(size_t)31;
+		sum = ws_ones_sum_avx2(buf, vector_len);
+	}
+#endif
+#ifdef WS_ONES_SUM_SSE2
+	if (vector_len == 0 && len >= 32) {
+		vector_len = len & ~(size_t)15;
+		sum = ws_ones_sum_sse2(buf, vector_len);
+	}
+#endif
+
+	sum += ws_ones_sum_portable(buf + vector_len, len - vector_len);
+	return ones_sum_fold(sum);
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
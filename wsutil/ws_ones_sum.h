@@ -0,0 +1,34 @@
+/** @file
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __WS_ONES_SUM_H__
+#define __WS_ONES_SUM_H__
+
+#include <wireshark.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/** Compute the one's complement sum of the 16-bit words of a buffer, in
+ * host byte order, as used by the Internet checksum (RFC 1071).  If the
+ * length is odd, the last byte is padded with a zero byte after it.
+ *
+ * The sum is not inverted.  It's 0 only if all the words are 0; a
+ * non-zero sum that's a multiple of 0xFFFF is returned as 0xFFFF.
+ *
+ * @return The sum, in host byte order.
+ */
+WS_DLL_PUBLIC uint16_t ws_ones_sum16(const uint8_t *buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __WS_ONES_SUM_H__ */
@@ -0,0 +1,71 @@
+/* ws_ones_sum_avx2.c
+ * AVX2 version of the one's complement sum in ws_ones_sum.c; this file is
+ * compiled with AVX2 enabled, and its routines are only called if the
+ * processor and OS support AVX2.
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#ifdef HAVE_AVX2
+
+#include <immintrin.h>
+
+#include "ws_ones_sum.h"
+#include "ws_ones_sum_int.h"
+
+/*
+ * Each 32-bit lane of the accumulator gets two words per 32 bytes, so it
+ * can take this many vectors before it might overflow.
+ */
+#define AVX2_BATCH	32768
+
+uint64_t
+ws_ones_sum_avx2(const uint8_t *buf, size_t len)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i data, acc;
+	uint32_t lanes[8];
+	uint64_t sum = 0;
+	size_t count;
+
+	while (len >= 32) {
+		count = MIN(len / 32, AVX2_BATCH);
+		len -= count * 32;
+
+		/* Zero-extend the words to 32 bits and add them up. */
+		acc = zero;
+		while (count-- > 0) {
+			data = _mm256_loadu_si256((const __m256i *)(const void *)buf);
+			acc = _mm256_add_epi32(acc, _mm256_unpacklo_epi16(data, zero));
+			acc = _mm256_add_epi32(acc, _mm256_unpackhi_epi16(data, zero));
+			buf += 32;
+		}
+
+		_mm256_storeu_si256((__m256i *)(void *)lanes, acc);
+		for (int i = 0; i < 8; i++)
+			sum += lanes[i];
+	}
+
+	return sum;
+}
+
+#endif /* HAVE_AVX2 */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
@@ -0,0 +1,24 @@
+/** @file
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __WS_ONES_SUM_INT_H__
+#define __WS_ONES_SUM_INT_H__
+
+/*
+ * These return the plain sum of the 16-bit words, to be folded by the
+ * caller.  The vectorized ones only handle whole vectors, and ignore the
+ * rest of the buffer.
+ */
+uint64_t ws_ones_sum_portable(const uint8_t *buf, size_t len);
+
+#ifdef HAVE_AVX2
+uint64_t ws_ones_sum_avx2(const uint8_t *buf, size_t len);
+#endif
+
+#endif /* __WS_ONES_SUM_INT_H__ */